@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include <mbgl/storage/database_file_source.hpp>
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/storage/resource_options.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/util/client_options.hpp>
+#include <mbgl/util/run_loop.hpp>
+#include <mbgl/util/string.hpp>
+
+#include <cstdio>
+#include <random>
+
+// Latency of cache lookups while the database is busy storing the tiles of an
+// offline download. The argument is the number of read connections.
+static void DatabaseFileSource_GetTileDuringDownload(benchmark::State& state) {
+    using namespace mbgl;
+
+    util::RunLoop loop;
+
+    const std::string path = "benchmark/fixtures/offline_database/concurrent.db";
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::remove((path + suffix).c_str());
+    }
+
+    DatabaseFileSource dbfs(
+        ResourceOptions().withCachePath(path).withCacheReadConnections(static_cast<uint32_t>(state.range(0))),
+        ClientOptions());
+
+    const unsigned tileCount = 100;
+    Response tile;
+    tile.data = std::make_shared<std::string>(50 * 1024, 0);
+    for (unsigned i = 0; i < tileCount; ++i) {
+        dbfs.forward(Resource::tile("mapbox://tile" + util::toString(i), 1, 0, 0, 0, Tileset::Scheme::XYZ),
+                     tile,
+                     i + 1 == tileCount ? std::function<void()>([&] { loop.stop(); }) : nullptr);
+    }
+    loop.run();
+
+    Response download;
+    download.data = std::make_shared<std::string>(512 * 1024, 0);
+    unsigned downloaded = 0;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dis(0, tileCount - 1);
+
+    while (state.KeepRunning()) {
+        dbfs.put(Resource::tile("mapbox://download" + util::toString(downloaded++), 1, 0, 0, 0, Tileset::Scheme::XYZ),
+                 download);
+        auto req = dbfs.request(
+            Resource::tile("mapbox://tile" + util::toString(dis(gen)), 1, 0, 0, 0, Tileset::Scheme::XYZ),
+            [&](const Response&) { loop.stop(); });
+        loop.run();
+    }
+}
+
+BENCHMARK(DatabaseFileSource_GetTileDuringDownload)->Arg(0)->Arg(2)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+
+#include <mbgl/storage/mbtiles_file_source.hpp>
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/storage/resource_options.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/util/client_options.hpp>
+#include <mbgl/util/run_loop.hpp>
+
+#include <climits>
+#include <memory>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#ifndef PATH_MAX
+#define PATH_MAX _MAX_PATH
+#endif
+#define getcwd _getcwd
+#else
+#include <unistd.h>
+#endif
+
+// Throughput of tile requests to an .mbtiles file with many requests in
+// flight, as when a server renders several maps from one file. The argument
+// is the number of concurrent requests.
+static void MBTilesFileSource_ConcurrentTiles(benchmark::State& state) {
+    using namespace mbgl;
+
+    util::RunLoop loop;
+
+    char cwd[PATH_MAX + 1];
+    const std::string url = std::string("mbtiles://") + getcwd(cwd, sizeof(cwd)) +
+                            "/test/fixtures/storage/mbtiles/geography-class-png.mbtiles?file={z}/{x}/{y}.png";
+
+    MBTilesFileSource mbtiles(ResourceOptions::Default(), ClientOptions());
+
+    const auto concurrency = static_cast<std::size_t>(state.range(0));
+    std::vector<std::unique_ptr<AsyncRequest>> requests(concurrency);
+    std::size_t pending = 0;
+
+    while (state.KeepRunning()) {
+        pending = concurrency;
+        for (std::size_t i = 0; i < concurrency; ++i) {
+            // The fixture holds zoom levels 0 and 1.
+            const auto x = static_cast<uint32_t>(i % 2);
+            const auto y = static_cast<uint32_t>(i / 2 % 2);
+            const uint8_t z = i % 5 == 4 ? 0 : 1;
+            requests[i] = mbtiles.request(
+                Resource::tile(url, 1.0, z ? x : 0, z ? y : 0, z, Tileset::Scheme::XYZ), [&](const Response&) {
+                    if (--pending == 0) {
+                        loop.stop();
+                    }
+                });
+        }
+        loop.run();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * concurrency));
+}
+
+BENCHMARK(MBTilesFileSource_ConcurrentTiles)->Arg(1)->Arg(16)->Arg(128)->Unit(benchmark::kMicrosecond);
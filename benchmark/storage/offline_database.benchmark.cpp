@@ -7,6 +7,8 @@
 #include <mbgl/util/string.hpp>
 #include <mbgl/util/logging.hpp>
 
+#include <cstdio>
+#include <memory>
 #include <random>
 
 class OfflineDatabase : public benchmark::Fixture {
@@ -200,3 +202,160 @@ BENCHMARK_F(OfflineDatabase, ResizeDatabase)(benchmark::State& state) {
         }
     }
 }
+
+// Reads from a file backed cache whose tiles were last used in an earlier
+// session, as when a map loads from a warm cache.
+static void OfflineDatabase_GetTileWarmCache(benchmark::State& state) {
+    using namespace mbgl;
+
+    const std::string path = "benchmark/fixtures/offline_database/warm_cache.db";
+    const unsigned tileCount = 100;
+    std::remove(path.c_str());
+
+    {
+        mbgl::OfflineDatabase db{path, TileServerOptions::DefaultConfiguration()};
+        Response response;
+        response.data = std::make_shared<std::string>(50 * 1024, 0);
+        for (unsigned i = 0; i < tileCount; ++i) {
+            db.put(Resource::tile("mapbox://tile_warm" + util::toString(i), 1, 0, 0, 0, Tileset::Scheme::XYZ),
+                   response);
+        }
+    }
+
+    {
+        auto raw = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadWriteCreate);
+        raw.exec("UPDATE tiles SET accessed = 0");
+    }
+
+    mbgl::OfflineDatabase db{path, TileServerOptions::DefaultConfiguration()};
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dis(0, tileCount - 1);
+
+    while (state.KeepRunning()) {
+        auto res = db.get(
+            Resource::tile("mapbox://tile_warm" + util::toString(dis(gen)), 1, 0, 0, 0, Tileset::Scheme::XYZ));
+        assert(res != std::nullopt);
+    }
+}
+
+BENCHMARK(OfflineDatabase_GetTileWarmCache);
+
+// Imports an .mbtiles archive into a region, as when tiles are delivered as a
+// file rather than downloaded. Reports tiles per second.
+static void OfflineDatabase_ImportRegionTiles(benchmark::State& state) {
+    using namespace mbgl;
+
+    const std::string path = "benchmark/fixtures/offline_database/import.mbtiles";
+    const int64_t tileCount = 20000;
+    std::remove(path.c_str());
+
+    {
+        auto archive = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadWriteCreate);
+        archive.exec("CREATE TABLE tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB)");
+        mapbox::sqlite::Transaction transaction(archive);
+        mapbox::sqlite::Statement statement(archive, "INSERT INTO tiles VALUES (?1, ?2, ?3, ?4)");
+        for (int64_t i = 0; i < tileCount; ++i) {
+            // Distinct tiles of typical vector tile size at zoom level 8.
+            std::string data(2 * 1024, 0);
+            data.replace(0, sizeof(i), reinterpret_cast<const char*>(&i), sizeof(i));
+            mapbox::sqlite::Query query{statement};
+            query.bind(1, 8);
+            query.bind(2, i % 256);
+            query.bind(3, i / 256);
+            query.bindBlob(4, data.data(), data.size(), false);
+            query.run();
+        }
+        transaction.commit();
+    }
+
+    OfflineTilePyramidRegionDefinition definition{"mapbox://style", LatLngBounds::world(), 0, 8, 1.0, false};
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        mbgl::OfflineDatabase db{":memory:", TileServerOptions::DefaultConfiguration()};
+        const int64_t regionID = db.createRegion(definition, {})->getID();
+        state.ResumeTiming();
+
+        auto imported = db.importRegionTiles(regionID, path, "http://example.com/{z}/{x}/{y}.pbf");
+        assert(imported && *imported == static_cast<uint64_t>(tileCount));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * tileCount);
+}
+
+BENCHMARK(OfflineDatabase_ImportRegionTiles);
+
+// Merges a side-loaded database of a few hundred megabytes of region tiles
+// into an empty offline database, chunk by chunk as DatabaseFileSource does.
+static void OfflineDatabase_MergeDatabase(benchmark::State& state) {
+    using namespace mbgl;
+
+    const std::string sidePath = "benchmark/fixtures/offline_database/merge_side.db";
+    const std::string path = "benchmark/fixtures/offline_database/merge_main.db";
+    const int64_t tileCount = 10000;
+    const size_t tileSize = 32 * 1024;
+    std::remove(sidePath.c_str());
+
+    int64_t regionID = 0;
+    {
+        mbgl::OfflineDatabase side{sidePath, TileServerOptions::DefaultConfiguration()};
+        OfflineTilePyramidRegionDefinition definition{"https://example.com/style.json",
+                                                      LatLngBounds::world(), 0, 14, 1.0, false};
+        regionID = side.createRegion(definition, {})->getID();
+    }
+    {
+        auto side = mapbox::sqlite::Database::open(sidePath, mapbox::sqlite::ReadWriteCreate);
+        mapbox::sqlite::Transaction transaction(side);
+        mapbox::sqlite::Statement tile(
+            side,
+            "INSERT INTO tiles (url_template, pixel_ratio, z, x, y, modified, data, compressed, accessed) "
+            "VALUES ('https://example.com/{z}/{x}/{y}.png', 1, 14, ?1, ?2, 0, ?3, 0, 0)");
+        mapbox::sqlite::Statement regionTile(side, "INSERT INTO region_tiles (region_id, tile_id) VALUES (?1, ?2)");
+
+        // Raster tiles don't compress, so the database is as large as its tiles.
+        std::mt19937 gen(42);
+        std::string data(tileSize, 0);
+        for (int64_t i = 0; i < tileCount; ++i) {
+            for (auto& byte : data) {
+                byte = static_cast<char>(gen());
+            }
+            mapbox::sqlite::Query tileQuery{tile};
+            tileQuery.bind(1, i % 1024);
+            tileQuery.bind(2, i / 1024);
+            tileQuery.bindBlob(3, data.data(), data.size(), false);
+            tileQuery.run();
+
+            mapbox::sqlite::Query regionTileQuery{regionTile};
+            regionTileQuery.bind(1, regionID);
+            regionTileQuery.bind(2, tileQuery.lastInsertRowId());
+            regionTileQuery.run();
+        }
+        transaction.commit();
+    }
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (const char* suffix : {"", "-wal", "-shm"}) {
+            std::remove((path + suffix).c_str());
+        }
+        auto db = std::make_unique<mbgl::OfflineDatabase>(path, TileServerOptions::DefaultConfiguration());
+        state.ResumeTiming();
+
+        auto progress = db->beginMerge(sidePath);
+        while (progress && !progress->complete()) {
+            progress = db->mergeChunk();
+        }
+        auto merged = db->finishMerge();
+        assert(merged && merged->size() == 1);
+
+        state.PauseTiming();
+        db.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * tileCount);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * tileCount * tileSize);
+}
+
+BENCHMARK(OfflineDatabase_MergeDatabase)->Unit(benchmark::kMillisecond);
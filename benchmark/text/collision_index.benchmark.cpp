@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include <mbgl/map/transform.hpp>
+#include <mbgl/renderer/buckets/symbol_bucket.hpp>
+#include <mbgl/text/collision_index.hpp>
+#include <mbgl/util/constants.hpp>
+#include <mbgl/util/tile_cover.hpp>
+
+#include <random>
+
+using namespace mbgl;
+
+namespace {
+
+class CollisionBenchmark {
+public:
+    explicit CollisionBenchmark(std::size_t labelCount) {
+        transform.resize({1024, 1024});
+        transform.jumpTo(CameraOptions().withCenter(LatLng{40.726989, -73.992857}).withZoom(14.0));
+        transform.getState().matrixFor(posMatrix, util::tileCover(transform.getState(), 14).front().toUnwrapped());
+
+        // Deterministic, roughly uniform label distribution with realistic
+        // label extents (20-120px wide, 12-24px high).
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> position(0.0f, util::EXTENT);
+        std::uniform_real_distribution<float> halfWidth(10.0f, 60.0f);
+        std::uniform_real_distribution<float> halfHeight(6.0f, 12.0f);
+        const float boxScale = util::EXTENT / util::tileSize_D;
+
+        features.reserve(labelCount);
+        for (std::size_t i = 0; i < labelCount; ++i) {
+            const Anchor anchor(position(generator), position(generator), 0.0f);
+            const float w = halfWidth(generator);
+            const float h = halfHeight(generator);
+            features.emplace_back(GeometryCoordinates{},
+                                  anchor,
+                                  -h,
+                                  h,
+                                  -w,
+                                  w,
+                                  std::nullopt,
+                                  boxScale,
+                                  2.0f,
+                                  style::SymbolPlacementType::Point,
+                                  IndexedSubfeature(i, "source-layer", "bucket", i),
+                                  1.0f,
+                                  0.0f);
+        }
+    }
+
+    // Places every label in order, inserting the ones that fit, the same way
+    // Placement does for a single tile.
+    std::size_t placeAll() const {
+        CollisionIndex collisionIndex(transform.getState(), MapMode::Continuous);
+        std::vector<ProjectedCollisionBox> projectedBoxes;
+        std::size_t placed = 0;
+        for (const auto& feature : features) {
+            projectedBoxes.clear();
+            auto result = collisionIndex.placeFeature(feature,
+                                                      {},
+                                                      posMatrix,
+                                                      posMatrix,
+                                                      pixelRatio,
+                                                      symbol,
+                                                      1.0f,
+                                                      16.0f,
+                                                      false,
+                                                      false,
+                                                      false,
+                                                      std::nullopt,
+                                                      std::nullopt,
+                                                      projectedBoxes);
+            if (result.first) {
+                collisionIndex.insertFeature(feature, projectedBoxes, false, 0, 0);
+                ++placed;
+            }
+        }
+        return placed;
+    }
+
+    Transform transform;
+    mat4 posMatrix;
+    const float pixelRatio = static_cast<float>(util::tileSize_D / util::EXTENT);
+    const PlacedSymbol symbol{{}, 0, 16.0f, 16.0f, {{0.0f, 0.0f}}, WritingModeType::Horizontal, {}, {}};
+    std::vector<CollisionFeature> features;
+};
+
+} // end namespace
+
+static void Collision_PlacePointLabels(benchmark::State& state) {
+    CollisionBenchmark bench(static_cast<std::size_t>(state.range(0)));
+
+    std::size_t placed = 0;
+    for (auto _ : state) {
+        placed = bench.placeAll();
+        benchmark::DoNotOptimize(placed);
+    }
+    state.counters["placed"] = static_cast<double>(placed);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(Collision_PlacePointLabels)->Arg(500)->Arg(2000)->Arg(10000);
@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+
+#include <mbgl/util/compression.hpp>
+#include <mbgl/util/io.hpp>
+
+#include <vector>
+
+using namespace mbgl;
+
+namespace {
+
+const std::string& tileData() {
+    static const std::string data = util::read_file("test/fixtures/api/assets/streets/10-163-395.vector.pbf");
+    return data;
+}
+
+// There are too few tile fixtures to train on, so chunks of one tile serve as samples.
+const util::zstd::Dictionary& tileDictionary() {
+    static const util::zstd::Dictionary dictionary = [] {
+        std::vector<std::string> samples;
+        for (std::size_t offset = 0; offset < tileData().size(); offset += 2048) {
+            samples.push_back(tileData().substr(offset, 2048));
+        }
+        return util::zstd::Dictionary(util::zstd::trainDictionary(samples, 16 * 1024));
+    }();
+    return dictionary;
+}
+
+} // namespace
+
+static void Compression_DecompressZlib(benchmark::State& state) {
+    const std::string compressed = util::compress(tileData());
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(util::decompress(compressed));
+    }
+    state.counters["size"] = static_cast<double>(compressed.size());
+}
+
+static void Compression_DecompressZstd(benchmark::State& state) {
+    if (!util::zstd::supported()) {
+        state.SkipWithError("zstd support is not available");
+        return;
+    }
+    const util::zstd::Dictionary* dictionary = state.range(0) ? &tileDictionary() : nullptr;
+    const std::string compressed = util::zstd::compress(tileData(), dictionary);
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(util::zstd::decompress(compressed, dictionary));
+    }
+    state.counters["size"] = static_cast<double>(compressed.size());
+}
+
+BENCHMARK(Compression_DecompressZlib);
+// The argument selects whether the data is compressed with a dictionary.
+BENCHMARK(Compression_DecompressZstd)->Arg(0)->Arg(1);
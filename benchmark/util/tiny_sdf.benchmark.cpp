@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+
+#include <mbgl/text/glyph.hpp>
+#include <mbgl/util/tiny_sdf.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace mbgl;
+
+namespace {
+
+// An antialiased ring of the given em size plus the glyph border, similar to
+// what LocalGlyphRasterizer hands to GlyphManager.
+AlphaImage glyphRaster(uint32_t em) {
+    const uint32_t side = em + 2 * Glyph::borderSize;
+    AlphaImage image({side, side});
+    const double center = side / 2.0;
+    const double outer = em / 2.0;
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            const double r = std::hypot(x + 0.5 - center, y + 0.5 - center);
+            const double coverage = std::min(std::clamp(outer - r + 0.5, 0.0, 1.0),
+                                             std::clamp(r - outer / 2 + 0.5, 0.0, 1.0));
+            image.data[y * side + x] = static_cast<uint8_t>(std::lround(coverage * 255));
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+static void TinySDF_TransformGlyph(::benchmark::State& state) {
+    const AlphaImage raster = glyphRaster(static_cast<uint32_t>(state.range(0)));
+    while (state.KeepRunning()) {
+        auto sdf = util::transformRasterToSDF(raster, 8, .25);
+        ::benchmark::DoNotOptimize(sdf.data.get());
+    }
+}
+
+BENCHMARK(TinySDF_TransformGlyph)->Arg(24)->Arg(48)->Arg(96);
@@ -86,6 +86,12 @@ int main(int argc, char* argv[]) {
     args::ValueFlag<std::string> inputValue(
         mergeGroup, "input", "Database to merge into. Use with --merge option.", {'i', "input"});
 
+    args::Group importGroup(argumentParser, "Import tiles:", args::Group::Validators::AllOrNone);
+    args::ValueFlag<std::string> importPathValue(
+        importGroup, "file", "MBTiles or PMTiles archive to import into the region before downloading", {"import"});
+    args::ValueFlag<std::string> tileURLTemplateValue(
+        importGroup, "URL", "Tile URL template of the style source the archive holds", {"tileURLTemplate"});
+
     // LatLngBounds
     args::Group latLngBoundsGroup(argumentParser, "LatLng bounds:", args::Group::Validators::AllOrNone);
     args::ValueFlag<double> northValue(latLngBoundsGroup, "degrees", "North latitude", {"north"});
@@ -131,6 +137,8 @@ int main(int argc, char* argv[]) {
     if (mergePathValue) mergePath = args::get(mergePathValue);
     std::optional<std::string> inputDb = std::nullopt;
     if (inputValue) inputDb = args::get(inputValue);
+    std::optional<std::string> importPath = std::nullopt;
+    if (importPathValue) importPath = args::get(importPathValue);
 
     const double minZoom = minZoomValue ? args::get(minZoomValue) : 0.0;
     const double maxZoom = maxZoomValue ? args::get(maxZoomValue) : 15.0;
@@ -182,10 +190,21 @@ int main(int argc, char* argv[]) {
     if (inputDb && mergePath) {
         DatabaseFileSource inputSource(ResourceOptions().withCachePath(*inputDb), ClientOptions());
 
+        class MergeObserver : public OfflineMergeObserver {
+        public:
+            void progressChanged(OfflineMergeProgress progress) override {
+                std::cout << progress.completedTileCount << " / " << progress.tileCount << " tiles | "
+                          << progress.completedResourceCount << " / " << progress.resourceCount
+                          << " resources merged" << std::endl;
+            }
+        };
+
         int retCode = 0;
         std::cout << "Start Merge" << std::endl;
         inputSource.mergeOfflineRegions(
-            *mergePath, [&](mbgl::expected<std::vector<OfflineRegion>, std::exception_ptr> result) {
+            *mergePath,
+            std::make_unique<MergeObserver>(),
+            [&](mbgl::expected<std::vector<OfflineRegion>, std::exception_ptr> result) {
                 if (!result) {
                     std::cerr << "Error merging database: " << util::toString(result.error()) << std::endl;
                     retCode = 1;
@@ -263,6 +282,8 @@ int main(int argc, char* argv[]) {
 
     std::signal(SIGINT, [](int) { stop(); });
 
+    int retCode = 0;
+
     fileSource->createOfflineRegion(
         definition, metadata, [&](mbgl::expected<OfflineRegion, std::exception_ptr> region_) {
             if (!region_) {
@@ -274,10 +295,36 @@ int main(int argc, char* argv[]) {
                 region = std::make_unique<OfflineRegion>(std::move(*region_));
                 fileSource->setOfflineRegionObserver(*region,
                                                      std::make_unique<Observer>(*region, fileSource, loop, mergePath));
-                fileSource->setOfflineRegionDownloadState(*region, OfflineRegionDownloadState::Active);
+                if (!importPath) {
+                    fileSource->setOfflineRegionDownloadState(*region, OfflineRegionDownloadState::Active);
+                    return;
+                }
+
+                // The download then only fetches what the archive doesn't hold.
+                std::cout << "Start Import" << std::endl;
+                const Timestamp importStart = util::now();
+                fileSource->importOfflineRegionTiles(
+                    *region,
+                    *importPath,
+                    args::get(tileURLTemplateValue),
+                    [&, importStart](mbgl::expected<uint64_t, std::exception_ptr> result) {
+                        if (!result) {
+                            std::cerr << "Error importing tiles: " << util::toString(result.error()) << std::endl;
+                            retCode = 1;
+                            loop.stop();
+                            return;
+                        }
+                        const auto elapsed = std::chrono::duration<double>(util::now() - importStart).count();
+                        std::cout << " Imported " << *result << " tiles in " << elapsed << " s";
+                        if (elapsed > 0) {
+                            std::cout << " (" << static_cast<uint64_t>(*result / elapsed) << " tiles/sec)";
+                        }
+                        std::cout << std::endl;
+                        fileSource->setOfflineRegionDownloadState(*region, OfflineRegionDownloadState::Active);
+                    });
             }
         });
 
     loop.run();
-    return 0;
+    return retCode;
 }
@@ -2,6 +2,7 @@
 
 #include <mbgl/renderer/query.hpp>
 #include <mbgl/annotation/annotation.hpp>
+#include <mbgl/util/chrono.hpp>
 #include <mbgl/util/geo.hpp>
 #include <mbgl/util/geojson.hpp>
 
@@ -107,6 +108,36 @@ public:
      */
     const std::vector<PlacedSymbolData>& getPlacedSymbolsData() const;
 
+    /**
+     * @brief In Continuous map mode, enables or disables computing the symbol
+     * placement on a background thread.
+     *
+     * While a new placement is being computed, frames keep using the previously
+     * committed one. If the new placement is not ready `maxStaleness` after it
+     * was started, the next frame waits for it.
+     *
+     * Background placement is disabled by default.
+     */
+    void setBackgroundPlacement(bool enable, Duration maxStaleness = Milliseconds(100));
+
+    /**
+     * @brief In Continuous map mode, sets the time budget per frame for computing
+     * the symbol placement, or disables time-slicing if `std::nullopt` is given.
+     *
+     * With a budget set, a new placement is computed bucket by bucket over several
+     * frames, which keep using the previously committed placement until the new
+     * one is complete. Background placement takes precedence, if enabled.
+     *
+     * Time-slicing is disabled by default.
+     */
+    void setPlacementTimeBudget(std::optional<Duration> budget);
+
+    /**
+     * @brief Returns the number of frames the last committed symbol placement
+     * took to compute.
+     */
+    std::size_t getLastPlacementFrameCount() const;
+
     // Memory
     void reduceMemoryUse();
     void clearData();
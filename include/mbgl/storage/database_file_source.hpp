@@ -20,6 +20,7 @@ public:
     void forward(const Resource&, const Response&, std::function<void()> callback) override;
     bool canRequest(const Resource&) const override;
     void setProperty(const std::string&, const mapbox::base::Value&) override;
+    mapbox::base::Value getProperty(const std::string&) const override;
     void pause() override;
     void resume() override;
 
@@ -196,10 +197,44 @@ public:
      *
      * Merged regions may not be in a completed status if the secondary database
      * does not contain all the tiles or resources required by the region definition.
+     *
+     * Tiles and resources are copied in batches, each in a transaction of its own,
+     * and other requests are served in between. Merges requested while another one
+     * is running start once it has completed. An interrupted merge can be requested
+     * again, and only copies what is still missing.
+     */
+    virtual void mergeOfflineRegions(const std::string& sideDatabasePath,
+                                     std::function<void(expected<OfflineRegions, std::exception_ptr>)>);
+
+    /**
+     * Merge offline regions from a secondary database as above, notifying the
+     * observer each time a batch of tiles or resources has been copied.
      */
     virtual void mergeOfflineRegions(const std::string& sideDatabasePath,
+                                     std::unique_ptr<OfflineMergeObserver>,
                                      std::function<void(expected<OfflineRegions, std::exception_ptr>)>);
 
+    /**
+     * Store every tile of a local MBTiles or PMTiles archive as a tile of an
+     * offline region, for the tileset with the given URL template. This is
+     * much faster than downloading the same tiles, and lets a region be
+     * prepared from an archive produced elsewhere.
+     *
+     * Tiles are keyed by their XYZ coordinates and stored as the archive
+     * holds them. When the import is completed, the provided callback is
+     * executed on the database thread with the number of tiles imported; it
+     * is the responsibility of the SDK bindings to re-execute a user-provided
+     * callback on the main thread.
+     *
+     * Invokes the callback with a `MapboxTileLimitExceededException` error if
+     * the import exceeds the offline tile count limit. Tiles imported until
+     * then stay in the region.
+     */
+    virtual void importOfflineRegionTiles(const OfflineRegion&,
+                                          const std::string& archivePath,
+                                          const std::string& urlTemplate,
+                                          std::function<void(expected<uint64_t, std::exception_ptr>)>);
+
     /**
      * Remove an offline region from the database and perform any resources
      * evictions necessary as a result.
@@ -25,6 +25,7 @@ enum FileSourceType : uint8_t {
     FileSystem,
     Network,
     Mbtiles,
+    Pmtiles,
     ResourceLoader ///< %Resource loader acts as a proxy and has logic
     /// for request delegation to Asset, Cache, and other
     /// file sources.
@@ -46,6 +47,12 @@ public:
     /// is executed, the callback will not be executed.
     virtual std::unique_ptr<AsyncRequest> request(const Resource&, Callback) = 0;
 
+    /// Moves a request that is still waiting to be served to the place the
+    /// `priority` and `priorityOrder` of the given resource call for. The
+    /// request must have been made with this file source. File sources that
+    /// serve requests in no particular order ignore this.
+    virtual void updatePriority(AsyncRequest&, const Resource&) {}
+
     /// Allows to forward response from one source to another.
     /// Optionally, callback can be provided to receive notification for forward
     /// operation.
@@ -117,4 +124,18 @@ constexpr const char* MAX_CONCURRENT_REQUESTS_KEY = "max-concurrent-requests";
 /// database opens in read-write-create mode otherwise. type: bool
 constexpr const char* READ_ONLY_MODE_KEY = "read-only-mode";
 
+/// Property to get a number that changes whenever the database drops or
+/// invalidates resources, e.g. when the ambient cache is cleared. type: uint64_t
+constexpr const char* CACHE_GENERATION_KEY = "cache-generation";
+
+// Properties that may be supported by resource loaders:
+
+/// Property to get the number of requests answered from the in-memory
+/// resource cache. type: uint64_t
+constexpr const char* MEMORY_CACHE_HITS_KEY = "memory-cache-hits";
+
+/// Property to get the number of requests that the in-memory resource cache
+/// could have answered, but didn't have a fresh response for. type: uint64_t
+constexpr const char* MEMORY_CACHE_MISSES_KEY = "memory-cache-misses";
+
 } // namespace mbgl
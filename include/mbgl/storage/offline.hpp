@@ -140,7 +140,8 @@ public:
 
     /**
      * The cumulative size, in bytes, of all tiles that have been fully
-     * downloaded. This is a subset of `completedResourceSize`.
+     * downloaded. This is a subset of `completedResourceSize`. Tiles with
+     * identical contents are stored once, and count once.
      */
     uint64_t completedTileSize = 0;
 
@@ -213,6 +214,58 @@ public:
     virtual void mapboxTileCountLimitExceeded(uint64_t /* limit */) {}
 };
 
+/*
+ * The progress of merging the regions of a side-loaded database into the
+ * offline database. Only tiles and resources that belong to a region of the
+ * side-loaded database are counted.
+ */
+class OfflineMergeProgress {
+public:
+    /**
+     * The number of tiles that have been merged so far.
+     */
+    uint64_t completedTileCount = 0;
+
+    /**
+     * The number of tiles to merge.
+     */
+    uint64_t tileCount = 0;
+
+    /**
+     * The number of resources other than tiles that have been merged so far.
+     */
+    uint64_t completedResourceCount = 0;
+
+    /**
+     * The number of resources other than tiles to merge.
+     */
+    uint64_t resourceCount = 0;
+
+    bool complete() const { return completedTileCount >= tileCount && completedResourceCount >= resourceCount; }
+};
+
+/*
+ * Gets notified about the progress of a merge of a side-loaded database.
+ */
+class OfflineMergeObserver {
+public:
+    virtual ~OfflineMergeObserver() = default;
+
+    /*
+     * Implement this method to be notified each time a part of the merge has
+     * been committed to the offline database.
+     *
+     * The merged regions are added when the merge begins, and get their tiles
+     * and resources part by part. Until the merge completes, they are listed
+     * with the contents merged so far; if it fails, they keep those contents.
+     *
+     * Note that this method will be executed on the database thread; it is the
+     * responsibility of the SDK bindings to wrap this object in an interface
+     * that re-executes the user-provided implementation on the main thread.
+     */
+    virtual void progressChanged(OfflineMergeProgress) {}
+};
+
 class OfflineRegion {
 public:
     ~OfflineRegion();
@@ -20,6 +20,7 @@ public:
 private:
     // FileSource overrides
     std::unique_ptr<AsyncRequest> request(const Resource&, Callback) override;
+    void updatePriority(AsyncRequest&, const Resource&) override;
     bool canRequest(const Resource&) const override;
     void pause() override;
     void resume() override;
@@ -23,9 +23,12 @@ public:
         Image
     };
 
-    enum class Priority : bool {
-        Regular,
-        Low
+    // Network requests are served in this order.
+    enum class Priority : uint8_t {
+        High,     // Styles, sources, sprites and glyphs; nothing can be drawn without them.
+        Regular,  // Tiles that are on screen.
+        Prefetch, // Tiles that are expected to be on screen soon.
+        Low       // Offline downloads and revalidation of resources that are still usable.
     };
 
     enum class Usage : bool {
@@ -62,6 +65,9 @@ public:
              LoadingMethod loadingMethod_ = LoadingMethod::All)
         : kind(kind_),
           loadingMethod(loadingMethod_),
+          priority(kind_ == Style || kind_ == Source || kind_ == Glyphs || kind_ == SpriteImage || kind_ == SpriteJSON
+                       ? Priority::High
+                       : Priority::Regular),
           url(std::move(url_)),
           tileData(std::move(tileData_)) {}
 
@@ -90,6 +96,9 @@ public:
     LoadingMethod loadingMethod;
     Usage usage{Usage::Online};
     Priority priority{Priority::Regular};
+    // Orders requests of the same priority; lower values are served first.
+    // Tiles use their distance from the center of the screen.
+    uint32_t priorityOrder = 0;
     std::string url;
 
     // Includes auxiliary data if this is a tile request.
@@ -99,8 +108,14 @@ public:
     std::optional<Timestamp> priorExpires = std::nullopt;
     std::optional<std::string> priorEtag = std::nullopt;
     std::shared_ptr<const std::string> priorData;
+    bool priorDataCompressed = false;
     Duration minimumUpdateInterval{Duration::zero()};
     StoragePolicy storagePolicy{StoragePolicy::Permanent};
+
+    // Set by requestors that decompress the response data themselves, which
+    // lets file sources pass on compressed data as they received or stored
+    // it. See Response::compressed.
+    bool acceptsCompressedData = false;
 };
 
 inline bool Resource::hasLoadingMethod(Resource::LoadingMethod method) const {
@@ -70,6 +70,108 @@ public:
      */
     const std::string& cachePath() const;
 
+    /**
+     * @brief Sets the number of read-only connections to the cache database,
+     * each on its own thread, that serve cache lookups while writes, such as
+     * offline downloads, continue on the writer connection. With any read
+     * connections the database uses write-ahead logging. The default, zero,
+     * serves lookups and writes from a single connection. Has no effect on
+     * in-memory databases.
+     *
+     * @param count Number of read connections.
+     * @return ResourceOptions for chaining options together.
+     */
+    ResourceOptions& withCacheReadConnections(uint32_t count);
+
+    /**
+     * @brief Gets the previously set (or default) number of read connections.
+     *
+     * @return number of read-only cache database connections
+     */
+    uint32_t cacheReadConnections() const;
+
+    /**
+     * @brief Sets the number of bytes of recently used responses that the
+     * resource loader keeps in memory, in front of the cache database.
+     * Requests for those resources are answered without a database lookup,
+     * until they expire. Volatile resources and offline downloads are not
+     * kept. The memory cache is cleared whenever the database drops or
+     * invalidates resources, e.g. when the ambient cache is cleared. It is
+     * disabled by default (zero).
+     *
+     * @param size Memory cache size in bytes.
+     * @return ResourceOptions for chaining options together.
+     */
+    ResourceOptions& withMemoryCacheSize(uint64_t size);
+
+    /**
+     * @brief Gets the previously set (or default) memory cache size.
+     *
+     * @return memory cache size in bytes
+     */
+    uint64_t memoryCacheSize() const;
+
+    /**
+     * @brief Sets the directory in which decoded glyph ranges are kept across
+     * runs. The directory must exist. Unlike the cache database, it is not
+     * affected by cache eviction or by clearing the ambient cache. The glyph
+     * store takes at most the maximum cache size; beyond that, the ranges
+     * stored longest ago are deleted. An empty path, the default, disables
+     * the glyph store.
+     *
+     * @param path Glyph store directory.
+     * @return ResourceOptions for chaining options together.
+     */
+    ResourceOptions& withGlyphCachePath(std::string path);
+
+    /**
+     * @brief Gets the previously set (or default) glyph store directory.
+     *
+     * @return glyph store directory
+     */
+    const std::string& glyphCachePath() const;
+
+    /**
+     * @brief Sets the maximum number of connections that the HTTP file source
+     * opens to a single host. Requests beyond the limit wait for a connection
+     * to become available. HTTP/2 servers serve all requests on one
+     * connection, so the limit only matters for HTTP/1.1 hosts, where it
+     * trades parallelism for fewer TLS handshakes. The default, zero, sets
+     * no limit.
+     *
+     * @param count Maximum number of connections per host.
+     * @return ResourceOptions for chaining options together.
+     */
+    ResourceOptions& withMaximumConnectionsPerHost(uint32_t count);
+
+    /**
+     * @brief Gets the previously set (or default) maximum number of
+     * connections per host.
+     *
+     * @return maximum number of connections per host, or zero for no limit
+     */
+    uint32_t maximumConnectionsPerHost() const;
+
+    /**
+     * @brief Sets how many idle connections the HTTP file source keeps open
+     * for later requests, across all hosts. Keeping connections open saves
+     * handshakes at the cost of sockets. The default, zero, leaves the
+     * choice to the HTTP library; libcurl keeps up to four times the number
+     * of requests in progress.
+     *
+     * @param count Maximum number of idle connections.
+     * @return ResourceOptions for chaining options together.
+     */
+    ResourceOptions& withConnectionCacheSize(uint32_t count);
+
+    /**
+     * @brief Gets the previously set (or default) maximum number of idle
+     * connections.
+     *
+     * @return maximum number of idle connections, or zero for the default
+     */
+    uint32_t connectionCacheSize() const;
+
     /**
      * @brief Sets the asset path, which is the root directory from where
      * the asset:// scheme gets resolved in a style.
@@ -33,6 +33,11 @@ public:
     // The actual data of the response. Present only for non-error, non-notModified responses.
     std::shared_ptr<const std::string> data;
 
+    // This is set to true when `data` is still zlib, gzip or zstd compressed,
+    // as it was received or stored. Only responses to resources that set
+    // acceptsCompressedData may be compressed; see util::decompress().
+    bool compressed = false;
+
     std::optional<Timestamp> modified;
     std::optional<Timestamp> expires;
     std::optional<std::string> etag;
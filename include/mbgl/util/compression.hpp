@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace mbgl {
 namespace util {
@@ -13,7 +16,55 @@ enum CompressionFormat {
 };
 
 std::string compress(const std::string& raw, int windowBits = CompressionFormat::ZLIB);
+// With DETECT, zstd frames are decompressed too, using the registered
+// dictionary the frame names, if any; see zstd::registerDictionary().
 std::string decompress(const std::string& raw, int windowBits = CompressionFormat::DETECT);
 
+namespace zstd {
+
+// Whether mbgl was built with Zstandard support. Without it, the functions
+// below throw std::runtime_error.
+bool supported();
+
+// A dictionary trained on samples of similar data, e.g. the tiles of one
+// tileset. Data compressed with a dictionary can only be decompressed with
+// the same dictionary. A Dictionary may be used from any thread.
+class Dictionary {
+public:
+    explicit Dictionary(const std::string& data);
+    ~Dictionary();
+
+    // The ID zstd writes to the header of every frame compressed with this
+    // dictionary.
+    uint32_t id() const;
+
+private:
+    friend std::string compress(const std::string&, const Dictionary*);
+    friend std::string decompress(const std::string&, const Dictionary*);
+
+    class Impl;
+    std::unique_ptr<const Impl> impl;
+};
+
+std::string compress(const std::string& raw, const Dictionary* = nullptr);
+std::string decompress(const std::string& raw, const Dictionary* = nullptr);
+
+// Returns the ID of the dictionary needed to decompress `compressed`, or 0 if
+// it was compressed without one.
+uint32_t dictionaryID(const std::string& compressed);
+
+// Whether `data` starts with a zstd frame. Works without zstd support, too.
+bool isFrame(const std::string& data);
+
+// Makes a dictionary available to util::decompress() on any thread. Since
+// dictionary IDs are random, dictionaries of all databases share one registry.
+void registerDictionary(std::shared_ptr<const Dictionary>);
+
+// Returns a dictionary of at most `capacity` bytes, or an empty string if the
+// samples are too few or too small to train one.
+std::string trainDictionary(const std::vector<std::string>& samples, std::size_t capacity);
+
+} // namespace zstd
+
 } // namespace util
 } // namespace mbgl
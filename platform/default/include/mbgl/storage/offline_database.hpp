@@ -7,12 +7,15 @@
 #include <mbgl/util/constants.hpp>
 #include <mbgl/util/mapbox.hpp>
 #include <mbgl/util/expected.hpp>
+#include <mbgl/util/chrono.hpp>
 
 #include <list>
 #include <map>
 #include <memory>
 #include <string>
 #include <optional>
+#include <tuple>
+#include <vector>
 
 namespace mapbox {
 namespace sqlite {
@@ -30,6 +33,9 @@ class TileID;
 
 namespace util {
 struct IOException;
+namespace zstd {
+class Dictionary;
+} // namespace zstd
 } // namespace util
 
 struct MapboxTileLimitExceededException : util::Exception {
@@ -39,7 +45,7 @@ struct MapboxTileLimitExceededException : util::Exception {
 
 class OfflineDatabase {
 public:
-    OfflineDatabase(std::string path, const TileServerOptions& options);
+    OfflineDatabase(std::string path, const TileServerOptions& options, bool readOnly = false);
     ~OfflineDatabase();
 
     void changePath(const std::string&);
@@ -47,6 +53,28 @@ public:
 
     std::optional<Response> get(const Resource&);
 
+    // Reads buffer the accessed timestamps used for LRU eviction and write
+    // them periodically. Call this when idle to write them right away; it is
+    // also done before eviction and when the database is closed.
+    void flushAccessedTimestamps();
+    bool hasPendingAccessedTimestamps() const;
+
+    // Accessed timestamps of reads that haven't been written yet. Tiles are
+    // keyed by (url template, pixel ratio, x, y, z).
+    struct AccessedTimestamps {
+        std::map<std::string, Timestamp> resources;
+        std::map<std::tuple<std::string, uint8_t, int32_t, int32_t, int8_t>, Timestamp> tiles;
+    };
+
+    // A read-only database can't write the timestamps its reads buffer, so
+    // read-only connections hand them over to the writable one.
+    AccessedTimestamps takeAccessedTimestamps();
+    void addAccessedTimestamps(const AccessedTimestamps&);
+
+    // Write-ahead logging lets read-only connections to the same file read
+    // while this one writes. It is off by default.
+    void setWriteAheadLog(bool enabled);
+
     // Return value is (inserted, stored size)
     std::pair<bool, uint64_t> put(const Resource&, const Response&);
 
@@ -69,6 +97,29 @@ public:
 
     expected<OfflineRegions, std::exception_ptr> mergeDatabase(const std::string& sideDatabasePath);
 
+    // Merges a side database in steps, so that other operations can run in
+    // between. beginMerge() attaches the side database, checks it and adds
+    // its regions. Each mergeChunk() call copies the next batch of region
+    // tiles or resources in a transaction of its own, until the progress it
+    // returns is complete. finishMerge() then returns the merged regions.
+    // Only one merge can be in progress at a time. A merge that was
+    // interrupted can be run again, and only copies what is still missing or
+    // outdated. mergeDatabase() runs all of the steps at once.
+    expected<OfflineMergeProgress, std::exception_ptr> beginMerge(const std::string& sideDatabasePath);
+    expected<OfflineMergeProgress, std::exception_ptr> mergeChunk();
+    expected<OfflineRegions, std::exception_ptr> finishMerge();
+    bool isMerging() const { return merge.has_value(); }
+
+    // Stores every tile of an MBTiles or PMTiles archive as a tile of the
+    // region, for the tileset with the given URL template and the XYZ
+    // scheme. Tile data is stored as the archive holds it, in large
+    // transactions. Returns the number of tiles imported. Fails with a
+    // MapboxTileLimitExceededException once the offline Mapbox tile count
+    // limit is exceeded; the tiles imported until then stay in the region.
+    expected<uint64_t, std::exception_ptr> importRegionTiles(int64_t regionID,
+                                                             const std::string& archivePath,
+                                                             const std::string& urlTemplate);
+
     expected<OfflineRegionMetadata, std::exception_ptr> updateMetadata(int64_t regionID, const OfflineRegionMetadata&);
 
     std::exception_ptr deleteRegion(OfflineRegion&&);
@@ -78,11 +129,34 @@ public:
     std::optional<std::pair<Response, uint64_t>> getRegionResource(const Resource&);
     std::optional<int64_t> hasRegionResource(const Resource&);
     uint64_t putRegionResource(int64_t regionID, const Resource&, const Response&);
-    void putRegionResources(int64_t regionID, const std::list<std::tuple<Resource, Response>>&, OfflineRegionStatus&);
+    // Returns the stored size of each resource, or nothing if they couldn't be stored.
+    // Tiles whose contents another tile of the region already uses have size 0.
+    std::vector<uint64_t> putRegionResources(int64_t regionID,
+                                             const std::list<std::tuple<Resource, Response>>&,
+                                             OfflineRegionStatus&);
 
     expected<OfflineRegionDefinition, std::exception_ptr> getRegionDefinition(int64_t regionID);
     expected<OfflineRegionStatus, std::exception_ptr> getRegionCompletedStatus(int64_t regionID);
 
+    // Progress of a region download through the tiles of a tileset at a range
+    // of zoom levels: the first `position` tiles, in the order in which the
+    // download enumerates them, are done. `completedCount` of them are stored,
+    // `completedSize` bytes in total; the others were not found.
+    struct RegionTileCursor {
+        uint64_t position = 0;
+        uint64_t completedCount = 0;
+        uint64_t completedSize = 0;
+    };
+
+    std::optional<RegionTileCursor> getRegionTileCursor(int64_t regionID,
+                                                        const std::string& urlTemplate,
+                                                        const Range<uint8_t>& zoomRange);
+    void putRegionTileCursor(int64_t regionID,
+                             const std::string& urlTemplate,
+                             const Range<uint8_t>&,
+                             const RegionTileCursor&);
+    void deleteRegionTileCursors(int64_t regionID);
+
     std::exception_ptr setMaximumAmbientCacheSize(uint64_t);
     void setOfflineMapboxTileCountLimit(uint64_t);
     uint64_t getOfflineMapboxTileCountLimit();
@@ -95,7 +169,36 @@ public:
 
     void reopenDatabaseReadOnly(bool readOnly);
 
+    // Trains a Zstandard dictionary on the stored tiles of a tileset. Tiles of
+    // the tileset stored afterwards are compressed with it; tiles stored
+    // before keep their compression. Does nothing and returns false if the
+    // tileset already has a dictionary, too few of its tiles are stored, or
+    // zstd support isn't available.
+    bool trainTileDictionary(const std::string& urlTemplate);
+
+    // The steps of trainTileDictionary(), for callers that train the
+    // dictionary on another thread: getTileDictionarySamples() returns no
+    // samples where trainTileDictionary() would do nothing, and
+    // trainDictionary() doesn't touch the database, so it may run anywhere.
+    std::vector<std::string> getTileDictionarySamples(const std::string& urlTemplate);
+    static std::string trainDictionary(const std::vector<std::string>& samples);
+    bool putTileDictionary(const std::string& urlTemplate, const std::string& data);
+
+    // Incremental eviction: once the ambient cache grows past 90% of its
+    // maximum size, each call deletes one small batch of the least recently
+    // used ambient entries in its own transaction, until the cache is below
+    // 80%. Returns true while more batches are needed. Call it when idle, so
+    // that put() rarely has to evict while reads wait.
+    bool evictAmbientCacheBatch();
+
 private:
+    // Values of the `compressed` column.
+    enum class DataEncoding : uint8_t {
+        None = 0,
+        Deflate = 1,
+        Zstd = 2
+    };
+
     class DatabaseSizeChangeStats;
 
     void initialize();
@@ -104,33 +207,57 @@ private:
     void handleError(const std::runtime_error& ex, const char* action);
     void handleError(const char* action);
 
+    void closeDatabase();
     void removeExisting();
+    void abortMerge();
+    void deleteUnusedTileData();
     void removeOldCacheTable();
     void createSchema();
     void migrateToVersion5();
     void migrateToVersion3();
     void migrateToVersion6();
+    void migrateToVersion7();
+    void migrateToVersion8();
+    void migrateToVersion9();
+    void migrateToVersion10();
     void cleanup();
+    void applyJournalMode();
     bool disabled();
     void vacuum();
     void checkFlags();
 
     mapbox::sqlite::Statement& getStatement(const char*);
 
-    std::optional<std::pair<Response, uint64_t>> getTile(const Resource::TileData&);
+    std::optional<std::pair<Response, uint64_t>> getTile(const Resource::TileData&, bool acceptsCompressedData);
     std::optional<int64_t> hasTile(const Resource::TileData&);
-    bool putTile(const Resource::TileData&, const Response&, const std::string&, bool compressed);
+    bool putTile(const Resource::TileData&, const Response&, const std::string&, DataEncoding);
+    // Returns the ID of the tile_data row with the given contents, adding one if needed.
+    int64_t putTileData(const std::string&);
 
     std::optional<std::pair<Response, uint64_t>> getResource(const Resource&);
     std::optional<int64_t> hasResource(const Resource&);
-    bool putResource(const Resource&, const Response&, const std::string&, bool compressed);
+    bool putResource(const Resource&, const Response&, const std::string&, DataEncoding);
 
     uint64_t putRegionResourceInternal(int64_t regionID, const Resource&, const Response&);
 
+    void recordResourceAccess(const std::string& url, Timestamp accessed);
+    void recordTileAccess(const Resource::TileData&, Timestamp accessed);
+    void flushAccessedTimestampsIfDue();
+    void writeAccessedTimestamps();
+    void discardAccessedTimestamps();
+
+    // Sets the data of a response read from the database, and returns its stored size.
+    uint64_t setResponseData(Response&, std::string data, DataEncoding, bool acceptsCompressedData);
+    std::shared_ptr<const util::zstd::Dictionary> getDictionary(uint32_t id);
+    std::shared_ptr<const util::zstd::Dictionary> getTileDictionary(const std::string& urlTemplate);
+
     std::optional<std::pair<Response, uint64_t>> getInternal(const Resource&);
     std::optional<int64_t> hasInternal(const Resource&);
     std::pair<bool, uint64_t> putInternal(const Resource&, const Response&, bool evict);
 
+    // Size of the tile's contents, or 0 if another tile of the region uses them too.
+    uint64_t getUnsharedTileSize(int64_t regionID, const Resource::TileData&);
+
     // Return value is true iff the resource was previously unused by any other regions.
     bool markUsed(int64_t regionID, const Resource&);
 
@@ -149,7 +276,26 @@ private:
 
     std::optional<uint64_t> offlineMapboxTileCount;
 
+    // The merge in progress. Side tiles and resources are merged in the order
+    // of their IDs; these are the last IDs merged so far.
+    struct Merge {
+        int64_t lastTileID = 0;
+        int64_t lastResourceID = 0;
+        OfflineMergeProgress progress;
+    };
+    std::optional<Merge> merge;
+
+    // Dictionaries by ID, and the dictionary new tiles of a tileset are
+    // compressed with, by URL template; nullptr if the tileset has none.
+    std::map<uint32_t, std::shared_ptr<const util::zstd::Dictionary>> dictionaries;
+    std::map<std::string, std::shared_ptr<const util::zstd::Dictionary>> tileDictionaries;
+
+    AccessedTimestamps pendingAccesses;
+    std::optional<Timestamp> oldestPendingAccess;
+
     bool evict(uint64_t neededFreeSize, DatabaseSizeChangeStats& stats);
+    bool evictLeastRecentlyUsed(uint64_t count);
+    bool ambientCacheEvicting = false;
 
     TileServerOptions tileServerOptions;
 
@@ -184,6 +330,7 @@ private:
 
     bool autopack = true;
     bool readOnly = false;
+    bool writeAheadLog = false;
 };
 
 } // namespace mbgl
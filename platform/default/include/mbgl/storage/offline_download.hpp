@@ -4,10 +4,14 @@
 #include <mbgl/storage/offline.hpp>
 #include <mbgl/storage/resource.hpp>
 
+#include <mapbox/std/weak.hpp>
+
 #include <list>
+#include <map>
 #include <unordered_set>
 #include <memory>
 #include <deque>
+#include <optional>
 
 namespace mbgl {
 
@@ -51,6 +55,9 @@ private:
 
     void onMapboxTileCountLimitExceeded();
 
+    // The tiles of one tileset, enumerated as they are requested.
+    struct TileStream;
+
     int64_t id;
     OfflineRegionDefinition definition;
     OfflineDatabase& offlineDatabase;
@@ -61,12 +68,24 @@ private:
     std::list<std::unique_ptr<AsyncRequest>> requests;
     std::set<std::string> requiredSourceURLs;
     std::deque<Resource> resourcesRemaining;
+    std::list<std::unique_ptr<TileStream>> tileStreams;
     std::list<Resource> resourcesToBeMarkedAsUsed;
     std::list<std::tuple<Resource, Response>> buffer;
+    // Tiles stored per URL template since the download was created.
+    std::map<std::string, uint32_t> storedTileCounts;
 
     void queueResource(Resource&&);
     void queueTiles(style::SourceType, uint16_t tileSize, const Tileset&);
+    std::optional<Resource> nextTile();
+    bool hasResourcesRemaining() const;
+    // Records that a tile is done: stored with the given size, or not found.
+    void tileDone(const Resource&, std::optional<uint64_t> storedSize);
+    void saveTileCursors();
     void markPendingUsedResources();
+    // Trains a compression dictionary for the tileset on a background thread.
+    void trainTileDictionary(const std::string& urlTemplate);
+
+    mapbox::base::WeakPtrFactory<OfflineDownload> weakFactory{this};
 };
 
 } // namespace mbgl
@@ -17,6 +17,7 @@ static constexpr const char* offlineDatabaseSchema =
     "  compressed INTEGER NOT NULL DEFAULT 0,\n"
     "  accessed INTEGER NOT NULL,\n"
     "  must_revalidate INTEGER NOT NULL DEFAULT 0,\n"
+    "  ambient INTEGER NOT NULL DEFAULT 1,\n"
     "  UNIQUE (url)\n"
     ");\n"
     "CREATE TABLE tiles (\n"
@@ -33,8 +34,20 @@ static constexpr const char* offlineDatabaseSchema =
     "  compressed INTEGER NOT NULL DEFAULT 0,\n"
     "  accessed INTEGER NOT NULL,\n"
     "  must_revalidate INTEGER NOT NULL DEFAULT 0,\n"
+    "  ambient INTEGER NOT NULL DEFAULT 1,\n"
+    "  data_id INTEGER,\n"
     "  UNIQUE (url_template, pixel_ratio, z, x, y)\n"
     ");\n"
+    "CREATE TABLE tile_data (\n"
+    "  id INTEGER NOT NULL PRIMARY KEY,\n"
+    "  hash INTEGER NOT NULL,\n"
+    "  data BLOB NOT NULL\n"
+    ");\n"
+    "CREATE TABLE dictionaries (\n"
+    "  id INTEGER NOT NULL PRIMARY KEY,\n"
+    "  url_template TEXT NOT NULL,\n"
+    "  data BLOB NOT NULL\n"
+    ");\n"
     "CREATE TABLE regions (\n"
     "  id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,\n"
     "  definition TEXT NOT NULL,\n"
@@ -50,13 +63,73 @@ static constexpr const char* offlineDatabaseSchema =
     "  tile_id INTEGER NOT NULL REFERENCES tiles(id),\n"
     "  UNIQUE (region_id, tile_id)\n"
     ");\n"
-    "CREATE INDEX resources_accessed\n"
-    "ON resources (accessed);\n"
-    "CREATE INDEX tiles_accessed\n"
-    "ON tiles (accessed);\n"
+    "CREATE TABLE region_tile_cursors (\n"
+    "  region_id INTEGER NOT NULL REFERENCES regions(id) ON DELETE CASCADE,\n"
+    "  url_template TEXT NOT NULL,\n"
+    "  min_zoom INTEGER NOT NULL,\n"
+    "  max_zoom INTEGER NOT NULL,\n"
+    "  position INTEGER NOT NULL,\n"
+    "  completed_count INTEGER NOT NULL,\n"
+    "  completed_size INTEGER NOT NULL,\n"
+    "  UNIQUE (region_id, url_template, min_zoom, max_zoom)\n"
+    ");\n"
+    "CREATE INDEX resources_ambient_accessed\n"
+    "ON resources (ambient, accessed);\n"
+    "CREATE INDEX tiles_ambient_accessed\n"
+    "ON tiles (ambient, accessed);\n"
     "CREATE INDEX region_resources_resource_id\n"
     "ON region_resources (resource_id);\n"
     "CREATE INDEX region_tiles_tile_id\n"
-    "ON region_tiles (tile_id);\n";
+    "ON region_tiles (tile_id);\n"
+    "CREATE INDEX dictionaries_url_template\n"
+    "ON dictionaries (url_template);\n"
+    "CREATE INDEX tile_data_hash\n"
+    "ON tile_data (hash);\n"
+    "CREATE INDEX tiles_data_id\n"
+    "ON tiles (data_id);\n"
+    "CREATE TRIGGER region_resources_insert AFTER INSERT ON region_resources\n"
+    "BEGIN\n"
+    "  UPDATE resources SET ambient = 0 WHERE id = NEW.resource_id;\n"
+    "END;\n"
+    "CREATE TRIGGER region_resources_delete AFTER DELETE ON region_resources\n"
+    "BEGIN\n"
+    "  UPDATE resources SET ambient = 1\n"
+    "  WHERE id = OLD.resource_id\n"
+    "  AND NOT EXISTS (SELECT 1 FROM region_resources WHERE resource_id = OLD.resource_id);\n"
+    "END;\n"
+    "CREATE TRIGGER resources_insert AFTER INSERT ON resources\n"
+    "WHEN EXISTS (SELECT 1 FROM region_resources WHERE resource_id = NEW.id)\n"
+    "BEGIN\n"
+    "  UPDATE resources SET ambient = 0 WHERE id = NEW.id;\n"
+    "END;\n"
+    "CREATE TRIGGER region_tiles_insert AFTER INSERT ON region_tiles\n"
+    "BEGIN\n"
+    "  UPDATE tiles SET ambient = 0 WHERE id = NEW.tile_id;\n"
+    "END;\n"
+    "CREATE TRIGGER region_tiles_delete AFTER DELETE ON region_tiles\n"
+    "BEGIN\n"
+    "  UPDATE tiles SET ambient = 1\n"
+    "  WHERE id = OLD.tile_id\n"
+    "  AND NOT EXISTS (SELECT 1 FROM region_tiles WHERE tile_id = OLD.tile_id);\n"
+    "END;\n"
+    "CREATE TRIGGER tiles_insert AFTER INSERT ON tiles\n"
+    "WHEN EXISTS (SELECT 1 FROM region_tiles WHERE tile_id = NEW.id)\n"
+    "BEGIN\n"
+    "  UPDATE tiles SET ambient = 0 WHERE id = NEW.id;\n"
+    "END;\n"
+    "CREATE TRIGGER tiles_delete AFTER DELETE ON tiles\n"
+    "WHEN OLD.data_id IS NOT NULL\n"
+    "BEGIN\n"
+    "  DELETE FROM tile_data\n"
+    "  WHERE id = OLD.data_id\n"
+    "  AND NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = OLD.data_id);\n"
+    "END;\n"
+    "CREATE TRIGGER tiles_update_data AFTER UPDATE OF data_id ON tiles\n"
+    "WHEN OLD.data_id IS NOT NULL AND OLD.data_id IS NOT NEW.data_id\n"
+    "BEGIN\n"
+    "  DELETE FROM tile_data\n"
+    "  WHERE id = OLD.data_id\n"
+    "  AND NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = OLD.data_id);\n"
+    "END;\n";
 
 } // namespace mbgl
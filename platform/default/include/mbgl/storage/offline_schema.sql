@@ -29,16 +29,22 @@ CREATE TABLE resources (
 
   data BLOB,                                       -- Contents of the resource.
 
-  compressed INTEGER NOT NULL DEFAULT 0,           -- If the resource is compressed with Deflate or not. Compression is
-                                                   -- optional and should be used when the compression ratio is
-                                                   -- significant. Using compression will make decoding time slower
-                                                   -- because it will add an extra decompression step.
+  compressed INTEGER NOT NULL DEFAULT 0,           -- How the resource is compressed:
+                                                   -- none                        = 0
+                                                   -- Deflate (zlib or gzip)      = 1
+                                                   -- Zstandard                   = 2
+                                                   -- Compression is optional and should be used when the compression
+                                                   -- ratio is significant. Using compression will make decoding time
+                                                   -- slower because it will add an extra decompression step.
 
   accessed INTEGER NOT NULL,                       -- Last time the resource was used by GL Native. Useful for when
                                                    -- evicting the least used resources from the cache.
 
   must_revalidate INTEGER NOT NULL DEFAULT 0,      -- When set to true, the resource will not be used unless it gets
                                                    -- first revalidated by the server.
+
+  ambient INTEGER NOT NULL DEFAULT 1,              -- Set to true when the resource is part of the ambient cache, i.e. of
+                                                   -- no region. Maintained by the region_resources triggers below.
   UNIQUE (url)
 );
 
@@ -72,21 +78,60 @@ CREATE TABLE tiles (
                                                    -- get re-downloaded. See:
                                                    -- https://developer.mozilla.org/en-US/docs/Web/HTTP/Headers/ETag
 
-  data BLOB,                                       -- Contents of the tile.
+  data BLOB,                                       -- Contents of the tile, if not stored in tile_data.
 
-  compressed INTEGER NOT NULL DEFAULT 0,           -- If the tile is compressed with Deflate or not. Compression is
-                                                   -- optional and should be used when the compression ratio is
-                                                   -- significant. Using compression will make decoding time slower
-                                                   -- because it will add an extra decompression step.
+  compressed INTEGER NOT NULL DEFAULT 0,           -- How the tile is compressed:
+                                                   -- none                        = 0
+                                                   -- Deflate (zlib or gzip)      = 1
+                                                   -- Zstandard                   = 2, with the dictionary named by the
+                                                   --                                   frame header, if any
+                                                   -- Compression is optional and should be used when the compression
+                                                   -- ratio is significant. Using compression will make decoding time
+                                                   -- slower because it will add an extra decompression step.
 
   accessed INTEGER NOT NULL,                       -- Last time the tile was used by GL Native. Useful for when
                                                    -- evicting the least used tiles from the cache.
 
   must_revalidate INTEGER NOT NULL DEFAULT 0,      -- When set to true, the tile will not be used unless it gets
                                                    -- first revalidated by the server.
+
+  ambient INTEGER NOT NULL DEFAULT 1,              -- Set to true when the tile is part of the ambient cache, i.e. of no
+                                                   -- region. Maintained by the region_tiles triggers below.
+
+  data_id INTEGER,                                 -- The tile_data row holding the contents of the tile, if any. Tiles
+                                                   -- stored before schema version 9 keep their contents in `data`.
   UNIQUE (url_template, pixel_ratio, z, x, y)
 );
 
+--
+-- Tile contents, stored once for all tiles with the same contents, like
+-- the many empty water tiles of a region. A row is deleted along with the
+-- last tile referring to it, see the tiles triggers below.
+--
+CREATE TABLE tile_data (
+  id INTEGER NOT NULL PRIMARY KEY,                 -- Primary key.
+
+  hash INTEGER NOT NULL,                           -- 64-bit FNV-1a hash of the data, used to look up equal contents.
+                                                   -- Rows with equal hashes are compared byte by byte.
+
+  data BLOB NOT NULL                               -- Contents of the tiles, encoded as given by their `compressed`
+                                                   -- column.
+);
+
+--
+-- Zstandard dictionaries, each trained on the tiles of one tileset.
+-- Tiles compressed with a dictionary name it in their frame header.
+-- Dictionaries are small and are kept when the tiles using them are
+-- removed.
+--
+CREATE TABLE dictionaries (
+  id INTEGER NOT NULL PRIMARY KEY,                 -- The dictionary ID zstd writes to frame headers.
+
+  url_template TEXT NOT NULL,                      -- The URL template of the tileset the dictionary was trained on.
+
+  data BLOB NOT NULL                               -- Contents of the dictionary.
+);
+
 --
 -- Regions define the offline regions, which could be a GeoJSON geometry,
 -- or a bounding box like this example:
@@ -148,18 +193,113 @@ CREATE TABLE region_tiles (
   UNIQUE (region_id, tile_id)
 );
 
+--
+-- Progress of region downloads through the tiles of each tileset, so that
+-- an interrupted download resumes without enumerating and checking the
+-- tiles it already has. Rows are deleted once a download completes.
+--
+CREATE TABLE region_tile_cursors (
+  region_id INTEGER NOT NULL REFERENCES regions(id) ON DELETE CASCADE,
+  url_template TEXT NOT NULL,                      -- The tileset, and the zoom levels the download
+  min_zoom INTEGER NOT NULL,                       -- covers in it.
+  max_zoom INTEGER NOT NULL,
+
+  position INTEGER NOT NULL,                       -- Number of tiles, in the order in which the download enumerates
+                                                   -- them, that are done.
+
+  completed_count INTEGER NOT NULL,                -- Number and total size of the tiles among them that are stored;
+  completed_size INTEGER NOT NULL,                 -- the others were not found.
+  UNIQUE (region_id, url_template, min_zoom, max_zoom)
+);
+
 --
 -- Indexes for efficient eviction queries.
 --
 
-CREATE INDEX resources_accessed
-ON resources (accessed);
+CREATE INDEX resources_ambient_accessed
+ON resources (ambient, accessed);
 
-CREATE INDEX tiles_accessed
-ON tiles (accessed);
+CREATE INDEX tiles_ambient_accessed
+ON tiles (ambient, accessed);
 
 CREATE INDEX region_resources_resource_id
 ON region_resources (resource_id);
 
 CREATE INDEX region_tiles_tile_id
 ON region_tiles (tile_id);
+
+CREATE INDEX dictionaries_url_template
+ON dictionaries (url_template);
+
+CREATE INDEX tile_data_hash
+ON tile_data (hash);
+
+CREATE INDEX tiles_data_id
+ON tiles (data_id);
+
+--
+-- Triggers keeping the ambient flags in sync with the region tables, so
+-- that eviction can find the least recently used ambient entries with
+-- the indexes above instead of joining the region tables. Region
+-- deletion removes region rows by cascade, which fires the delete
+-- triggers as well. The insert triggers on resources and tiles cover
+-- REPLACE INTO, which reinserts rows that may belong to regions.
+--
+
+CREATE TRIGGER region_resources_insert AFTER INSERT ON region_resources
+BEGIN
+  UPDATE resources SET ambient = 0 WHERE id = NEW.resource_id;
+END;
+
+CREATE TRIGGER region_resources_delete AFTER DELETE ON region_resources
+BEGIN
+  UPDATE resources SET ambient = 1
+  WHERE id = OLD.resource_id
+  AND NOT EXISTS (SELECT 1 FROM region_resources WHERE resource_id = OLD.resource_id);
+END;
+
+CREATE TRIGGER resources_insert AFTER INSERT ON resources
+WHEN EXISTS (SELECT 1 FROM region_resources WHERE resource_id = NEW.id)
+BEGIN
+  UPDATE resources SET ambient = 0 WHERE id = NEW.id;
+END;
+
+CREATE TRIGGER region_tiles_insert AFTER INSERT ON region_tiles
+BEGIN
+  UPDATE tiles SET ambient = 0 WHERE id = NEW.tile_id;
+END;
+
+CREATE TRIGGER region_tiles_delete AFTER DELETE ON region_tiles
+BEGIN
+  UPDATE tiles SET ambient = 1
+  WHERE id = OLD.tile_id
+  AND NOT EXISTS (SELECT 1 FROM region_tiles WHERE tile_id = OLD.tile_id);
+END;
+
+CREATE TRIGGER tiles_insert AFTER INSERT ON tiles
+WHEN EXISTS (SELECT 1 FROM region_tiles WHERE tile_id = NEW.id)
+BEGIN
+  UPDATE tiles SET ambient = 0 WHERE id = NEW.id;
+END;
+
+--
+-- Triggers deleting tile contents once no tile refers to them anymore.
+-- REPLACE INTO doesn't fire delete triggers, so merging a sideloaded
+-- database removes unreferenced tile contents separately.
+--
+
+CREATE TRIGGER tiles_delete AFTER DELETE ON tiles
+WHEN OLD.data_id IS NOT NULL
+BEGIN
+  DELETE FROM tile_data
+  WHERE id = OLD.data_id
+  AND NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = OLD.data_id);
+END;
+
+CREATE TRIGGER tiles_update_data AFTER UPDATE OF data_id ON tiles
+WHEN OLD.data_id IS NOT NULL AND OLD.data_id IS NOT NEW.data_id
+BEGIN
+  DELETE FROM tile_data
+  WHERE id = OLD.data_id
+  AND NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = OLD.data_id);
+END;
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <mbgl/util/mapped_file.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mbgl {
+namespace pmtiles {
+
+// See https://github.com/protomaps/PMTiles/blob/main/spec/v3/spec.md
+
+enum Compression : uint8_t {
+    UnknownCompression = 0,
+    NoCompression = 1,
+    Gzip = 2,
+    Brotli = 3,
+    Zstd = 4,
+};
+
+enum TileType : uint8_t {
+    UnknownTileType = 0,
+    MVT = 1,
+    PNG = 2,
+    JPEG = 3,
+    WebP = 4,
+    AVIF = 5,
+};
+
+struct Header {
+    uint64_t rootOffset;
+    uint64_t rootLength;
+    uint64_t metadataOffset;
+    uint64_t metadataLength;
+    uint64_t leafOffset;
+    uint64_t leafLength;
+    uint64_t tileDataOffset;
+    uint64_t tileDataLength;
+    uint8_t internalCompression;
+    uint8_t tileCompression;
+    uint8_t tileType;
+    uint8_t minZoom;
+    uint8_t maxZoom;
+    double minLon;
+    double minLat;
+    double maxLon;
+    double maxLat;
+    uint8_t centerZoom;
+    double centerLon;
+    double centerLat;
+};
+
+// A run of `runLength` consecutive tile IDs starting at `tileID` that share
+// the same data, or a leaf directory if `runLength` is 0.
+struct Entry {
+    uint64_t tileID;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t runLength;
+};
+
+using Directory = std::vector<Entry>;
+
+// Tile IDs number all tiles of lower zoom levels first, then the tiles of
+// zoom level `z` along a Hilbert curve.
+uint64_t tileID(uint8_t z, uint32_t x, uint32_t y);
+
+// The inverse of tileID().
+void tileCoordinate(uint64_t id, uint8_t& z, uint32_t& x, uint32_t& y);
+
+std::string decompress(const std::string& data, uint8_t compression);
+
+// An open archive. The file stays mapped for the lifetime of the Archive.
+// Throws std::runtime_error if the file is not a valid archive, or when
+// reading a truncated or malformed part of it.
+class Archive {
+public:
+    explicit Archive(const std::string& path);
+
+    const Header& getHeader() const { return header; }
+
+    std::string metadata() const;
+
+    // Returns the stored (possibly compressed) data of a tile, pointing into
+    // the mapped file, or nothing if the archive doesn't contain the tile.
+    std::optional<std::pair<const char*, size_t>> tile(uint8_t z, uint32_t x, uint32_t y);
+
+    using TileCallback = std::function<void(uint8_t z, uint32_t x, uint32_t y, const char* data, size_t length)>;
+
+    // Calls `callback` with the stored data of every tile in the archive, in
+    // tile ID order. Runs are expanded to one call per tile, all pointing at
+    // the same data. Leaf directories are decoded once and not cached.
+    void forEachTile(const TileCallback& callback) const;
+
+private:
+    const char* range(uint64_t offset, uint64_t length) const;
+    Directory readDirectory(uint64_t offset, uint64_t length) const;
+    const Directory& leaf(uint64_t offset, uint64_t length);
+    void forEachTile(const Directory&, int depth, const TileCallback&) const;
+
+    const util::MappedFile file;
+    Header header;
+    Directory root;
+
+    // Decoded leaf directories by file offset, most recently used first.
+    std::list<std::pair<uint64_t, Directory>> leaves;
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Directory>>::iterator> leafIndex;
+};
+
+} // namespace pmtiles
+} // namespace mbgl
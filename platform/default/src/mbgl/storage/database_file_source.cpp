@@ -11,31 +11,57 @@
 #include <mbgl/util/logging.hpp>
 #include <mbgl/util/platform.hpp>
 #include <mbgl/util/thread.hpp>
+#include <mbgl/util/timer.hpp>
 
+#include <atomic>
+#include <list>
 #include <map>
 #include <utility>
+#include <vector>
 
 namespace mbgl {
+namespace {
+
+void respond(std::optional<Response> offlineResponse, const ActorRef<FileSourceRequest>& req) {
+    if (!offlineResponse) {
+        offlineResponse.emplace();
+        offlineResponse->noContent = true;
+        offlineResponse->error = std::make_unique<Response::Error>(Response::Error::Reason::NotFound,
+                                                                   "Not found in offline database");
+    } else if (!offlineResponse->isUsable()) {
+        offlineResponse->error = std::make_unique<Response::Error>(Response::Error::Reason::NotFound,
+                                                                   "Cached resource is unusable");
+    }
+    req.invoke(&FileSourceRequest::setResponse, *offlineResponse);
+}
+
+// Other connections can't open an in-memory database.
+bool isFileDatabase(const std::string& path) {
+    return !path.empty() && path != ":memory:" && path.find("mode=memory") == std::string::npos;
+}
+
+} // namespace
+
 class DatabaseFileSourceThread {
 public:
-    DatabaseFileSourceThread(std::shared_ptr<FileSource> onlineFileSource_, const std::string& cachePath)
+    DatabaseFileSourceThread(std::shared_ptr<FileSource> onlineFileSource_,
+                             const std::string& cachePath,
+                             bool writeAheadLog)
         : db(std::make_unique<OfflineDatabase>(cachePath, onlineFileSource_->getResourceOptions().tileServerOptions())),
-          onlineFileSource(std::move(onlineFileSource_)) {}
+          onlineFileSource(std::move(onlineFileSource_)) {
+        if (writeAheadLog) {
+            db->setWriteAheadLog(true);
+        }
+    }
 
     void request(const Resource& resource, const ActorRef<FileSourceRequest>& req) {
-        std::optional<Response> offlineResponse = (resource.storagePolicy != Resource::StoragePolicy::Volatile)
-                                                      ? db->get(resource)
-                                                      : std::nullopt;
-        if (!offlineResponse) {
-            offlineResponse.emplace();
-            offlineResponse->noContent = true;
-            offlineResponse->error = std::make_unique<Response::Error>(Response::Error::Reason::NotFound,
-                                                                       "Not found in offline database");
-        } else if (!offlineResponse->isUsable()) {
-            offlineResponse->error = std::make_unique<Response::Error>(Response::Error::Reason::NotFound,
-                                                                       "Cached resource is unusable");
-        }
-        req.invoke(&FileSourceRequest::setResponse, *offlineResponse);
+        respond((resource.storagePolicy != Resource::StoragePolicy::Volatile) ? db->get(resource) : std::nullopt, req);
+        scheduleFlush();
+    }
+
+    void addAccessedTimestamps(const OfflineDatabase::AccessedTimestamps& accesses) {
+        db->addAccessedTimestamps(accesses);
+        scheduleFlush();
     }
 
     void setDatabasePath(const std::string& path, const std::function<void()>& callback) {
@@ -47,6 +73,7 @@ public:
 
     void forward(const Resource& resource, const Response& response, const std::function<void()>& callback) {
         db->put(resource, response);
+        scheduleEviction(Milliseconds(500));
         if (callback) {
             callback();
         }
@@ -58,7 +85,10 @@ public:
 
     void runPackDatabaseAutomatically(bool autopack) { db->runPackDatabaseAutomatically(autopack); }
 
-    void put(const Resource& resource, const Response& response) { db->put(resource, response); }
+    void put(const Resource& resource, const Response& response) {
+        db->put(resource, response);
+        scheduleEviction(Milliseconds(500));
+    }
 
     void invalidateAmbientCache(const std::function<void(std::exception_ptr)>& callback) {
         callback(db->invalidateAmbientCache());
@@ -83,8 +113,19 @@ public:
     }
 
     void mergeOfflineRegions(const std::string& sideDatabasePath,
+                             std::unique_ptr<OfflineMergeObserver> observer,
                              const std::function<void(expected<OfflineRegions, std::exception_ptr>)>& callback) {
-        callback(db->mergeDatabase(sideDatabasePath));
+        merges.push_back({sideDatabasePath, std::move(observer), callback});
+        if (merges.size() == 1) {
+            startMerge();
+        }
+    }
+
+    void importRegionTiles(int64_t regionID,
+                           const std::string& archivePath,
+                           const std::string& urlTemplate,
+                           const std::function<void(expected<uint64_t, std::exception_ptr>)>& callback) {
+        callback(db->importRegionTiles(regionID, archivePath, urlTemplate));
     }
 
     void updateMetadata(const int64_t regionID,
@@ -128,6 +169,52 @@ public:
     void reopenDatabaseReadOnly(bool readOnly) { db->reopenDatabaseReadOnly(readOnly); }
 
 private:
+    // Write the accessed timestamps buffered by reads once requests stop
+    // coming in, e.g. after the map finished loading.
+    void scheduleFlush() {
+        if (db->hasPendingAccessedTimestamps()) {
+            flushTimer.start(Seconds(2), Duration::zero(), [this] { db->flushAccessedTimestamps(); });
+        }
+    }
+
+    // Keep the ambient cache below its watermarks once writes stop coming in.
+    // Each batch is a short transaction, and requests queued in between are
+    // handled before the next one.
+    void scheduleEviction(Duration delay) {
+        evictionTimer.start(delay, Duration::zero(), [this] {
+            if (db->evictAmbientCacheBatch()) {
+                scheduleEviction(Milliseconds(10));
+            }
+        });
+    }
+
+    // Run the first queued merge one chunk at a time. Each chunk is a short
+    // transaction, and requests queued in between are handled before the next
+    // one.
+    void startMerge() { continueMerge(db->beginMerge(merges.front().sideDatabasePath)); }
+
+    void continueMerge(const expected<OfflineMergeProgress, std::exception_ptr>& progress) {
+        PendingMerge& merge = merges.front();
+        if (progress && merge.observer) {
+            merge.observer->progressChanged(*progress);
+        }
+        if (progress && !progress->complete()) {
+            mergeTimer.start(Duration::zero(), Duration::zero(), [this] { continueMerge(db->mergeChunk()); });
+            return;
+        }
+
+        auto callback = std::move(merge.callback);
+        merges.pop_front();
+        if (progress) {
+            callback(db->finishMerge());
+        } else {
+            callback(unexpected<std::exception_ptr>(progress.error()));
+        }
+        if (!merges.empty()) {
+            mergeTimer.start(Duration::zero(), Duration::zero(), [this] { startMerge(); });
+        }
+    }
+
     expected<OfflineDownload*, std::exception_ptr> getDownload(int64_t regionID) {
         if (!onlineFileSource) {
             return unexpected<std::exception_ptr>(
@@ -150,6 +237,60 @@ private:
     std::unique_ptr<OfflineDatabase> db;
     std::map<int64_t, std::unique_ptr<OfflineDownload>> downloads;
     std::shared_ptr<FileSource> onlineFileSource;
+    util::Timer flushTimer;
+    util::Timer evictionTimer;
+
+    struct PendingMerge {
+        std::string sideDatabasePath;
+        std::unique_ptr<OfflineMergeObserver> observer;
+        std::function<void(expected<OfflineRegions, std::exception_ptr>)> callback;
+    };
+    std::list<PendingMerge> merges;
+    util::Timer mergeTimer;
+};
+
+// Serves cache lookups from a read-only connection, so that they don't queue
+// behind writes on the DatabaseFileSourceThread.
+class DatabaseFileSourceReader {
+public:
+    DatabaseFileSourceReader(ActorRef<DatabaseFileSourceThread> writer_,
+                             std::string path_,
+                             const TileServerOptions& tileServerOptions_)
+        : writer(std::move(writer_)),
+          path(std::move(path_)),
+          tileServerOptions(tileServerOptions_),
+          db(std::make_unique<OfflineDatabase>(path, tileServerOptions, true)) {}
+
+    void request(const Resource& resource, const ActorRef<FileSourceRequest>& req) {
+        respond((resource.storagePolicy != Resource::StoragePolicy::Volatile) ? db->get(resource) : std::nullopt, req);
+        if (db->hasPendingAccessedTimestamps()) {
+            auto accesses = db->takeAccessedTimestamps();
+            // A writer in read-only mode would only discard them.
+            if (!readOnlyMode) {
+                writer.invoke(&DatabaseFileSourceThread::addAccessedTimestamps, std::move(accesses));
+            }
+        }
+    }
+
+    void setReadOnlyMode(bool readOnlyMode_) { readOnlyMode = readOnlyMode_; }
+
+    void setDatabasePath(const std::string& path_) {
+        path = path_;
+        reopen();
+    }
+
+    // Called after the writer replaced or rewrote the database file.
+    void reopen() {
+        db.reset();
+        db = std::make_unique<OfflineDatabase>(path, tileServerOptions, true);
+    }
+
+private:
+    ActorRef<DatabaseFileSourceThread> writer;
+    std::string path;
+    const TileServerOptions tileServerOptions;
+    std::unique_ptr<OfflineDatabase> db;
+    bool readOnlyMode = false;
 };
 
 class DatabaseFileSource::Impl {
@@ -161,14 +302,96 @@ public:
               util::makeThreadPrioritySetter(platform::EXPERIMENTAL_THREAD_PRIORITY_DATABASE),
               "DatabaseFileSource",
               std::move(onlineFileSource),
-              resourceOptions_.cachePath())),
+              resourceOptions_.cachePath(),
+              resourceOptions_.cacheReadConnections() > 0 && isFileDatabase(resourceOptions_.cachePath()))),
           resourceOptions(resourceOptions_.clone()),
-          clientOptions(clientOptions_.clone()) {}
+          clientOptions(clientOptions_.clone()) {
+        if (!isFileDatabase(resourceOptions_.cachePath())) {
+            return;
+        }
+        for (uint32_t i = 0; i < resourceOptions_.cacheReadConnections(); ++i) {
+            readers.push_back(std::make_unique<util::Thread<DatabaseFileSourceReader>>(
+                util::makeThreadPrioritySetter(platform::EXPERIMENTAL_THREAD_PRIORITY_DATABASE),
+                "DatabaseFileSourceReader",
+                thread->actor(),
+                resourceOptions_.cachePath(),
+                resourceOptions_.tileServerOptions()));
+        }
+    }
 
     ActorRef<DatabaseFileSourceThread> actor() const { return thread->actor(); }
 
-    void pause() { thread->pause(); }
-    void resume() { thread->resume(); }
+    void request(const Resource& resource, const ActorRef<FileSourceRequest>& req) {
+        if (readers.empty()) {
+            actor().invoke(&DatabaseFileSourceThread::request, resource, req);
+        } else {
+            readers[nextReader++ % readers.size()]->actor().invoke(&DatabaseFileSourceReader::request, resource, req);
+        }
+    }
+
+    // Wraps a callback of an operation that replaces or rewrites the database
+    // file, so that the read connections open the new file once it is in place.
+    template <typename... Args>
+    std::function<void(Args...)> reopenReaders(std::function<void(Args...)> callback,
+                                               std::optional<std::string> path = std::nullopt) {
+        if (readers.empty()) {
+            return callback;
+        }
+        std::vector<ActorRef<DatabaseFileSourceReader>> actors;
+        for (const auto& reader : readers) {
+            actors.push_back(reader->actor());
+        }
+        return [actors = std::move(actors), path = std::move(path), callback = std::move(callback)](Args... args) {
+            for (const auto& reader : actors) {
+                if (path) {
+                    reader.invoke(&DatabaseFileSourceReader::setDatabasePath, *path);
+                } else {
+                    reader.invoke(&DatabaseFileSourceReader::reopen);
+                }
+            }
+            if (callback) {
+                callback(std::forward<Args>(args)...);
+            }
+        };
+    }
+
+    // Wraps a callback of an operation that drops or invalidates resources,
+    // which resource loaders may still keep in memory. The generation changes
+    // when the operation starts and again once it is done, so that responses
+    // read in between aren't kept either.
+    template <typename... Args>
+    std::function<void(Args...)> nextGeneration(std::function<void(Args...)> callback) {
+        ++*generation;
+        return [generation_ = generation, callback = std::move(callback)](Args... args) {
+            ++*generation_;
+            if (callback) {
+                callback(std::forward<Args>(args)...);
+            }
+        };
+    }
+
+    uint64_t getGeneration() const { return *generation; }
+
+    void reopenDatabaseReadOnly(bool readOnly) {
+        actor().invoke(&DatabaseFileSourceThread::reopenDatabaseReadOnly, readOnly);
+        for (const auto& reader : readers) {
+            reader->actor().invoke(&DatabaseFileSourceReader::setReadOnlyMode, readOnly);
+        }
+    }
+
+    void pause() {
+        thread->pause();
+        for (auto& reader : readers) {
+            reader->pause();
+        }
+    }
+
+    void resume() {
+        thread->resume();
+        for (auto& reader : readers) {
+            reader->resume();
+        }
+    }
 
     void setResourceOptions(ResourceOptions options) {
         std::lock_guard<std::mutex> lock(resourceOptionsMutex);
@@ -192,6 +415,9 @@ public:
 
 private:
     const std::unique_ptr<util::Thread<DatabaseFileSourceThread>> thread;
+    std::vector<std::unique_ptr<util::Thread<DatabaseFileSourceReader>>> readers;
+    std::atomic<std::size_t> nextReader{0};
+    const std::shared_ptr<std::atomic<uint64_t>> generation = std::make_shared<std::atomic<uint64_t>>(0);
     mutable std::mutex resourceOptionsMutex;
     mutable std::mutex clientOptionsMutex;
     ResourceOptions resourceOptions;
@@ -208,7 +434,7 @@ DatabaseFileSource::~DatabaseFileSource() = default;
 
 std::unique_ptr<AsyncRequest> DatabaseFileSource::request(const Resource& resource, Callback callback) {
     auto req = std::make_unique<FileSourceRequest>(std::move(callback));
-    impl->actor().invoke(&DatabaseFileSourceThread::request, resource, req->actor());
+    impl->request(resource, req->actor());
     return req;
 }
 
@@ -229,15 +455,18 @@ bool DatabaseFileSource::canRequest(const Resource& resource) const {
 }
 
 void DatabaseFileSource::setDatabasePath(const std::string& path, std::function<void()> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::setDatabasePath, path, std::move(callback));
+    impl->actor().invoke(&DatabaseFileSourceThread::setDatabasePath,
+                         path,
+                         impl->reopenReaders(impl->nextGeneration(std::move(callback)), path));
 }
 
 void DatabaseFileSource::resetDatabase(std::function<void(std::exception_ptr)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::resetDatabase, std::move(callback));
+    impl->actor().invoke(&DatabaseFileSourceThread::resetDatabase,
+                         impl->reopenReaders(impl->nextGeneration(std::move(callback))));
 }
 
 void DatabaseFileSource::packDatabase(std::function<void(std::exception_ptr)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::packDatabase, std::move(callback));
+    impl->actor().invoke(&DatabaseFileSourceThread::packDatabase, impl->reopenReaders(std::move(callback)));
 }
 
 void DatabaseFileSource::runPackDatabaseAutomatically(bool autopack) {
@@ -249,11 +478,12 @@ void DatabaseFileSource::put(const Resource& resource, const Response& response)
 }
 
 void DatabaseFileSource::invalidateAmbientCache(std::function<void(std::exception_ptr)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::invalidateAmbientCache, std::move(callback));
+    impl->actor().invoke(&DatabaseFileSourceThread::invalidateAmbientCache, impl->nextGeneration(std::move(callback)));
 }
 
 void DatabaseFileSource::clearAmbientCache(std::function<void(std::exception_ptr)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::clearAmbientCache, std::move(callback));
+    impl->actor().invoke(&DatabaseFileSourceThread::clearAmbientCache,
+                         impl->reopenReaders(impl->nextGeneration(std::move(callback))));
 }
 
 void DatabaseFileSource::setMaximumAmbientCacheSize(uint64_t size, std::function<void(std::exception_ptr)> callback) {
@@ -274,7 +504,24 @@ void DatabaseFileSource::createOfflineRegion(
 
 void DatabaseFileSource::mergeOfflineRegions(
     const std::string& sideDatabasePath, std::function<void(expected<OfflineRegions, std::exception_ptr>)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::mergeOfflineRegions, sideDatabasePath, std::move(callback));
+    mergeOfflineRegions(sideDatabasePath, nullptr, std::move(callback));
+}
+
+void DatabaseFileSource::mergeOfflineRegions(
+    const std::string& sideDatabasePath,
+    std::unique_ptr<OfflineMergeObserver> observer,
+    std::function<void(expected<OfflineRegions, std::exception_ptr>)> callback) {
+    impl->actor().invoke(
+        &DatabaseFileSourceThread::mergeOfflineRegions, sideDatabasePath, std::move(observer), std::move(callback));
+}
+
+void DatabaseFileSource::importOfflineRegionTiles(
+    const OfflineRegion& region,
+    const std::string& archivePath,
+    const std::string& urlTemplate,
+    std::function<void(expected<uint64_t, std::exception_ptr>)> callback) {
+    impl->actor().invoke(
+        &DatabaseFileSourceThread::importRegionTiles, region.getID(), archivePath, urlTemplate, std::move(callback));
 }
 
 void DatabaseFileSource::updateOfflineMetadata(
@@ -286,12 +533,13 @@ void DatabaseFileSource::updateOfflineMetadata(
 
 void DatabaseFileSource::deleteOfflineRegion(const OfflineRegion& region,
                                              std::function<void(std::exception_ptr)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::deleteRegion, region, std::move(callback));
+    impl->actor().invoke(&DatabaseFileSourceThread::deleteRegion, region, impl->nextGeneration(std::move(callback)));
 }
 
 void DatabaseFileSource::invalidateOfflineRegion(const OfflineRegion& region,
                                                  std::function<void(std::exception_ptr)> callback) {
-    impl->actor().invoke(&DatabaseFileSourceThread::invalidateRegion, region.getID(), std::move(callback));
+    impl->actor().invoke(
+        &DatabaseFileSourceThread::invalidateRegion, region.getID(), impl->nextGeneration(std::move(callback)));
 }
 
 void DatabaseFileSource::setOfflineRegionObserver(const OfflineRegion& region,
@@ -315,13 +563,20 @@ void DatabaseFileSource::setOfflineMapboxTileCountLimit(uint64_t limit) const {
 
 void DatabaseFileSource::setProperty(const std::string& key, const mapbox::base::Value& value) {
     if (key == READ_ONLY_MODE_KEY && value.getBool()) {
-        impl->actor().invoke(&DatabaseFileSourceThread::reopenDatabaseReadOnly, *value.getBool());
+        impl->reopenDatabaseReadOnly(*value.getBool());
     } else {
         std::string message = "Resource provider does not support property " + key;
         Log::Error(Event::General, message.c_str());
     }
 }
 
+mapbox::base::Value DatabaseFileSource::getProperty(const std::string& key) const {
+    if (key == CACHE_GENERATION_KEY) {
+        return impl->getGeneration();
+    }
+    return {};
+}
+
 void DatabaseFileSource::pause() {
     impl->pause();
 }
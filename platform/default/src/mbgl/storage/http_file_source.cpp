@@ -49,6 +49,7 @@ public:
     CURL *getHandle();
     void returnHandle(CURL *handle);
     void checkMultiInfo();
+    void updateConnectionLimits();
 
     // Used as the CURL timer function to periodically check for socket updates.
     util::Timer timeout;
@@ -64,6 +65,13 @@ public:
     // creating and destroying them all the time.
     std::queue<CURL *> handles;
 
+    // Whether libcurl was built with HTTP/2 support.
+    bool http2 = false;
+
+    // The connection limits the multi handle currently uses.
+    uint32_t maximumConnectionsPerHost = 0;
+    uint32_t connectionCacheSize = 0;
+
     void setResourceOptions(ResourceOptions options);
     ResourceOptions getResourceOptions();
 
@@ -98,6 +106,7 @@ private:
 
     std::optional<std::string> retryAfter;
     std::optional<std::string> xRateLimitReset;
+    std::optional<std::string> contentEncoding;
 
     CURL *handle = nullptr;
     curl_slist *headers = nullptr;
@@ -112,13 +121,25 @@ HTTPFileSource::Impl::Impl(const ResourceOptions &resourceOptions_, const Client
         throw std::runtime_error("Could not init cURL");
     }
 
+    // Requests share DNS lookups and TLS sessions, so that new connections
+    // to a host can resume a session instead of a full handshake.
     share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
 
     multi = curl_multi_init();
     handleError(curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, handleSocket));
     handleError(curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this));
     handleError(curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, startTimeout));
     handleError(curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this));
+#if LIBCURL_VERSION_NUM >= ((7) << 16 | (43) << 8 | 0) // Added in 7.43.0
+    // Run concurrent requests to an HTTP/2 host as streams of one connection.
+    handleError(curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX));
+#endif
+#if LIBCURL_VERSION_NUM >= ((7) << 16 | (47) << 8 | 0) // Added in 7.47.0
+    http2 = (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+#endif
+    updateConnectionLimits();
 }
 
 HTTPFileSource::Impl::~Impl() {
@@ -151,6 +172,28 @@ void HTTPFileSource::Impl::returnHandle(CURL *handle) {
     handles.push(handle);
 }
 
+void HTTPFileSource::Impl::updateConnectionLimits() {
+    uint32_t perHost = 0;
+    uint32_t cacheSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(resourceOptionsMutex);
+        perHost = resourceOptions.maximumConnectionsPerHost();
+        cacheSize = resourceOptions.connectionCacheSize();
+    }
+    if (perHost != maximumConnectionsPerHost) {
+        maximumConnectionsPerHost = perHost;
+#if LIBCURL_VERSION_NUM >= ((7) << 16 | (30) << 8 | 0) // Added in 7.30.0
+        handleError(curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(perHost)));
+#endif
+    }
+    if (cacheSize != connectionCacheSize) {
+        connectionCacheSize = cacheSize;
+#if LIBCURL_VERSION_NUM >= ((7) << 16 | (16) << 8 | 3) // Added in 7.16.3
+        handleError(curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(cacheSize)));
+#endif
+    }
+}
+
 void HTTPFileSource::Impl::checkMultiInfo() {
     CURLMsg *message = nullptr;
     int pending = 0;
@@ -263,6 +306,8 @@ HTTPRequest::HTTPRequest(HTTPFileSource::Impl *context_, Resource resource_, Fil
       resource(std::move(resource_)),
       callback(std::move(callback_)),
       handle(context->getHandle()) {
+    context->updateConnectionLimits();
+
     // If there's already a response, set the correct etags/modified headers to
     // make sure we are getting a 304 response if possible. This avoids
     // redownloading unchanged data.
@@ -286,13 +331,32 @@ HTTPRequest::HTTPRequest(HTTPFileSource::Impl *context_, Resource resource_, Fil
     handleError(curl_easy_setopt(handle, CURLOPT_WRITEDATA, this));
     handleError(curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, headerCallback));
     handleError(curl_easy_setopt(handle, CURLOPT_HEADERDATA, this));
+    // Callers that accept compressed data get gzip bodies as they arrive, so
+    // that they can be cached without recompressing them.
+    const char *const acceptEncoding = resource.acceptsCompressedData ? "gzip" : "gzip, deflate";
 #if LIBCURL_VERSION_NUM >= ((7) << 16 | (21) << 8 | 6) // Renamed in 7.21.6
-    handleError(curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "gzip, deflate"));
+    handleError(curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, acceptEncoding));
 #else
-    handleError(curl_easy_setopt(handle, CURLOPT_ENCODING, "gzip, deflate"));
+    handleError(curl_easy_setopt(handle, CURLOPT_ENCODING, acceptEncoding));
 #endif
+    if (resource.acceptsCompressedData) {
+        handleError(curl_easy_setopt(handle, CURLOPT_HTTP_CONTENT_DECODING, 0L));
+    }
     handleError(curl_easy_setopt(handle, CURLOPT_USERAGENT, "MapboxGL/1.0"));
     handleError(curl_easy_setopt(handle, CURLOPT_SHARE, context->share));
+#if LIBCURL_VERSION_NUM >= ((7) << 16 | (47) << 8 | 0) // Added in 7.47.0
+    // Negotiate HTTP/2 for TLS connections. libcurl rejects the option when
+    // it was built without HTTP/2 support.
+    if (context->http2) {
+        handleError(curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS));
+    }
+#endif
+#if LIBCURL_VERSION_NUM >= ((7) << 16 | (43) << 8 | 0) // Added in 7.43.0
+    // Wait for a connection to the same host that is being set up, rather
+    // than opening another one, so that the request can become one of its
+    // streams.
+    handleError(curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L));
+#endif
 
     // Start requesting the information.
     handleError(curl_multi_add_handle(context->multi, handle));
@@ -376,6 +440,12 @@ size_t HTTPRequest::headerCallback(char *const buffer, const size_t size, const
     } else if ((begin = headerMatches("x-rate-limit-reset: ", buffer, length)) != std::string::npos) {
         baton->xRateLimitReset = std::string(buffer + begin,
                                              length - begin - 2); // remove \r\n
+    } else if ((begin = headerMatches("content-encoding: ", buffer, length)) != std::string::npos) {
+        baton->contentEncoding = std::string(buffer + begin,
+                                             length - begin - 2); // remove \r\n
+    } else if (headerMatches("http/", buffer, length) != std::string::npos) {
+        // A new status line, e.g. after a redirect; forget the previous response's encoding.
+        baton->contentEncoding = std::nullopt;
     }
     // NOLINTEND(bugprone-assignment-in-if-condition)
 
@@ -411,12 +481,19 @@ void HTTPRequest::handleResult(CURLcode code) {
         long responseCode = 0;
         curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &responseCode);
 
-        if (responseCode == 200) {
+        const bool passthrough = resource.acceptsCompressedData && contentEncoding && *contentEncoding != "identity";
+        if (responseCode == 200 && passthrough && *contentEncoding != "gzip") {
+            // Content decoding is disabled for this request, and the body is in
+            // an encoding that can't be decoded later.
+            response->error = std::make_unique<Error>(Error::Reason::Other,
+                                                      "Unsupported content encoding " + *contentEncoding);
+        } else if (responseCode == 200) {
             if (data) {
                 response->data = std::move(data);
             } else {
                 response->data = std::make_shared<std::string>();
             }
+            response->compressed = passthrough && !response->data->empty();
         } else if (responseCode == 204 || (responseCode == 404 && resource.kind == Resource::Kind::Tile)) {
             response->noContent = true;
         } else if (responseCode == 304) {
@@ -10,10 +10,148 @@
 #include <mbgl/util/stopwatch.hpp>
 #include <mbgl/util/thread.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <list>
 #include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
 
 namespace mbgl {
+namespace {
+
+using CoalescingKey = std::tuple<std::string,
+                                 Resource::Kind,
+                                 Resource::LoadingMethod,
+                                 Resource::Usage,
+                                 Resource::StoragePolicy,
+                                 bool,
+                                 Duration::rep,
+                                 std::string,
+                                 uint8_t,
+                                 int32_t,
+                                 int32_t,
+                                 int8_t>;
+
+// Identical requests for a resource may share one response, whatever their
+// priority. Revalidation requests carry the state of their requester, so they
+// are never shared.
+std::optional<CoalescingKey> coalescingKey(const Resource& resource) {
+    if (resource.priorModified || resource.priorExpires || resource.priorEtag || resource.priorData) {
+        return std::nullopt;
+    }
+    CoalescingKey key{resource.url,
+                      resource.kind,
+                      resource.loadingMethod,
+                      resource.usage,
+                      resource.storagePolicy,
+                      resource.acceptsCompressedData,
+                      resource.minimumUpdateInterval.count(),
+                      {},
+                      0,
+                      0,
+                      0,
+                      0};
+    if (resource.tileData) {
+        std::get<7>(key) = resource.tileData->urlTemplate;
+        std::get<8>(key) = resource.tileData->pixelRatio;
+        std::get<9>(key) = resource.tileData->x;
+        std::get<10>(key) = resource.tileData->y;
+        std::get<11>(key) = resource.tileData->z;
+    }
+    return key;
+}
+
+struct MemoryCacheStats {
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+};
+
+// The most recently used responses, up to a number of bytes of URLs and data.
+class MemoryCache {
+public:
+    void setMaximumSize(uint64_t size) {
+        maximumSize = size;
+        evict(0);
+    }
+
+    bool enabled() const { return maximumSize > 0; }
+
+    void clear() {
+        entries.clear();
+        index.clear();
+        currentSize = 0;
+    }
+
+    std::optional<Response> get(const std::string& url) {
+        auto it = index.find(url);
+        if (it == index.end()) {
+            return std::nullopt;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->response;
+    }
+
+    // Keeps track of the latest response for a resource.
+    void update(const std::string& url, const Response& response) {
+        if (response.notModified) {
+            auto it = index.find(url);
+            if (it != index.end()) {
+                it->second->response.expires = response.expires;
+                it->second->response.modified = response.modified;
+                it->second->response.etag = response.etag;
+                it->second->response.mustRevalidate = response.mustRevalidate;
+            }
+        } else if (response.noContent ||
+                   (response.error && response.error->reason == Response::Error::Reason::NotFound)) {
+            erase(url);
+        } else if (!response.error && response.data) {
+            erase(url);
+            const uint64_t size = url.size() + response.data->size();
+            if (size <= maximumSize) {
+                evict(size);
+                entries.push_front({url, response, size});
+                index.emplace(url, entries.begin());
+                currentSize += size;
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        std::string url;
+        Response response;
+        uint64_t size;
+    };
+
+    void erase(const std::string& url) {
+        auto it = index.find(url);
+        if (it != index.end()) {
+            currentSize -= it->second->size;
+            entries.erase(it->second);
+            index.erase(it);
+        }
+    }
+
+    // Makes room for `size` more bytes.
+    void evict(uint64_t size) {
+        while (!entries.empty() && currentSize + size > maximumSize) {
+            currentSize -= entries.back().size;
+            index.erase(entries.back().url);
+            entries.pop_back();
+        }
+    }
+
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    uint64_t currentSize = 0;
+    uint64_t maximumSize = 0;
+};
+
+} // namespace
 
 class MainResourceLoaderThread {
 public:
@@ -21,16 +159,71 @@ public:
                              std::shared_ptr<FileSource> databaseFileSource_,
                              std::shared_ptr<FileSource> localFileSource_,
                              std::shared_ptr<FileSource> onlineFileSource_,
-                             std::shared_ptr<FileSource> mbtilesFileSource_)
+                             std::shared_ptr<FileSource> mbtilesFileSource_,
+                             std::shared_ptr<FileSource> pmtilesFileSource_,
+                             uint64_t memoryCacheSize,
+                             std::shared_ptr<MemoryCacheStats> memoryCacheStats_)
         : assetFileSource(std::move(assetFileSource_)),
           databaseFileSource(std::move(databaseFileSource_)),
           localFileSource(std::move(localFileSource_)),
           onlineFileSource(std::move(onlineFileSource_)),
-          mbtilesFileSource(std::move(mbtilesFileSource_)) {}
+          mbtilesFileSource(std::move(mbtilesFileSource_)),
+          pmtilesFileSource(std::move(pmtilesFileSource_)),
+          memoryCacheStats(std::move(memoryCacheStats_)) {
+        memoryCache.setMaximumSize(memoryCacheSize);
+    }
 
     void request(AsyncRequest* req, const Resource& resource, const ActorRef<FileSourceRequest>& ref) {
-        auto callback = [ref](const Response& res) {
-            ref.invoke(&FileSourceRequest::setResponse, res);
+        // Attach to an identical request that hasn't been answered yet, e.g.
+        // the same tile requested by another map.
+        const auto key = coalescingKey(resource);
+        if (key) {
+            auto it = inFlight.find(*key);
+            if (it != inFlight.end()) {
+                Group& group = *it->second;
+                group.requesters.emplace(req, Requester{ref, resource.priority, resource.priorityOrder});
+                requests.emplace(req, group.shared_from_this());
+                reprioritize(group);
+                return;
+            }
+        }
+
+        auto group = std::make_shared<Group>(resource);
+        group->requesters.emplace(req, Requester{ref, resource.priority, resource.priorityOrder});
+        requests.emplace(req, group);
+        if (key) {
+            group->key = key;
+            inFlight.emplace(*key, group.get());
+        }
+
+        // Only resources that would otherwise come from the cache database
+        // are kept in memory.
+        const bool memoryCacheable = memoryCache.enabled() && databaseFileSource &&
+                                     databaseFileSource->canRequest(resource) &&
+                                     resource.storagePolicy == Resource::StoragePolicy::Permanent &&
+                                     resource.usage == Resource::Usage::Online;
+        if (memoryCacheable) {
+            checkDatabaseGeneration();
+        }
+
+        Group* const target = group.get();
+        auto callback = [this, target, memoryCacheable, generation = databaseGeneration, url = resource.url](
+                            const Response& res) {
+            // Requests made from now on may expect a fresher response.
+            if (target->key) {
+                inFlight.erase(*target->key);
+                target->key.reset();
+            }
+            if (memoryCacheable) {
+                // The response may predate the database dropping it.
+                checkDatabaseGeneration();
+                if (generation == databaseGeneration) {
+                    memoryCache.update(url, res);
+                }
+            }
+            for (const auto& requester : target->requesters) {
+                requester.second.ref.invoke(&FileSourceRequest::setResponse, res);
+            }
         };
 
         auto requestFromNetwork = [=](const Resource& res,
@@ -60,28 +253,47 @@ public:
             });
         };
 
-        // Initial tasksSize is used to check whether any of
-        // the sources were able to request a resource.
-        const std::size_t tasksSize = tasks.size();
+        // Set when the request was answered from memory without a source request.
+        bool answered = false;
 
         // Waterfall resource request processing and return early once resource was requested.
         if (assetFileSource && assetFileSource->canRequest(resource)) {
             // Asset request
-            tasks[req] = assetFileSource->request(resource, callback);
+            target->task = assetFileSource->request(resource, callback);
         } else if (mbtilesFileSource && mbtilesFileSource->canRequest(resource)) {
             // Local file request
-            tasks[req] = mbtilesFileSource->request(resource, callback);
+            target->task = mbtilesFileSource->request(resource, callback);
+        } else if (pmtilesFileSource && pmtilesFileSource->canRequest(resource)) {
+            // Local file request
+            target->task = pmtilesFileSource->request(resource, callback);
         } else if (localFileSource && localFileSource->canRequest(resource)) {
             // Local file request
-            tasks[req] = localFileSource->request(resource, callback);
+            target->task = localFileSource->request(resource, callback);
+        } else if (auto cached = memoryCacheable ? getFromMemoryCache(resource) : std::nullopt) {
+            // Fresh response in memory. As for a database hit, the network
+            // refreshes the resource once it expires.
+            callback(*cached);
+            answered = true;
+            if (resource.loadingMethod != Resource::LoadingMethod::CacheOnly) {
+                Resource res = resource;
+                res.setPriority(Resource::Priority::Low);
+                res.priorModified = cached->modified;
+                res.priorExpires = cached->expires;
+                res.priorEtag = cached->etag;
+                target->task = requestFromNetwork(res, nullptr);
+            }
         } else if (databaseFileSource && databaseFileSource->canRequest(resource)) {
             // Try cache only request if needed.
             if (resource.loadingMethod == Resource::LoadingMethod::CacheOnly) {
-                tasks[req] = databaseFileSource->request(resource, callback);
+                target->task = databaseFileSource->request(resource, callback);
             } else {
                 // Cache request with fallback to network with cache control
-                tasks[req] = databaseFileSource->request(resource, [=](const Response& response) {
+                target->task = databaseFileSource->request(resource, [=](const Response& response) {
                     Resource res = resource;
+                    // The priority may have changed while the cache was being read.
+                    res.setPriority(target->resource.priority);
+                    res.priorityOrder = target->resource.priorityOrder;
+                    bool revalidatesUsable = false;
 
                     // Resource is in the cache
                     if (!response.noContent) {
@@ -89,12 +301,14 @@ public:
                             callback(response);
                             // Set the priority of existing resource to low if it's expired but usable.
                             res.setPriority(Resource::Priority::Low);
+                            revalidatesUsable = true;
                         } else {
                             // Set prior data only if it was not returned to
                             // the requester. Once we get 304 response from
                             // the network, we will forward response to the
                             // requester.
                             res.priorData = response.data;
+                            res.priorDataCompressed = response.compressed;
                         }
 
                         // Copy response fields for cache control request
@@ -103,16 +317,19 @@ public:
                         res.priorEtag = response.etag;
                     }
 
-                    tasks[req] = requestFromNetwork(res, std::move(tasks[req]));
+                    target->task = requestFromNetwork(res, std::move(target->task));
+                    target->followsPriority = !revalidatesUsable && onlineFileSource &&
+                                              onlineFileSource->canRequest(resource);
                 });
             }
         } else if (auto networkReq = requestFromNetwork(resource, nullptr)) {
             // Get from the online file source
-            tasks[req] = std::move(networkReq);
+            target->task = std::move(networkReq);
+            target->followsPriority = true;
         }
 
-        // If no new tasks were added, notify client that request cannot be processed.
-        if (tasks.size() == tasksSize) {
+        // If no source took the request, notify client that request cannot be processed.
+        if (!target->task && !answered) {
             Response response;
             response.noContent = true;
             response.error = std::make_unique<Response::Error>(Response::Error::Reason::Other,
@@ -121,18 +338,116 @@ public:
         }
     }
 
+    void updatePriority(AsyncRequest* req, const Resource& resource) {
+        auto it = requests.find(req);
+        if (it == requests.end()) {
+            return;
+        }
+        Group& group = *it->second;
+        Requester& requester = group.requesters.at(req);
+        requester.priority = resource.priority;
+        requester.priorityOrder = resource.priorityOrder;
+        reprioritize(group);
+    }
+
+    void setMemoryCacheSize(uint64_t size) { memoryCache.setMaximumSize(size); }
+
     void cancel(AsyncRequest* req) {
         assert(req);
-        tasks.erase(req);
+        auto it = requests.find(req);
+        if (it == requests.end()) {
+            return;
+        }
+        // Dropping the last reference to the group cancels its source request.
+        const std::shared_ptr<Group> group = std::move(it->second);
+        requests.erase(it);
+        group->requesters.erase(req);
+        if (!group->requesters.empty()) {
+            reprioritize(*group);
+        } else if (group->key) {
+            inFlight.erase(*group->key);
+        }
     }
 
 private:
+    struct Group;
+
+    // Gives the source request of a group the priority of its most urgent
+    // requester.
+    void reprioritize(Group& group) {
+        const auto mostUrgent = std::min_element(
+            group.requesters.begin(), group.requesters.end(), [](const auto& lhs, const auto& rhs) {
+                return std::tie(lhs.second.priority, lhs.second.priorityOrder) <
+                       std::tie(rhs.second.priority, rhs.second.priorityOrder);
+            });
+        if (mostUrgent == group.requesters.end() ||
+            (mostUrgent->second.priority == group.resource.priority &&
+             mostUrgent->second.priorityOrder == group.resource.priorityOrder)) {
+            return;
+        }
+        group.resource.setPriority(mostUrgent->second.priority);
+        group.resource.priorityOrder = mostUrgent->second.priorityOrder;
+        if (group.followsPriority && group.task) {
+            onlineFileSource->updatePriority(*group.task, group.resource);
+        }
+    }
+
+    // Forgets the responses in memory once the cache database has dropped or
+    // invalidated resources, e.g. because the ambient cache was cleared.
+    void checkDatabaseGeneration() {
+        auto value = databaseFileSource->getProperty(CACHE_GENERATION_KEY);
+        const uint64_t* generation = value.getUint();
+        if (generation && *generation != databaseGeneration) {
+            databaseGeneration = *generation;
+            memoryCache.clear();
+        }
+    }
+
+    std::optional<Response> getFromMemoryCache(const Resource& resource) {
+        auto response = memoryCache.get(resource.url);
+        if (response && response->isFresh() && (!response->compressed || resource.acceptsCompressedData)) {
+            ++memoryCacheStats->hits;
+            return response;
+        }
+        ++memoryCacheStats->misses;
+        return std::nullopt;
+    }
+
     const std::shared_ptr<FileSource> assetFileSource;
     const std::shared_ptr<FileSource> databaseFileSource;
     const std::shared_ptr<FileSource> localFileSource;
     const std::shared_ptr<FileSource> onlineFileSource;
     const std::shared_ptr<FileSource> mbtilesFileSource;
-    std::map<AsyncRequest*, std::unique_ptr<AsyncRequest>> tasks;
+    const std::shared_ptr<FileSource> pmtilesFileSource;
+    const std::shared_ptr<MemoryCacheStats> memoryCacheStats;
+    MemoryCache memoryCache;
+    uint64_t databaseGeneration = 0;
+
+    struct Requester {
+        ActorRef<FileSourceRequest> ref;
+        Resource::Priority priority;
+        uint32_t priorityOrder;
+    };
+
+    // Requests that share one source request.
+    struct Group : std::enable_shared_from_this<Group> {
+        explicit Group(Resource resource_)
+            : resource(std::move(resource_)) {}
+
+        std::unique_ptr<AsyncRequest> task;
+        std::map<AsyncRequest*, Requester> requesters;
+        // The requested resource, with the priority of the most urgent
+        // requester, which a network request made after a cache lookup uses.
+        Resource resource;
+        // Set when the task is a network request made on behalf of the
+        // requesters, which is reprioritized along with them.
+        bool followsPriority = false;
+        // Set while other requests may still join.
+        std::optional<CoalescingKey> key;
+    };
+
+    std::map<AsyncRequest*, std::shared_ptr<Group>> requests;
+    std::map<CoalescingKey, Group*> inFlight;
 };
 
 class MainResourceLoader::Impl {
@@ -143,13 +458,16 @@ public:
          std::shared_ptr<FileSource> databaseFileSource_,
          std::shared_ptr<FileSource> localFileSource_,
          std::shared_ptr<FileSource> onlineFileSource_,
-         std::shared_ptr<FileSource> mbtilesFileSource_)
+         std::shared_ptr<FileSource> mbtilesFileSource_,
+         std::shared_ptr<FileSource> pmtilesFileSource_)
         : assetFileSource(std::move(assetFileSource_)),
           databaseFileSource(std::move(databaseFileSource_)),
           localFileSource(std::move(localFileSource_)),
           onlineFileSource(std::move(onlineFileSource_)),
           mbtilesFileSource(std::move(mbtilesFileSource_)),
+          pmtilesFileSource(std::move(pmtilesFileSource_)),
           supportsCacheOnlyRequests_(bool(databaseFileSource)),
+          memoryCacheStats(std::make_shared<MemoryCacheStats>()),
           thread(std::make_unique<util::Thread<MainResourceLoaderThread>>(
               util::makeThreadPrioritySetter(platform::EXPERIMENTAL_THREAD_PRIORITY_WORKER),
               "ResourceLoaderThread",
@@ -157,7 +475,10 @@ public:
               databaseFileSource,
               localFileSource,
               onlineFileSource,
-              mbtilesFileSource)),
+              mbtilesFileSource,
+              pmtilesFileSource,
+              resourceOptions_.memoryCacheSize(),
+              memoryCacheStats)),
           resourceOptions(resourceOptions_.clone()),
           clientOptions(clientOptions_.clone()) {}
 
@@ -171,16 +492,30 @@ public:
         return req;
     }
 
+    void updatePriority(AsyncRequest& req, const Resource& resource) {
+        thread->actor().invoke(&MainResourceLoaderThread::updatePriority, &req, resource);
+    }
+
     bool canRequest(const Resource& resource) const {
         return (assetFileSource && assetFileSource->canRequest(resource)) ||
                (localFileSource && localFileSource->canRequest(resource)) ||
                (databaseFileSource && databaseFileSource->canRequest(resource)) ||
                (onlineFileSource && onlineFileSource->canRequest(resource)) ||
-               (mbtilesFileSource && mbtilesFileSource->canRequest(resource));
+               (mbtilesFileSource && mbtilesFileSource->canRequest(resource)) ||
+               (pmtilesFileSource && pmtilesFileSource->canRequest(resource));
     }
 
     bool supportsCacheOnlyRequests() const { return supportsCacheOnlyRequests_; }
 
+    mapbox::base::Value getProperty(const std::string& key) const {
+        if (key == MEMORY_CACHE_HITS_KEY) {
+            return uint64_t(memoryCacheStats->hits);
+        } else if (key == MEMORY_CACHE_MISSES_KEY) {
+            return uint64_t(memoryCacheStats->misses);
+        }
+        return {};
+    }
+
     void pause() { thread->pause(); }
 
     void resume() { thread->resume(); }
@@ -193,6 +528,8 @@ public:
         localFileSource->setResourceOptions(options.clone());
         onlineFileSource->setResourceOptions(options.clone());
         mbtilesFileSource->setResourceOptions(options.clone());
+        pmtilesFileSource->setResourceOptions(options.clone());
+        thread->actor().invoke(&MainResourceLoaderThread::setMemoryCacheSize, options.memoryCacheSize());
     }
 
     ResourceOptions getResourceOptions() {
@@ -208,6 +545,7 @@ public:
         localFileSource->setClientOptions(options.clone());
         onlineFileSource->setClientOptions(options.clone());
         mbtilesFileSource->setClientOptions(options.clone());
+        pmtilesFileSource->setClientOptions(options.clone());
     }
 
     ClientOptions getClientOptions() {
@@ -221,7 +559,9 @@ private:
     const std::shared_ptr<FileSource> localFileSource;
     const std::shared_ptr<FileSource> onlineFileSource;
     const std::shared_ptr<FileSource> mbtilesFileSource;
+    const std::shared_ptr<FileSource> pmtilesFileSource;
     const bool supportsCacheOnlyRequests_;
+    const std::shared_ptr<MemoryCacheStats> memoryCacheStats;
     const std::unique_ptr<util::Thread<MainResourceLoaderThread>> thread;
     mutable std::mutex resourceOptionsMutex;
     ResourceOptions resourceOptions;
@@ -237,7 +577,8 @@ MainResourceLoader::MainResourceLoader(const ResourceOptions& resourceOptions, c
           FileSourceManager::get()->getFileSource(FileSourceType::Database, resourceOptions, clientOptions),
           FileSourceManager::get()->getFileSource(FileSourceType::FileSystem, resourceOptions, clientOptions),
           FileSourceManager::get()->getFileSource(FileSourceType::Network, resourceOptions, clientOptions),
-          FileSourceManager::get()->getFileSource(FileSourceType::Mbtiles, resourceOptions, clientOptions))) {}
+          FileSourceManager::get()->getFileSource(FileSourceType::Mbtiles, resourceOptions, clientOptions),
+          FileSourceManager::get()->getFileSource(FileSourceType::Pmtiles, resourceOptions, clientOptions))) {}
 
 MainResourceLoader::~MainResourceLoader() = default;
 
@@ -249,10 +590,18 @@ std::unique_ptr<AsyncRequest> MainResourceLoader::request(const Resource& resour
     return impl->request(resource, std::move(callback));
 }
 
+void MainResourceLoader::updatePriority(AsyncRequest& req, const Resource& resource) {
+    impl->updatePriority(req, resource);
+}
+
 bool MainResourceLoader::canRequest(const Resource& resource) const {
     return impl->canRequest(resource);
 }
 
+mapbox::base::Value MainResourceLoader::getProperty(const std::string& key) const {
+    return impl->getProperty(key);
+}
+
 void MainResourceLoader::pause() {
     impl->pause();
 }
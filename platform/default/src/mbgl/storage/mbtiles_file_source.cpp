@@ -1,5 +1,10 @@
-#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <map>
+#include <optional>
+#include <thread>
+#include <tuple>
 
 #include <mbgl/platform/settings.hpp>
 #include <mbgl/storage/mbtiles_file_source.hpp>
@@ -30,6 +35,22 @@ bool acceptsURL(const std::string &url) {
 std::string url_to_path(const std::string &url) {
     return mbgl::util::percentDecode(url.substr(std::char_traits<char>::length(mbgl::util::MBTILES_PROTOCOL)));
 }
+
+// Each thread has its own read-only connection per file. A few of them keep
+// a server busy without opening a connection per core on large machines.
+std::size_t threadCount() {
+    return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 4);
+}
+
+// Tiles are read ahead in aligned 2x2 blocks; requests for the tiles of a
+// block go to the same thread, so that they find each other's read-ahead.
+std::size_t blockHash(const mbgl::Resource::TileData &tile) {
+    return std::hash<uint64_t>()(static_cast<uint64_t>(tile.z) << 56 ^ static_cast<uint64_t>(tile.x >> 1) << 28 ^
+                                 (tile.y >> 1));
+}
+
+// Read ahead tiles are dropped if they aren't requested soon.
+constexpr std::size_t maxReadAheadTiles = 64;
 } // namespace
 
 namespace mbgl {
@@ -41,19 +62,15 @@ public:
         : resourceOptions(resourceOptions_.clone()),
           clientOptions(clientOptions_.clone()) {}
 
-    std::vector<double> &split(const std::string &s, char delim, std::vector<double> &elems) {
-        std::stringstream ss(s);
-        std::string item;
-        while (std::getline(ss, item, delim)) {
-            double value = atof(item.c_str());
-            elems.push_back(value);
-        }
-        return elems;
-    }
-
     std::vector<double> split(const std::string &s, char delim) {
         std::vector<double> elems;
-        split(s, delim, elems);
+        for (const char *begin = s.c_str();; ++begin) {
+            elems.push_back(std::strtod(begin, nullptr));
+            begin = std::strchr(begin, delim);
+            if (!begin) {
+                break;
+            }
+        }
         return elems;
     }
 
@@ -67,7 +84,15 @@ public:
 
     std::string db_path(const std::string &path) { return path.substr(0, path.find('?')); }
 
-    bool is_compressed(const std::string &v) { return (((uint8_t)v[0]) == 0x1f) && (((uint8_t)v[1]) == 0x8b); }
+    // gzip or zlib data, both of which util::decompress() handles
+    bool is_compressed(const std::string &v) {
+        if (v.size() < 2) {
+            return false;
+        }
+        const auto first = static_cast<uint8_t>(v[0]);
+        const auto second = static_cast<uint8_t>(v[1]);
+        return (first == 0x1f && second == 0x8b) || (first == 0x78 && (first << 8 | second) % 31 == 0);
+    }
 
     // Generate a tilejson resource from .mbtiles file
     void request_tilejson(const Resource &resource, ActorRef<FileSourceRequest> req) {
@@ -79,10 +104,9 @@ public:
         auto &allocator = doc.GetAllocator();
 
         std::map<std::string, std::string> values;
-        auto db = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly);
+        auto &connection = get_connection(path);
 
-        mapbox::sqlite::Statement meta(db, "SELECT * from metadata");
-        for (mapbox::sqlite::Query q(meta); q.run();) {
+        for (mapbox::sqlite::Query q(connection.getStatement("SELECT * from metadata")); q.run();) {
             auto name = q.get<std::string>(0);
             auto val = q.get<std::string>(1);
             if (name == "json") {
@@ -120,9 +144,8 @@ public:
         auto maxzoom_ptr = values.find("maxzoom");
 
         if (minzoom_ptr == values.end() || maxzoom_ptr == values.end()) {
-            mapbox::sqlite::Statement zoom_stmt(db, "SELECT MIN(zoom_level),MAX(zoom_level) from tiles");
-
-            for (mapbox::sqlite::Query q(zoom_stmt); q.run();) {
+            for (mapbox::sqlite::Query q(connection.getStatement("SELECT MIN(zoom_level),MAX(zoom_level) from tiles"));
+                 q.run();) {
                 minz = q.get<std::string>(0);
                 maxz = q.get<std::string>(1);
             }
@@ -181,34 +204,81 @@ public:
     void request_tile(const Resource &resource, ActorRef<FileSourceRequest> req) {
         std::string base_path = url_to_path(resource.url);
         std::string path = db_path(base_path);
-        auto &db = get_db(path);
-
-        int iy = resource.tileData->y;
-        int iz = resource.tileData->z;
-
-        auto x = std::to_string(resource.tileData->x);
-        auto y = std::to_string((int)(pow(2, iz) - 1) - iy);
-        auto z = std::to_string(iz);
+        auto &connection = get_connection(path);
+
+        const auto &tile = *resource.tileData;
+        const int64_t z = tile.z;
+        const int64_t x = tile.x;
+        const int64_t y = (int64_t(1) << z) - 1 - tile.y; // TMS row
+
+        std::optional<std::string> data;
+        const TileKey key{z, x, y};
+        auto readAhead = connection.readAhead.find(key);
+        if (readAhead != connection.readAhead.end()) {
+            data = std::move(readAhead->second);
+            connection.readAhead.erase(readAhead);
+        } else if (connection.lastZoom == z) {
+            // Consecutive requests at one zoom level usually cover a viewport,
+            // so fetch the rest of the tile's 2x2 block with the same lookup.
+            if (connection.readAhead.size() > maxReadAheadTiles) {
+                connection.readAhead.clear();
+            }
+            const int64_t minX = x & ~int64_t(1);
+            const int64_t minY = y & ~int64_t(1);
+            for (int64_t bx = minX; bx <= minX + 1; ++bx) {
+                for (int64_t by = minY; by <= minY + 1; ++by) {
+                    if (bx != x || by != y) {
+                        // Stays empty if the tile doesn't exist.
+                        connection.readAhead.emplace(TileKey{z, bx, by}, std::nullopt);
+                    }
+                }
+            }
 
-        std::string sql = "SELECT tile_data FROM tiles where zoom_level = " + z + " AND tile_column = " + x +
-                          " AND tile_row = " + y;
-        mapbox::sqlite::Statement stmt(db, sql.c_str());
+            mapbox::sqlite::Query q(
+                connection.getStatement("SELECT tile_column, tile_row, tile_data FROM tiles WHERE zoom_level = ?1 AND "
+                                        "tile_column BETWEEN ?2 AND ?3 AND tile_row BETWEEN ?4 AND ?5"));
+            q.bind(1, z);
+            q.bind(2, minX);
+            q.bind(3, minX + 1);
+            q.bind(4, minY);
+            q.bind(5, minY + 1);
+            while (q.run()) {
+                const TileKey found{z, q.get<int64_t>(0), q.get<int64_t>(1)};
+                if (found == key) {
+                    data = q.get<std::optional<std::string>>(2);
+                } else {
+                    connection.readAhead[found] = q.get<std::optional<std::string>>(2);
+                }
+            }
+        } else {
+            mapbox::sqlite::Query q(connection.getStatement(
+                "SELECT tile_data FROM tiles WHERE zoom_level = ?1 AND tile_column = ?2 AND tile_row = ?3"));
+            q.bind(1, z);
+            q.bind(2, x);
+            q.bind(3, y);
+            if (q.run()) {
+                data = q.get<std::optional<std::string>>(0);
+            }
+        }
+        connection.lastZoom = z;
 
         Response response;
         response.noContent = true;
 
-        for (mapbox::sqlite::Query q(stmt); q.run();) {
-            std::optional<std::string> data = q.get<std::optional<std::string>>(0);
-            if (data) {
-                response.data = std::make_shared<std::string>(*data);
-                response.noContent = false;
-                response.expires = Timestamp::max();
-                response.etag = resource.url;
-
-                if (is_compressed(*response.data)) {
-                    response.data = std::make_shared<std::string>(util::decompress(*response.data));
+        if (data) {
+            response.noContent = false;
+            response.expires = Timestamp::max();
+            response.etag = resource.url;
+
+            if (is_compressed(*data)) {
+                if (resource.acceptsCompressedData) {
+                    // Tile workers decompress it off this thread.
+                    response.compressed = true;
+                } else {
+                    *data = util::decompress(*data);
                 }
             }
+            response.data = std::make_shared<std::string>(std::move(*data));
         }
         req.invoke(&FileSourceRequest::setResponse, response);
     }
@@ -234,27 +304,38 @@ public:
     }
 
 private:
-    std::map<std::string, mapbox::sqlite::Database> db_cache;
+    // zoom level, column and TMS row
+    using TileKey = std::tuple<int64_t, int64_t, int64_t>;
 
-    void close_db(const std::string &path) {
-        auto ptr = db_cache.find(path);
-        if (ptr != db_cache.end()) {
-            db_cache.erase(path);
+    struct Connection {
+        explicit Connection(const std::string &path)
+            : db(mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly)) {}
+
+        mapbox::sqlite::Statement &getStatement(const char *sql) {
+            auto it = statements.find(sql);
+            if (it == statements.end()) {
+                it = statements.emplace(sql, std::make_unique<mapbox::sqlite::Statement>(db, sql)).first;
+            }
+            return *it->second;
         }
-    }
 
-    void close_all() { db_cache.clear(); }
+        mapbox::sqlite::Database db;
+        std::map<const char *, const std::unique_ptr<mapbox::sqlite::Statement>> statements;
+
+        // Zoom level of the previous tile request.
+        std::optional<int64_t> lastZoom;
+        std::map<TileKey, std::optional<std::string>> readAhead;
+    };
 
     // Multiple databases open simultaneoulsy, to effectively support multiple .mbtiles maps
-    mapbox::sqlite::Database &get_db(const std::string &path) {
-        auto ptr = db_cache.find(path);
-        if (ptr != db_cache.end()) {
-            return ptr->second;
-        };
-
-        auto ptr2 = db_cache.insert(std::pair<std::string, mapbox::sqlite::Database>(
-            path, mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly)));
-        return ptr2.first->second;
+    std::map<std::string, std::unique_ptr<Connection>> connections;
+
+    Connection &get_connection(const std::string &path) {
+        auto it = connections.find(path);
+        if (it == connections.end()) {
+            it = connections.emplace(path, std::make_unique<Connection>(path)).first;
+        }
+        return *it->second;
     }
 
     mutable std::mutex resourceOptionsMutex;
@@ -263,19 +344,23 @@ private:
     ClientOptions clientOptions;
 };
 
-MBTilesFileSource::MBTilesFileSource(const ResourceOptions &resourceOptions, const ClientOptions &clientOptions)
-    : thread(std::make_unique<util::Thread<Impl>>(
-          util::makeThreadPrioritySetter(platform::EXPERIMENTAL_THREAD_PRIORITY_FILE),
-          "MBTilesFileSource",
-          resourceOptions.clone(),
-          clientOptions.clone())) {}
+MBTilesFileSource::MBTilesFileSource(const ResourceOptions &resourceOptions, const ClientOptions &clientOptions) {
+    for (std::size_t i = threadCount(); i > 0; --i) {
+        threads.push_back(std::make_unique<util::Thread<Impl>>(
+            util::makeThreadPrioritySetter(platform::EXPERIMENTAL_THREAD_PRIORITY_FILE),
+            "MBTilesFileSource",
+            resourceOptions.clone(),
+            clientOptions.clone()));
+    }
+}
 
 std::unique_ptr<AsyncRequest> MBTilesFileSource::request(const Resource &resource, FileSource::Callback callback) {
     auto req = std::make_unique<FileSourceRequest>(std::move(callback));
 
     // assume if there is a tile request, that the mbtiles file has been validated
-    if (resource.kind == Resource::Tile) {
-        thread->actor().invoke(&Impl::request_tile, resource, req->actor());
+    if (resource.kind == Resource::Tile && resource.tileData) {
+        threads[blockHash(*resource.tileData) % threads.size()]->actor().invoke(
+            &Impl::request_tile, resource, req->actor());
         return req;
     }
 
@@ -302,7 +387,7 @@ std::unique_ptr<AsyncRequest> MBTilesFileSource::request(const Resource &resourc
     }
 
     // return TileJSON
-    thread->actor().invoke(&Impl::request_tilejson, resource, req->actor());
+    threads[nextThread++ % threads.size()]->actor().invoke(&Impl::request_tilejson, resource, req->actor());
     return req;
 }
 
@@ -313,19 +398,23 @@ bool MBTilesFileSource::canRequest(const Resource &resource) const {
 MBTilesFileSource::~MBTilesFileSource() = default;
 
 void MBTilesFileSource::setResourceOptions(ResourceOptions options) {
-    thread->actor().invoke(&Impl::setResourceOptions, options.clone());
+    for (const auto &thread : threads) {
+        thread->actor().invoke(&Impl::setResourceOptions, options.clone());
+    }
 }
 
 ResourceOptions MBTilesFileSource::getResourceOptions() {
-    return thread->actor().ask(&Impl::getResourceOptions).get();
+    return threads.front()->actor().ask(&Impl::getResourceOptions).get();
 }
 
 void MBTilesFileSource::setClientOptions(ClientOptions options) {
-    thread->actor().invoke(&Impl::setClientOptions, options.clone());
+    for (const auto &thread : threads) {
+        thread->actor().invoke(&Impl::setClientOptions, options.clone());
+    }
 }
 
 ClientOptions MBTilesFileSource::getClientOptions() {
-    return thread->actor().ask(&Impl::getClientOptions).get();
+    return threads.front()->actor().ask(&Impl::getClientOptions).get();
 }
 
 } // namespace mbgl
@@ -10,12 +10,74 @@
 
 #include <mbgl/storage/offline_schema.hpp>
 #include <mbgl/storage/merge_sideloaded.hpp>
+#include <mbgl/storage/pmtiles_archive.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 
 namespace mbgl {
 
-OfflineDatabase::OfflineDatabase(std::string path_, const TileServerOptions& options)
+namespace {
+
+// Reads refresh an entry's accessed timestamp only if it is at least this old,
+// and buffered timestamps are written at least this often.
+const Seconds accessedTimestampGranularity{60};
+
+// Buffered timestamps are written once this many entries were read.
+const std::size_t maximumPendingAccesses = 1024;
+
+// Tile dictionaries are trained on up to this many stored tiles, and only if
+// at least the minimum number of tiles is stored.
+const std::size_t minimumDictionarySamples = 64;
+const std::size_t maximumDictionarySamples = 2000;
+const std::size_t maximumDictionarySampleSize = 8 * 1024 * 1024;
+const std::size_t dictionaryCapacity = 64 * 1024;
+
+// Eviction deletes the least recently used ambient entries in batches of
+// about this many entries.
+const uint64_t evictionBatchSize = 50;
+
+// Incremental eviction starts once the ambient cache exceeds the high
+// watermark and stops once it is below the low watermark, both in percent of
+// the maximum ambient cache size.
+const uint64_t ambientCacheHighWatermark = 90;
+const uint64_t ambientCacheLowWatermark = 80;
+
+// Merges copy this many side tiles or resources per transaction.
+const uint64_t mergeChunkSize = 500;
+
+// Archive imports commit a transaction every this many tiles.
+const uint64_t importBatchSize = 10000;
+
+// Whether archived tile data is gzip or zlib compressed, which tile workers
+// decompress themselves.
+bool isDeflated(const std::string& data) {
+    if (data.size() < 2) {
+        return false;
+    }
+    const auto first = static_cast<uint8_t>(data[0]);
+    const auto second = static_cast<uint8_t>(data[1]);
+    return (first == 0x1f && second == 0x8b) || ((first & 0x0f) == 8 && (first * 256 + second) % 31 == 0);
+}
+
+// Hash of stored tile contents, see the tile_data table. It is persisted, so
+// it must be the same on all platforms.
+uint64_t tileDataHash(const std::string& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+OfflineDatabase::OfflineDatabase(std::string path_, const TileServerOptions& options, bool readOnly_)
     : path(std::move(path_)),
-      tileServerOptions(options) {
+      tileServerOptions(options),
+      readOnly(readOnly_) {
     try {
         initialize();
     } catch (...) {
@@ -53,7 +115,7 @@ void OfflineDatabase::initialize() {
             // Newly created database, or old cache-only database; remove old table if it exists.
             removeOldCacheTable();
             createSchema();
-            return;
+            break;
         case 2:
             migrateToVersion3();
             // fall through
@@ -67,13 +129,53 @@ void OfflineDatabase::initialize() {
             migrateToVersion6();
             // fall through
         case 6:
+            migrateToVersion7();
+            // fall through
+        case 7:
+            migrateToVersion8();
+            // fall through
+        case 8:
+            migrateToVersion9();
+            // fall through
+        case 9:
+            migrateToVersion10();
+            // fall through
+        case 10:
             // Happy path; we're done
-            return;
+            break;
         default:
             // Downgrade: delete the database and try to reinitialize.
             removeExisting();
             initialize();
+            return;
+    }
+
+    if (writeAheadLog) {
+        applyJournalMode();
+    }
+}
+
+void OfflineDatabase::applyJournalMode() {
+    assert(db);
+    checkFlags();
+
+    db->exec(writeAheadLog ? "PRAGMA journal_mode = WAL" : "PRAGMA journal_mode = DELETE");
+    db->exec(writeAheadLog ? "PRAGMA synchronous = NORMAL" : "PRAGMA synchronous = FULL");
+}
+
+void OfflineDatabase::setWriteAheadLog(bool enabled) try {
+    if (writeAheadLog == enabled) {
+        return;
+    }
+
+    writeAheadLog = enabled;
+    if (!db) {
+        initialize();
+    } else if (!readOnly) {
+        applyJournalMode();
     }
+} catch (...) {
+    handleError("change journal mode");
 }
 
 void OfflineDatabase::changePath(const std::string& path_) {
@@ -84,6 +186,14 @@ void OfflineDatabase::changePath(const std::string& path_) {
 }
 
 void OfflineDatabase::cleanup() {
+    if (db) {
+        flushAccessedTimestamps();
+    }
+    discardAccessedTimestamps();
+    dictionaries.clear();
+    tileDictionaries.clear();
+    merge = std::nullopt;
+
     // Deleting these SQLite objects may result in exceptions
     try {
         statements.clear();
@@ -109,6 +219,13 @@ void OfflineDatabase::handleError(const mapbox::sqlite::Exception& ex, const cha
         // The database was corruped, moved away, or deleted. We're going to
         // start fresh with a clean slate for the next operation.
         Log::Error(Event::Database, static_cast<int>(ex.code), std::string("Can't ") + action + ": " + ex.what());
+        if (readOnly) {
+            // The file belongs to a writer, which may already have replaced
+            // it, so only this connection is dropped. The next operation
+            // opens the file again.
+            closeDatabase();
+            return;
+        }
         try {
             removeExisting();
         } catch (const util::IOException& ioEx) {
@@ -147,13 +264,29 @@ void OfflineDatabase::handleError(const char* action) {
     }
 }
 
+void OfflineDatabase::closeDatabase() {
+    discardAccessedTimestamps();
+    dictionaries.clear();
+    tileDictionaries.clear();
+    merge = std::nullopt;
+    statements.clear();
+    db.reset();
+}
+
 void OfflineDatabase::removeExisting() {
+    // Read-only connections never delete the file.
+    checkFlags();
     Log::Warning(Event::Database, "Removing existing incompatible offline database");
 
-    statements.clear();
-    db.reset();
+    closeDatabase();
 
     util::deleteFile(path);
+    if (writeAheadLog) {
+        // Read connections may still keep the log of the old database around,
+        // which must not be applied to the new one.
+        std::remove((path + "-wal").c_str());
+        std::remove((path + "-shm").c_str());
+    }
 }
 
 void OfflineDatabase::removeOldCacheTable() {
@@ -173,7 +306,7 @@ void OfflineDatabase::createSchema() {
     db->exec("PRAGMA synchronous = FULL");
     mapbox::sqlite::Transaction transaction(*db);
     db->exec(offlineDatabaseSchema);
-    db->exec("PRAGMA user_version = 6");
+    db->exec("PRAGMA user_version = 10");
     transaction.commit();
 }
 
@@ -215,6 +348,126 @@ void OfflineDatabase::migrateToVersion6() {
     transaction.commit();
 }
 
+void OfflineDatabase::migrateToVersion7() {
+    assert(db);
+    checkFlags();
+
+    mapbox::sqlite::Transaction transaction(*db);
+    db->exec(
+        "CREATE TABLE dictionaries ("
+        "  id INTEGER NOT NULL PRIMARY KEY,"
+        "  url_template TEXT NOT NULL,"
+        "  data BLOB NOT NULL)");
+    db->exec("CREATE INDEX dictionaries_url_template ON dictionaries (url_template)");
+    db->exec("PRAGMA user_version = 7");
+    transaction.commit();
+}
+
+void OfflineDatabase::migrateToVersion8() {
+    assert(db);
+    checkFlags();
+
+    mapbox::sqlite::Transaction transaction(*db);
+    db->exec("ALTER TABLE resources ADD COLUMN ambient INTEGER NOT NULL DEFAULT 1");
+    db->exec("ALTER TABLE tiles ADD COLUMN ambient INTEGER NOT NULL DEFAULT 1");
+    db->exec("UPDATE resources SET ambient = 0 WHERE id IN (SELECT resource_id FROM region_resources)");
+    db->exec("UPDATE tiles SET ambient = 0 WHERE id IN (SELECT tile_id FROM region_tiles)");
+    db->exec("DROP INDEX IF EXISTS resources_accessed");
+    db->exec("DROP INDEX IF EXISTS tiles_accessed");
+    db->exec("CREATE INDEX resources_ambient_accessed ON resources (ambient, accessed)");
+    db->exec("CREATE INDEX tiles_ambient_accessed ON tiles (ambient, accessed)");
+    // clang-format off
+    db->exec(
+        "CREATE TRIGGER region_resources_insert AFTER INSERT ON region_resources "
+        "BEGIN "
+        "  UPDATE resources SET ambient = 0 WHERE id = NEW.resource_id; "
+        "END; "
+        "CREATE TRIGGER region_resources_delete AFTER DELETE ON region_resources "
+        "BEGIN "
+        "  UPDATE resources SET ambient = 1 "
+        "  WHERE id = OLD.resource_id "
+        "  AND NOT EXISTS (SELECT 1 FROM region_resources WHERE resource_id = OLD.resource_id); "
+        "END; "
+        "CREATE TRIGGER resources_insert AFTER INSERT ON resources "
+        "WHEN EXISTS (SELECT 1 FROM region_resources WHERE resource_id = NEW.id) "
+        "BEGIN "
+        "  UPDATE resources SET ambient = 0 WHERE id = NEW.id; "
+        "END; "
+        "CREATE TRIGGER region_tiles_insert AFTER INSERT ON region_tiles "
+        "BEGIN "
+        "  UPDATE tiles SET ambient = 0 WHERE id = NEW.tile_id; "
+        "END; "
+        "CREATE TRIGGER region_tiles_delete AFTER DELETE ON region_tiles "
+        "BEGIN "
+        "  UPDATE tiles SET ambient = 1 "
+        "  WHERE id = OLD.tile_id "
+        "  AND NOT EXISTS (SELECT 1 FROM region_tiles WHERE tile_id = OLD.tile_id); "
+        "END; "
+        "CREATE TRIGGER tiles_insert AFTER INSERT ON tiles "
+        "WHEN EXISTS (SELECT 1 FROM region_tiles WHERE tile_id = NEW.id) "
+        "BEGIN "
+        "  UPDATE tiles SET ambient = 0 WHERE id = NEW.id; "
+        "END");
+    // clang-format on
+    db->exec("PRAGMA user_version = 8");
+    transaction.commit();
+}
+
+// Existing tiles keep their contents in tiles.data; they move to tile_data
+// when they are stored again.
+void OfflineDatabase::migrateToVersion9() {
+    assert(db);
+    checkFlags();
+
+    mapbox::sqlite::Transaction transaction(*db);
+    db->exec(
+        "CREATE TABLE tile_data ("
+        "  id INTEGER NOT NULL PRIMARY KEY,"
+        "  hash INTEGER NOT NULL,"
+        "  data BLOB NOT NULL)");
+    db->exec("CREATE INDEX tile_data_hash ON tile_data (hash)");
+    db->exec("ALTER TABLE tiles ADD COLUMN data_id INTEGER");
+    db->exec("CREATE INDEX tiles_data_id ON tiles (data_id)");
+    // clang-format off
+    db->exec(
+        "CREATE TRIGGER tiles_delete AFTER DELETE ON tiles "
+        "WHEN OLD.data_id IS NOT NULL "
+        "BEGIN "
+        "  DELETE FROM tile_data "
+        "  WHERE id = OLD.data_id "
+        "  AND NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = OLD.data_id); "
+        "END; "
+        "CREATE TRIGGER tiles_update_data AFTER UPDATE OF data_id ON tiles "
+        "WHEN OLD.data_id IS NOT NULL AND OLD.data_id IS NOT NEW.data_id "
+        "BEGIN "
+        "  DELETE FROM tile_data "
+        "  WHERE id = OLD.data_id "
+        "  AND NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = OLD.data_id); "
+        "END");
+    // clang-format on
+    db->exec("PRAGMA user_version = 9");
+    transaction.commit();
+}
+
+void OfflineDatabase::migrateToVersion10() {
+    assert(db);
+    checkFlags();
+
+    mapbox::sqlite::Transaction transaction(*db);
+    db->exec(
+        "CREATE TABLE region_tile_cursors ("
+        "  region_id INTEGER NOT NULL REFERENCES regions(id) ON DELETE CASCADE,"
+        "  url_template TEXT NOT NULL,"
+        "  min_zoom INTEGER NOT NULL,"
+        "  max_zoom INTEGER NOT NULL,"
+        "  position INTEGER NOT NULL,"
+        "  completed_count INTEGER NOT NULL,"
+        "  completed_size INTEGER NOT NULL,"
+        "  UNIQUE (region_id, url_template, min_zoom, max_zoom))");
+    db->exec("PRAGMA user_version = 10");
+    transaction.commit();
+}
+
 void OfflineDatabase::vacuum() {
     assert(db);
     checkFlags();
@@ -250,6 +503,7 @@ std::optional<Response> OfflineDatabase::get(const Resource& resource) try {
     }
 
     auto result = getInternal(resource);
+    flushAccessedTimestampsIfDue();
     return result ? std::optional<Response>{result->first} : std::nullopt;
 } catch (...) {
     handleError("read resource");
@@ -259,12 +513,135 @@ std::optional<Response> OfflineDatabase::get(const Resource& resource) try {
 std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getInternal(const Resource& resource) {
     if (resource.kind == Resource::Kind::Tile) {
         assert(resource.tileData);
-        return getTile(*resource.tileData);
+        return getTile(*resource.tileData, resource.acceptsCompressedData);
     } else {
         return getResource(resource);
     }
 }
 
+// Accessed timestamps only order entries for LRU eviction, so reads refresh
+// them at most once per granularity period, and the updates are buffered and
+// written in a single transaction instead of turning every read into a write.
+void OfflineDatabase::recordResourceAccess(const std::string& url, Timestamp accessed) {
+    const Timestamp now = util::now();
+    if (now - accessed < accessedTimestampGranularity) {
+        return;
+    }
+
+    pendingAccesses.resources[url] = now;
+    if (!oldestPendingAccess) {
+        oldestPendingAccess = now;
+    }
+}
+
+void OfflineDatabase::recordTileAccess(const Resource::TileData& tile, Timestamp accessed) {
+    const Timestamp now = util::now();
+    if (now - accessed < accessedTimestampGranularity) {
+        return;
+    }
+
+    pendingAccesses.tiles[std::make_tuple(tile.urlTemplate, tile.pixelRatio, tile.x, tile.y, tile.z)] = now;
+    if (!oldestPendingAccess) {
+        oldestPendingAccess = now;
+    }
+}
+
+void OfflineDatabase::flushAccessedTimestampsIfDue() {
+    if (oldestPendingAccess &&
+        (pendingAccesses.resources.size() + pendingAccesses.tiles.size() >= maximumPendingAccesses ||
+         util::now() - *oldestPendingAccess >= accessedTimestampGranularity)) {
+        flushAccessedTimestamps();
+    }
+}
+
+bool OfflineDatabase::hasPendingAccessedTimestamps() const {
+    return !pendingAccesses.resources.empty() || !pendingAccesses.tiles.empty();
+}
+
+OfflineDatabase::AccessedTimestamps OfflineDatabase::takeAccessedTimestamps() {
+    AccessedTimestamps result = std::move(pendingAccesses);
+    discardAccessedTimestamps();
+    return result;
+}
+
+void OfflineDatabase::addAccessedTimestamps(const AccessedTimestamps& accesses) {
+    for (const auto& [url, accessed] : accesses.resources) {
+        auto& pending = pendingAccesses.resources[url];
+        pending = std::max(pending, accessed);
+    }
+    for (const auto& [tile, accessed] : accesses.tiles) {
+        auto& pending = pendingAccesses.tiles[tile];
+        pending = std::max(pending, accessed);
+    }
+    if (!oldestPendingAccess && hasPendingAccessedTimestamps()) {
+        oldestPendingAccess = util::now();
+    }
+    flushAccessedTimestampsIfDue();
+}
+
+void OfflineDatabase::flushAccessedTimestamps() try {
+    if (!hasPendingAccessedTimestamps()) {
+        return;
+    }
+
+    if (readOnly) {
+        // Nobody took them; see takeAccessedTimestamps().
+        discardAccessedTimestamps();
+        return;
+    }
+
+    if (!db) {
+        initialize();
+    }
+
+    mapbox::sqlite::Transaction transaction(*db);
+    writeAccessedTimestamps();
+    transaction.commit();
+} catch (...) {
+    handleError("update timestamps");
+}
+
+// Must be called within a transaction. Pending timestamps are dropped even if
+// writing them fails; losing them only makes eviction slightly less accurate.
+void OfflineDatabase::writeAccessedTimestamps() {
+    const AccessedTimestamps accesses = takeAccessedTimestamps();
+
+    for (const auto& [url, accessed] : accesses.resources) {
+        mapbox::sqlite::Query query{
+            getStatement("UPDATE resources SET accessed = MAX(accessed, ?1) WHERE url = ?2")};
+        query.bind(1, accessed);
+        query.bind(2, url);
+        query.run();
+    }
+
+    for (const auto& [tile, accessed] : accesses.tiles) {
+        // clang-format off
+        mapbox::sqlite::Query query{ getStatement(
+            "UPDATE tiles "
+            "SET accessed       = MAX(accessed, ?1) "
+            "WHERE url_template = ?2 "
+            "  AND pixel_ratio  = ?3 "
+            "  AND x            = ?4 "
+            "  AND y            = ?5 "
+            "  AND z            = ?6 ") };
+        // clang-format on
+
+        query.bind(1, accessed);
+        query.bind(2, std::get<0>(tile));
+        query.bind(3, std::get<1>(tile));
+        query.bind(4, std::get<2>(tile));
+        query.bind(5, std::get<3>(tile));
+        query.bind(6, std::get<4>(tile));
+        query.run();
+    }
+}
+
+void OfflineDatabase::discardAccessedTimestamps() {
+    pendingAccesses.resources.clear();
+    pendingAccesses.tiles.clear();
+    oldestPendingAccess = std::nullopt;
+}
+
 std::optional<int64_t> OfflineDatabase::hasInternal(const Resource& resource) {
     if (resource.kind == Resource::Kind::Tile) {
         assert(resource.tileData);
@@ -274,6 +651,83 @@ std::optional<int64_t> OfflineDatabase::hasInternal(const Resource& resource) {
     }
 }
 
+uint64_t OfflineDatabase::setResponseData(Response& response,
+                                          std::string data,
+                                          DataEncoding encoding,
+                                          bool acceptsCompressedData) {
+    const uint64_t size = data.size();
+    switch (encoding) {
+        case DataEncoding::None:
+            response.data = std::make_shared<std::string>(std::move(data));
+            break;
+        case DataEncoding::Deflate:
+            if (acceptsCompressedData) {
+                response.data = std::make_shared<std::string>(std::move(data));
+                response.compressed = true;
+            } else {
+                response.data = std::make_shared<std::string>(util::decompress(data));
+            }
+            break;
+        case DataEncoding::Zstd: {
+            // Loading the dictionary registers it for util::decompress() on the worker threads.
+            const uint32_t dictionaryID = util::zstd::dictionaryID(data);
+            const auto dictionary = dictionaryID ? getDictionary(dictionaryID) : nullptr;
+            if (acceptsCompressedData) {
+                response.data = std::make_shared<std::string>(std::move(data));
+                response.compressed = true;
+            } else {
+                response.data = std::make_shared<std::string>(util::zstd::decompress(data, dictionary.get()));
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown data encoding");
+    }
+    return size;
+}
+
+std::shared_ptr<const util::zstd::Dictionary> OfflineDatabase::getDictionary(uint32_t id) {
+    auto it = dictionaries.find(id);
+    if (it != dictionaries.end()) {
+        return it->second;
+    }
+
+    mapbox::sqlite::Query query{getStatement("SELECT data FROM dictionaries WHERE id = ?1")};
+    query.bind(1, id);
+    if (!query.run()) {
+        throw std::runtime_error("Missing compression dictionary");
+    }
+
+    auto dictionary = std::make_shared<const util::zstd::Dictionary>(query.get<std::string>(0));
+    util::zstd::registerDictionary(dictionary);
+    dictionaries.emplace(id, dictionary);
+    return dictionary;
+}
+
+std::shared_ptr<const util::zstd::Dictionary> OfflineDatabase::getTileDictionary(const std::string& urlTemplate) {
+    if (!util::zstd::supported()) {
+        return nullptr;
+    }
+
+    auto it = tileDictionaries.find(urlTemplate);
+    if (it != tileDictionaries.end()) {
+        return it->second;
+    }
+
+    std::optional<uint32_t> id;
+    {
+        mapbox::sqlite::Query query{getStatement("SELECT id FROM dictionaries WHERE url_template = ?1 LIMIT 1")};
+        query.bind(1, urlTemplate);
+        if (query.run()) {
+            id = static_cast<uint32_t>(query.get<int64_t>(0));
+        }
+    }
+
+    auto dictionary = id ? getDictionary(*id) : nullptr;
+    tileDictionaries.emplace(urlTemplate, dictionary);
+    return dictionary;
+}
+
 std::pair<bool, uint64_t> OfflineDatabase::put(const Resource& resource, const Response& response) try {
     if (readOnly) return {false, 0};
 
@@ -304,15 +758,33 @@ std::pair<bool, uint64_t> OfflineDatabase::putInternal(const Resource& resource,
     }
 
     std::string compressedData;
-    bool compressed = false;
-    uint64_t size = 0;
+    DataEncoding encoding = DataEncoding::None;
 
-    if (response.data) {
+    std::shared_ptr<const util::zstd::Dictionary> dictionary;
+    if (response.data && !response.compressed && !response.data->empty() &&
+        resource.kind == Resource::Kind::Tile) {
+        assert(resource.tileData);
+        dictionary = getTileDictionary(resource.tileData->urlTemplate);
+    }
+
+    if (response.data && response.compressed) {
+        // Data that arrived compressed is stored as it is, rather than being
+        // recompressed with the tileset's dictionary.
+        encoding = util::zstd::isFrame(*response.data) ? DataEncoding::Zstd : DataEncoding::Deflate;
+    } else if (dictionary) {
+        compressedData = util::zstd::compress(*response.data, dictionary.get());
+        encoding = DataEncoding::Zstd;
+    } else if (response.data) {
         compressedData = util::compress(*response.data);
-        compressed = compressedData.size() < response.data->size();
-        size = compressed ? compressedData.size() : response.data->size();
+        if (compressedData.size() < response.data->size()) {
+            encoding = DataEncoding::Deflate;
+        }
     }
 
+    const bool storedAsReceived = response.data && (encoding == DataEncoding::None || response.compressed);
+    const std::string& data = storedAsReceived ? *response.data : compressedData;
+    const uint64_t size = response.data ? data.size() : 0;
+
     std::optional<DatabaseSizeChangeStats> stats;
     if (evict_) {
         stats = DatabaseSizeChangeStats(this);
@@ -326,19 +798,9 @@ std::pair<bool, uint64_t> OfflineDatabase::putInternal(const Resource& resource,
 
     if (resource.kind == Resource::Kind::Tile) {
         assert(resource.tileData);
-        inserted = putTile(*resource.tileData,
-                           response,
-                           compressed      ? compressedData
-                           : response.data ? *response.data
-                                           : "",
-                           compressed);
+        inserted = putTile(*resource.tileData, response, data, encoding);
     } else {
-        inserted = putResource(resource,
-                               response,
-                               compressed      ? compressedData
-                               : response.data ? *response.data
-                                               : "",
-                               compressed);
+        inserted = putResource(resource, response, data, encoding);
     }
 
     if (stats) {
@@ -349,28 +811,10 @@ std::pair<bool, uint64_t> OfflineDatabase::putInternal(const Resource& resource,
 }
 
 std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getResource(const Resource& resource) {
-    // Update accessed timestamp used for LRU eviction.
-    if (!readOnly) {
-        try {
-            mapbox::sqlite::Query accessedQuery{getStatement("UPDATE resources SET accessed = ?1 WHERE url = ?2")};
-            accessedQuery.bind(1, util::now());
-            accessedQuery.bind(2, resource.url);
-            accessedQuery.run();
-        } catch (const mapbox::sqlite::Exception& ex) {
-            if (ex.code == mapbox::sqlite::ResultCode::NotADB || ex.code == mapbox::sqlite::ResultCode::Corrupt) {
-                throw;
-            }
-
-            // If we don't have any indication that the database is corrupt, continue as usual.
-            Log::Warning(
-                Event::Database, static_cast<int>(ex.code), std::string("Can't update timestamp: ") + ex.what());
-        }
-    }
-
     // clang-format off
     mapbox::sqlite::Query query{ getStatement(
-        //        0      1            2            3       4      5
-        "SELECT etag, expires, must_revalidate, modified, data, compressed "
+        //        0      1            2            3       4      5           6
+        "SELECT etag, expires, must_revalidate, modified, data, compressed, accessed "
         "FROM resources "
         "WHERE url = ?") };
     // clang-format on
@@ -381,6 +825,8 @@ std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getResource(const
         return std::nullopt;
     }
 
+    recordResourceAccess(resource.url, query.get<Timestamp>(6));
+
     Response response;
     uint64_t size = 0;
 
@@ -392,12 +838,11 @@ std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getResource(const
     auto data = query.get<std::optional<std::string>>(4);
     if (!data) {
         response.noContent = true;
-    } else if (query.get<bool>(5)) {
-        response.data = std::make_shared<std::string>(util::decompress(*data));
-        size = data->length();
     } else {
-        response.data = std::make_shared<std::string>(*data);
-        size = data->length();
+        size = setResponseData(response,
+                               std::move(*data),
+                               static_cast<DataEncoding>(query.get<int>(5)),
+                               resource.acceptsCompressedData);
     }
 
     return std::make_pair(response, size);
@@ -416,7 +861,7 @@ std::optional<int64_t> OfflineDatabase::hasResource(const Resource& resource) {
 bool OfflineDatabase::putResource(const Resource& resource,
                                   const Response& response,
                                   const std::string& data,
-                                  bool compressed) {
+                                  DataEncoding encoding) {
     checkFlags();
 
     if (response.notModified) {
@@ -465,7 +910,7 @@ bool OfflineDatabase::putResource(const Resource& resource,
         updateQuery.bind(8, false);
     } else {
         updateQuery.bindBlob(7, data.data(), data.size(), false);
-        updateQuery.bind(8, compressed);
+        updateQuery.bind(8, static_cast<uint8_t>(encoding));
     }
 
     updateQuery.run();
@@ -492,7 +937,7 @@ bool OfflineDatabase::putResource(const Resource& resource,
         insertQuery.bind(9, false);
     } else {
         insertQuery.bindBlob(8, data.data(), data.size(), false);
-        insertQuery.bind(9, compressed);
+        insertQuery.bind(9, static_cast<uint8_t>(encoding));
     }
 
     insertQuery.run();
@@ -500,44 +945,14 @@ bool OfflineDatabase::putResource(const Resource& resource,
     return true;
 }
 
-std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getTile(const Resource::TileData& tile) {
-    // Update accessed timestamp used for LRU eviction.
-    if (!readOnly) {
-        try {
-            // clang-format off
-            mapbox::sqlite::Query accessedQuery{ getStatement(
-                "UPDATE tiles "
-                "SET accessed       = ?1 "
-                "WHERE url_template = ?2 "
-                "  AND pixel_ratio  = ?3 "
-                "  AND x            = ?4 "
-                "  AND y            = ?5 "
-                "  AND z            = ?6 ") };
-            // clang-format on
-
-            accessedQuery.bind(1, util::now());
-            accessedQuery.bind(2, tile.urlTemplate);
-            accessedQuery.bind(3, tile.pixelRatio);
-            accessedQuery.bind(4, tile.x);
-            accessedQuery.bind(5, tile.y);
-            accessedQuery.bind(6, tile.z);
-            accessedQuery.run();
-        } catch (const mapbox::sqlite::Exception& ex) {
-            if (ex.code == mapbox::sqlite::ResultCode::NotADB || ex.code == mapbox::sqlite::ResultCode::Corrupt) {
-                throw;
-            }
-
-            // If we don't have any indication that the database is corrupt, continue as usual.
-            Log::Warning(
-                Event::Database, static_cast<int>(ex.code), std::string("Can't update timestamp: ") + ex.what());
-        }
-    }
-
+std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getTile(const Resource::TileData& tile,
+                                                                      bool acceptsCompressedData) {
     // clang-format off
     mapbox::sqlite::Query query{ getStatement(
-        //        0      1           2,            3,      4,      5
-        "SELECT etag, expires, must_revalidate, modified, data, compressed "
+        //        0      1           2,            3,                     4,                        5           6
+        "SELECT etag, expires, must_revalidate, modified, IFNULL(tiles.data, tile_data.data), compressed, accessed "
         "FROM tiles "
+        "LEFT JOIN tile_data ON tile_data.id = tiles.data_id "
         "WHERE url_template = ?1 "
         "  AND pixel_ratio  = ?2 "
         "  AND x            = ?3 "
@@ -555,6 +970,8 @@ std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getTile(const Reso
         return std::nullopt;
     }
 
+    recordTileAccess(tile, query.get<Timestamp>(6));
+
     Response response;
     uint64_t size = 0;
 
@@ -566,12 +983,9 @@ std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getTile(const Reso
     std::optional<std::string> data = query.get<std::optional<std::string>>(4);
     if (!data) {
         response.noContent = true;
-    } else if (query.get<bool>(5)) {
-        response.data = std::make_shared<std::string>(util::decompress(*data));
-        size = data->length();
     } else {
-        response.data = std::make_shared<std::string>(*data);
-        size = data->length();
+        size = setResponseData(
+            response, std::move(*data), static_cast<DataEncoding>(query.get<int>(5)), acceptsCompressedData);
     }
 
     return std::make_pair(response, size);
@@ -580,8 +994,9 @@ std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getTile(const Reso
 std::optional<int64_t> OfflineDatabase::hasTile(const Resource::TileData& tile) {
     // clang-format off
     mapbox::sqlite::Query size{ getStatement(
-        "SELECT length(data) "
+        "SELECT length(IFNULL(tiles.data, tile_data.data)) "
         "FROM tiles "
+        "LEFT JOIN tile_data ON tile_data.id = tiles.data_id "
         "WHERE url_template = ?1 "
         "  AND pixel_ratio  = ?2 "
         "  AND x            = ?3 "
@@ -605,7 +1020,7 @@ std::optional<int64_t> OfflineDatabase::hasTile(const Resource::TileData& tile)
 bool OfflineDatabase::putTile(const Resource::TileData& tile,
                               const Response& response,
                               const std::string& data,
-                              bool compressed) {
+                              DataEncoding encoding) {
     checkFlags();
 
     if (response.notModified) {
@@ -634,6 +1049,12 @@ bool OfflineDatabase::putTile(const Resource::TileData& tile,
         return false;
     }
 
+    // Tiles with equal contents share a tile_data row.
+    std::optional<int64_t> dataID;
+    if (!response.noContent) {
+        dataID = putTileData(data);
+    }
+
     // We can't use REPLACE because it would change the id value.
 
     // clang-format off
@@ -644,7 +1065,8 @@ bool OfflineDatabase::putTile(const Resource::TileData& tile,
         "    expires         = ?3, "
         "    must_revalidate = ?4, "
         "    accessed        = ?5, "
-        "    data            = ?6, "
+        "    data            = NULL, "
+        "    data_id         = ?6, "
         "    compressed      = ?7 "
         "WHERE url_template  = ?8 "
         "  AND pixel_ratio   = ?9 "
@@ -668,8 +1090,8 @@ bool OfflineDatabase::putTile(const Resource::TileData& tile,
         updateQuery.bind(6, nullptr);
         updateQuery.bind(7, false);
     } else {
-        updateQuery.bindBlob(6, data.data(), data.size(), false);
-        updateQuery.bind(7, compressed);
+        updateQuery.bind(6, *dataID);
+        updateQuery.bind(7, static_cast<uint8_t>(encoding));
     }
 
     updateQuery.run();
@@ -679,8 +1101,8 @@ bool OfflineDatabase::putTile(const Resource::TileData& tile,
 
     // clang-format off
     mapbox::sqlite::Query insertQuery{ getStatement(
-        "INSERT INTO tiles (url_template, pixel_ratio, x,  y,  z,  modified, must_revalidate, etag, expires, accessed,  data, compressed) "
-        "VALUES            (?1,           ?2,          ?3, ?4, ?5, ?6,       ?7,              ?8,   ?9,      ?10,       ?11,  ?12)") };
+        "INSERT INTO tiles (url_template, pixel_ratio, x,  y,  z,  modified, must_revalidate, etag, expires, accessed,  data_id, compressed) "
+        "VALUES            (?1,           ?2,          ?3, ?4, ?5, ?6,       ?7,              ?8,   ?9,      ?10,       ?11,     ?12)") };
     // clang-format on
 
     insertQuery.bind(1, tile.urlTemplate);
@@ -698,8 +1120,8 @@ bool OfflineDatabase::putTile(const Resource::TileData& tile,
         insertQuery.bind(11, nullptr);
         insertQuery.bind(12, false);
     } else {
-        insertQuery.bindBlob(11, data.data(), data.size(), false);
-        insertQuery.bind(12, compressed);
+        insertQuery.bind(11, *dataID);
+        insertQuery.bind(12, static_cast<uint8_t>(encoding));
     }
 
     insertQuery.run();
@@ -707,6 +1129,27 @@ bool OfflineDatabase::putTile(const Resource::TileData& tile,
     return true;
 }
 
+int64_t OfflineDatabase::putTileData(const std::string& data) {
+    const auto hash = static_cast<int64_t>(tileDataHash(data));
+
+    // clang-format off
+    mapbox::sqlite::Query selectQuery{ getStatement(
+        "SELECT id FROM tile_data "
+        "WHERE hash = ?1 AND data = ?2") };
+    // clang-format on
+    selectQuery.bind(1, hash);
+    selectQuery.bindBlob(2, data.data(), data.size(), false);
+    if (selectQuery.run()) {
+        return selectQuery.get<int64_t>(0);
+    }
+
+    mapbox::sqlite::Query insertQuery{getStatement("INSERT INTO tile_data (hash, data) VALUES (?1, ?2)")};
+    insertQuery.bind(1, hash);
+    insertQuery.bindBlob(2, data.data(), data.size(), false);
+    insertQuery.run();
+    return insertQuery.lastInsertRowId();
+}
+
 std::exception_ptr OfflineDatabase::invalidateAmbientCache() try {
     checkFlags();
 
@@ -714,9 +1157,7 @@ std::exception_ptr OfflineDatabase::invalidateAmbientCache() try {
     mapbox::sqlite::Query tileQuery{ getStatement(
         "UPDATE tiles "
         "SET expires = 0, must_revalidate = 1 "
-        "WHERE id NOT IN ("
-        "    SELECT tile_id FROM region_tiles"
-        ")"
+        "WHERE ambient = 1"
     ) };
     // clang-format on
 
@@ -726,9 +1167,7 @@ std::exception_ptr OfflineDatabase::invalidateAmbientCache() try {
     mapbox::sqlite::Query resourceQuery{ getStatement(
         "UPDATE resources "
         "SET expires = 0, must_revalidate = 1 "
-        "WHERE id NOT IN ("
-        "    SELECT resource_id FROM region_resources"
-        ")"
+        "WHERE ambient = 1"
     ) };
     // clang-format on
 
@@ -746,9 +1185,7 @@ std::exception_ptr OfflineDatabase::clearAmbientCache() try {
     // clang-format off
     mapbox::sqlite::Query tileQuery{ getStatement(
         "DELETE FROM tiles "
-        "WHERE id NOT IN ("
-        "    SELECT tile_id FROM region_tiles"
-        ")"
+        "WHERE ambient = 1"
     ) };
     // clang-format on
 
@@ -757,9 +1194,7 @@ std::exception_ptr OfflineDatabase::clearAmbientCache() try {
     // clang-format off
     mapbox::sqlite::Query resourceQuery{ getStatement(
         "DELETE FROM resources "
-        "WHERE id NOT IN ("
-        "    SELECT resource_id FROM region_resources"
-        ")"
+        "WHERE ambient = 1"
     ) };
     // clang-format on
 
@@ -855,8 +1290,24 @@ expected<OfflineRegion, std::exception_ptr> OfflineDatabase::createRegion(const
 }
 
 expected<OfflineRegions, std::exception_ptr> OfflineDatabase::mergeDatabase(const std::string& sideDatabasePath) {
+    auto progress = beginMerge(sideDatabasePath);
+    while (progress && !progress->complete()) {
+        progress = mergeChunk();
+    }
+    if (!progress) {
+        return unexpected<std::exception_ptr>(progress.error());
+    }
+    return finishMerge();
+}
+
+expected<OfflineMergeProgress, std::exception_ptr> OfflineDatabase::beginMerge(const std::string& sideDatabasePath) {
     checkFlags();
 
+    if (merge) {
+        return unexpected<std::exception_ptr>(
+            std::make_exception_ptr(std::runtime_error("Another merge is in progress")));
+    }
+
     try {
         // clang-format off
         mapbox::sqlite::Query query{ getStatement("ATTACH DATABASE ?1 AS side") };
@@ -872,15 +1323,29 @@ expected<OfflineRegions, std::exception_ptr> OfflineDatabase::mergeDatabase(cons
         return unexpected<std::exception_ptr>(std::current_exception());
     }
     try {
-        // Support sideloaded databases at user_version = 6. Future schema
-        // version changes will need to implement migration paths for sideloaded
-        // databases at version 6.
+        // Support sideloaded databases at user_version = 6 to 10. Version 7
+        // only added the dictionaries table, version 8 the ambient columns,
+        // which the merge doesn't copy, version 9 the tile_data table and
+        // version 10 the download cursors, which the merge doesn't copy.
+        // Future schema version changes
+        // will need to implement migration paths for sideloaded databases at
+        // these versions.
         auto sideUserVersion = static_cast<int>(getPragma<int64_t>("PRAGMA side.user_version"));
         const auto mainUserVersion = getPragma<int64_t>("PRAGMA user_version");
-        if (sideUserVersion < 6 || sideUserVersion != mainUserVersion) {
+        if (sideUserVersion < 6 || sideUserVersion > mainUserVersion) {
             throw std::runtime_error("Merge database has incorrect user_version");
         }
 
+        // Without zstd, such tiles could neither be read nor transcoded, so
+        // the merge is refused before anything is copied.
+        if (!util::zstd::supported()) {
+            mapbox::sqlite::Query query{getStatement("SELECT 1 FROM side.tiles WHERE compressed = ?1 LIMIT 1")};
+            query.bind(1, static_cast<int>(DataEncoding::Zstd));
+            if (query.run()) {
+                throw std::runtime_error("Merge database uses zstd, which isn't supported in this build");
+            }
+        }
+
         auto currentTileCount = getOfflineMapboxTileCount();
         // clang-format off
          mapbox::sqlite::Query queryTiles{ getStatement(
@@ -905,8 +1370,192 @@ expected<OfflineRegions, std::exception_ptr> OfflineDatabase::mergeDatabase(cons
         queryTiles.reset();
 
         mapbox::sqlite::Transaction transaction(*db);
+        // The merge reads the contents of side tiles from side_tiles.data.
+        if (sideUserVersion >= 9) {
+            // clang-format off
+            db->exec(
+                "CREATE TEMPORARY VIEW side_tiles AS "
+                "SELECT st.id, st.url_template, st.pixel_ratio, st.z, st.x, st.y, st.expires, st.modified, st.etag, "
+                "       IFNULL(st.data, std.data) AS data, st.compressed, st.accessed, st.must_revalidate "
+                "FROM side.tiles st "
+                "LEFT JOIN side.tile_data std ON std.id = st.data_id");
+            // clang-format on
+        } else {
+            db->exec("CREATE TEMPORARY VIEW side_tiles AS SELECT * FROM side.tiles");
+        }
+        if (sideUserVersion >= 7) {
+            // Dictionary IDs are random, so equal IDs mean equal dictionaries.
+            db->exec("INSERT OR IGNORE INTO dictionaries SELECT * FROM side.dictionaries");
+            tileDictionaries.clear();
+        }
+        // Adds the side regions and maps them to regions of this database.
         db->exec(mergeSideloadedDatabaseSQL);
         transaction.commit();
+        merge.emplace();
+
+        {
+            mapbox::sqlite::Query query{getStatement("SELECT COUNT(DISTINCT tile_id) FROM side.region_tiles")};
+            query.run();
+            merge->progress.tileCount = query.get<int64_t>(0);
+        }
+        {
+            mapbox::sqlite::Query query{
+                getStatement("SELECT COUNT(DISTINCT resource_id) FROM side.region_resources")};
+            query.run();
+            merge->progress.resourceCount = query.get<int64_t>(0);
+        }
+        return merge->progress;
+    } catch (const std::runtime_error& ex) {
+        abortMerge();
+        Log::Error(Event::Database, std::string(ex.what()));
+
+        return unexpected<std::exception_ptr>(std::current_exception());
+    }
+}
+
+expected<OfflineMergeProgress, std::exception_ptr> OfflineDatabase::mergeChunk() {
+    checkFlags();
+
+    if (!merge) {
+        return unexpected<std::exception_ptr>(std::make_exception_ptr(std::runtime_error("No merge in progress")));
+    }
+
+    try {
+        OfflineMergeProgress& progress = merge->progress;
+        mapbox::sqlite::Transaction transaction(*db);
+
+        if (progress.completedTileCount < progress.tileCount) {
+            // clang-format off
+            mapbox::sqlite::Query chunkQuery{ getStatement(
+                "SELECT MAX(tile_id), COUNT(*) "
+                "FROM (SELECT DISTINCT tile_id FROM side.region_tiles "
+                "      WHERE tile_id > ?1 ORDER BY tile_id LIMIT ?2)") };
+            // clang-format on
+            chunkQuery.bind(1, merge->lastTileID);
+            chunkQuery.bind(2, static_cast<int64_t>(mergeChunkSize));
+            chunkQuery.run();
+            const auto count = static_cast<uint64_t>(chunkQuery.get<int64_t>(1));
+            const int64_t last = count ? chunkQuery.get<int64_t>(0) : merge->lastTileID;
+            chunkQuery.reset();
+
+            if (count == 0) {
+                progress.completedTileCount = progress.tileCount;
+            } else {
+                // Copy the side region tiles that are new, or newer than the
+                // ones in this database. Their old IDs are kept in case of a
+                // REPLACE; new tiles get a new ID.
+                // clang-format off
+                mapbox::sqlite::Query tilesQuery{ getStatement(
+                    "REPLACE INTO tiles (id, url_template, pixel_ratio, z, x, y, "
+                    "                   expires, modified, etag, data, compressed, accessed, must_revalidate) "
+                    "SELECT t.id, st.url_template, st.pixel_ratio, st.z, st.x, st.y, "
+                    "       st.expires, st.modified, st.etag, st.data, st.compressed, st.accessed, st.must_revalidate "
+                    "FROM side_tiles st "
+                    "LEFT JOIN tiles t ON st.url_template = t.url_template AND st.pixel_ratio = t.pixel_ratio "
+                    "                 AND st.z = t.z AND st.x = t.x AND st.y = t.y "
+                    "WHERE st.id > ?1 AND st.id <= ?2 "
+                    "  AND EXISTS (SELECT 1 FROM side.region_tiles srt WHERE srt.tile_id = st.id) "
+                    "  AND (t.id IS NULL OR st.modified > t.modified)") };
+                // clang-format on
+                tilesQuery.bind(1, merge->lastTileID);
+                tilesQuery.bind(2, last);
+                tilesQuery.run();
+
+                // clang-format off
+                mapbox::sqlite::Query regionTilesQuery{ getStatement(
+                    "INSERT OR IGNORE INTO region_tiles (region_id, tile_id) "
+                    "SELECT rm.main_region_id, t.id "
+                    "FROM side.region_tiles srt "
+                    "JOIN region_mapping rm ON srt.region_id = rm.side_region_id "
+                    "JOIN side.tiles st ON srt.tile_id = st.id "
+                    "JOIN tiles t ON st.url_template = t.url_template AND st.pixel_ratio = t.pixel_ratio "
+                    "            AND st.z = t.z AND st.x = t.x AND st.y = t.y "
+                    "WHERE srt.tile_id > ?1 AND srt.tile_id <= ?2") };
+                // clang-format on
+                regionTilesQuery.bind(1, merge->lastTileID);
+                regionTilesQuery.bind(2, last);
+                regionTilesQuery.run();
+
+                merge->lastTileID = last;
+                progress.completedTileCount += count;
+                offlineMapboxTileCount = std::nullopt;
+            }
+        } else if (progress.completedResourceCount < progress.resourceCount) {
+            // clang-format off
+            mapbox::sqlite::Query chunkQuery{ getStatement(
+                "SELECT MAX(resource_id), COUNT(*) "
+                "FROM (SELECT DISTINCT resource_id FROM side.region_resources "
+                "      WHERE resource_id > ?1 ORDER BY resource_id LIMIT ?2)") };
+            // clang-format on
+            chunkQuery.bind(1, merge->lastResourceID);
+            chunkQuery.bind(2, static_cast<int64_t>(mergeChunkSize));
+            chunkQuery.run();
+            const auto count = static_cast<uint64_t>(chunkQuery.get<int64_t>(1));
+            const int64_t last = count ? chunkQuery.get<int64_t>(0) : merge->lastResourceID;
+            chunkQuery.reset();
+
+            if (count == 0) {
+                progress.completedResourceCount = progress.resourceCount;
+            } else {
+                // clang-format off
+                mapbox::sqlite::Query resourcesQuery{ getStatement(
+                    "REPLACE INTO resources (id, url, kind, "
+                    "                       expires, modified, etag, data, compressed, accessed, must_revalidate) "
+                    "SELECT r.id, sr.url, sr.kind, sr.expires, sr.modified, sr.etag, "
+                    "       sr.data, sr.compressed, sr.accessed, sr.must_revalidate "
+                    "FROM side.resources sr "
+                    "LEFT JOIN resources r ON sr.url = r.url "
+                    "WHERE sr.id > ?1 AND sr.id <= ?2 "
+                    "  AND EXISTS (SELECT 1 FROM side.region_resources srr WHERE srr.resource_id = sr.id) "
+                    "  AND (r.id IS NULL OR sr.modified > r.modified)") };
+                // clang-format on
+                resourcesQuery.bind(1, merge->lastResourceID);
+                resourcesQuery.bind(2, last);
+                resourcesQuery.run();
+
+                // clang-format off
+                mapbox::sqlite::Query regionResourcesQuery{ getStatement(
+                    "INSERT OR IGNORE INTO region_resources (region_id, resource_id) "
+                    "SELECT rm.main_region_id, r.id "
+                    "FROM side.region_resources srr "
+                    "JOIN region_mapping rm ON srr.region_id = rm.side_region_id "
+                    "JOIN side.resources sr ON srr.resource_id = sr.id "
+                    "JOIN resources r ON sr.url = r.url "
+                    "WHERE srr.resource_id > ?1 AND srr.resource_id <= ?2") };
+                // clang-format on
+                regionResourcesQuery.bind(1, merge->lastResourceID);
+                regionResourcesQuery.bind(2, last);
+                regionResourcesQuery.run();
+
+                merge->lastResourceID = last;
+                progress.completedResourceCount += count;
+            }
+        }
+
+        transaction.commit();
+        return progress;
+    } catch (const std::runtime_error& ex) {
+        abortMerge();
+        Log::Error(Event::Database, std::string(ex.what()));
+
+        return unexpected<std::exception_ptr>(std::current_exception());
+    }
+}
+
+expected<OfflineRegions, std::exception_ptr> OfflineDatabase::finishMerge() {
+    checkFlags();
+
+    if (!merge) {
+        return unexpected<std::exception_ptr>(std::make_exception_ptr(std::runtime_error("No merge in progress")));
+    }
+
+    try {
+        mapbox::sqlite::Transaction transaction(*db);
+        db->exec("DROP VIEW side_tiles");
+        db->exec("DROP TABLE region_mapping");
+        deleteUnusedTileData();
+        transaction.commit();
+        merge = std::nullopt;
 
         // clang-format off
         mapbox::sqlite::Query queryRegions{ getStatement(
@@ -923,16 +1572,243 @@ expected<OfflineRegions, std::exception_ptr> OfflineDatabase::mergeDatabase(cons
                                  queryRegions.get<std::vector<uint8_t>>(2));
             result.emplace_back(std::move(region));
         }
+        queryRegions.reset();
         db->exec("DETACH DATABASE side");
         // Explicit move to avoid triggering the copy constructor.
         return {std::move(result)};
     } catch (const std::runtime_error& ex) {
-        db->exec("DETACH DATABASE side");
+        abortMerge();
         Log::Error(Event::Database, std::string(ex.what()));
 
         return unexpected<std::exception_ptr>(std::current_exception());
     }
-    return {};
+}
+
+// Undoes what beginMerge() set up. Its temporary view and table exist once
+// `merge` is set.
+void OfflineDatabase::abortMerge() {
+    if (!db) {
+        merge = std::nullopt;
+        return;
+    }
+    if (merge) {
+        merge = std::nullopt;
+        db->exec("DROP VIEW IF EXISTS side_tiles");
+        db->exec("DROP TABLE IF EXISTS region_mapping");
+        // The chunks merged so far are kept.
+        deleteUnusedTileData();
+    }
+    db->exec("DETACH DATABASE side");
+}
+
+// Merged tiles store their contents in tiles.data. REPLACE INTO doesn't fire
+// the delete triggers, so the contents the replaced tiles referred to are
+// removed once the merge ends.
+void OfflineDatabase::deleteUnusedTileData() {
+    db->exec("DELETE FROM tile_data WHERE NOT EXISTS (SELECT 1 FROM tiles WHERE data_id = tile_data.id)");
+}
+
+expected<uint64_t, std::exception_ptr> OfflineDatabase::importRegionTiles(int64_t regionID,
+                                                                        const std::string& archivePath,
+                                                                        const std::string& urlTemplate) try {
+    checkFlags();
+
+    if (!db) {
+        initialize();
+    }
+
+    const auto definition = getRegionDefinition(regionID);
+    if (!definition) {
+        return unexpected<std::exception_ptr>(definition.error());
+    }
+
+    // Key the tiles the way Resource::tile() does for this region.
+    const float pixelRatio = definition->match([](auto& def) { return def.pixelRatio; });
+    const bool supportsRatio = urlTemplate.find("{ratio}") != std::string::npos;
+    Resource::TileData tile{urlTemplate, uint8_t(supportsRatio && pixelRatio > 1.0 ? 2 : 1), 0, 0, 0};
+    const bool canonical = util::mapbox::isCanonicalURL(tileServerOptions, urlTemplate);
+    if (canonical) {
+        // Count the tiles stored so far before adding any.
+        getOfflineMapboxTileCount();
+    }
+
+    // Stores a tile like putTile() does, and returns its id. Archived tiles
+    // don't expire; they are revalidated like any other tile without caching
+    // headers once the region is online. New tiles, the common case, take a
+    // single statement. All tiles of an import are accessed at the same time.
+    const auto accessed = util::now();
+    const auto putArchivedTile = [&](const std::string& data, DataEncoding encoding) -> int64_t {
+        const int64_t dataID = putTileData(data);
+
+        // clang-format off
+        mapbox::sqlite::Query insertQuery{ getStatement(
+            "INSERT OR IGNORE INTO tiles (url_template, pixel_ratio, x,  y,  z,  accessed, data_id, compressed) "
+            "VALUES                      (?1,           ?2,          ?3, ?4, ?5, ?6,       ?7,      ?8)") };
+        // clang-format on
+        insertQuery.bind(1, tile.urlTemplate, false);
+        insertQuery.bind(2, tile.pixelRatio);
+        insertQuery.bind(3, tile.x);
+        insertQuery.bind(4, tile.y);
+        insertQuery.bind(5, tile.z);
+        insertQuery.bind(6, accessed);
+        insertQuery.bind(7, dataID);
+        insertQuery.bind(8, static_cast<uint8_t>(encoding));
+        insertQuery.run();
+        if (insertQuery.changes() != 0) {
+            return insertQuery.lastInsertRowId();
+        }
+
+        // clang-format off
+        mapbox::sqlite::Query selectQuery{ getStatement(
+            "SELECT id FROM tiles "
+            "WHERE url_template = ?1 "
+            "  AND pixel_ratio  = ?2 "
+            "  AND x            = ?3 "
+            "  AND y            = ?4 "
+            "  AND z            = ?5 ") };
+        // clang-format on
+        selectQuery.bind(1, tile.urlTemplate, false);
+        selectQuery.bind(2, tile.pixelRatio);
+        selectQuery.bind(3, tile.x);
+        selectQuery.bind(4, tile.y);
+        selectQuery.bind(5, tile.z);
+        selectQuery.run();
+        const auto tileID = selectQuery.get<int64_t>(0);
+
+        // clang-format off
+        mapbox::sqlite::Query updateQuery{ getStatement(
+            "UPDATE tiles "
+            "SET modified        = NULL, "
+            "    etag            = NULL, "
+            "    expires         = NULL, "
+            "    must_revalidate = 0, "
+            "    accessed        = ?1, "
+            "    data            = NULL, "
+            "    data_id         = ?2, "
+            "    compressed      = ?3 "
+            "WHERE id            = ?4 ") };
+        // clang-format on
+        updateQuery.bind(1, accessed);
+        updateQuery.bind(2, dataID);
+        updateQuery.bind(3, static_cast<uint8_t>(encoding));
+        updateQuery.bind(4, tileID);
+        updateQuery.run();
+        return tileID;
+    };
+
+    // Links a tile to the region like markUsed() does, but by id, and only
+    // looks at other regions when the tile counts towards the tile limit.
+    const auto linkTile = [&](int64_t tileID) -> bool {
+        mapbox::sqlite::Query insertQuery{
+            getStatement("INSERT OR IGNORE INTO region_tiles (region_id, tile_id) VALUES (?1, ?2)")};
+        insertQuery.bind(1, regionID);
+        insertQuery.bind(2, tileID);
+        insertQuery.run();
+        if (insertQuery.changes() == 0 || !canonical) {
+            return false;
+        }
+
+        mapbox::sqlite::Query selectQuery{
+            getStatement("SELECT 1 FROM region_tiles WHERE tile_id = ?1 AND region_id != ?2 LIMIT 1")};
+        selectQuery.bind(1, tileID);
+        selectQuery.bind(2, regionID);
+        return !selectQuery.run();
+    };
+
+    uint64_t count = 0;
+    std::optional<mapbox::sqlite::Transaction> transaction;
+    const auto importTile = [&](uint8_t z, uint32_t x, uint32_t y, const std::string& data, DataEncoding encoding) {
+        if (!transaction) {
+            transaction.emplace(*db);
+        }
+
+        tile.z = static_cast<int8_t>(z);
+        tile.x = static_cast<int32_t>(x);
+        tile.y = static_cast<int32_t>(y);
+
+        if (linkTile(putArchivedTile(data, encoding))) {
+            if (offlineMapboxTileCountLimitExceeded()) {
+                // Keep what was imported so far, like a download would.
+                transaction->commit();
+                throw MapboxTileLimitExceededException();
+            }
+            if (offlineMapboxTileCount) {
+                *offlineMapboxTileCount += 1;
+            }
+        }
+
+        if (++count % importBatchSize == 0) {
+            transaction->commit();
+            transaction.reset();
+        }
+    };
+
+    char magic[16] = {};
+    std::ifstream(archivePath, std::ios::binary).read(magic, sizeof(magic));
+
+    if (std::memcmp(magic, "PMTiles", 7) == 0) {
+        pmtiles::Archive archive(archivePath);
+        const uint8_t compression = archive.getHeader().tileCompression;
+        if (compression == pmtiles::Compression::Brotli || compression > pmtiles::Compression::Zstd) {
+            throw std::runtime_error("unsupported PMTiles tile compression");
+        }
+        if (compression == pmtiles::Compression::Zstd && !util::zstd::supported()) {
+            throw std::runtime_error("PMTiles archive uses zstd, which isn't supported in this build");
+        }
+
+        archive.forEachTile([&](uint8_t z, uint32_t x, uint32_t y, const char* bytes, size_t length) {
+            const std::string data(bytes, length);
+            DataEncoding encoding = DataEncoding::None;
+            if (compression == pmtiles::Compression::Zstd) {
+                encoding = DataEncoding::Zstd;
+            } else if (compression == pmtiles::Compression::Gzip ||
+                       (compression == pmtiles::Compression::UnknownCompression && isDeflated(data))) {
+                encoding = DataEncoding::Deflate;
+            }
+            importTile(z, x, y, data, encoding);
+        });
+    } else if (std::memcmp(magic, "SQLite format 3", 16) == 0) {
+        // Errors reading the archive must not be handled as errors of this
+        // database, which handleError() might delete.
+        bool importing = false;
+        try {
+            auto archive = mapbox::sqlite::Database::open(archivePath, mapbox::sqlite::ReadOnly);
+            mapbox::sqlite::Statement statement(archive,
+                                                "SELECT zoom_level, tile_column, tile_row, tile_data FROM tiles");
+            mapbox::sqlite::Query query{statement};
+            while (query.run()) {
+                const auto zoom = query.get<int64_t>(0);
+                if (zoom < 0 || zoom > 30) {
+                    throw std::runtime_error("invalid zoom level in MBTiles archive");
+                }
+                const auto z = static_cast<uint8_t>(zoom);
+                const auto x = static_cast<uint32_t>(query.get<int64_t>(1));
+                // MBTiles rows use the TMS scheme.
+                const auto y = static_cast<uint32_t>((int64_t(1) << z) - 1 - query.get<int64_t>(2));
+                const auto data = query.get<std::string>(3);
+                importing = true;
+                importTile(z, x, y, data, isDeflated(data) ? DataEncoding::Deflate : DataEncoding::None);
+                importing = false;
+            }
+        } catch (const mapbox::sqlite::Exception& ex) {
+            if (importing) {
+                throw;
+            }
+            throw std::runtime_error(std::string("can't read MBTiles archive: ") + ex.what());
+        }
+    } else {
+        throw std::runtime_error("not an MBTiles or PMTiles archive: " + archivePath);
+    }
+
+    if (transaction) {
+        transaction->commit();
+    }
+    return count;
+} catch (const MapboxTileLimitExceededException&) {
+    return unexpected<std::exception_ptr>(std::current_exception());
+} catch (...) {
+    handleError("import region tiles");
+    return unexpected<std::exception_ptr>(std::current_exception());
 }
 
 expected<OfflineRegionMetadata, std::exception_ptr> OfflineDatabase::updateMetadata(
@@ -978,7 +1854,9 @@ std::exception_ptr OfflineDatabase::deleteRegion(OfflineRegion&& region) try {
 }
 
 std::optional<std::pair<Response, uint64_t>> OfflineDatabase::getRegionResource(const Resource& resource) try {
-    return getInternal(resource);
+    auto result = getInternal(resource);
+    flushAccessedTimestampsIfDue();
+    return result;
 } catch (...) {
     handleError("read region resource");
     return std::nullopt;
@@ -1006,9 +1884,9 @@ uint64_t OfflineDatabase::putRegionResource(int64_t regionID, const Resource& re
     return 0;
 }
 
-void OfflineDatabase::putRegionResources(int64_t regionID,
-                                         const std::list<std::tuple<Resource, Response>>& resources,
-                                         OfflineRegionStatus& status) try {
+std::vector<uint64_t> OfflineDatabase::putRegionResources(int64_t regionID,
+                                                          const std::list<std::tuple<Resource, Response>>& resources,
+                                                          OfflineRegionStatus& status) try {
     checkFlags();
 
     if (!db) {
@@ -1023,6 +1901,8 @@ void OfflineDatabase::putRegionResources(int64_t regionID,
     uint64_t completedResourceSize = 0;
     uint64_t completedTileCount = 0;
     uint64_t completedTileSize = 0;
+    std::vector<uint64_t> sizes;
+    sizes.reserve(resources.size());
 
     for (const auto& elem : resources) {
         const auto& resource = std::get<0>(elem);
@@ -1030,6 +1910,11 @@ void OfflineDatabase::putRegionResources(int64_t regionID,
 
         try {
             uint64_t resourceSize = putRegionResourceInternal(regionID, resource, response);
+            if (resource.kind == Resource::Kind::Tile) {
+                // Count contents once per region, as getRegionCompletedStatus() does.
+                resourceSize = getUnsharedTileSize(regionID, *resource.tileData);
+            }
+            sizes.push_back(resourceSize);
             completedResourceCount++;
             completedResourceSize += resourceSize;
             if (resource.kind == Resource::Kind::Tile) {
@@ -1050,8 +1935,10 @@ void OfflineDatabase::putRegionResources(int64_t regionID,
     status.completedResourceSize += completedResourceSize;
     status.completedTileCount += completedTileCount;
     status.completedTileSize += completedTileSize;
+    return sizes;
 } catch (...) {
     handleError("write region resources");
+    return {};
 }
 
 uint64_t OfflineDatabase::putRegionResourceInternal(int64_t regionID,
@@ -1074,6 +1961,38 @@ uint64_t OfflineDatabase::putRegionResourceInternal(int64_t regionID,
     return size;
 }
 
+uint64_t OfflineDatabase::getUnsharedTileSize(int64_t regionID, const Resource::TileData& tile) {
+    // clang-format off
+    mapbox::sqlite::Query query{ getStatement(
+        "SELECT LENGTH(IFNULL(tiles.data, tile_data.data)) "
+        "FROM tiles "
+        "LEFT JOIN tile_data ON tile_data.id = tiles.data_id "
+        "WHERE url_template = ?2 "
+        "  AND pixel_ratio  = ?3 "
+        "  AND x            = ?4 "
+        "  AND y            = ?5 "
+        "  AND z            = ?6 "
+        "  AND (tiles.data_id IS NULL OR NOT EXISTS ( "
+        "    SELECT 1 FROM tiles other "
+        "    JOIN region_tiles ON region_tiles.tile_id = other.id "
+        "    WHERE region_tiles.region_id = ?1 "
+        "      AND other.data_id = tiles.data_id "
+        "      AND other.id != tiles.id)) ") };
+    // clang-format on
+
+    query.bind(1, regionID);
+    query.bind(2, tile.urlTemplate);
+    query.bind(3, tile.pixelRatio);
+    query.bind(4, tile.x);
+    query.bind(5, tile.y);
+    query.bind(6, tile.z);
+
+    if (!query.run()) {
+        return 0;
+    }
+    return query.get<std::optional<int64_t>>(0).value_or(0);
+}
+
 bool OfflineDatabase::markUsed(int64_t regionID, const Resource& resource) {
     checkFlags();
 
@@ -1183,6 +2102,68 @@ expected<OfflineRegionStatus, std::exception_ptr> OfflineDatabase::getRegionComp
     return unexpected<std::exception_ptr>(std::current_exception());
 }
 
+std::optional<OfflineDatabase::RegionTileCursor> OfflineDatabase::getRegionTileCursor(
+    int64_t regionID, const std::string& urlTemplate, const Range<uint8_t>& zoomRange) try {
+    // clang-format off
+    mapbox::sqlite::Query query{ getStatement(
+        "SELECT position, completed_count, completed_size "
+        "FROM region_tile_cursors "
+        "WHERE region_id = ?1 "
+        "AND url_template = ?2 "
+        "AND min_zoom = ?3 "
+        "AND max_zoom = ?4") };
+    // clang-format on
+    query.bind(1, regionID);
+    query.bind(2, urlTemplate);
+    query.bind(3, zoomRange.min);
+    query.bind(4, zoomRange.max);
+    if (!query.run()) {
+        return std::nullopt;
+    }
+    RegionTileCursor cursor;
+    cursor.position = query.get<int64_t>(0);
+    cursor.completedCount = query.get<int64_t>(1);
+    cursor.completedSize = query.get<int64_t>(2);
+    return cursor;
+} catch (...) {
+    handleError("read region tile cursor");
+    return std::nullopt;
+}
+
+void OfflineDatabase::putRegionTileCursor(int64_t regionID,
+                                          const std::string& urlTemplate,
+                                          const Range<uint8_t>& zoomRange,
+                                          const RegionTileCursor& cursor) try {
+    checkFlags();
+
+    // clang-format off
+    mapbox::sqlite::Query query{ getStatement(
+        "REPLACE INTO region_tile_cursors "
+        "(region_id, url_template, min_zoom, max_zoom, position, completed_count, completed_size) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)") };
+    // clang-format on
+    query.bind(1, regionID);
+    query.bind(2, urlTemplate);
+    query.bind(3, zoomRange.min);
+    query.bind(4, zoomRange.max);
+    query.bind(5, static_cast<int64_t>(cursor.position));
+    query.bind(6, static_cast<int64_t>(cursor.completedCount));
+    query.bind(7, static_cast<int64_t>(cursor.completedSize));
+    query.run();
+} catch (...) {
+    handleError("write region tile cursor");
+}
+
+void OfflineDatabase::deleteRegionTileCursors(int64_t regionID) try {
+    checkFlags();
+
+    mapbox::sqlite::Query query{getStatement("DELETE FROM region_tile_cursors WHERE region_id = ?1")};
+    query.bind(1, regionID);
+    query.run();
+} catch (...) {
+    handleError("delete region tile cursors");
+}
+
 std::pair<int64_t, int64_t> OfflineDatabase::getCompletedResourceCountAndSize(int64_t regionID) {
     // clang-format off
     mapbox::sqlite::Query query{ getStatement(
@@ -1197,9 +2178,18 @@ std::pair<int64_t, int64_t> OfflineDatabase::getCompletedResourceCountAndSize(in
 }
 
 std::pair<int64_t, int64_t> OfflineDatabase::getCompletedTileCountAndSize(int64_t regionID) {
+    // Contents shared by several tiles of the region are only stored once.
     // clang-format off
     mapbox::sqlite::Query query{ getStatement(
-        "SELECT COUNT(*), SUM(LENGTH(data)) "
+        "SELECT COUNT(*), "
+        "       IFNULL(SUM(LENGTH(data)), 0) "
+        "       + IFNULL(( "
+        "           SELECT SUM(LENGTH(data)) FROM tile_data "
+        "           WHERE id IN ( "
+        "             SELECT DISTINCT data_id FROM region_tiles, tiles "
+        "             WHERE region_id = ?1 AND tile_id = tiles.id "
+        "           ) "
+        "         ), 0) "
         "FROM region_tiles, tiles "
         "WHERE region_id = ?1 "
         "AND tile_id = tiles.id ") };
@@ -1230,78 +2220,111 @@ bool OfflineDatabase::evict(uint64_t neededFreeSize, DatabaseSizeChangeStats& st
     checkFlags();
     uint64_t ambientCacheSize = (initAmbientCacheSize() == nullptr) ? *currentAmbientCacheSize
                                                                     : maximumAmbientCacheSize;
-    uint64_t newAmbientCacheSize = ambientCacheSize + neededFreeSize + stats.pageSize();
+    const uint64_t neededAmbientCacheSize = ambientCacheSize + neededFreeSize + stats.pageSize();
+    uint64_t newAmbientCacheSize = neededAmbientCacheSize;
+
+    // Eviction picks entries by their accessed timestamp, so it has to see
+    // recent reads.
+    if (newAmbientCacheSize > maximumAmbientCacheSize) {
+        writeAccessedTimestamps();
+    }
 
     while (newAmbientCacheSize > maximumAmbientCacheSize) {
-        // clang-format off
-        mapbox::sqlite::Query accessedQuery{ getStatement(
-            "SELECT max(accessed) "
-            "FROM ( "
-            "    SELECT accessed "
-            "    FROM resources "
-            "    LEFT JOIN region_resources "
-            "    ON resource_id = resources.id "
-            "    WHERE resource_id IS NULL "
-            "  UNION ALL "
-            "    SELECT accessed "
-            "    FROM tiles "
-            "    LEFT JOIN region_tiles "
-            "    ON tile_id = tiles.id "
-            "    WHERE tile_id IS NULL "
-            "  ORDER BY accessed ASC LIMIT ?1 "
-            ") "
-        ) };
-        accessedQuery.bind(1, 50);
-        // clang-format on
-        if (!accessedQuery.run()) {
+        if (!evictLeastRecentlyUsed(evictionBatchSize)) {
             return false;
         }
-        Timestamp accessed = accessedQuery.get<Timestamp>(0);
-
-        // clang-format off
-        mapbox::sqlite::Query resourceQuery{ getStatement(
-            "DELETE FROM resources "
-            "WHERE id IN ( "
-            "  SELECT id FROM resources "
-            "  LEFT JOIN region_resources "
-            "  ON resource_id = resources.id "
-            "  WHERE resource_id IS NULL "
-            "  AND accessed <= ?1 "
-            ") ") };
-        // clang-format on
-        resourceQuery.bind(1, accessed);
-        resourceQuery.run();
-        const uint64_t resourceChanges = resourceQuery.changes();
-
-        // clang-format off
-        mapbox::sqlite::Query tileQuery{ getStatement(
-            "DELETE FROM tiles "
-            "WHERE id IN ( "
-            "  SELECT id FROM tiles "
-            "  LEFT JOIN region_tiles "
-            "  ON tile_id = tiles.id "
-            "  WHERE tile_id IS NULL "
-            "  AND accessed <= ?1 "
-            ") ") };
-        // clang-format on
-        tileQuery.bind(1, accessed);
-        tileQuery.run();
-        const uint64_t tileChanges = tileQuery.changes();
 
         // Update current ambient cache size, based on how many bytes were released.
         newAmbientCacheSize = std::max<int64_t>(
-            static_cast<int64_t>(newAmbientCacheSize) - static_cast<int64_t>(stats.bytesReleased()), 0u);
-
-        // The cached value of offlineTileCount does not need to be updated
-        // here because only non-offline tiles can be removed by eviction.
-        if (resourceChanges == 0 && tileChanges == 0) {
-            return false;
-        }
+            static_cast<int64_t>(neededAmbientCacheSize) - static_cast<int64_t>(stats.bytesReleased()), 0u);
     }
 
     return true;
 }
 
+// Deletes about the `count` least recently used ambient entries; up to `count`
+// of each table. Returns false if there was nothing to delete. The ambient
+// flags make all queries range scans of the (ambient, accessed) indexes.
+bool OfflineDatabase::evictLeastRecentlyUsed(uint64_t count) {
+    // clang-format off
+    mapbox::sqlite::Query accessedQuery{ getStatement(
+        "SELECT max(accessed) "
+        "FROM ( "
+        "    SELECT accessed FROM resources WHERE ambient = 1 "
+        "  UNION ALL "
+        "    SELECT accessed FROM tiles WHERE ambient = 1 "
+        "  ORDER BY accessed ASC LIMIT ?1 "
+        ") "
+    ) };
+    // clang-format on
+    accessedQuery.bind(1, static_cast<int64_t>(count));
+    const auto accessed = accessedQuery.run() ? accessedQuery.get<std::optional<Timestamp>>(0) : std::nullopt;
+    if (!accessed) {
+        return false;
+    }
+
+    // clang-format off
+    mapbox::sqlite::Query resourceQuery{ getStatement(
+        "DELETE FROM resources "
+        "WHERE id IN ( "
+        "  SELECT id FROM resources "
+        "  WHERE ambient = 1 AND accessed <= ?1 "
+        "  ORDER BY accessed LIMIT ?2 "
+        ") ") };
+    // clang-format on
+    resourceQuery.bind(1, *accessed);
+    resourceQuery.bind(2, static_cast<int64_t>(count));
+    resourceQuery.run();
+    const uint64_t resourceChanges = resourceQuery.changes();
+
+    // clang-format off
+    mapbox::sqlite::Query tileQuery{ getStatement(
+        "DELETE FROM tiles "
+        "WHERE id IN ( "
+        "  SELECT id FROM tiles "
+        "  WHERE ambient = 1 AND accessed <= ?1 "
+        "  ORDER BY accessed LIMIT ?2 "
+        ") ") };
+    // clang-format on
+    tileQuery.bind(1, *accessed);
+    tileQuery.bind(2, static_cast<int64_t>(count));
+    tileQuery.run();
+    const uint64_t tileChanges = tileQuery.changes();
+
+    // The cached value of offlineTileCount does not need to be updated
+    // here because only non-offline tiles can be removed by eviction.
+    return resourceChanges != 0 || tileChanges != 0;
+}
+
+bool OfflineDatabase::evictAmbientCacheBatch() try {
+    if (readOnly || !db || initAmbientCacheSize()) {
+        return false;
+    }
+
+    const uint64_t highWatermark = maximumAmbientCacheSize / 100 * ambientCacheHighWatermark;
+    const uint64_t lowWatermark = maximumAmbientCacheSize / 100 * ambientCacheLowWatermark;
+    if (!ambientCacheEvicting && *currentAmbientCacheSize <= highWatermark) {
+        return false;
+    }
+
+    DatabaseSizeChangeStats stats(this);
+    bool evicted = false;
+    {
+        mapbox::sqlite::Transaction transaction(*db);
+        writeAccessedTimestamps();
+        evicted = evictLeastRecentlyUsed(evictionBatchSize);
+        transaction.commit();
+    }
+    updateAmbientCacheSize(stats);
+
+    ambientCacheEvicting = evicted && *currentAmbientCacheSize > lowWatermark;
+    return ambientCacheEvicting;
+} catch (...) {
+    ambientCacheEvicting = false;
+    handleError("evict ambient cache");
+    return false;
+}
+
 std::exception_ptr OfflineDatabase::initAmbientCacheSize() {
     if (!currentAmbientCacheSize) {
         try {
@@ -1322,11 +2345,18 @@ std::exception_ptr OfflineDatabase::initAmbientCacheSize() {
             "               + IFNULL(LENGTH(compressed), 0) "
             "               + IFNULL(LENGTH(accessed), 0) "
             "               + IFNULL(LENGTH(must_revalidate), 0) "
+            "               + IFNULL(LENGTH(ambient), 0) "
+            "               + IFNULL(LENGTH(data_id), 0) "
             "               ) as data "
             "    FROM tiles "
-            "    LEFT JOIN region_tiles "
-            "    ON tile_id = tiles.id "
-            "    WHERE tile_id IS NULL "
+            "    WHERE ambient = 1 "
+            "  UNION ALL "
+            "    SELECT SUM(IFNULL(LENGTH(data), 0) "
+            "               + IFNULL(LENGTH(id), 0) "
+            "               + IFNULL(LENGTH(hash), 0) "
+            "               ) as data "
+            "    FROM tile_data "
+            "    WHERE id IN (SELECT data_id FROM tiles WHERE ambient = 1) "
             "  UNION ALL "
             "    SELECT SUM(IFNULL(LENGTH(data), 0) "
             "               + IFNULL(LENGTH(id), 0) "
@@ -1338,11 +2368,10 @@ std::exception_ptr OfflineDatabase::initAmbientCacheSize() {
             "               + IFNULL(LENGTH(compressed), 0) "
             "               + IFNULL(LENGTH(accessed), 0) "
             "               + IFNULL(LENGTH(must_revalidate), 0) "
+            "               + IFNULL(LENGTH(ambient), 0) "
             "               ) as data "
             "    FROM resources "
-            "    LEFT JOIN region_resources "
-            "    ON resource_id = resources.id "
-            "    WHERE resource_id IS NULL "
+            "    WHERE ambient = 1 "
             ") ") };
             // clang-format on
             query.run();
@@ -1440,6 +2469,10 @@ void OfflineDatabase::markUsedResources(int64_t regionID, const std::list<Resour
 
 std::exception_ptr OfflineDatabase::pack() try {
     if (!db) initialize();
+    checkFlags();
+    // A merge that didn't finish, e.g. because the database was closed, can
+    // leave tile contents behind.
+    if (!merge) deleteUnusedTileData();
     vacuum();
     return nullptr;
 } catch (...) {
@@ -1467,6 +2500,81 @@ void OfflineDatabase::reopenDatabaseReadOnly(bool readOnly_) {
     }
 }
 
+std::vector<std::string> OfflineDatabase::getTileDictionarySamples(const std::string& urlTemplate) try {
+    if (readOnly || !util::zstd::supported() || getTileDictionary(urlTemplate)) {
+        return {};
+    }
+
+    std::vector<std::string> samples;
+    {
+        // clang-format off
+        mapbox::sqlite::Query query{ getStatement(
+            "SELECT IFNULL(tiles.data, tile_data.data), compressed FROM tiles "
+            "LEFT JOIN tile_data ON tile_data.id = tiles.data_id "
+            "WHERE url_template = ?1 AND (tiles.data IS NOT NULL OR data_id IS NOT NULL) "
+            "LIMIT ?2") };
+        // clang-format on
+        query.bind(1, urlTemplate);
+        query.bind(2, static_cast<int64_t>(maximumDictionarySamples));
+
+        std::size_t sampleSize = 0;
+        while (sampleSize < maximumDictionarySampleSize && query.run()) {
+            Response response;
+            setResponseData(response, query.get<std::string>(0), static_cast<DataEncoding>(query.get<int>(1)), false);
+            sampleSize += response.data->size();
+            samples.push_back(std::move(*response.data));
+        }
+    }
+
+    if (samples.size() < minimumDictionarySamples) {
+        return {};
+    }
+    return samples;
+} catch (...) {
+    handleError("read compression dictionary samples");
+    return {};
+}
+
+std::string OfflineDatabase::trainDictionary(const std::vector<std::string>& samples) {
+    if (samples.empty() || !util::zstd::supported()) {
+        return {};
+    }
+    return util::zstd::trainDictionary(samples, dictionaryCapacity);
+}
+
+bool OfflineDatabase::putTileDictionary(const std::string& urlTemplate, const std::string& data) try {
+    if (readOnly || data.empty() || getTileDictionary(urlTemplate)) {
+        return false;
+    }
+    auto dictionary = std::make_shared<const util::zstd::Dictionary>(data);
+
+    // clang-format off
+    mapbox::sqlite::Query query{ getStatement(
+        "INSERT OR IGNORE INTO dictionaries (id, url_template, data) "
+        "VALUES (?1, ?2, ?3)") };
+    // clang-format on
+    query.bind(1, dictionary->id());
+    query.bind(2, urlTemplate);
+    query.bindBlob(3, data.data(), data.size(), false);
+    query.run();
+    if (query.changes() == 0) {
+        // Another dictionary already has this ID.
+        return false;
+    }
+
+    util::zstd::registerDictionary(dictionary);
+    dictionaries[dictionary->id()] = dictionary;
+    tileDictionaries[urlTemplate] = dictionary;
+    return true;
+} catch (...) {
+    handleError("store compression dictionary");
+    return false;
+}
+
+bool OfflineDatabase::trainTileDictionary(const std::string& urlTemplate) {
+    return putTileDictionary(urlTemplate, trainDictionary(getTileDictionarySamples(urlTemplate)));
+}
+
 OfflineDatabase::DatabaseSizeChangeStats::DatabaseSizeChangeStats(OfflineDatabase* db_)
     : db(db_) {
     assert(db);
@@ -1,3 +1,4 @@
+#include <mbgl/actor/scheduler.hpp>
 #include <mbgl/storage/offline_database.hpp>
 #include <mbgl/storage/offline_download.hpp>
 #include <mbgl/storage/resource.hpp>
@@ -18,12 +19,17 @@
 #include <mbgl/util/tile_cover.hpp>
 #include <mbgl/util/tileset.hpp>
 
+#include <algorithm>
 #include <set>
+#include <tuple>
 
 namespace {
 
 const size_t kResourcesBatchSize = 64;
 const size_t kMarkBatchSize = 200;
+// Number of tiles of a tileset to store before training a compression
+// dictionary for the rest of them.
+const uint32_t kDictionaryTrainingTileCount = 256;
 
 } // namespace
 
@@ -48,28 +54,43 @@ Range<uint8_t> coveringZoomRange(const RegionDefinition& definition,
     return {static_cast<uint8_t>(minZ), static_cast<uint8_t>(maxZ)};
 }
 
-template <class Geometry, class Fn>
-void tileCover(const Geometry& geometry, uint8_t z, Fn&& fn) {
-    util::TileCover cover(geometry, z);
-    while (cover.hasNext()) {
-        fn(cover.next()->canonical);
+// Enumerates the tiles of a region at a range of zoom levels, one at a time,
+// so that only the current row of tiles is kept in memory.
+class OfflineTileCover {
+public:
+    OfflineTileCover(const OfflineRegionDefinition& definition_, const Range<uint8_t>& zoomRange)
+        : definition(definition_),
+          z(zoomRange.min),
+          maxZ(zoomRange.max) {}
+
+    std::optional<CanonicalTileID> next() {
+        while (true) {
+            if (cover && cover->hasNext()) {
+                if (auto tile = cover->next()) {
+                    return tile->canonical;
+                }
+                cover.reset();
+            } else if (z <= maxZ) {
+                const auto zoom = static_cast<uint8_t>(z++);
+                cover = definition.match(
+                    [&](const OfflineTilePyramidRegionDefinition& reg) {
+                        return std::make_unique<util::TileCover>(reg.bounds, zoom);
+                    },
+                    [&](const OfflineGeometryRegionDefinition& reg) {
+                        return std::make_unique<util::TileCover>(reg.geometry, zoom);
+                    });
+            } else {
+                return std::nullopt;
+            }
+        }
     }
-}
 
-template <class Fn>
-void tileCover(const OfflineRegionDefinition& definition,
-               style::SourceType type,
-               uint16_t tileSize,
-               const Range<uint8_t>& zoomRange,
-               Fn&& fn) {
-    const Range<uint8_t> clampedZoomRange = definition.match(
-        [&](auto& reg) { return coveringZoomRange(reg, type, tileSize, zoomRange); });
-
-    for (uint8_t z = clampedZoomRange.min; z <= clampedZoomRange.max; z++) {
-        definition.match([&](const OfflineTilePyramidRegionDefinition& reg) { tileCover(reg.bounds, z, fn); },
-                         [&](const OfflineGeometryRegionDefinition& reg) { tileCover(reg.geometry, z, fn); });
-    }
-}
+private:
+    const OfflineRegionDefinition& definition;
+    std::unique_ptr<util::TileCover> cover;
+    uint32_t z;
+    const uint32_t maxZ;
+};
 
 uint64_t tileCount(const OfflineRegionDefinition& definition,
                    style::SourceType type,
@@ -90,6 +111,36 @@ uint64_t tileCount(const OfflineRegionDefinition& definition,
 
 // OfflineDownload
 
+struct OfflineDownload::TileStream {
+    TileStream(const OfflineRegionDefinition& definition, const Tileset& tileset, const Range<uint8_t>& zoomRange_)
+        : urlTemplate(tileset.tiles[0]),
+          scheme(tileset.scheme),
+          zoomRange(zoomRange_),
+          cover(definition, zoomRange) {}
+
+    const std::string urlTemplate;
+    const Tileset::Scheme scheme;
+    const Range<uint8_t> zoomRange;
+    OfflineTileCover cover;
+    bool exhausted = false;
+
+    // Number of tiles enumerated so far, and the number that was added to
+    // the required counts before enumerating them.
+    uint64_t position = 0;
+    uint64_t estimatedCount = 0;
+
+    // The tiles before the cursor are done. Tiles after it that have been
+    // enumerated are pending, by position, until the cursor passes them.
+    OfflineDatabase::RegionTileCursor cursor;
+    uint64_t savedPosition = 0;
+    struct PendingTile {
+        bool done = false;
+        std::optional<uint64_t> storedSize;
+    };
+    std::map<uint64_t, PendingTile> pending;
+    std::map<std::tuple<int32_t, int32_t, int8_t>, uint64_t> pendingPositions;
+};
+
 OfflineDownload::OfflineDownload(int64_t id_,
                                  OfflineRegionDefinition definition_,
                                  OfflineDatabase& offlineDatabase_,
@@ -375,11 +426,14 @@ void OfflineDownload::activateDownload() {
    fruitless anyway.
 */
 void OfflineDownload::continueDownload() {
-    if (resourcesRemaining.empty()) {
+    if (!hasResourcesRemaining()) {
         // Flush pending buffers.
         if (!flushResourcesBuffer()) return;
         if (status.complete()) {
             markPendingUsedResources();
+            // Activating the download again checks all of its resources.
+            tileStreams.clear();
+            offlineDatabase.deleteRegionTileCursors(id);
             setState(OfflineRegionDownloadState::Inactive);
             return;
         }
@@ -393,15 +447,23 @@ void OfflineDownload::continueDownload() {
         maxConcurrentRequests = static_cast<uint32_t>(*maxRequests);
     }
 
-    while (!resourcesRemaining.empty() && requests.size() < maxConcurrentRequests) {
-        ensureResource(std::move(resourcesRemaining.front()));
-        resourcesRemaining.pop_front();
+    while (requests.size() < maxConcurrentRequests) {
+        if (!resourcesRemaining.empty()) {
+            ensureResource(std::move(resourcesRemaining.front()));
+            resourcesRemaining.pop_front();
+        } else if (auto tile = nextTile()) {
+            ensureResource(std::move(*tile));
+        } else {
+            break;
+        }
     }
 }
 
 void OfflineDownload::deactivateDownload() {
+    saveTileCursors();
     requiredSourceURLs.clear();
     resourcesRemaining.clear();
+    tileStreams.clear();
     requests.clear();
     buffer.clear();
 }
@@ -409,8 +471,23 @@ void OfflineDownload::deactivateDownload() {
 bool OfflineDownload::flushResourcesBuffer() {
     if (buffer.empty()) return true;
     try {
-        offlineDatabase.putRegionResources(id, buffer, status);
+        const auto sizes = offlineDatabase.putRegionResources(id, buffer, status);
+        auto size = sizes.begin();
+        for (const auto& [resource, response] : buffer) {
+            if (resource.kind == Resource::Kind::Tile && !response.noContent &&
+                ++storedTileCounts[resource.tileData->urlTemplate] == kDictionaryTrainingTileCount) {
+                trainTileDictionary(resource.tileData->urlTemplate);
+            }
+            // Tiles that couldn't be stored are fetched again when the download resumes.
+            if (size != sizes.end()) {
+                if (resource.kind == Resource::Kind::Tile) {
+                    tileDone(resource, *size);
+                }
+                ++size;
+            }
+        }
         buffer.clear();
+        saveTileCursors();
         observer->statusChanged(status);
         return true;
     } catch (const MapboxTileLimitExceededException&) {
@@ -419,6 +496,21 @@ bool OfflineDownload::flushResourcesBuffer() {
     }
 }
 
+void OfflineDownload::trainTileDictionary(const std::string& urlTemplate) {
+    auto samples = std::make_shared<const std::vector<std::string>>(
+        offlineDatabase.getTileDictionarySamples(urlTemplate));
+    if (samples->empty()) return;
+
+    auto train = [samples] {
+        return OfflineDatabase::trainDictionary(*samples);
+    };
+    auto store = [this, weak = weakFactory.makeWeakPtr(), urlTemplate](const std::string& dictionary) {
+        if (!weak) return; // This download has been deleted.
+        offlineDatabase.putTileDictionary(urlTemplate, dictionary);
+    };
+    Scheduler::GetBackground()->scheduleAndReplyValue(train, store);
+}
+
 void OfflineDownload::queueResource(Resource&& resource) {
     resource.setPriority(Resource::Priority::Low);
     resource.setUsage(Resource::Usage::Offline);
@@ -430,22 +522,126 @@ void OfflineDownload::queueResource(Resource&& resource) {
 }
 
 void OfflineDownload::queueTiles(SourceType type, uint16_t tileSize, const Tileset& tileset) {
-    tileCover(definition, type, tileSize, tileset.zoomRange, [&](const auto& tile) {
-        status.requiredResourceCount++;
-        status.requiredTileCount++;
+    const Range<uint8_t> zoomRange = definition.match(
+        [&](auto& reg) { return coveringZoomRange(reg, type, tileSize, tileset.zoomRange); });
+    auto stream = std::make_unique<TileStream>(definition, tileset, zoomRange);
+    stream->estimatedCount = tileCount(definition, type, tileSize, tileset.zoomRange);
+    status.requiredResourceCount += stream->estimatedCount;
+    status.requiredTileCount += stream->estimatedCount;
+
+    // Skip the tiles that an interrupted download of the region already got
+    // through, without checking them in the database again.
+    if (auto cursor = offlineDatabase.getRegionTileCursor(id, stream->urlTemplate, zoomRange)) {
+        while (stream->position < cursor->position && stream->cover.next()) {
+            stream->position++;
+        }
+        if (stream->position == cursor->position) {
+            stream->cursor = *cursor;
+            stream->savedPosition = cursor->position;
+            status.completedResourceCount += cursor->completedCount;
+            status.completedResourceSize += cursor->completedSize;
+            status.completedTileCount += cursor->completedCount;
+            status.completedTileSize += cursor->completedSize;
+            // Tiles that were not found are not required, see ensureResource.
+            status.requiredResourceCount -= cursor->position - cursor->completedCount;
+        } else {
+            // The region has fewer tiles than the cursor; start over.
+            auto restarted = std::make_unique<TileStream>(definition, tileset, zoomRange);
+            restarted->estimatedCount = stream->estimatedCount;
+            stream = std::move(restarted);
+        }
+    }
 
-        auto tileResource = Resource::tile(tileset.tiles[0],
-                                           definition.match([](auto& def) { return def.pixelRatio; }),
-                                           tile.x,
-                                           tile.y,
-                                           tile.z,
-                                           tileset.scheme);
+    tileStreams.push_back(std::move(stream));
+}
+
+std::optional<Resource> OfflineDownload::nextTile() {
+    for (auto& stream : tileStreams) {
+        if (stream->exhausted) {
+            continue;
+        }
+
+        if (auto tile = stream->cover.next()) {
+            auto tileResource = Resource::tile(stream->urlTemplate,
+                                               definition.match([](auto& def) { return def.pixelRatio; }),
+                                               tile->x,
+                                               tile->y,
+                                               tile->z,
+                                               stream->scheme);
+
+            tileResource.setPriority(Resource::Priority::Low);
+            tileResource.setUsage(Resource::Usage::Offline);
+            // Tiles are only stored, so keep them in the encoding they arrive in.
+            tileResource.acceptsCompressedData = true;
+
+            const auto& tileData = *tileResource.tileData;
+            stream->pending.emplace(stream->position, TileStream::PendingTile{});
+            stream->pendingPositions.emplace(std::make_tuple(tileData.x, tileData.y, tileData.z), stream->position);
+            stream->position++;
+            return tileResource;
+        }
+
+        // Replace the estimate with the actual number of tiles.
+        stream->exhausted = true;
+        status.requiredResourceCount += stream->position;
+        status.requiredResourceCount -= stream->estimatedCount;
+        status.requiredTileCount += stream->position;
+        status.requiredTileCount -= stream->estimatedCount;
+    }
+    return std::nullopt;
+}
+
+bool OfflineDownload::hasResourcesRemaining() const {
+    return !resourcesRemaining.empty() ||
+           std::any_of(tileStreams.begin(), tileStreams.end(), [](const auto& stream) { return !stream->exhausted; });
+}
 
-        tileResource.setPriority(Resource::Priority::Low);
-        tileResource.setUsage(Resource::Usage::Offline);
+void OfflineDownload::tileDone(const Resource& resource, std::optional<uint64_t> storedSize) {
+    const auto& tileData = *resource.tileData;
+    for (auto& stream : tileStreams) {
+        if (stream->urlTemplate != tileData.urlTemplate) {
+            continue;
+        }
+        auto it = stream->pendingPositions.find(std::make_tuple(tileData.x, tileData.y, tileData.z));
+        if (it == stream->pendingPositions.end()) {
+            continue;
+        }
 
-        resourcesRemaining.push_back(std::move(tileResource));
+        auto& tile = stream->pending[it->second];
+        tile.done = true;
+        tile.storedSize = storedSize;
+        stream->pendingPositions.erase(it);
+
+        // Move the cursor past the tiles that are done.
+        while (!stream->pending.empty() && stream->pending.begin()->second.done) {
+            const auto& [position, done] = *stream->pending.begin();
+            stream->cursor.position = position + 1;
+            if (done.storedSize) {
+                stream->cursor.completedCount++;
+                stream->cursor.completedSize += *done.storedSize;
+            }
+            stream->pending.erase(stream->pending.begin());
+        }
+        return;
+    }
+}
+
+void OfflineDownload::saveTileCursors() {
+    const bool advanced = std::any_of(tileStreams.begin(), tileStreams.end(), [](const auto& stream) {
+        return stream->cursor.position > stream->savedPosition;
     });
+    if (!advanced) return;
+
+    // Tiles found in the database only belong to the region once they are
+    // marked as used, and a saved cursor must not pass unlinked tiles.
+    if (!resourcesToBeMarkedAsUsed.empty()) markPendingUsedResources();
+
+    for (auto& stream : tileStreams) {
+        if (stream->cursor.position > stream->savedPosition) {
+            offlineDatabase.putRegionTileCursor(id, stream->urlTemplate, stream->zoomRange, stream->cursor);
+            stream->savedPosition = stream->cursor.position;
+        }
+    }
 }
 
 void OfflineDownload::markPendingUsedResources() {
@@ -485,6 +681,7 @@ void OfflineDownload::ensureResource(Resource&& resource, std::function<void(Res
             if (resourceKind == Resource::Kind::Tile) {
                 status.completedTileCount += 1;
                 status.completedTileSize += *offlineResponse;
+                tileDone(resource, static_cast<uint64_t>(*offlineResponse));
             }
 
             observer->statusChanged(status);
@@ -506,6 +703,9 @@ void OfflineDownload::ensureResource(Resource&& resource, std::function<void(Res
                     requests.erase(fileRequestsIt);
                     assert(status.requiredResourceCount > 0);
                     status.requiredResourceCount--;
+                    if (resource.kind == Resource::Kind::Tile) {
+                        tileDone(resource, std::nullopt);
+                    }
                     continueDownload();
                 }
                 return;
@@ -521,10 +721,10 @@ void OfflineDownload::ensureResource(Resource&& resource, std::function<void(Res
             buffer.emplace_back(resource, onlineResponse);
 
             // Flush buffer periodically.
-            // Have to keep `resourcesRemaining.empty()` as the following
+            // Have to keep `!hasResourcesRemaining()` as the following
             // condition would fail otherwise.
             // TODO: Simplify the tile count limit check code path!
-            if ((buffer.size() == kResourcesBatchSize || resourcesRemaining.empty()) && !flushResourcesBuffer()) return;
+            if ((buffer.size() == kResourcesBatchSize || !hasResourcesRemaining()) && !flushResourcesBuffer()) return;
 
             if (offlineDatabase.exceedsOfflineMapboxTileCountLimit(resource)) {
                 onMapboxTileCountLimitExceeded();
@@ -25,8 +25,9 @@
 
 #include <algorithm>
 #include <cassert>
-#include <list>
 #include <map>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 
 namespace mbgl {
@@ -92,6 +93,17 @@ public:
         tasks[req] = std::make_unique<OnlineFileRequest>(std::move(resource), std::move(callback), *this);
     }
 
+    void updatePriority(AsyncRequest* req, Resource::Priority priority, uint32_t priorityOrder) {
+        auto it = tasks.find(req);
+        if (it == tasks.end()) {
+            return;
+        }
+        OnlineFileRequest* request = it->second.get();
+        request->resource.priority = priority;
+        request->resource.priorityOrder = priorityOrder;
+        pendingRequests.update(request);
+    }
+
     void cancel(AsyncRequest* req) {
         auto it = tasks.find(req);
         assert(it != tasks.end());
@@ -171,7 +183,10 @@ public:
 
     void setResourceTransform(ResourceTransform transform) { resourceTransform = std::move(transform); }
 
-    void setResourceOptions(ResourceOptions options) { resourceOptions = options; }
+    void setResourceOptions(ResourceOptions options) {
+        httpFileSource.setResourceOptions(options.clone());
+        resourceOptions = std::move(options);
+    }
 
     const ResourceOptions& getResourceOptions() const { return resourceOptions; }
 
@@ -205,59 +220,56 @@ private:
     friend struct OnlineFileRequest;
 
     void networkIsReachableAgain() {
-        // Notify regular priority requests.
-        for (auto& req : allRequests) {
-            if (req->resource.priority == Resource::Priority::Regular) {
-                req->networkIsReachableAgain();
-            }
-        }
-
-        // Notify low priority requests.
-        for (auto& req : allRequests) {
-            if (req->resource.priority == Resource::Priority::Low) {
-                req->networkIsReachableAgain();
+        // Notify the requests in order of priority.
+        for (const auto priority : {Resource::Priority::High,
+                                    Resource::Priority::Regular,
+                                    Resource::Priority::Prefetch,
+                                    Resource::Priority::Low}) {
+            for (auto& req : allRequests) {
+                if (req->resource.priority == priority) {
+                    req->networkIsReachableAgain();
+                }
             }
         }
     }
 
-    // Using Pending Requests as an priority queue which processes
-    // file requests in a FIFO manner but prefers regular requests
-    // over offline requests with a low priority such that low priority
-    // requests do not throttle regular requests.
-    //
-    // The order of a queue is therefore:
-    //
-    // hi0 -- hi1 -- hi2 -- hi3 -- lo0 -- lo1 --lo2
-    //                              ^
-    //                              firstLowPriorityRequest
-
+    // Pending requests are served by priority, then by their priority order
+    // (e.g. the distance of a tile from the center of the screen), and in the
+    // order they were queued otherwise, so that requests for later parts of
+    // the map do not throttle the ones that are needed now. Queueing,
+    // reprioritizing, removing and popping a request are all O(log n).
     struct PendingRequests {
-        PendingRequests()
-            : firstLowPriorityRequest(queue.begin()) {}
+        using Key = std::tuple<Resource::Priority, uint32_t, uint64_t>;
 
-        std::list<OnlineFileRequest*> queue;
-        std::list<OnlineFileRequest*>::iterator firstLowPriorityRequest;
+        std::map<Key, OnlineFileRequest*> queue;
+        std::unordered_map<const OnlineFileRequest*, std::map<Key, OnlineFileRequest*>::iterator> index;
+        uint64_t sequence = 0;
 
         void remove(const OnlineFileRequest* request) {
-            auto it = std::find(queue.begin(), queue.end(), request);
-            if (it != queue.end()) {
-                if (it == firstLowPriorityRequest) {
-                    firstLowPriorityRequest++;
-                }
-                queue.erase(it);
+            auto it = index.find(request);
+            if (it != index.end()) {
+                queue.erase(it->second);
+                index.erase(it);
             }
         }
 
         void insert(OnlineFileRequest* request) {
-            if (request->resource.priority == Resource::Priority::Regular) {
-                firstLowPriorityRequest = queue.insert(firstLowPriorityRequest, request);
-                firstLowPriorityRequest++;
-            } else {
-                if (firstLowPriorityRequest == queue.end()) {
-                    firstLowPriorityRequest = queue.insert(queue.end(), request);
-                } else {
-                    queue.insert(queue.end(), request);
-                }
+            assert(!contains(request));
+            const Key key{request->resource.priority, request->resource.priorityOrder, sequence++};
+            index.emplace(request, queue.emplace(key, request).first);
+        }
+
+        // Moves a queued request to the place its current priority calls for.
+        // Requests keep their position among requests of equal priority.
+        void update(OnlineFileRequest* request) {
+            auto it = index.find(request);
+            if (it == index.end()) {
+                return;
+            }
+            const Key key{request->resource.priority, request->resource.priorityOrder, std::get<2>(it->second->first)};
+            if (key != it->second->first) {
+                queue.erase(it->second);
+                it->second = queue.emplace(key, request).first;
             }
         }
 
@@ -266,18 +278,13 @@ private:
                 return {};
             }
 
-            if (queue.begin() == firstLowPriorityRequest) {
-                firstLowPriorityRequest++;
-            }
-
-            OnlineFileRequest* next = queue.front();
-            queue.pop_front();
+            OnlineFileRequest* next = queue.begin()->second;
+            queue.erase(queue.begin());
+            index.erase(next);
             return {next};
         }
 
-        bool contains(OnlineFileRequest* request) const {
-            return (std::find(queue.begin(), queue.end(), request) != queue.end());
-        }
+        bool contains(const OnlineFileRequest* request) const { return index.find(request) != index.end(); }
     };
 
     ResourceTransform resourceTransform;
@@ -328,6 +335,10 @@ public:
         return req;
     }
 
+    void updatePriority(AsyncRequest& req, const Resource& res) {
+        thread->actor().invoke(&OnlineFileSourceThread::updatePriority, &req, res.priority, res.priorityOrder);
+    }
+
     void pause() { thread->pause(); }
 
     void resume() { thread->resume(); }
@@ -540,6 +551,7 @@ void OnlineFileRequest::completed(Response response) {
         // If we get a 304 response, this means that we have send the cached
         // data to give the requestor a chance to actually obtain the data.
         response.data = std::move(resource.priorData);
+        response.compressed = resource.priorDataCompressed;
         response.notModified = false;
     }
 
@@ -653,6 +665,10 @@ std::unique_ptr<AsyncRequest> OnlineFileSource::request(const Resource& resource
     return impl->request(std::move(callback), std::move(res));
 }
 
+void OnlineFileSource::updatePriority(AsyncRequest& req, const Resource& resource) {
+    impl->updatePriority(req, resource);
+}
+
 bool OnlineFileSource::canRequest(const Resource& resource) const {
     return resource.hasLoadingMethod(Resource::LoadingMethod::Network) &&
            resource.url.rfind(mbgl::util::ASSET_PROTOCOL, 0) == std::string::npos &&
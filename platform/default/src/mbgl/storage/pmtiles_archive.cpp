@@ -0,0 +1,285 @@
+#include <mbgl/storage/pmtiles_archive.hpp>
+#include <mbgl/util/compression.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace mbgl {
+namespace pmtiles {
+
+namespace {
+
+constexpr size_t headerLength = 127;
+constexpr uint8_t specVersion = 3;
+
+// The root directory and up to three levels of leaf directories.
+constexpr int maxDirectoryDepth = 4;
+
+// Leaf directories are small (a few thousand entries at most), but an archive
+// may have many of them; keep the most recently used ones.
+constexpr size_t maxCachedLeaves = 64;
+
+uint64_t readUInt64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+double readCoordinate(const uint8_t* data) {
+    const auto value = static_cast<int32_t>(static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                                            static_cast<uint32_t>(data[2]) << 16 |
+                                            static_cast<uint32_t>(data[3]) << 24);
+    return value / 10000000.0;
+}
+
+uint64_t readVarint(const uint8_t*& cursor, const uint8_t* end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cursor == end) {
+            throw std::runtime_error("truncated PMTiles directory");
+        }
+        const uint8_t byte = *cursor++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("malformed varint in PMTiles directory");
+}
+
+Directory decodeDirectory(const uint8_t* data, size_t length) {
+    const uint8_t* cursor = data;
+    const uint8_t* const end = data + length;
+
+    const uint64_t count = readVarint(cursor, end);
+    // Every entry takes at least four bytes.
+    if (count > length / 4) {
+        throw std::runtime_error("malformed PMTiles directory");
+    }
+
+    Directory entries(static_cast<size_t>(count));
+    uint64_t lastID = 0;
+    for (auto& entry : entries) {
+        lastID += readVarint(cursor, end);
+        entry.tileID = lastID;
+    }
+    for (auto& entry : entries) {
+        entry.runLength = static_cast<uint32_t>(readVarint(cursor, end));
+    }
+    for (auto& entry : entries) {
+        entry.length = static_cast<uint32_t>(readVarint(cursor, end));
+    }
+    for (size_t i = 0; i < entries.size(); i++) {
+        const uint64_t value = readVarint(cursor, end);
+        if (value == 0 && i > 0) {
+            // Contiguous with the previous entry.
+            entries[i].offset = entries[i - 1].offset + entries[i - 1].length;
+        } else if (value == 0) {
+            throw std::runtime_error("malformed PMTiles directory");
+        } else {
+            entries[i].offset = value - 1;
+        }
+    }
+    return entries;
+}
+
+// Returns the entry covering `id`, the leaf directory that may contain it,
+// or null.
+const Entry* findEntry(const Directory& entries, uint64_t id) {
+    auto it = std::upper_bound(
+        entries.begin(), entries.end(), id, [](uint64_t value, const Entry& entry) { return value < entry.tileID; });
+    if (it == entries.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (it->runLength == 0 || id - it->tileID < it->runLength) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+uint64_t tileID(uint8_t z, uint32_t x, uint32_t y) {
+    uint64_t id = ((uint64_t(1) << (2 * z)) - 1) / 3;
+    for (uint32_t s = z ? (uint32_t(1) << (z - 1)) : 0; s > 0; s >>= 1) {
+        const uint32_t rx = (x & s) ? 1 : 0;
+        const uint32_t ry = (y & s) ? 1 : 0;
+        id += uint64_t(s) * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            // Only the bits below `s` matter from here on, so wrapping is harmless.
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return id;
+}
+
+void tileCoordinate(uint64_t id, uint8_t& z, uint32_t& x, uint32_t& y) {
+    z = 0;
+    uint64_t base = 0;
+    while (z < 31 && id >= base + (uint64_t(1) << (2 * z))) {
+        base += uint64_t(1) << (2 * z);
+        z++;
+    }
+
+    // Walk the curve up from the smallest quadrants, undoing the rotations
+    // tileID() applies on the way down.
+    uint64_t position = id - base;
+    x = 0;
+    y = 0;
+    for (uint32_t s = 1; s < (uint32_t(1) << z); s <<= 1) {
+        const auto rx = static_cast<uint32_t>(1 & (position >> 1));
+        const auto ry = static_cast<uint32_t>(1 & (position ^ rx));
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        position >>= 2;
+    }
+}
+
+std::string decompress(const std::string& data, uint8_t compression) {
+    switch (compression) {
+        case Compression::UnknownCompression:
+        case Compression::NoCompression:
+            return data;
+        case Compression::Gzip:
+            return util::decompress(data);
+        case Compression::Zstd:
+            return util::zstd::decompress(data);
+        default:
+            throw std::runtime_error("unsupported PMTiles compression");
+    }
+}
+
+Archive::Archive(const std::string& path)
+    : file(path) {
+    if (!file.data() || file.size() < headerLength || std::memcmp(file.data(), "PMTiles", 7) != 0) {
+        throw std::runtime_error("not a PMTiles archive: " + path);
+    }
+    const uint8_t* data = file.data();
+    if (data[7] != specVersion) {
+        throw std::runtime_error("unsupported PMTiles version " + std::to_string(data[7]));
+    }
+
+    header.rootOffset = readUInt64(data + 8);
+    header.rootLength = readUInt64(data + 16);
+    header.metadataOffset = readUInt64(data + 24);
+    header.metadataLength = readUInt64(data + 32);
+    header.leafOffset = readUInt64(data + 40);
+    header.leafLength = readUInt64(data + 48);
+    header.tileDataOffset = readUInt64(data + 56);
+    header.tileDataLength = readUInt64(data + 64);
+    header.internalCompression = data[97];
+    header.tileCompression = data[98];
+    header.tileType = data[99];
+    header.minZoom = data[100];
+    header.maxZoom = data[101];
+    header.minLon = readCoordinate(data + 102);
+    header.minLat = readCoordinate(data + 106);
+    header.maxLon = readCoordinate(data + 110);
+    header.maxLat = readCoordinate(data + 114);
+    header.centerZoom = data[118];
+    header.centerLon = readCoordinate(data + 119);
+    header.centerLat = readCoordinate(data + 123);
+
+    root = readDirectory(header.rootOffset, header.rootLength);
+}
+
+std::string Archive::metadata() const {
+    if (header.metadataLength == 0) {
+        return {};
+    }
+    return decompress(std::string(range(header.metadataOffset, header.metadataLength), header.metadataLength),
+                      header.internalCompression);
+}
+
+std::optional<std::pair<const char*, size_t>> Archive::tile(uint8_t z, uint32_t x, uint32_t y) {
+    if (z < header.minZoom || z > header.maxZoom || z > 31 || x >> z || y >> z) {
+        return std::nullopt;
+    }
+    const uint64_t id = tileID(z, x, y);
+    const Directory* directory = &root;
+    for (int depth = 0; depth < maxDirectoryDepth; depth++) {
+        const Entry* entry = findEntry(*directory, id);
+        if (!entry) {
+            return std::nullopt;
+        }
+        if (entry->runLength > 0) {
+            return std::make_pair(range(header.tileDataOffset + entry->offset, entry->length),
+                                  static_cast<size_t>(entry->length));
+        }
+        directory = &leaf(header.leafOffset + entry->offset, entry->length);
+    }
+    throw std::runtime_error("PMTiles leaf directories are nested too deeply");
+}
+
+void Archive::forEachTile(const TileCallback& callback) const {
+    forEachTile(root, 0, callback);
+}
+
+void Archive::forEachTile(const Directory& directory, int depth, const TileCallback& callback) const {
+    if (depth >= maxDirectoryDepth) {
+        throw std::runtime_error("PMTiles leaf directories are nested too deeply");
+    }
+    for (const auto& entry : directory) {
+        if (entry.runLength == 0) {
+            forEachTile(readDirectory(header.leafOffset + entry.offset, entry.length), depth + 1, callback);
+            continue;
+        }
+        const char* data = range(header.tileDataOffset + entry.offset, entry.length);
+        for (uint64_t id = entry.tileID; id < entry.tileID + entry.runLength; id++) {
+            uint8_t z;
+            uint32_t x;
+            uint32_t y;
+            tileCoordinate(id, z, x, y);
+            callback(z, x, y, data, entry.length);
+        }
+    }
+}
+
+const char* Archive::range(uint64_t offset, uint64_t length) const {
+    if (offset > file.size() || length > file.size() - offset) {
+        throw std::runtime_error("PMTiles archive is truncated");
+    }
+    return reinterpret_cast<const char*>(file.data() + offset);
+}
+
+Directory Archive::readDirectory(uint64_t offset, uint64_t length) const {
+    const char* data = range(offset, length);
+    if (header.internalCompression == Compression::NoCompression) {
+        return decodeDirectory(reinterpret_cast<const uint8_t*>(data), length);
+    }
+    const std::string decompressed = decompress(std::string(data, length), header.internalCompression);
+    return decodeDirectory(reinterpret_cast<const uint8_t*>(decompressed.data()), decompressed.size());
+}
+
+const Directory& Archive::leaf(uint64_t offset, uint64_t length) {
+    auto it = leafIndex.find(offset);
+    if (it != leafIndex.end()) {
+        leaves.splice(leaves.begin(), leaves, it->second);
+        return it->second->second;
+    }
+    if (leaves.size() >= maxCachedLeaves) {
+        leafIndex.erase(leaves.back().first);
+        leaves.pop_back();
+    }
+    leaves.emplace_front(offset, readDirectory(offset, length));
+    leafIndex.emplace(offset, leaves.begin());
+    return leaves.front().second;
+}
+
+} // namespace pmtiles
+} // namespace mbgl
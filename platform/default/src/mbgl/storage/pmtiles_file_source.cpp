@@ -0,0 +1,257 @@
+#include <mbgl/platform/settings.hpp>
+#include <mbgl/storage/file_source_request.hpp>
+#include <mbgl/storage/pmtiles_archive.hpp>
+#include <mbgl/storage/pmtiles_file_source.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/util/compression.hpp>
+#include <mbgl/util/constants.hpp>
+#include <mbgl/util/thread.hpp>
+#include <mbgl/util/url.hpp>
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <map>
+#include <mutex>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace {
+bool acceptsURL(const std::string &url) {
+    return 0 == url.rfind(mbgl::util::PMTILES_PROTOCOL, 0);
+}
+
+std::string url_to_path(const std::string &url) {
+    return mbgl::util::percentDecode(url.substr(std::char_traits<char>::length(mbgl::util::PMTILES_PROTOCOL)));
+}
+} // namespace
+
+namespace mbgl {
+
+namespace pmtiles {
+
+std::string tileExtension(uint8_t tileType) {
+    switch (tileType) {
+        case TileType::MVT:
+            return ".pbf";
+        case TileType::PNG:
+            return ".png";
+        case TileType::JPEG:
+            return ".jpg";
+        case TileType::WebP:
+            return ".webp";
+        case TileType::AVIF:
+            return ".avif";
+        default:
+            return "";
+    }
+}
+
+} // namespace pmtiles
+
+using namespace rapidjson;
+
+class PMTilesFileSource::Impl {
+public:
+    explicit Impl(const ActorRef<Impl> &, const ResourceOptions &resourceOptions_, const ClientOptions &clientOptions_)
+        : resourceOptions(resourceOptions_.clone()),
+          clientOptions(clientOptions_.clone()) {}
+
+    // Generate a TileJSON resource from the archive header and metadata
+    void request_tilejson(const Resource &resource, ActorRef<FileSourceRequest> req) {
+        Response response;
+        try {
+            auto &archive = get_archive(archive_path(url_to_path(resource.url)));
+            const auto &header = archive.getHeader();
+
+            Document doc;
+            auto &allocator = doc.GetAllocator();
+            const std::string metadata = archive.metadata();
+            doc.Parse(metadata.c_str(), metadata.size());
+            if (!doc.IsObject()) {
+                doc.SetObject();
+            }
+
+            // The header is authoritative for everything the renderer needs.
+            const auto set = [&](const char *name, Value value) {
+                doc.RemoveMember(name);
+                doc.AddMember(Value(name, allocator), value, allocator);
+            };
+
+            Value tiles(kArrayType);
+            tiles.PushBack(
+                Value(resource.url + "?file={z}/{x}/{y}" + pmtiles::tileExtension(header.tileType), allocator),
+                allocator);
+
+            Value bounds(kArrayType);
+            bounds.PushBack(header.minLon, allocator);
+            bounds.PushBack(header.minLat, allocator);
+            bounds.PushBack(header.maxLon, allocator);
+            bounds.PushBack(header.maxLat, allocator);
+
+            Value center(kArrayType);
+            center.PushBack(header.centerLon, allocator);
+            center.PushBack(header.centerLat, allocator);
+            center.PushBack(header.centerZoom, allocator);
+
+            set("tilejson", Value(StringRef("2.0.0")));
+            set("scheme", Value(StringRef("xyz")));
+            set("tiles", std::move(tiles));
+            set("minzoom", Value(header.minZoom));
+            set("maxzoom", Value(header.maxZoom));
+            set("bounds", std::move(bounds));
+            set("center", std::move(center));
+
+            StringBuffer buffer;
+            Writer<StringBuffer> writer(buffer);
+            doc.Accept(writer);
+            response.data = std::make_shared<std::string>(buffer.GetString(), buffer.GetSize());
+        } catch (const std::exception &error) {
+            response.noContent = true;
+            response.error = std::make_unique<Response::Error>(Response::Error::Reason::Other, error.what());
+        }
+        req.invoke(&FileSourceRequest::setResponse, response);
+    }
+
+    // Load data for specific tile
+    void request_tile(const Resource &resource, ActorRef<FileSourceRequest> req) {
+        Response response;
+        response.noContent = true;
+        try {
+            auto &archive = get_archive(archive_path(url_to_path(resource.url)));
+            const auto &tileData = *resource.tileData;
+            if (auto tile = archive.tile(tileData.z, tileData.x, tileData.y)) {
+                response.noContent = false;
+                response.expires = Timestamp::max();
+                response.etag = resource.url;
+
+                const auto compression = archive.getHeader().tileCompression;
+                const bool gzipped = compression == pmtiles::Compression::Gzip ||
+                                     (compression == pmtiles::Compression::UnknownCompression && tile->second >= 2 &&
+                                      static_cast<uint8_t>(tile->first[0]) == 0x1f &&
+                                      static_cast<uint8_t>(tile->first[1]) == 0x8b);
+                auto data = std::make_shared<std::string>(tile->first, tile->second);
+                if (gzipped && resource.acceptsCompressedData) {
+                    // Let the worker decompress it.
+                    response.compressed = true;
+                } else if (gzipped) {
+                    *data = util::decompress(*data);
+                } else if (compression != pmtiles::Compression::UnknownCompression) {
+                    *data = pmtiles::decompress(*data, compression);
+                }
+                response.data = std::move(data);
+            }
+        } catch (const std::exception &error) {
+            response.error = std::make_unique<Response::Error>(Response::Error::Reason::Other, error.what());
+        }
+        req.invoke(&FileSourceRequest::setResponse, response);
+    }
+
+    void setResourceOptions(ResourceOptions options) {
+        std::lock_guard<std::mutex> lock(resourceOptionsMutex);
+        resourceOptions = options;
+    }
+
+    ResourceOptions getResourceOptions() {
+        std::lock_guard<std::mutex> lock(resourceOptionsMutex);
+        return resourceOptions.clone();
+    }
+
+    void setClientOptions(ClientOptions options) {
+        std::lock_guard<std::mutex> lock(clientOptionsMutex);
+        clientOptions = options;
+    }
+
+    ClientOptions getClientOptions() {
+        std::lock_guard<std::mutex> lock(clientOptionsMutex);
+        return clientOptions.clone();
+    }
+
+private:
+    std::string archive_path(const std::string &path) { return path.substr(0, path.find('?')); }
+
+    // Archives stay open once used, to effectively support multiple .pmtiles maps
+    pmtiles::Archive &get_archive(const std::string &path) {
+        auto it = archives.find(path);
+        if (it == archives.end()) {
+            it = archives.emplace(path, std::make_unique<pmtiles::Archive>(path)).first;
+        }
+        return *it->second;
+    }
+
+    std::map<std::string, std::unique_ptr<pmtiles::Archive>> archives;
+
+    mutable std::mutex resourceOptionsMutex;
+    mutable std::mutex clientOptionsMutex;
+    ResourceOptions resourceOptions;
+    ClientOptions clientOptions;
+};
+
+PMTilesFileSource::PMTilesFileSource(const ResourceOptions &resourceOptions, const ClientOptions &clientOptions)
+    : thread(std::make_unique<util::Thread<Impl>>(
+          util::makeThreadPrioritySetter(platform::EXPERIMENTAL_THREAD_PRIORITY_FILE),
+          "PMTilesFileSource",
+          resourceOptions.clone(),
+          clientOptions.clone())) {}
+
+std::unique_ptr<AsyncRequest> PMTilesFileSource::request(const Resource &resource, FileSource::Callback callback) {
+    auto req = std::make_unique<FileSourceRequest>(std::move(callback));
+
+    // assume if there is a tile request, that the archive has been validated
+    if (resource.kind == Resource::Tile && resource.tileData) {
+        thread->actor().invoke(&Impl::request_tile, resource, req->actor());
+        return req;
+    }
+
+    if (resource.url.find(":///") == std::string::npos) {
+        Response response;
+        response.noContent = true;
+        response.error = std::make_unique<Response::Error>(Response::Error::Reason::Other,
+                                                           "PMTilesFileSource only supports absolute path urls");
+        req->actor().invoke(&FileSourceRequest::setResponse, response);
+        return req;
+    }
+
+    // file must exist
+    auto path = url_to_path(resource.url);
+    struct stat buffer;
+    int result = stat(path.c_str(), &buffer);
+    if (result == -1 && errno == ENOENT) {
+        Response response;
+        response.noContent = true;
+        response.error = std::make_unique<Response::Error>(Response::Error::Reason::NotFound,
+                                                           "path not found: " + path);
+        req->actor().invoke(&FileSourceRequest::setResponse, response);
+        return req;
+    }
+
+    // return TileJSON
+    thread->actor().invoke(&Impl::request_tilejson, resource, req->actor());
+    return req;
+}
+
+bool PMTilesFileSource::canRequest(const Resource &resource) const {
+    return acceptsURL(resource.url);
+}
+
+PMTilesFileSource::~PMTilesFileSource() = default;
+
+void PMTilesFileSource::setResourceOptions(ResourceOptions options) {
+    thread->actor().invoke(&Impl::setResourceOptions, options.clone());
+}
+
+ResourceOptions PMTilesFileSource::getResourceOptions() {
+    return thread->actor().ask(&Impl::getResourceOptions).get();
+}
+
+void PMTilesFileSource::setClientOptions(ClientOptions options) {
+    thread->actor().invoke(&Impl::setClientOptions, options.clone());
+}
+
+ClientOptions PMTilesFileSource::getClientOptions() {
+    return thread->actor().ask(&Impl::getClientOptions).get();
+}
+
+} // namespace mbgl
@@ -1,5 +1,381 @@
 #include <mbgl/text/local_glyph_rasterizer.hpp>
 
+#if defined(MBGL_USE_FREETYPE)
+
+#include <mbgl/util/constants.hpp>
+#include <mbgl/util/i18n.hpp>
+#include <mbgl/util/logging.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace mbgl {
+
+namespace {
+
+std::string normalizeFontName(const std::string& name) {
+    std::string result;
+    result.reserve(name.size());
+    for (const char c : name) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            result.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+        }
+    }
+    return result;
+}
+
+/*
+    Process-wide FreeType state. Font faces and rasterized glyphs are shared by
+    every LocalGlyphRasterizer, so a glyph that has been drawn for one map is
+    not drawn again for another. FreeType objects are not thread safe, and
+    maps may be rendered on different threads, so all access goes through one
+    mutex. The index of installed fonts is built on its own thread with its
+    own FreeType library, so that the directory scan neither runs on a render
+    thread nor holds the mutex.
+*/
+class FreeTypeFonts {
+public:
+    static FreeTypeFonts& get() {
+        static FreeTypeFonts instance;
+        return instance;
+    }
+
+    FreeTypeFonts(const FreeTypeFonts&) = delete;
+    FreeTypeFonts& operator=(const FreeTypeFonts&) = delete;
+
+    // Starts building the index of installed fonts, unless it has been
+    // started before.
+    void scanInstalledFaces() {
+        std::call_once(scanStarted, [this] { installed = std::async(std::launch::async, &scan).share(); });
+    }
+
+    // Returns the first face among `names` that has a glyph for the codepoint.
+    FT_Face faceForGlyph(const std::vector<std::string>& names, GlyphID glyphID) {
+        // The scan has normally finished long before the first local glyph is
+        // needed; if it has not, wait for it without holding the mutex.
+        scanInstalledFaces();
+        const std::vector<InstalledFace>& installedFaces = installed.get();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& name : names) {
+            FT_Face face = resolve(name, installedFaces);
+            if (face && FT_Get_Char_Index(face, glyphID) != 0) {
+                return face;
+            }
+        }
+        return nullptr;
+    }
+
+    std::optional<Glyph> rasterize(FT_Face face, GlyphID glyphID) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const GlyphKey key{face, glyphID};
+        auto it = glyphs.find(key);
+        if (it != glyphs.end()) {
+            // Move the glyph to the front of the recently used list.
+            recentGlyphs.splice(recentGlyphs.begin(), recentGlyphs, it->second);
+        } else {
+            if (glyphs.size() >= maxCachedGlyphs) {
+                glyphs.erase(recentGlyphs.back().first);
+                recentGlyphs.pop_back();
+            }
+            recentGlyphs.emplace_front(key, draw(face, glyphID));
+            it = glyphs.emplace(key, recentGlyphs.begin()).first;
+        }
+
+        const std::optional<Glyph>& cached = it->second->second;
+        if (!cached) {
+            return std::nullopt;
+        }
+        Glyph glyph;
+        glyph.id = glyphID;
+        glyph.bitmap = cached->bitmap.clone();
+        glyph.metrics = cached->metrics;
+        return glyph;
+    }
+
+private:
+    struct InstalledFace {
+        std::string path;
+        FT_Long index;
+        std::string familyName;
+        std::string fullName;
+    };
+
+    struct GlyphKey {
+        FT_Face face;
+        GlyphID glyphID;
+
+        bool operator==(const GlyphKey& other) const { return face == other.face && glyphID == other.glyphID; }
+    };
+
+    struct GlyphKeyHash {
+        std::size_t operator()(const GlyphKey& key) const {
+            return std::hash<const void*>()(key.face) ^ (std::hash<GlyphID>()(key.glyphID) << 1);
+        }
+    };
+
+    using CachedGlyphs = std::list<std::pair<GlyphKey, std::optional<Glyph>>>;
+
+    // Rasterized glyphs are small greyscale bitmaps; this bounds the cache to
+    // a few megabytes even when a map touches a large part of the CJK block.
+    // The least recently used glyph is evicted first.
+    static constexpr std::size_t maxCachedGlyphs = 8192;
+
+    FreeTypeFonts() {
+        if (FT_Init_FreeType(&library) != 0) {
+            Log::Error(Event::General, "Unable to initialize FreeType");
+            library = nullptr;
+        }
+    }
+
+    ~FreeTypeFonts() {
+        for (auto& entry : openFaces) {
+            FT_Done_Face(entry.second);
+        }
+        if (library) {
+            FT_Done_FreeType(library);
+        }
+    }
+
+    // Resolves a font file path, or a family or full font name of an
+    // installed font, to an open face. Results are cached, including misses.
+    FT_Face resolve(const std::string& name, const std::vector<InstalledFace>& installed) {
+        if (!library) {
+            return nullptr;
+        }
+
+        auto cached = resolvedNames.find(name);
+        if (cached != resolvedNames.end()) {
+            return cached->second;
+        }
+
+        FT_Face face = nullptr;
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(name, ec)) {
+            face = open(name, 0);
+        } else {
+            const std::string normalized = normalizeFontName(name);
+            // Prefer an exact face ("Noto Sans CJK JP Bold") over a family
+            // match, so that the weight in the font stack name is respected.
+            auto match = std::find_if(installed.begin(), installed.end(), [&](const InstalledFace& installedFace) {
+                return installedFace.fullName == normalized;
+            });
+            if (match == installed.end()) {
+                match = std::find_if(installed.begin(), installed.end(), [&](const InstalledFace& installedFace) {
+                    return installedFace.familyName == normalized;
+                });
+            }
+            if (match != installed.end()) {
+                face = open(match->path, match->index);
+            }
+        }
+
+        resolvedNames.emplace(name, face);
+        return face;
+    }
+
+    FT_Face open(const std::string& path, FT_Long index) {
+        const std::string key = path + "#" + std::to_string(index);
+        auto it = openFaces.find(key);
+        if (it != openFaces.end()) {
+            return it->second;
+        }
+
+        FT_Face face = nullptr;
+        if (FT_New_Face(library, path.c_str(), index, &face) != 0 ||
+            FT_Set_Pixel_Sizes(face, 0, util::ONE_EM) != 0) {
+            Log::Warning(Event::General, "Unable to load local font " + path);
+            if (face) {
+                FT_Done_Face(face);
+            }
+            face = nullptr;
+        }
+        openFaces.emplace(key, face);
+        return face;
+    }
+
+    // Scans the usual font directories. Only the face headers are read here;
+    // glyph outlines are loaded on demand.
+    static std::vector<InstalledFace> scan() {
+        std::vector<InstalledFace> faces;
+        FT_Library scanLibrary = nullptr;
+        if (FT_Init_FreeType(&scanLibrary) != 0) {
+            return faces;
+        }
+
+        std::vector<std::filesystem::path> directories = {"/usr/share/fonts", "/usr/local/share/fonts"};
+        if (const char* home = std::getenv("HOME")) {
+            directories.emplace_back(std::filesystem::path(home) / ".local/share/fonts");
+            directories.emplace_back(std::filesystem::path(home) / ".fonts");
+        }
+
+        for (const auto& directory : directories) {
+            std::error_code ec;
+            std::filesystem::recursive_directory_iterator it(
+                directory, std::filesystem::directory_options::skip_permission_denied, ec);
+            for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+                std::string extension = it->path().extension().string();
+                std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+                    return static_cast<char>(std::tolower(c));
+                });
+                if (extension != ".ttf" && extension != ".otf" && extension != ".ttc" && extension != ".otc") {
+                    continue;
+                }
+
+                const std::string path = it->path().string();
+                FT_Long faceCount = 1;
+                for (FT_Long index = 0; index < faceCount; ++index) {
+                    FT_Face face = nullptr;
+                    if (FT_New_Face(scanLibrary, path.c_str(), index, &face) != 0) {
+                        break;
+                    }
+                    faceCount = face->num_faces;
+                    if (face->family_name) {
+                        const std::string family = face->family_name;
+                        const std::string style = face->style_name ? face->style_name : "";
+                        faces.push_back({path, index, normalizeFontName(family), normalizeFontName(family + style)});
+                    }
+                    FT_Done_Face(face);
+                }
+            }
+        }
+
+        FT_Done_FreeType(scanLibrary);
+        return faces;
+    }
+
+    std::optional<Glyph> draw(FT_Face face, GlyphID glyphID) {
+        if (FT_Load_Char(face, glyphID, FT_LOAD_RENDER) != 0) {
+            return std::nullopt;
+        }
+
+        const FT_GlyphSlot slot = face->glyph;
+        const FT_Bitmap& source = slot->bitmap;
+        if (source.pixel_mode != FT_PIXEL_MODE_GRAY) {
+            return std::nullopt;
+        }
+
+        // Mimic glyph PBF metrics: the bitmap carries a border on every side,
+        // and `top` is relative to a baseline one em below the line origin.
+        Glyph glyph;
+        glyph.id = glyphID;
+        glyph.metrics.width = source.width;
+        glyph.metrics.height = source.rows;
+        glyph.metrics.left = slot->bitmap_left;
+        glyph.metrics.top = slot->bitmap_top - static_cast<int32_t>(util::ONE_EM);
+        glyph.metrics.advance = static_cast<uint32_t>((slot->advance.x + 32) >> 6);
+
+        const uint32_t border = Glyph::borderSize;
+        glyph.bitmap = AlphaImage({source.width + 2 * border, source.rows + 2 * border});
+        std::fill(glyph.bitmap.data.get(), glyph.bitmap.data.get() + glyph.bitmap.bytes(), 0);
+        for (uint32_t y = 0; y < source.rows; ++y) {
+            const uint8_t* row = source.buffer + static_cast<std::ptrdiff_t>(y) * source.pitch;
+            std::copy(row, row + source.width, glyph.bitmap.data.get() + (y + border) * glyph.bitmap.stride() + border);
+        }
+
+        return glyph;
+    }
+
+    std::mutex mutex;
+    FT_Library library = nullptr;
+    std::once_flag scanStarted;
+    std::shared_future<std::vector<InstalledFace>> installed;
+    std::unordered_map<std::string, FT_Face> openFaces;
+    std::unordered_map<std::string, FT_Face> resolvedNames;
+    CachedGlyphs recentGlyphs;
+    std::unordered_map<GlyphKey, CachedGlyphs::iterator, GlyphKeyHash> glyphs;
+};
+
+} // namespace
+
+/*
+    Draws glyphs with FreeType from fonts that are installed on the system or
+    bundled with the application. Like the other platform implementations,
+    only glyphs in the CJK and Hangul ranges are drawn locally; everything
+    else still comes from the style's glyph PBFs.
+
+    `localFontFamily` is a list of font names, one per line. Each entry is
+    either the path to a font file or the family or full name of an installed
+    font. The names in the font stack take precedence over these, so a style
+    that names an installed CJK font gets that font and weight.
+*/
+class LocalGlyphRasterizer::Impl {
+public:
+    Impl(const std::optional<std::string>& fontFamily) {
+        if (!fontFamily) {
+            return;
+        }
+        std::istringstream stream(*fontFamily);
+        std::string name;
+        while (std::getline(stream, name)) {
+            if (!name.empty()) {
+                fallbackFontNames.push_back(name);
+            }
+        }
+        enabled = true;
+        // Index the installed fonts while the style and tiles are loading.
+        FreeTypeFonts::get().scanInstalledFaces();
+    }
+
+    bool isEnabled() const { return enabled; }
+
+    FT_Face faceForGlyph(const FontStack& fontStack, GlyphID glyphID) {
+        auto it = fontNames.find(fontStack);
+        if (it == fontNames.end()) {
+            std::vector<std::string> names;
+            for (const auto& fontName : fontStack) {
+                // The default text-font contains these last resort fonts, but
+                // they should not take precedence over the configured fonts.
+                if (fontName != util::LAST_RESORT_ALPHABETIC_FONT && fontName != util::LAST_RESORT_PAN_UNICODE_FONT) {
+                    names.push_back(fontName);
+                }
+            }
+            names.insert(names.end(), fallbackFontNames.begin(), fallbackFontNames.end());
+            it = fontNames.emplace(fontStack, std::move(names)).first;
+        }
+        return FreeTypeFonts::get().faceForGlyph(it->second, glyphID);
+    }
+
+private:
+    bool enabled = false;
+    std::vector<std::string> fallbackFontNames;
+    std::map<FontStack, std::vector<std::string>> fontNames;
+};
+
+LocalGlyphRasterizer::LocalGlyphRasterizer(const std::optional<std::string>& fontFamily)
+    : impl(std::make_unique<Impl>(fontFamily)) {}
+
+LocalGlyphRasterizer::~LocalGlyphRasterizer() = default;
+
+bool LocalGlyphRasterizer::canRasterizeGlyph(const FontStack& fontStack, GlyphID glyphID) {
+    return impl->isEnabled() && util::i18n::allowsFixedWidthGlyphGeneration(glyphID) &&
+           impl->faceForGlyph(fontStack, glyphID) != nullptr;
+}
+
+Glyph LocalGlyphRasterizer::rasterizeGlyph(const FontStack& fontStack, GlyphID glyphID) {
+    FT_Face face = impl->faceForGlyph(fontStack, glyphID);
+    if (!face) {
+        return Glyph();
+    }
+    return FreeTypeFonts::get().rasterize(face, glyphID).value_or(Glyph());
+}
+
+} // namespace mbgl
+
+#else
+
 namespace mbgl {
 
 class LocalGlyphRasterizer::Impl {};
@@ -17,3 +393,5 @@ Glyph LocalGlyphRasterizer::rasterizeGlyph(const FontStack&, GlyphID) {
 }
 
 } // namespace mbgl
+
+#endif
@@ -2,8 +2,15 @@
 
 #include <zlib.h>
 
+#if defined(MBGL_USE_ZSTD)
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
 #include <cstdio>
 #include <cstring>
+#include <map>
+#include <mutex>
 #include <stdexcept>
 
 #if defined(__GNUC__)
@@ -28,6 +35,41 @@ const static bool zlibVersionCheck MBGL_UNUSED = []() {
 namespace mbgl {
 namespace util {
 
+namespace zstd {
+
+namespace {
+
+std::mutex dictionariesMutex;
+
+std::map<uint32_t, std::shared_ptr<const Dictionary>>& registeredDictionaries() {
+    static std::map<uint32_t, std::shared_ptr<const Dictionary>> dictionaries;
+    return dictionaries;
+}
+
+std::shared_ptr<const Dictionary> registeredDictionary(uint32_t id) {
+    std::lock_guard<std::mutex> lock(dictionariesMutex);
+    auto it = registeredDictionaries().find(id);
+    if (it == registeredDictionaries().end()) {
+        throw std::runtime_error("Missing compression dictionary");
+    }
+    return it->second;
+}
+
+} // namespace
+
+bool isFrame(const std::string& data) {
+    // The zstd magic number, 0xFD2FB528, in little endian.
+    return data.size() >= 4 && data.compare(0, 4, "\x28\xB5\x2F\xFD") == 0;
+}
+
+void registerDictionary(std::shared_ptr<const Dictionary> dictionary) {
+    const uint32_t id = dictionary->id();
+    std::lock_guard<std::mutex> lock(dictionariesMutex);
+    registeredDictionaries().emplace(id, std::move(dictionary));
+}
+
+} // namespace zstd
+
 // Needed when using a zlib compiled with -DZ_PREFIX
 // because it will mess with this function name and
 // cause a link error.
@@ -69,6 +111,11 @@ std::string compress(const std::string &raw, int windowBits) {
 }
 
 std::string decompress(const std::string &raw, int windowBits) {
+    if (windowBits == CompressionFormat::DETECT && zstd::isFrame(raw)) {
+        const uint32_t dictionaryID = zstd::dictionaryID(raw);
+        return zstd::decompress(raw, dictionaryID ? zstd::registeredDictionary(dictionaryID).get() : nullptr);
+    }
+
     z_stream inflate_stream;
     memset(&inflate_stream, 0, sizeof(inflate_stream));
 
@@ -102,5 +149,190 @@ std::string decompress(const std::string &raw, int windowBits) {
 
     return result;
 }
+
+namespace zstd {
+
+#if defined(MBGL_USE_ZSTD)
+
+namespace {
+
+// Compression level used for all data; decompression speed is the same for all levels.
+constexpr int compressionLevel = 3;
+
+struct ContextDeleter {
+    void operator()(ZSTD_CCtx* context) const { ZSTD_freeCCtx(context); }
+    void operator()(ZSTD_DCtx* context) const { ZSTD_freeDCtx(context); }
+};
+
+// Contexts are expensive to create, so each thread keeps one of each.
+ZSTD_CCtx* compressionContext() {
+    thread_local std::unique_ptr<ZSTD_CCtx, ContextDeleter> context{ZSTD_createCCtx()};
+    if (!context) {
+        throw std::runtime_error("failed to initialize zstd compression");
+    }
+    return context.get();
+}
+
+ZSTD_DCtx* decompressionContext() {
+    thread_local std::unique_ptr<ZSTD_DCtx, ContextDeleter> context{ZSTD_createDCtx()};
+    if (!context) {
+        throw std::runtime_error("failed to initialize zstd decompression");
+    }
+    return context.get();
+}
+
+} // namespace
+
+// Holds the dictionary digested for both directions, so that it isn't parsed
+// again for every call.
+class Dictionary::Impl {
+public:
+    explicit Impl(const std::string& data)
+        : compression(ZSTD_createCDict(data.data(), data.size(), compressionLevel)),
+          decompression(ZSTD_createDDict(data.data(), data.size())),
+          id(ZSTD_getDictID_fromDict(data.data(), data.size())) {
+        if (!compression || !decompression) {
+            ZSTD_freeCDict(compression);
+            ZSTD_freeDDict(decompression);
+            throw std::runtime_error("failed to load zstd dictionary");
+        }
+    }
+
+    ~Impl() {
+        ZSTD_freeCDict(compression);
+        ZSTD_freeDDict(decompression);
+    }
+
+    ZSTD_CDict* const compression;
+    ZSTD_DDict* const decompression;
+    const uint32_t id;
+};
+
+bool supported() {
+    return true;
+}
+
+Dictionary::Dictionary(const std::string& data)
+    : impl(std::make_unique<const Impl>(data)) {}
+
+Dictionary::~Dictionary() = default;
+
+uint32_t Dictionary::id() const {
+    return impl->id;
+}
+
+std::string compress(const std::string& raw, const Dictionary* dictionary) {
+    std::string result(ZSTD_compressBound(raw.size()), '\0');
+    const size_t size = dictionary ? ZSTD_compress_usingCDict(compressionContext(),
+                                                              &result[0],
+                                                              result.size(),
+                                                              raw.data(),
+                                                              raw.size(),
+                                                              dictionary->impl->compression)
+                                   : ZSTD_compressCCtx(compressionContext(),
+                                                       &result[0],
+                                                       result.size(),
+                                                       raw.data(),
+                                                       raw.size(),
+                                                       compressionLevel);
+    if (ZSTD_isError(size)) {
+        throw std::runtime_error(ZSTD_getErrorName(size));
+    }
+    result.resize(size);
+    return result;
+}
+
+std::string decompress(const std::string& raw, const Dictionary* dictionary) {
+    // compress() always records the content size in the frame header.
+    const unsigned long long contentSize = ZSTD_getFrameContentSize(raw.data(), raw.size());
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+        throw std::runtime_error("invalid zstd frame");
+    }
+
+    std::string result(static_cast<size_t>(contentSize), '\0');
+    const size_t size = dictionary ? ZSTD_decompress_usingDDict(decompressionContext(),
+                                                                &result[0],
+                                                                result.size(),
+                                                                raw.data(),
+                                                                raw.size(),
+                                                                dictionary->impl->decompression)
+                                   : ZSTD_decompressDCtx(
+                                         decompressionContext(), &result[0], result.size(), raw.data(), raw.size());
+    if (ZSTD_isError(size)) {
+        throw std::runtime_error(ZSTD_getErrorName(size));
+    }
+    result.resize(size);
+    return result;
+}
+
+uint32_t dictionaryID(const std::string& compressed) {
+    return ZSTD_getDictID_fromFrame(compressed.data(), compressed.size());
+}
+
+std::string trainDictionary(const std::vector<std::string>& samples, std::size_t capacity) {
+    std::string buffer;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const auto& sample : samples) {
+        buffer.append(sample);
+        sizes.push_back(sample.size());
+    }
+
+    std::string result(capacity, '\0');
+    const size_t size = ZDICT_trainFromBuffer(
+        &result[0], result.size(), buffer.data(), sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size)) {
+        return {};
+    }
+    result.resize(size);
+    return result;
+}
+
+#else
+
+namespace {
+
+[[noreturn]] void unsupported() {
+    throw std::runtime_error("zstd support is not available");
+}
+
+} // namespace
+
+class Dictionary::Impl {};
+
+bool supported() {
+    return false;
+}
+
+Dictionary::Dictionary(const std::string&) {
+    unsupported();
+}
+
+Dictionary::~Dictionary() = default;
+
+uint32_t Dictionary::id() const {
+    unsupported();
+}
+
+std::string compress(const std::string&, const Dictionary*) {
+    unsupported();
+}
+
+std::string decompress(const std::string&, const Dictionary*) {
+    unsupported();
+}
+
+uint32_t dictionaryID(const std::string&) {
+    unsupported();
+}
+
+std::string trainDictionary(const std::vector<std::string>&, std::size_t) {
+    unsupported();
+}
+
+#endif
+
+} // namespace zstd
+
 } // namespace util
 } // namespace mbgl
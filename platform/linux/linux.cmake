@@ -2,6 +2,7 @@ option(MLN_WITH_X11 "Build with X11 Support" ON)
 option(MLN_WITH_WAYLAND "Build with Wayland Support" OFF)
 
 find_package(CURL REQUIRED)
+find_package(Freetype)
 find_package(ICU OPTIONAL_COMPONENTS i18n)
 find_package(ICU OPTIONAL_COMPONENTS uc)
 find_package(JPEG REQUIRED)
@@ -13,6 +14,7 @@ endif ()
 find_package(Threads REQUIRED)
 
 pkg_search_module(LIBUV libuv REQUIRED)
+pkg_search_module(ZSTD libzstd)
 
 target_sources(
     mbgl-core
@@ -32,6 +34,8 @@ target_sources(
         ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/local_file_request.cpp
         ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/local_file_source.cpp
         ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/mbtiles_file_source.cpp
+        ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/pmtiles_archive.cpp
+        ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/pmtiles_file_source.cpp
         ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/main_resource_loader.cpp
         ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/offline.cpp
         ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/storage/offline_database.cpp
@@ -99,6 +103,7 @@ target_include_directories(
         ${JPEG_INCLUDE_DIRS}
         ${LIBUV_INCLUDE_DIRS}
         ${X11_INCLUDE_DIRS}
+        ${ZSTD_INCLUDE_DIRS}
 )
 
 include(${PROJECT_SOURCE_DIR}/vendor/nunicode.cmake)
@@ -118,6 +123,24 @@ if(NOT ${ICU_FOUND} OR "${ICU_VERSION}" VERSION_LESS 62.0)
     )
 endif()
 
+if(${FREETYPE_FOUND})
+    set_source_files_properties(
+        ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/text/local_glyph_rasterizer.cpp
+        PROPERTIES
+        COMPILE_DEFINITIONS
+        MBGL_USE_FREETYPE
+    )
+endif()
+
+if(${ZSTD_FOUND})
+    set_source_files_properties(
+        ${PROJECT_SOURCE_DIR}/platform/default/src/mbgl/util/compression.cpp
+        PROPERTIES
+        COMPILE_DEFINITIONS
+        MBGL_USE_ZSTD
+    )
+endif()
+
 target_link_libraries(
     mbgl-core
     PRIVATE
@@ -125,11 +148,13 @@ target_link_libraries(
         ${JPEG_LIBRARIES}
         ${LIBUV_LIBRARIES}
         ${X11_LIBRARIES}
+        ${ZSTD_LIBRARIES}
         ${CMAKE_THREAD_LIBS_INIT}
         $<$<NOT:$<BOOL:${MLN_USE_BUILTIN_ICU}>>:ICU::i18n>
         $<$<NOT:$<BOOL:${MLN_USE_BUILTIN_ICU}>>:ICU::uc>
         $<$<BOOL:${MLN_USE_BUILTIN_ICU}>:mbgl-vendor-icu>
         PNG::PNG
+        $<$<BOOL:${FREETYPE_FOUND}>:Freetype::Freetype>
         mbgl-vendor-nunicode
         mbgl-vendor-sqlite
 )
@@ -120,6 +120,7 @@ SymbolInstance::SymbolInstance(Anchor& anchor_,
       textOffset(textOffset_),
       iconOffset(iconOffset_),
       key(std::move(key_)),
+      keyHash(std::hash<std::u16string>()(key)),
       textBoxScale(textBoxScale_),
       variableTextOffset(variableTextOffset_),
       singleLine(shapedTextOrientations.singleLine) {
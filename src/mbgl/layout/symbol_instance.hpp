@@ -113,6 +113,7 @@ public:
     std::array<float, 2> textOffset;
     std::array<float, 2> iconOffset;
     std::u16string key;
+    std::size_t keyHash; // Precomputed so that cross-tile matching doesn't rehash the key
     bool isDuplicate;
     std::optional<size_t> placedRightTextIndex;
     std::optional<size_t> placedCenterTextIndex;
@@ -65,7 +65,8 @@ void Map::Impl::onUpdate() {
                                fileSource,
                                prefetchZoomDelta,
                                bool(stillImageRequest),
-                               crossSourceCollisions};
+                               crossSourceCollisions,
+                               transform.getTransitionTrajectory()};
 
     rendererFrontend.update(std::make_shared<UpdateParameters>(std::move(params)));
 }
@@ -12,6 +12,7 @@
 #include <mbgl/util/logging.hpp>
 #include <mbgl/util/platform.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <utility>
@@ -487,6 +488,14 @@ ProjectionMode Transform::getProjectionMode() const {
 
 // MARK: - Transition
 
+namespace {
+
+// Number of camera states sampled along an animated transition so that the
+// tiles it will pass over can be requested ahead of time.
+constexpr size_t transitionTrajectorySamples = 10;
+
+} // namespace
+
 void Transform::startTransition(const CameraOptions& camera,
                                 const AnimationOptions& animation,
                                 const std::function<void(double)>& frame,
@@ -512,6 +521,22 @@ void Transform::startTransition(const CameraOptions& camera,
     transitionStart = Clock::now();
     transitionDuration = duration;
 
+    transitionTrajectory.clear();
+    if (isAnimated) {
+        // Run the frame function ahead of time to find out where the camera
+        // is going to be, then put the current state back.
+        const util::UnitBezier ease = animation.easing ? *animation.easing : util::DEFAULT_TRANSITION_EASE;
+        const TransformState current = state;
+        transitionTrajectory.reserve(transitionTrajectorySamples);
+        for (size_t i = 1; i <= transitionTrajectorySamples; ++i) {
+            const double t = double(i) / transitionTrajectorySamples;
+            frame(i == transitionTrajectorySamples ? 1.0 : ease.solve(t, 0.001));
+            if (anchor) state.moveLatLng(anchorLatLng, *anchor);
+            transitionTrajectory.push_back(state);
+            state = current;
+        }
+    }
+
     transitionFrameFn = [isAnimated, animation, frame, anchor, anchorLatLng, this](const TimePoint now) {
         float t = isAnimated ? (std::chrono::duration<float>(now - transitionStart) / transitionDuration) : 1.0f;
         if (t >= 1.0) {
@@ -523,6 +548,14 @@ void Transform::startTransition(const CameraOptions& camera,
 
         if (anchor) state.moveLatLng(anchorLatLng, *anchor);
 
+        // Drop the samples the camera has already passed.
+        const auto remaining = static_cast<size_t>(
+            std::ceil(std::max(0.0f, 1.0f - t) * static_cast<float>(transitionTrajectorySamples)));
+        if (transitionTrajectory.size() > remaining) {
+            transitionTrajectory.erase(transitionTrajectory.begin(),
+                                       transitionTrajectory.end() - static_cast<std::ptrdiff_t>(remaining));
+        }
+
         // At t = 1.0, a DidChangeAnimated notification should be sent from finish().
         if (t < 1.0) {
             if (animation.transitionFrameFn) {
@@ -537,6 +570,7 @@ void Transform::startTransition(const CameraOptions& camera,
     };
 
     transitionFinishFn = [isAnimated, animation, this] {
+        transitionTrajectory.clear();
         state.setProperties(
             TransformStateProperties().withPanningInProgress(false).withScalingInProgress(false).withRotatingInProgress(
                 false));
@@ -611,6 +645,7 @@ void Transform::cancelTransitions() {
 
     transitionFrameFn = nullptr;
     transitionFinishFn = nullptr;
+    transitionTrajectory.clear();
 }
 
 void Transform::setGestureInProgress(bool inProgress) {
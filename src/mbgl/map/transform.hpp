@@ -13,6 +13,7 @@
 #include <cmath>
 #include <functional>
 #include <optional>
+#include <vector>
 
 namespace mbgl {
 
@@ -100,6 +101,10 @@ public:
     TimePoint getTransitionStart() const { return transitionStart; }
     Duration getTransitionDuration() const { return transitionDuration; }
     void cancelTransitions();
+    /** Returns camera states sampled along the part of the current animated
+        transition that has not been rendered yet, ending at the destination.
+        Empty when no animated transition is in progress. */
+    const std::vector<TransformState>& getTransitionTrajectory() const { return transitionTrajectory; }
 
     // Gesture
     void setGestureInProgress(bool);
@@ -134,6 +139,7 @@ private:
     Duration transitionDuration;
     std::function<bool(const TimePoint)> transitionFrameFn;
     std::function<void()> transitionFinishFn;
+    std::vector<TransformState> transitionTrajectory;
 };
 
 } // namespace mbgl
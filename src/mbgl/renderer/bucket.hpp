@@ -20,7 +20,7 @@ using PatternLayerMap = std::map<std::string, PatternDependency>;
 class Placement;
 class TransformState;
 class BucketPlacementData;
-class RenderTile;
+class PlacementTile;
 
 class Bucket {
 public:
@@ -57,13 +57,18 @@ public:
     // Returns a pair, the first element of which is a bucket cross-tile id
     // on success call; `0` otherwise. The second element is `true` if
     // the bucket was originally registered; `false` otherwise.
-    virtual std::pair<uint32_t, bool> registerAtCrossTileIndex(CrossTileSymbolLayerIndex&, const RenderTile&) {
+    virtual std::pair<uint32_t, bool> registerAtCrossTileIndex(CrossTileSymbolLayerIndex&, const PlacementTile&) {
         return std::make_pair(0u, false);
     }
     // Places this bucket to the given placement.
     virtual void place(Placement&, const BucketPlacementData&, std::set<uint32_t>&) {}
-    virtual void updateVertices(
-        const Placement&, bool /*updateOpacities*/, const TransformState&, const RenderTile&, std::set<uint32_t>&) {}
+    // Returns `true` if the dynamic vertices must be updated with `updateDynamicVertices()`.
+    virtual bool updateVertices(
+        const Placement&, bool /*updateOpacities*/, const TransformState&, const PlacementTile&, std::set<uint32_t>&) {
+        return false;
+    }
+    // May run concurrently with the same call for other buckets.
+    virtual void updateDynamicVertices(const Placement&, const TransformState&, const PlacementTile&) {}
 
 protected:
     Bucket() = default;
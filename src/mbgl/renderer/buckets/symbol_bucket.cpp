@@ -326,7 +326,7 @@ bool SymbolBucket::hasFormatSectionOverrides() const {
 }
 
 std::pair<uint32_t, bool> SymbolBucket::registerAtCrossTileIndex(CrossTileSymbolLayerIndex& index,
-                                                                 const RenderTile& renderTile) {
+                                                                 const PlacementTile& renderTile) {
     bool firstTimeAdded = index.addBucket(renderTile.getOverscaledTileID(), renderTile.matrix, *this);
     return std::make_pair(bucketInstanceId, firstTimeAdded);
 }
@@ -335,17 +335,28 @@ void SymbolBucket::place(Placement& placement, const BucketPlacementData& data,
     placement.placeSymbolBucket(data, seenIds);
 }
 
-void SymbolBucket::updateVertices(const Placement& placement,
+bool SymbolBucket::updateVertices(const Placement& placement,
                                   bool updateOpacities,
                                   const TransformState& state,
-                                  const RenderTile& tile,
+                                  const PlacementTile& tile,
                                   std::set<uint32_t>& seenIds) {
     if (updateOpacities) {
         placement.updateBucketOpacities(*this, state, seenIds);
         placementChangesUploaded = false;
         uploaded = false;
+        // Hidden symbols are not reprojected, so the projection is outdated now.
+        dynamicVerticesKey = std::nullopt;
     }
 
+    return !dynamicVerticesKey ||
+           !(*dynamicVerticesKey ==
+             DynamicVerticesKey{tile.matrix, state.getZoom(), state.getSize(), placement.getRevision()});
+}
+
+void SymbolBucket::updateDynamicVertices(const Placement& placement,
+                                         const TransformState& state,
+                                         const PlacementTile& tile) {
+    dynamicVerticesKey = DynamicVerticesKey{tile.matrix, state.getZoom(), state.getSize(), placement.getRevision()};
     if (placement.updateBucketDynamicVertices(*this, state, tile)) {
         dynamicUploaded = false;
         uploaded = false;
@@ -83,10 +83,14 @@ public:
 
     void upload(gfx::UploadPass&) override;
     bool hasData() const override;
-    std::pair<uint32_t, bool> registerAtCrossTileIndex(CrossTileSymbolLayerIndex&, const RenderTile&) override;
+    std::pair<uint32_t, bool> registerAtCrossTileIndex(CrossTileSymbolLayerIndex&, const PlacementTile&) override;
     void place(Placement&, const BucketPlacementData&, std::set<uint32_t>&) override;
-    void updateVertices(
-        const Placement&, bool updateOpacities, const TransformState&, const RenderTile&, std::set<uint32_t>&) override;
+    bool updateVertices(const Placement&,
+                        bool updateOpacities,
+                        const TransformState&,
+                        const PlacementTile&,
+                        std::set<uint32_t>&) override;
+    void updateDynamicVertices(const Placement&, const TransformState&, const PlacementTile&) override;
     bool hasTextData() const;
     bool hasIconData() const;
     bool hasSdfIconData() const;
@@ -124,6 +128,21 @@ public:
     std::vector<SymbolInstance> symbolInstances;
     const std::vector<SortKeyRange> sortKeyRanges;
 
+    // The view and placement the current dynamic vertices were computed for;
+    // reprojection is skipped while they stay the same.
+    struct DynamicVerticesKey {
+        mat4 tileMatrix;
+        double zoom;
+        Size size;
+        uint64_t placementRevision;
+
+        bool operator==(const DynamicVerticesKey& other) const {
+            return placementRevision == other.placementRevision && zoom == other.zoom && size == other.size &&
+                   tileMatrix == other.tileMatrix;
+        }
+    };
+    std::optional<DynamicVerticesKey> dynamicVerticesKey;
+
     struct PaintProperties {
         SymbolIconProgram::Binders iconBinders;
         SymbolSDFTextProgram::Binders textBinders;
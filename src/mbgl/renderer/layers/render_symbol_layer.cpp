@@ -632,7 +632,8 @@ void RenderSymbolLayer::prepare(const LayerPrepareParameters& params) {
     placementData.clear();
 
     for (const RenderTile& renderTile : *renderTiles) {
-        auto* bucket = static_cast<SymbolBucket*>(renderTile.getBucket(*baseImpl));
+        const LayerRenderData* renderData = renderTile.getLayerRenderData(*baseImpl);
+        auto* bucket = renderData ? static_cast<SymbolBucket*>(renderData->bucket.get()) : nullptr;
         if (bucket && bucket->bucketLeaderID == getID()) {
             // Only place this layer if it's the "group leader" for the bucket
             const Tile* tile = params.source->getRenderedTile(renderTile.id);
@@ -642,10 +643,20 @@ void RenderSymbolLayer::prepare(const LayerPrepareParameters& params) {
             auto featureIndex = static_cast<const GeometryTile*>(tile)->getFeatureIndex();
 
             if (bucket->sortKeyRanges.empty()) {
-                placementData.push_back({*bucket, renderTile, featureIndex, baseImpl->source, std::nullopt});
+                placementData.push_back({renderData->bucket,
+                                         PlacementTile(renderTile),
+                                         featureIndex,
+                                         baseImpl->source,
+                                         std::nullopt,
+                                         bucket->justReloaded});
             } else {
                 for (const auto& sortKeyRange : bucket->sortKeyRanges) {
-                    BucketPlacementData layerData{*bucket, renderTile, featureIndex, baseImpl->source, sortKeyRange};
+                    BucketPlacementData layerData{renderData->bucket,
+                                                  PlacementTile(renderTile),
+                                                  featureIndex,
+                                                  baseImpl->source,
+                                                  sortKeyRange,
+                                                  bucket->justReloaded};
                     auto sortPosition = std::upper_bound(
                         placementData.cbegin(), placementData.cend(), layerData, [](const auto& lhs, const auto& rhs) {
                             assert(lhs.sortKeyRange && rhs.sortKeyRange);
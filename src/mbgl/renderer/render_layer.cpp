@@ -12,6 +12,12 @@ namespace mbgl {
 
 using namespace style;
 
+PlacementTile::PlacementTile(const RenderTile& renderTile)
+    : id(renderTile.id),
+      matrix(renderTile.matrix),
+      overscaledID(renderTile.getOverscaledTileID()),
+      heldForFade(renderTile.holdForFade()) {}
+
 RenderLayer::RenderLayer(Immutable<style::LayerProperties> properties)
     : evaluatedProperties(std::move(properties)),
       baseImpl(evaluatedProperties->baseImpl) {}
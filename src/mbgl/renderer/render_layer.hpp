@@ -5,6 +5,7 @@
 #include <mbgl/renderer/render_source.hpp>
 #include <mbgl/style/layer_properties.hpp>
 #include <mbgl/tile/geometry_tile_data.hpp>
+#include <mbgl/tile/tile_id.hpp>
 #include <mbgl/util/mat4.hpp>
 #include <memory>
 #include <string>
@@ -37,13 +38,33 @@ public:
     size_t end;
 };
 
+// Copy of the render tile state used by symbol placement. Unlike the render
+// tile, it does not refer to the tile itself and stays valid after the frame
+// it was taken in.
+class PlacementTile {
+public:
+    explicit PlacementTile(const RenderTile&);
+
+    const OverscaledTileID& getOverscaledTileID() const { return overscaledID; }
+    bool holdForFade() const { return heldForFade; }
+
+    UnwrappedTileID id;
+    mat4 matrix;
+
+private:
+    OverscaledTileID overscaledID;
+    bool heldForFade;
+};
+
 class BucketPlacementData {
 public:
-    std::reference_wrapper<Bucket> bucket;
-    std::reference_wrapper<const RenderTile> tile;
+    std::shared_ptr<Bucket> bucket;
+    PlacementTile tile;
     std::shared_ptr<FeatureIndex> featureIndex;
     std::string sourceId;
     std::optional<SortKeyRange> sortKeyRange;
+    // Copy of the bucket's flag, which placement may read off the render thread.
+    bool justReloaded = false;
 };
 
 using LayerPlacementData = std::list<BucketPlacementData>;
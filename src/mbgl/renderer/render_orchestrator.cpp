@@ -24,6 +24,7 @@
 #include <mbgl/text/glyph_manager.hpp>
 #include <mbgl/tile/tile.hpp>
 #include <mbgl/util/math.hpp>
+#include <mbgl/util/parallel.hpp>
 #include <mbgl/util/string.hpp>
 #include <mbgl/util/logging.hpp>
 
@@ -66,6 +67,7 @@ public:
                    PatternAtlas& patternAtlas_,
                    RenderLayerReferences layersNeedPlacement_,
                    Immutable<Placement> placement_,
+                   std::shared_ptr<Scheduler> renderHelpers_,
                    bool updateSymbolOpacities_)
         : RenderTree(std::move(parameters_)),
           layerRenderItems(std::move(layerRenderItems_)),
@@ -74,12 +76,12 @@ public:
           patternAtlas(patternAtlas_),
           layersNeedPlacement(std::move(layersNeedPlacement_)),
           placement(std::move(placement_)),
+          renderHelpers(std::move(renderHelpers_)),
           updateSymbolOpacities(updateSymbolOpacities_) {}
 
     void prepare() override {
-        for (auto it = layersNeedPlacement.rbegin(); it != layersNeedPlacement.rend(); ++it) {
-            placement->updateLayerBuckets(*it, parameters->transformParams.state, updateSymbolOpacities);
-        }
+        placement->updateLayerBuckets(
+            layersNeedPlacement, parameters->transformParams.state, updateSymbolOpacities, *renderHelpers);
     }
 
     RenderItems getLayerRenderItems() const override { return {layerRenderItems.begin(), layerRenderItems.end()}; }
@@ -98,6 +100,7 @@ public:
     std::reference_wrapper<PatternAtlas> patternAtlas;
     RenderLayerReferences layersNeedPlacement;
     Immutable<Placement> placement;
+    std::shared_ptr<Scheduler> renderHelpers;
     bool updateSymbolOpacities;
 };
 
@@ -113,6 +116,7 @@ RenderOrchestrator::RenderOrchestrator(bool backgroundLayerAsColor_, const std::
       sourceImpls(makeMutable<std::vector<Immutable<style::Source::Impl>>>()),
       layerImpls(makeMutable<std::vector<Immutable<style::Layer::Impl>>>()),
       renderLight(makeMutable<Light::Impl>()),
+      renderHelpers(util::getRenderHelperScheduler()),
       backgroundLayerAsColor(backgroundLayerAsColor_) {
     glyphManager->setObserver(this);
     imageManager->setObserver(this);
@@ -172,7 +176,8 @@ std::unique_ptr<RenderTree> RenderOrchestrator::createRenderTree(
                                         updateParameters->annotationManager,
                                         *imageManager,
                                         *glyphManager,
-                                        updateParameters->prefetchZoomDelta};
+                                        updateParameters->prefetchZoomDelta,
+                                        &updateParameters->transitionTrajectory};
 
     glyphManager->setURL(updateParameters->glyphURL);
 
@@ -381,14 +386,21 @@ std::unique_ptr<RenderTree> RenderOrchestrator::createRenderTree(
     bool symbolBucketsChanged = false;
     bool symbolBucketsAdded = false;
     std::set<std::string> usedSymbolLayers;
-    const auto longitude = static_cast<float>(updateParameters->transformState.getLatLng().longitude());
-    for (auto it = layersNeedPlacement.crbegin(); it != layersNeedPlacement.crend(); ++it) {
-        RenderLayer& layer = *it;
-        auto result = crossTileSymbolIndex.addLayer(layer, longitude);
-        if (isMapModeContinuous) {
-            usedSymbolLayers.insert(layer.getID());
-            symbolBucketsAdded = symbolBucketsAdded || (result & CrossTileSymbolIndex::AddLayerResult::BucketsAdded);
-            symbolBucketsChanged = symbolBucketsChanged || (result != CrossTileSymbolIndex::AddLayerResult::NoChanges);
+    bool placementCommitted = placementController.commitPendingPlacement(updateParameters->timePoint);
+    // A pending background placement reads the cross-tile IDs of its buckets, so the
+    // index is updated only after that placement has been committed.
+    if (!placementController.hasPendingPlacement()) {
+        const auto longitude = static_cast<float>(updateParameters->transformState.getLatLng().longitude());
+        for (auto it = layersNeedPlacement.crbegin(); it != layersNeedPlacement.crend(); ++it) {
+            RenderLayer& layer = *it;
+            auto result = crossTileSymbolIndex.addLayer(layer, longitude);
+            if (isMapModeContinuous) {
+                usedSymbolLayers.insert(layer.getID());
+                symbolBucketsAdded = symbolBucketsAdded ||
+                                     (result & CrossTileSymbolIndex::AddLayerResult::BucketsAdded);
+                symbolBucketsChanged = symbolBucketsChanged ||
+                                       (result != CrossTileSymbolIndex::AddLayerResult::NoChanges);
+            }
         }
     }
 
@@ -407,22 +419,34 @@ std::unique_ptr<RenderTree> RenderOrchestrator::createRenderTree(
             placementUpdatePeriodOverride = std::optional<Duration>(Milliseconds(30));
         }
 
-        renderTreeParameters->placementChanged = !placementController.placementIsRecent(
-            updateParameters->timePoint,
-            static_cast<float>(updateParameters->transformState.getZoom()),
-            placementUpdatePeriodOverride);
-        symbolBucketsChanged |= renderTreeParameters->placementChanged;
-        if (renderTreeParameters->placementChanged) {
+        const bool startPlacement = !placementController.hasPendingPlacement() &&
+                                    !placementController.placementIsRecent(
+                                        updateParameters->timePoint,
+                                        static_cast<float>(updateParameters->transformState.getZoom()),
+                                        placementUpdatePeriodOverride);
+        if (startPlacement) {
             Mutable<Placement> placement = Placement::create(updateParameters, placementController.getPlacement());
-            placement->placeLayers(layersNeedPlacement);
-            placementController.setPlacement(std::move(placement));
+            if (placementController.deferredPlacementEnabled()) {
+                // Frames keep using the current placement until the new one is committed.
+                placementController.startDeferredPlacement(
+                    std::move(placement), layersNeedPlacement, updateParameters->timePoint);
+                placementCommitted = placementController.commitPendingPlacement(updateParameters->timePoint);
+            } else {
+                placement->placeLayers(layersNeedPlacement);
+                placementController.setPlacement(std::move(placement));
+                placementCommitted = true;
+            }
+        } else if (!placementController.hasPendingPlacement()) {
+            placementController.setPlacementStale();
+        }
+        if (placementCommitted) {
             crossTileSymbolIndex.pruneUnusedLayers(usedSymbolLayers);
             for (const auto& entry : renderSources) {
                 entry.second->updateFadingTiles();
             }
-        } else {
-            placementController.setPlacementStale();
         }
+        renderTreeParameters->placementChanged = placementCommitted;
+        symbolBucketsChanged |= placementCommitted;
         renderTreeParameters->symbolFadeChange = placementController.getPlacement()->symbolFadeChange(
             updateParameters->timePoint);
         renderTreeParameters->needsRepaint = hasTransitions(updateParameters->timePoint);
@@ -459,6 +483,7 @@ std::unique_ptr<RenderTree> RenderOrchestrator::createRenderTree(
                                             *patternAtlas,
                                             std::move(layersNeedPlacement),
                                             placementController.getPlacement(),
+                                            renderHelpers,
                                             symbolBucketsChanged);
 }
 
@@ -667,6 +692,18 @@ void RenderOrchestrator::collectPlacedSymbolData(bool enable) {
     placedSymbolDataCollected = enable;
 }
 
+void RenderOrchestrator::setBackgroundPlacement(bool enable, Duration maxStaleness) {
+    placementController.setBackgroundPlacement(enable, maxStaleness);
+}
+
+void RenderOrchestrator::setPlacementTimeBudget(std::optional<Duration> budget) {
+    placementController.setPlacementTimeBudget(budget);
+}
+
+std::size_t RenderOrchestrator::getLastPlacementFrameCount() const {
+    return placementController.getLastPlacementFrameCount();
+}
+
 const std::vector<PlacedSymbolData>& RenderOrchestrator::getPlacedSymbolsData() const {
     return placementController.getPlacement()->getPlacedSymbolsData();
 }
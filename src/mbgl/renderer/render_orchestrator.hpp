@@ -75,6 +75,9 @@ public:
     void reduceMemoryUse();
     void dumpDebugLogs();
     void collectPlacedSymbolData(bool);
+    void setBackgroundPlacement(bool enable, Duration maxStaleness);
+    void setPlacementTimeBudget(std::optional<Duration>);
+    std::size_t getLastPlacementFrameCount() const;
     const std::vector<PlacedSymbolData>& getPlacedSymbolsData() const;
     void clearData();
 
@@ -127,6 +130,8 @@ private:
 
     CrossTileSymbolIndex crossTileSymbolIndex;
     PlacementController placementController;
+    // Reprojects symbol buckets alongside the render thread.
+    std::shared_ptr<Scheduler> renderHelpers;
 
     const bool backgroundLayerAsColor;
     bool contextLost = false;
@@ -125,6 +125,18 @@ void Renderer::collectPlacedSymbolData(bool enable) {
     impl->orchestrator.collectPlacedSymbolData(enable);
 }
 
+void Renderer::setBackgroundPlacement(bool enable, Duration maxStaleness) {
+    impl->orchestrator.setBackgroundPlacement(enable, maxStaleness);
+}
+
+void Renderer::setPlacementTimeBudget(std::optional<Duration> budget) {
+    impl->orchestrator.setPlacementTimeBudget(budget);
+}
+
+std::size_t Renderer::getLastPlacementFrameCount() const {
+    return impl->orchestrator.getLastPlacementFrameCount();
+}
+
 const std::vector<PlacedSymbolData>& Renderer::getPlacedSymbolsData() const {
     return impl->orchestrator.getPlacedSymbolsData();
 }
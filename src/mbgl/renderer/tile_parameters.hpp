@@ -3,6 +3,7 @@
 #include <mbgl/map/mode.hpp>
 
 #include <memory>
+#include <vector>
 
 #include <mapbox/std/weak.hpp>
 
@@ -25,6 +26,8 @@ public:
     ImageManager& imageManager;
     GlyphManager& glyphManager;
     const uint8_t prefetchZoomDelta;
+    // Camera states the current animated transition will pass through, if any.
+    const std::vector<TransformState>* transitionTrajectory = nullptr;
 };
 
 } // namespace mbgl
@@ -5,6 +5,7 @@
 #include <mbgl/renderer/query.hpp>
 #include <mbgl/map/transform.hpp>
 #include <mbgl/math/clamp.hpp>
+#include <mbgl/util/projection.hpp>
 #include <mbgl/util/tile_cover.hpp>
 #include <mbgl/util/tile_range.hpp>
 #include <mbgl/util/enum.hpp>
@@ -131,6 +132,31 @@ void TilePyramid::update(const std::vector<Immutable<style::LayerProperties>>& l
         }
     }
 
+    // Tiles along the rest of an animated camera transition, mapped to the
+    // first sample that covers them. They are requested ahead of time as
+    // prefetches, but aren't rendered until they become ideal tiles; once the
+    // transition is over or has moved past them, they are cached as optional
+    // tiles, which cancels their pending requests.
+    std::map<OverscaledTileID, uint32_t> trajectoryTiles;
+    int32_t trajectoryTileZoom = tileZoom;
+    if (parameters.mode == MapMode::Continuous && parameters.transitionTrajectory &&
+        type != style::SourceType::GeoJSON && type != style::SourceType::Annotations) {
+        uint32_t sample = 0;
+        for (const auto& state : *parameters.transitionTrajectory) {
+            const int32_t stateZoom = util::coveringZoomLevel(state.getZoom(), type, tileSize);
+            if (stateZoom < zoomRange.min) {
+                continue;
+            }
+            const int32_t stateIdealZoom = std::min<int32_t>(zoomRange.max, stateZoom);
+            const int32_t stateTileZoom = type == SourceType::Raster ? stateIdealZoom : stateZoom;
+            trajectoryTileZoom = std::max(trajectoryTileZoom, stateTileZoom);
+            for (const auto& tileID : util::tileCover(state, stateIdealZoom, stateTileZoom)) {
+                trajectoryTiles.emplace(tileID, sample);
+            }
+            ++sample;
+        }
+    }
+
     // Stores a list of all the tiles that we're definitely going to retain.
     // There are two kinds of tiles we need: the ideal tiles determined by the
     // tile cover. They may not yet be in use because they're still loading. In
@@ -138,9 +164,24 @@ void TilePyramid::update(const std::vector<Immutable<style::LayerProperties>>& l
     // using, e.g. as a replacement for tile that aren't loaded yet.
     std::set<OverscaledTileID> retain;
 
+    // Network requests for tiles closer to the center of the screen are served
+    // first. The distance is rounded to whole tiles so that it only changes,
+    // and the request only moves in the queue, when the camera has moved far
+    // enough for it to matter.
+    const LatLng center = parameters.transformState.getLatLng();
+    auto distanceFromCenter = [&](const OverscaledTileID& tileID) -> uint32_t {
+        const Point<double> centerPoint = Projection::project(center, int32_t(tileID.canonical.z));
+        const double dx = tileID.wrap * std::pow(2.0, tileID.canonical.z) + tileID.canonical.x + 0.5 - centerPoint.x;
+        const double dy = tileID.canonical.y + 0.5 - centerPoint.y;
+        return static_cast<uint32_t>(std::lround(std::hypot(dx, dy)));
+    };
+
+    // Tiles retained for panning are prefetches; the ones that are needed for
+    // the current view are retained with a regular priority later on.
+    Resource::Priority retainPriority = Resource::Priority::Prefetch;
     auto retainTileFn = [&](Tile& tile, TileNecessity necessity) -> void {
         if (retain.emplace(tile.id).second) {
-            tile.setUpdateParameters({minimumUpdateInterval, isVolatile});
+            tile.setUpdateParameters({minimumUpdateInterval, isVolatile, retainPriority, distanceFromCenter(tile.id)});
             tile.setNecessity(necessity);
         }
 
@@ -159,7 +200,7 @@ void TilePyramid::update(const std::vector<Immutable<style::LayerProperties>>& l
     std::optional<util::TileRange> tileRange = std::nullopt;
     if (bounds) {
         tileRange = util::TileRange::fromLatLngBounds(
-            *bounds, zoomRange.min, std::min(tileZoom, static_cast<int32_t>(zoomRange.max)));
+            *bounds, zoomRange.min, std::min(trajectoryTileZoom, static_cast<int32_t>(zoomRange.max)));
     }
     auto createTileFn = [&](const OverscaledTileID& tileID) -> Tile* {
         if (tileRange && !tileRange->contains(tileID.canonical)) {
@@ -197,9 +238,29 @@ void TilePyramid::update(const std::vector<Immutable<style::LayerProperties>>& l
             maxParentTileOverscaleFactor);
     }
 
+    retainPriority = Resource::Priority::Regular;
     algorithm::updateRenderables(
         getTileFn, createTileFn, retainTileFn, renderTileFn, idealTiles, zoomRange, maxParentTileOverscaleFactor);
 
+    for (const auto& [tileID, sample] : trajectoryTiles) {
+        if (retain.count(tileID)) {
+            continue;
+        }
+        Tile* tile = getTileFn(tileID);
+        if (!tile) {
+            tile = createTileFn(tileID);
+            if (!tile) {
+                continue;
+            }
+        }
+        retain.emplace(tileID);
+        tile->setUpdateParameters({minimumUpdateInterval, isVolatile, Resource::Priority::Prefetch, sample});
+        tile->setNecessity(TileNecessity::Required);
+        if (needsRelayout) {
+            tile->setLayers(layers);
+        }
+    }
+
     for (auto previouslyRenderedTile : previouslyRenderedTiles) {
         Tile& tile = previouslyRenderedTile.second;
         tile.markRenderedPreviously();
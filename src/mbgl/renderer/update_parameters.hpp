@@ -44,6 +44,9 @@ public:
     const bool stillImageRequest;
 
     const bool crossSourceCollisions;
+
+    // Camera states the current animated transition will pass through.
+    const std::vector<TransformState> transitionTrajectory;
 };
 
 } // namespace mbgl
@@ -15,7 +15,10 @@ public:
 
     bool supportsCacheOnlyRequests() const override;
     std::unique_ptr<AsyncRequest> request(const Resource&, Callback) override;
+    void updatePriority(AsyncRequest&, const Resource&) override;
     bool canRequest(const Resource&) const override;
+    // Supports MEMORY_CACHE_HITS_KEY and MEMORY_CACHE_MISSES_KEY.
+    mapbox::base::Value getProperty(const std::string&) const override;
     void pause() override;
     void resume() override;
 
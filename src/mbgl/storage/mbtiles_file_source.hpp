@@ -5,9 +5,14 @@
 #include <mbgl/util/client_options.hpp>
 #include <mbgl/util/thread.hpp>
 
+#include <atomic>
+#include <vector>
+
 namespace mbgl {
 // File source for supporting .mbtiles maps.
-// can only load resource URLS that are absolute paths to local files
+// can only load resource URLS that are absolute paths to local files.
+// Requests are served by a small pool of threads, each with its own read-only
+// connection to every file.
 class MBTilesFileSource : public FileSource {
 public:
     MBTilesFileSource(const ResourceOptions& resourceOptions, const ClientOptions& clientOptions);
@@ -24,7 +29,8 @@ public:
 
 private:
     class Impl;
-    std::unique_ptr<util::Thread<Impl>> thread; // impl
+    std::vector<std::unique_ptr<util::Thread<Impl>>> threads; // impl
+    std::atomic<std::size_t> nextThread{0};
 };
 
 } // namespace mbgl
@@ -9,6 +9,11 @@ public:
     std::string apiKey;
     TileServerOptions tileServerOptions;
     std::string cachePath = ":memory:";
+    uint32_t cacheReadConnections = 0;
+    uint64_t memoryCacheSize = 0;
+    std::string glyphCachePath;
+    uint32_t maximumConnectionsPerHost = 0;
+    uint32_t connectionCacheSize = 0;
     std::string assetPath = ".";
     uint64_t maximumSize = mbgl::util::DEFAULT_MAX_CACHE_SIZE;
     void* platformContext = nullptr;
@@ -61,6 +66,51 @@ const std::string& ResourceOptions::cachePath() const {
     return impl_->cachePath;
 }
 
+ResourceOptions& ResourceOptions::withCacheReadConnections(uint32_t count) {
+    impl_->cacheReadConnections = count;
+    return *this;
+}
+
+uint32_t ResourceOptions::cacheReadConnections() const {
+    return impl_->cacheReadConnections;
+}
+
+ResourceOptions& ResourceOptions::withMemoryCacheSize(uint64_t size) {
+    impl_->memoryCacheSize = size;
+    return *this;
+}
+
+uint64_t ResourceOptions::memoryCacheSize() const {
+    return impl_->memoryCacheSize;
+}
+
+ResourceOptions& ResourceOptions::withGlyphCachePath(std::string path) {
+    impl_->glyphCachePath = std::move(path);
+    return *this;
+}
+
+const std::string& ResourceOptions::glyphCachePath() const {
+    return impl_->glyphCachePath;
+}
+
+ResourceOptions& ResourceOptions::withMaximumConnectionsPerHost(uint32_t count) {
+    impl_->maximumConnectionsPerHost = count;
+    return *this;
+}
+
+uint32_t ResourceOptions::maximumConnectionsPerHost() const {
+    return impl_->maximumConnectionsPerHost;
+}
+
+ResourceOptions& ResourceOptions::withConnectionCacheSize(uint32_t count) {
+    impl_->connectionCacheSize = count;
+    return *this;
+}
+
+uint32_t ResourceOptions::connectionCacheSize() const {
+    return impl_->connectionCacheSize;
+}
+
 ResourceOptions& ResourceOptions::withAssetPath(std::string path) {
     impl_->assetPath = std::move(path);
     return *this;
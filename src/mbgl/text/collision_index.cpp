@@ -1,4 +1,5 @@
 #include <mbgl/text/collision_index.hpp>
+#include <mbgl/text/collision_projection.hpp>
 #include <mbgl/layout/symbol_instance.hpp>
 #include <mbgl/geometry/feature_index.hpp>
 #include <mbgl/math/log2.hpp>
@@ -12,6 +13,7 @@
 
 #include <mbgl/renderer/buckets/symbol_bucket.hpp> // For PlacedSymbol: pull out to another location
 
+#include <algorithm>
 #include <cmath>
 
 namespace mbgl {
@@ -168,7 +170,7 @@ std::pair<bool, bool> CollisionIndex::placeFeature(
         projectedBoxes.emplace_back(
             collisionBoundaries[0], collisionBoundaries[1], collisionBoundaries[2], collisionBoundaries[3]);
         if ((avoidEdges && !isInsideTile(collisionBoundaries, *avoidEdges)) || !isInsideGrid(collisionBoundaries) ||
-            (!allowOverlap && collisionGrid.hitTest(projectedBoxes.back().box(), collisionGroupPredicate))) {
+            (!allowOverlap && hitTest(projectedBoxes.back().box(), collisionGroupPredicate))) {
             return {false, false};
         }
 
@@ -250,6 +252,32 @@ std::pair<bool, bool> CollisionIndex::placeLineFeature(
                                                    pitchWithMap);
     }
 
+    // Project the circle centers up front so that the projection can run
+    // several circles at a time. Only the span of circles the label reaches
+    // is projected; the loop below skips every circle outside of it.
+    std::size_t firstUsedCircle = feature.boxes.size();
+    std::size_t endUsedCircle = 0;
+    if (firstAndLastGlyph) {
+        for (std::size_t i = 0; i < feature.boxes.size(); ++i) {
+            const float boxSignedDistanceFromAnchor = feature.boxes[i].signedDistanceFromAnchor;
+            if (boxSignedDistanceFromAnchor >= -firstTileDistance && boxSignedDistanceFromAnchor <= lastTileDistance) {
+                firstUsedCircle = std::min(firstUsedCircle, i);
+                endUsedCircle = i + 1;
+            }
+        }
+    }
+    circleCentersX.resize(feature.boxes.size());
+    circleCentersY.resize(feature.boxes.size());
+    if (firstUsedCircle < endUsedCircle) {
+        collision::projectAnchors(posMatrix,
+                                  transformState.getSize(),
+                                  viewportPadding,
+                                  feature.boxes.data() + firstUsedCircle,
+                                  endUsedCircle - firstUsedCircle,
+                                  circleCentersX.data() + firstUsedCircle,
+                                  circleCentersY.data() + firstUsedCircle);
+    }
+
     bool previousCirclePlaced = false;
     projectedBoxes.resize(feature.boxes.size());
     for (size_t i = 0; i < feature.boxes.size(); i++) {
@@ -264,7 +292,7 @@ std::pair<bool, bool> CollisionIndex::placeLineFeature(
             continue;
         }
 
-        const auto projectedPoint = projectPoint(posMatrix, circle.anchor);
+        const Point<float> projectedPoint{circleCentersX[i], circleCentersY[i]};
         const float tileUnitRadius = (circle.x2 - circle.x1) / 2;
         const float radius = tileUnitRadius * tileToViewport;
 
@@ -314,7 +342,7 @@ std::pair<bool, bool> CollisionIndex::placeLineFeature(
         inGrid |= isInsideGrid(collisionBoundaries);
 
         if ((avoidEdges && !isInsideTile(collisionBoundaries, *avoidEdges)) ||
-            (!allowOverlap && collisionGrid.hitTest(projectedBoxes[i].circle(), collisionGroupPredicate))) {
+            (!allowOverlap && hitTest(projectedBoxes[i].circle(), collisionGroupPredicate))) {
             if (!collisionDebug) {
                 return {false, false};
             } else {
@@ -334,18 +362,20 @@ void CollisionIndex::insertFeature(const CollisionFeature& feature,
                                    uint32_t bucketInstanceId,
                                    uint16_t collisionGroupId) {
     if (feature.alongLine) {
+        // All circles of a line label share one key, so insert them as a batch.
+        circleScratch.clear();
         for (auto& circle : projectedBoxes) {
-            if (!circle.isCircle()) {
-                continue;
+            if (circle.isCircle()) {
+                circleScratch.push_back(circle.circle());
             }
+        }
 
-            if (ignorePlacement) {
-                ignoredGrid.insert(IndexedSubfeature(feature.indexedFeature, bucketInstanceId, collisionGroupId),
-                                   circle.circle());
-            } else {
-                collisionGrid.insert(IndexedSubfeature(feature.indexedFeature, bucketInstanceId, collisionGroupId),
-                                     circle.circle());
-            }
+        if (ignorePlacement) {
+            ignoredGrid.insert(IndexedSubfeature(feature.indexedFeature, bucketInstanceId, collisionGroupId),
+                               circleScratch);
+        } else {
+            collisionGrid.insert(IndexedSubfeature(feature.indexedFeature, bucketInstanceId, collisionGroupId),
+                                 circleScratch);
         }
     } else if (!projectedBoxes.empty()) {
         assert(projectedBoxes.size() == 1);
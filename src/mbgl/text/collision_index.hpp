@@ -7,6 +7,8 @@
 #include <mbgl/map/transform_state.hpp>
 
 #include <array>
+#include <functional>
+#include <optional>
 
 namespace mbgl {
 
@@ -72,6 +74,12 @@ private:
     bool isInsideTile(const CollisionBoundaries& boundaries, const CollisionBoundaries& tileBoundaries) const;
     bool overlapsTile(const CollisionBoundaries& boundaries, const CollisionBoundaries& tileBoundaries) const;
 
+    template <class Geometry>
+    bool hitTest(const Geometry& geometry,
+                 const std::optional<std::function<bool(const IndexedSubfeature&)>>& predicate) const {
+        return predicate ? collisionGrid.hitTest(geometry, *predicate) : collisionGrid.hitTest(geometry);
+    }
+
     std::pair<bool, bool> placeLineFeature(
         const CollisionFeature& feature,
         const mat4& posMatrix,
@@ -108,6 +116,9 @@ private:
     const float viewportPadding;
     CollisionGrid collisionGrid;
     CollisionGrid ignoredGrid;
+    std::vector<CollisionGrid::BCircle> circleScratch;
+    std::vector<float> circleCentersX;
+    std::vector<float> circleCentersY;
 
     const float screenRightBoundary;
     const float screenBottomBoundary;
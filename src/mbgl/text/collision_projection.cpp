@@ -0,0 +1,193 @@
+#include <mbgl/text/collision_projection.hpp>
+#include <mbgl/text/collision_feature.hpp>
+
+#include <cassert>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MBGL_COLLISION_PROJECTION_X86 1
+#include <immintrin.h>
+#else
+#define MBGL_COLLISION_PROJECTION_X86 0
+#endif
+
+namespace mbgl {
+namespace collision {
+
+namespace {
+
+// Shared by all paths for the elements that don't fill a whole vector.
+void projectAnchorsScalar(const mat4& m,
+                          const double width,
+                          const double height,
+                          const float padding,
+                          const CollisionBox* boxes,
+                          const std::size_t begin,
+                          const std::size_t end,
+                          float* outX,
+                          float* outY) {
+    for (std::size_t i = begin; i < end; ++i) {
+        vec4 p = {{boxes[i].anchor.x, boxes[i].anchor.y, 0, 1}};
+        matrix::transformMat4(p, p, m);
+        outX[i] = static_cast<float>((((p[0] / p[3] + 1) / 2) * width) + padding);
+        outY[i] = static_cast<float>((((-p[1] / p[3] + 1) / 2) * height) + padding);
+    }
+}
+
+#if MBGL_COLLISION_PROJECTION_X86
+
+// The vector paths spell out `m[0] * x + m[4] * y + m[8] * z + m[12] * w`
+// with z = 0 and w = 1 exactly like matrix::transformMat4, and never fuse
+// multiplies and adds, so every lane rounds like the scalar code.
+
+inline __m128d transformRowSSE2(const mat4& m, const std::size_t c, const __m128d x, const __m128d y) {
+    __m128d r = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(m[c]), x), _mm_mul_pd(_mm_set1_pd(m[c + 4]), y));
+    r = _mm_add_pd(r, _mm_mul_pd(_mm_set1_pd(m[c + 8]), _mm_setzero_pd()));
+    return _mm_add_pd(r, _mm_mul_pd(_mm_set1_pd(m[c + 12]), _mm_set1_pd(1.0)));
+}
+
+__attribute__((target("avx2"))) inline __m256d transformRowAVX2(const mat4& m,
+                                                                const std::size_t c,
+                                                                const __m256d x,
+                                                                const __m256d y) {
+    __m256d r = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(m[c]), x), _mm256_mul_pd(_mm256_set1_pd(m[c + 4]), y));
+    r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_set1_pd(m[c + 8]), _mm256_setzero_pd()));
+    return _mm256_add_pd(r, _mm256_mul_pd(_mm256_set1_pd(m[c + 12]), _mm256_set1_pd(1.0)));
+}
+
+void projectAnchorsSSE2(const mat4& m,
+                        const double width,
+                        const double height,
+                        const float padding,
+                        const CollisionBox* boxes,
+                        const std::size_t count,
+                        float* outX,
+                        float* outY) {
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d w = _mm_set1_pd(width);
+    const __m128d h = _mm_set1_pd(height);
+    const __m128d pad = _mm_set1_pd(padding);
+
+    std::size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128d x = _mm_set_pd(boxes[i + 1].anchor.x, boxes[i].anchor.x);
+        const __m128d y = _mm_set_pd(boxes[i + 1].anchor.y, boxes[i].anchor.y);
+        const __m128d p0 = transformRowSSE2(m, 0, x, y);
+        const __m128d p1 = transformRowSSE2(m, 1, x, y);
+        const __m128d p3 = transformRowSSE2(m, 3, x, y);
+
+        const __m128d px = _mm_add_pd(
+            _mm_mul_pd(_mm_div_pd(_mm_add_pd(_mm_div_pd(p0, p3), one), two), w), pad);
+        const __m128d py = _mm_add_pd(
+            _mm_mul_pd(_mm_div_pd(_mm_add_pd(_mm_div_pd(_mm_xor_pd(p1, sign), p3), one), two), h), pad);
+
+        alignas(16) float fx[4];
+        alignas(16) float fy[4];
+        _mm_store_ps(fx, _mm_cvtpd_ps(px));
+        _mm_store_ps(fy, _mm_cvtpd_ps(py));
+        outX[i] = fx[0];
+        outX[i + 1] = fx[1];
+        outY[i] = fy[0];
+        outY[i + 1] = fy[1];
+    }
+    projectAnchorsScalar(m, width, height, padding, boxes, i, count, outX, outY);
+}
+
+__attribute__((target("avx2"))) void projectAnchorsAVX2(const mat4& m,
+                                                        const double width,
+                                                        const double height,
+                                                        const float padding,
+                                                        const CollisionBox* boxes,
+                                                        const std::size_t count,
+                                                        float* outX,
+                                                        float* outY) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d w = _mm256_set1_pd(width);
+    const __m256d h = _mm256_set1_pd(height);
+    const __m256d pad = _mm256_set1_pd(padding);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d x = _mm256_set_pd(
+            boxes[i + 3].anchor.x, boxes[i + 2].anchor.x, boxes[i + 1].anchor.x, boxes[i].anchor.x);
+        const __m256d y = _mm256_set_pd(
+            boxes[i + 3].anchor.y, boxes[i + 2].anchor.y, boxes[i + 1].anchor.y, boxes[i].anchor.y);
+        const __m256d p0 = transformRowAVX2(m, 0, x, y);
+        const __m256d p1 = transformRowAVX2(m, 1, x, y);
+        const __m256d p3 = transformRowAVX2(m, 3, x, y);
+
+        const __m256d px = _mm256_add_pd(
+            _mm256_mul_pd(_mm256_div_pd(_mm256_add_pd(_mm256_div_pd(p0, p3), one), two), w), pad);
+        const __m256d py = _mm256_add_pd(
+            _mm256_mul_pd(_mm256_div_pd(_mm256_add_pd(_mm256_div_pd(_mm256_xor_pd(p1, sign), p3), one), two), h),
+            pad);
+
+        _mm_storeu_ps(outX + i, _mm256_cvtpd_ps(px));
+        _mm_storeu_ps(outY + i, _mm256_cvtpd_ps(py));
+    }
+    projectAnchorsScalar(m, width, height, padding, boxes, i, count, outX, outY);
+}
+
+#endif
+
+} // namespace
+
+bool supportsProjectionPath(const ProjectionPath path) {
+    switch (path) {
+        case ProjectionPath::Scalar:
+            return true;
+#if MBGL_COLLISION_PROJECTION_X86
+        case ProjectionPath::SSE2:
+            // Part of the x86-64 baseline.
+            return true;
+        case ProjectionPath::AVX2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case ProjectionPath::SSE2:
+        case ProjectionPath::AVX2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+ProjectionPath bestProjectionPath() {
+    static const ProjectionPath best = [] {
+        if (supportsProjectionPath(ProjectionPath::AVX2)) return ProjectionPath::AVX2;
+        if (supportsProjectionPath(ProjectionPath::SSE2)) return ProjectionPath::SSE2;
+        return ProjectionPath::Scalar;
+    }();
+    return best;
+}
+
+void projectAnchors(const mat4& posMatrix,
+                    const Size viewportSize,
+                    const float viewportPadding,
+                    const CollisionBox* boxes,
+                    const std::size_t count,
+                    float* outX,
+                    float* outY,
+                    const ProjectionPath path) {
+    assert(supportsProjectionPath(path));
+    const auto width = static_cast<double>(viewportSize.width);
+    const auto height = static_cast<double>(viewportSize.height);
+    switch (path) {
+#if MBGL_COLLISION_PROJECTION_X86
+        case ProjectionPath::AVX2:
+            projectAnchorsAVX2(posMatrix, width, height, viewportPadding, boxes, count, outX, outY);
+            return;
+        case ProjectionPath::SSE2:
+            projectAnchorsSSE2(posMatrix, width, height, viewportPadding, boxes, count, outX, outY);
+            return;
+#endif
+        default:
+            projectAnchorsScalar(posMatrix, width, height, viewportPadding, boxes, 0, count, outX, outY);
+            return;
+    }
+}
+
+} // namespace collision
+} // namespace mbgl
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <mbgl/util/mat4.hpp>
+#include <mbgl/util/size.hpp>
+
+#include <cstddef>
+
+namespace mbgl {
+
+class CollisionBox;
+
+namespace collision {
+
+enum class ProjectionPath : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// The fastest path supported by the running CPU, detected once.
+ProjectionPath bestProjectionPath();
+bool supportsProjectionPath(ProjectionPath);
+
+// Projects the anchors of `count` collision boxes from tile units to
+// collision grid coordinates, writing the results to `outX` and `outY`.
+// Every path performs the same double precision operations in the same
+// order as CollisionIndex::projectPoint, so results are bit-identical
+// regardless of the path taken.
+void projectAnchors(const mat4& posMatrix,
+                    Size viewportSize,
+                    float viewportPadding,
+                    const CollisionBox* boxes,
+                    std::size_t count,
+                    float* outX,
+                    float* outY,
+                    ProjectionPath = bestProjectionPath());
+
+} // namespace collision
+} // namespace mbgl
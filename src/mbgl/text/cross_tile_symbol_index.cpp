@@ -4,6 +4,8 @@
 #include <mbgl/renderer/render_tile.hpp>
 #include <mbgl/tile/tile.hpp>
 
+#include <algorithm>
+
 namespace mbgl {
 
 TileLayerIndex::TileLayerIndex(OverscaledTileID coord_,
@@ -15,9 +17,41 @@ TileLayerIndex::TileLayerIndex(OverscaledTileID coord_,
       bucketLeaderId(std::move(bucketLeaderId_)) {
     for (SymbolInstance& symbolInstance : symbolInstances) {
         if (symbolInstance.crossTileID == SymbolInstance::invalidCrossTileID()) continue;
-        indexedSymbolInstances[symbolInstance.key].emplace_back(symbolInstance.crossTileID,
-                                                                getScaledCoordinates(symbolInstance, coord));
+
+        auto& slot = indexedSymbolInstances[symbolInstance.keyHash];
+        auto keyed = std::find_if(slot.begin(), slot.end(), [&](const KeyedSymbols& candidate) {
+            return candidate.key == symbolInstance.key;
+        });
+        if (keyed == slot.end()) {
+            keyed = slot.insert(slot.end(), KeyedSymbols{symbolInstance.key, {}});
+        }
+        keyed->symbols.emplace_back(symbolInstance.crossTileID,
+                                    getScaledCoordinates(symbolInstance, coord),
+                                    static_cast<uint32_t>(keyed->symbols.size()));
+    }
+
+    for (auto& slot : indexedSymbolInstances) {
+        for (auto& keyed : slot.second) {
+            std::sort(keyed.symbols.begin(),
+                      keyed.symbols.end(),
+                      [](const IndexedSymbolInstance& a, const IndexedSymbolInstance& b) {
+                          return a.coord.x < b.coord.x || (a.coord.x == b.coord.x && a.order < b.order);
+                      });
+        }
+    }
+}
+
+auto TileLayerIndex::findKey(const SymbolInstance& symbolInstance) const -> const KeyedSymbols* {
+    auto it = indexedSymbolInstances.find(symbolInstance.keyHash);
+    if (it == indexedSymbolInstances.end()) {
+        return nullptr;
+    }
+    for (const auto& keyed : it->second) {
+        if (keyed.key == symbolInstance.key) {
+            return &keyed;
+        }
     }
+    return nullptr;
 }
 
 Point<int64_t> TileLayerIndex::getScaledCoordinates(SymbolInstance& symbolInstance,
@@ -33,11 +67,12 @@ Point<int64_t> TileLayerIndex::getScaledCoordinates(SymbolInstance& symbolInstan
 
 void TileLayerIndex::findMatches(SymbolBucket& bucket,
                                  const OverscaledTileID& newCoord,
-                                 std::set<uint32_t>& zoomCrossTileIDs) const {
+                                 std::unordered_set<uint32_t>& zoomCrossTileIDs) const {
     auto& symbolInstances = bucket.symbolInstances;
     float tolerance = coord.canonical.z < newCoord.canonical.z
                           ? 1.0f
                           : static_cast<float>(std::pow(2, coord.canonical.z - newCoord.canonical.z));
+    const auto xTolerance = static_cast<int64_t>(tolerance);
 
     if (bucket.bucketLeaderID != bucketLeaderId) return;
 
@@ -47,28 +82,40 @@ void TileLayerIndex::findMatches(SymbolBucket& bucket,
             continue;
         }
 
-        auto it = indexedSymbolInstances.find(symbolInstance.key);
-        if (it == indexedSymbolInstances.end()) {
+        const KeyedSymbols* keyed = findKey(symbolInstance);
+        if (!keyed) {
             // No symbol with this key in this bucket
             continue;
         }
 
         auto scaledSymbolCoord = getScaledCoordinates(symbolInstance, newCoord);
 
-        for (const IndexedSymbolInstance& thisTileSymbol : it->second) {
-            // Return any symbol with the same keys whose coordinates are within
-            // 1 grid unit. (with a 4px grid, this covers a 12px by 12px area)
+        // Return the first symbol, in bucket order, with the same key whose
+        // coordinates are within 1 grid unit. (with a 4px grid, this covers
+        // a 12px by 12px area)
+        const auto& symbols = keyed->symbols;
+        auto it = std::lower_bound(symbols.begin(),
+                                   symbols.end(),
+                                   scaledSymbolCoord.x - xTolerance,
+                                   [](const IndexedSymbolInstance& symbol, int64_t x) { return symbol.coord.x < x; });
+        const IndexedSymbolInstance* match = nullptr;
+        for (; it != symbols.end() && it->coord.x <= scaledSymbolCoord.x + xTolerance; ++it) {
+            const IndexedSymbolInstance& thisTileSymbol = *it;
+            if (match && match->order < thisTileSymbol.order) continue;
             if (std::abs(thisTileSymbol.coord.x - scaledSymbolCoord.x) <= tolerance &&
                 std::abs(thisTileSymbol.coord.y - scaledSymbolCoord.y) <= tolerance &&
                 zoomCrossTileIDs.find(thisTileSymbol.crossTileID) == zoomCrossTileIDs.end()) {
-                // Once we've marked ourselves duplicate against this parent
-                // symbol, don't let any other symbols at the same zoom level
-                // duplicate against the same parent (see issue #10844)
-                zoomCrossTileIDs.insert(thisTileSymbol.crossTileID);
-                symbolInstance.crossTileID = thisTileSymbol.crossTileID;
-                break;
+                match = &thisTileSymbol;
             }
         }
+
+        if (match) {
+            // Once we've marked ourselves duplicate against this parent
+            // symbol, don't let any other symbols at the same zoom level
+            // duplicate against the same parent (see issue #10844)
+            zoomCrossTileIDs.insert(match->crossTileID);
+            symbolInstance.crossTileID = match->crossTileID;
+        }
     }
 }
 
@@ -190,9 +237,12 @@ bool CrossTileSymbolLayerIndex::addBucket(const OverscaledTileID& tileID,
 }
 
 void CrossTileSymbolLayerIndex::removeBucketCrossTileIDs(uint8_t zoom, const TileLayerIndex& removedBucket) {
-    for (const auto& key : removedBucket.indexedSymbolInstances) {
-        for (auto indexedSymbolInstance : key.second) {
-            usedCrossTileIDs[zoom].erase(indexedSymbolInstance.crossTileID);
+    auto& zoomCrossTileIDs = usedCrossTileIDs[zoom];
+    for (const auto& slot : removedBucket.indexedSymbolInstances) {
+        for (const auto& keyed : slot.second) {
+            for (const auto& indexedSymbolInstance : keyed.symbols) {
+                zoomCrossTileIDs.erase(indexedSymbolInstance.crossTileID);
+            }
         }
     }
 }
@@ -232,9 +282,8 @@ auto CrossTileSymbolIndex::addLayer(const RenderLayer& layer, float lng) -> AddL
     layerIndex.handleWrapJump(lng);
 
     for (const auto& item : layer.getPlacementData()) {
-        const RenderTile& renderTile = item.tile;
-        Bucket& bucket = item.bucket;
-        auto pair = bucket.registerAtCrossTileIndex(layerIndex, renderTile);
+        Bucket& bucket = *item.bucket;
+        auto pair = bucket.registerAtCrossTileIndex(layerIndex, item.tile);
         assert(pair.first != 0u);
         if (pair.second) result |= AddLayerResult::BucketsAdded;
         currentBucketIDs.insert(pair.first);
@@ -11,6 +11,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace mbgl {
@@ -21,12 +22,14 @@ class SymbolBucket;
 
 class IndexedSymbolInstance {
 public:
-    IndexedSymbolInstance(uint32_t crossTileID_, Point<int64_t> coord_)
+    IndexedSymbolInstance(uint32_t crossTileID_, Point<int64_t> coord_, uint32_t order_)
         : crossTileID(crossTileID_),
-          coord(coord_) {}
+          coord(coord_),
+          order(order_) {}
 
     uint32_t crossTileID;
     Point<int64_t> coord;
+    uint32_t order; // Position among the symbols sharing the same key, in bucket order
 };
 
 class TileLayerIndex {
@@ -37,12 +40,22 @@ public:
                    std::string bucketLeaderId);
 
     Point<int64_t> getScaledCoordinates(SymbolInstance&, const OverscaledTileID&) const;
-    void findMatches(SymbolBucket&, const OverscaledTileID&, std::set<uint32_t>&) const;
+    void findMatches(SymbolBucket&, const OverscaledTileID&, std::unordered_set<uint32_t>&) const;
+
+    // All symbols sharing one key, sorted by x so that the candidates
+    // within the matching tolerance are found with a binary search.
+    struct KeyedSymbols {
+        std::u16string key;
+        std::vector<IndexedSymbolInstance> symbols;
+    };
+
+    const KeyedSymbols* findKey(const SymbolInstance&) const;
 
     OverscaledTileID coord;
     uint32_t bucketInstanceId;
     std::string bucketLeaderId;
-    std::map<std::u16string, std::vector<IndexedSymbolInstance>> indexedSymbolInstances;
+    // Keyed by SymbolInstance::keyHash; colliding keys share a slot.
+    std::unordered_map<std::size_t, std::vector<KeyedSymbols>> indexedSymbolInstances;
 };
 
 class CrossTileSymbolLayerIndex {
@@ -56,7 +69,7 @@ private:
     void removeBucketCrossTileIDs(uint8_t zoom, const TileLayerIndex& removedBucket);
 
     std::map<uint8_t, std::map<OverscaledTileID, TileLayerIndex>> indexes;
-    std::map<uint8_t, std::set<uint32_t>> usedCrossTileIDs;
+    std::map<uint8_t, std::unordered_set<uint32_t>> usedCrossTileIDs;
     float lng = 0;
     uint32_t& maxCrossTileID;
 };
@@ -77,7 +90,7 @@ public:
     void reset();
 
 private:
-    std::map<std::string, CrossTileSymbolLayerIndex> layerIndexes;
+    std::unordered_map<std::string, CrossTileSymbolLayerIndex> layerIndexes;
     uint32_t maxCrossTileID = 0;
 };
 
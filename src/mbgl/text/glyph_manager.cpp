@@ -1,9 +1,12 @@
+#include <mbgl/actor/scheduler.hpp>
 #include <mbgl/storage/file_source.hpp>
 #include <mbgl/storage/resource.hpp>
+#include <mbgl/storage/resource_options.hpp>
 #include <mbgl/storage/response.hpp>
 #include <mbgl/text/glyph_manager.hpp>
 #include <mbgl/text/glyph_manager_observer.hpp>
 #include <mbgl/text/glyph_pbf.hpp>
+#include <mbgl/text/glyph_store.hpp>
 #include <mbgl/util/async_request.hpp>
 #include <mbgl/util/std.hpp>
 #include <mbgl/util/tiny_sdf.hpp>
@@ -18,9 +21,19 @@ GlyphManager::GlyphManager(std::unique_ptr<LocalGlyphRasterizer> localGlyphRaste
 
 GlyphManager::~GlyphManager() = default;
 
-void GlyphManager::getGlyphs(GlyphRequestor& requestor, GlyphDependencies glyphDependencies, FileSource& fileSource) {
+void GlyphManager::getGlyphs(GlyphRequestor& requestor,
+                             GlyphDependencies glyphDependencies,
+                             std::shared_ptr<FileSource> fileSource) {
     auto dependencies = std::make_shared<GlyphDependencies>(std::move(glyphDependencies));
 
+    if (!glyphStoreInitialized) {
+        const ResourceOptions options = fileSource->getResourceOptions();
+        if (!options.glyphCachePath().empty()) {
+            glyphStore = std::make_shared<const GlyphStore>(options.glyphCachePath(), options.maximumCacheSize());
+        }
+        glyphStoreInitialized = true;
+    }
+
     // Figure out which glyph ranges need to be fetched. For each range that
     // does need to be fetched, record an entry mapping the requestor to a
     // shared pointer containing the dependencies. When the shared pointer
@@ -68,16 +81,59 @@ Glyph GlyphManager::generateLocalSDF(const FontStack& fontStack, GlyphID glyphID
 void GlyphManager::requestRange(GlyphRequest& request,
                                 const FontStack& fontStack,
                                 const GlyphRange& range,
-                                FileSource& fileSource) {
-    if (request.req) {
+                                const std::shared_ptr<FileSource>& fileSource) {
+    if (request.req || request.storeLookup) {
         return;
     }
 
-    request.req = fileSource.request(
+    if (glyphStore && !request.storeMissed) {
+        loadStoredRange(request, fontStack, range, fileSource);
+        return;
+    }
+
+    request.req = fileSource->request(
         Resource::glyphs(glyphURL, fontStack, range),
         [this, fontStack, range](const Response& res) { processResponse(res, fontStack, range); });
 }
 
+void GlyphManager::loadStoredRange(GlyphRequest& request,
+                                   const FontStack& fontStack,
+                                   const GlyphRange& range,
+                                   const std::shared_ptr<FileSource>& fileSource) {
+    request.storeLookup = true;
+
+    // The store reads files, so it is kept off the render thread.
+    auto load = [store = glyphStore, url = glyphURL, fontStack, range] {
+        std::optional<std::vector<Immutable<Glyph>>> result;
+        if (auto glyphs = store->load(url, fontStack, range)) {
+            result.emplace();
+            result->reserve(glyphs->size());
+            for (auto& glyph : *glyphs) {
+                result->push_back(makeMutable<Glyph>(std::move(glyph)));
+            }
+        }
+        return result;
+    };
+    auto reply = [this, weak = weakFactory.makeWeakPtr(), fontStack, range, fileSource](
+                     const std::optional<std::vector<Immutable<Glyph>>>& glyphs) {
+        if (!weak) return;
+        auto entry = entries.find(fontStack);
+        if (entry == entries.end()) return; // Evicted meanwhile.
+        auto it = entry->second.ranges.find(range);
+        if (it == entry->second.ranges.end() || !it->second.storeLookup) return;
+
+        GlyphRequest& pending = it->second;
+        pending.storeLookup = false;
+        if (glyphs) {
+            processGlyphs(*glyphs, fontStack, range, false);
+        } else {
+            pending.storeMissed = true;
+            requestRange(pending, fontStack, range, fileSource);
+        }
+    };
+    Scheduler::GetBackground()->scheduleAndReplyValue(load, reply);
+}
+
 void GlyphManager::processResponse(const Response& res, const FontStack& fontStack, const GlyphRange& range) {
     if (res.error) {
         observer->onGlyphsError(fontStack, range, std::make_exception_ptr(std::runtime_error(res.error->message)));
@@ -88,9 +144,7 @@ void GlyphManager::processResponse(const Response& res, const FontStack& fontSta
         return;
     }
 
-    Entry& entry = entries[fontStack];
-    GlyphRequest& request = entry.ranges[range];
-
+    std::vector<Immutable<Glyph>> parsed;
     if (!res.noContent) {
         std::vector<Glyph> glyphs;
 
@@ -101,15 +155,38 @@ void GlyphManager::processResponse(const Response& res, const FontStack& fontSta
             return;
         }
 
+        parsed.reserve(glyphs.size());
         for (auto& glyph : glyphs) {
-            auto id = glyph.id;
-            if (!localGlyphRasterizer->canRasterizeGlyph(fontStack, id)) {
-                entry.glyphs.erase(id);
-                entry.glyphs.emplace(id, makeMutable<Glyph>(std::move(glyph)));
-            }
+            parsed.push_back(makeMutable<Glyph>(std::move(glyph)));
+        }
+    }
+
+    processGlyphs(std::move(parsed), fontStack, range, !res.noContent);
+}
+
+void GlyphManager::processGlyphs(std::vector<Immutable<Glyph>> glyphs,
+                                 const FontStack& fontStack,
+                                 const GlyphRange& range,
+                                 bool writeToStore) {
+    Entry& entry = entries[fontStack];
+    GlyphRequest& request = entry.ranges[range];
+
+    for (const auto& glyph : glyphs) {
+        if (!localGlyphRasterizer->canRasterizeGlyph(fontStack, glyph->id)) {
+            entry.glyphs.erase(glyph->id);
+            entry.glyphs.emplace(glyph->id, glyph);
         }
     }
 
+    if (glyphStore && writeToStore) {
+        // Every glyph of the range is stored, so the store doesn't depend
+        // on which glyphs this map rasterizes locally.
+        Scheduler::GetBackground()->schedule(
+            [store = glyphStore, url = glyphURL, fontStack, range, glyphs_ = std::move(glyphs)] {
+                store->save(url, fontStack, range, glyphs_);
+            });
+    }
+
     request.parsed = true;
 
     for (auto& pair : request.requestors) {
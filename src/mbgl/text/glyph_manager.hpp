@@ -7,6 +7,9 @@
 #include <mbgl/util/font_stack.hpp>
 #include <mbgl/util/immutable.hpp>
 
+#include <mapbox/std/weak.hpp>
+
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -15,6 +18,7 @@ namespace mbgl {
 class FileSource;
 class AsyncRequest;
 class Response;
+class GlyphStore;
 
 class GlyphRequestor {
 public:
@@ -35,9 +39,10 @@ public:
     // Workers send a `getGlyphs` message to the main thread once they have
     // determined their `GlyphDependencies`. If all glyphs are already locally
     // available, GlyphManager will provide them to the requestor immediately.
-    // Otherwise, it makes a request on the FileSource is made for each range
-    // needed, and notifies the observer when all are complete.
-    void getGlyphs(GlyphRequestor&, GlyphDependencies, FileSource&);
+    // Otherwise, each range needed is looked up in the glyph store on a
+    // background thread, or requested from the FileSource if it isn't
+    // stored, and the observer is notified when all are complete.
+    void getGlyphs(GlyphRequestor&, GlyphDependencies, std::shared_ptr<FileSource>);
     void removeRequestor(GlyphRequestor&);
 
     void setURL(const std::string& url) { glyphURL = url; }
@@ -53,6 +58,10 @@ private:
 
     struct GlyphRequest {
         bool parsed = false;
+        // Set while the range is looked up in the glyph store, and after it
+        // wasn't found there.
+        bool storeLookup = false;
+        bool storeMissed = false;
         std::unique_ptr<AsyncRequest> req;
         std::unordered_map<GlyphRequestor*, std::shared_ptr<GlyphDependencies>> requestors;
     };
@@ -64,13 +73,22 @@ private:
 
     std::unordered_map<FontStack, Entry, FontStackHasher> entries;
 
-    void requestRange(GlyphRequest&, const FontStack&, const GlyphRange&, FileSource& fileSource);
+    void requestRange(GlyphRequest&, const FontStack&, const GlyphRange&, const std::shared_ptr<FileSource>&);
+    void loadStoredRange(GlyphRequest&, const FontStack&, const GlyphRange&, const std::shared_ptr<FileSource>&);
     void processResponse(const Response&, const FontStack&, const GlyphRange&);
+    void processGlyphs(std::vector<Immutable<Glyph>>, const FontStack&, const GlyphRange&, bool writeToStore);
     void notify(GlyphRequestor&, const GlyphDependencies&);
 
     GlyphManagerObserver* observer = nullptr;
 
     std::unique_ptr<LocalGlyphRasterizer> localGlyphRasterizer;
+
+    // Set up from the file source's resource options on first use. Shared
+    // with the background tasks that write ranges to it.
+    std::shared_ptr<const GlyphStore> glyphStore;
+    bool glyphStoreInitialized = false;
+
+    mapbox::base::WeakPtrFactory<GlyphManager> weakFactory{this};
 };
 
 } // namespace mbgl
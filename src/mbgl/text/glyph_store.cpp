@@ -0,0 +1,241 @@
+#include <mbgl/text/glyph_store.hpp>
+#include <mbgl/util/io.hpp>
+#include <mbgl/util/logging.hpp>
+#include <mbgl/util/mapped_file.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace mbgl {
+
+namespace {
+
+// Bump when the layout below changes; files with another version are ignored.
+constexpr uint32_t formatVersion = 1;
+constexpr char magic[4] = {'M', 'B', 'G', 'S'};
+
+// A file is a FileHeader, the key (glyph URL and font stack), one
+// GlyphRecord per glyph and finally all bitmaps, in record order.
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint16_t first;
+    uint16_t last;
+    uint32_t keyLength;
+    uint32_t glyphCount;
+};
+
+struct GlyphRecord {
+    uint16_t id;
+    uint16_t reserved;
+    uint32_t bitmapWidth;
+    uint32_t bitmapHeight;
+    uint32_t width;
+    uint32_t height;
+    int32_t left;
+    int32_t top;
+    uint32_t advance;
+};
+
+std::string storeKey(const std::string& url, const FontStack& fontStack) {
+    return url + "\n" + fontStackToString(fontStack);
+}
+
+// File names must be stable across runs and platforms, so std::hash won't do.
+uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Writes to a temporary file first, so that a concurrent load or a crash
+// never sees a partially written file.
+bool writeFile(const std::string& filename, const std::string& data) {
+    static std::atomic<uint64_t> temporaryCounter{0};
+    const std::string temporary = filename + "." + std::to_string(temporaryCounter++) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            Log::Warning(Event::Glyph, "Unable to write glyph store file " + temporary);
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+#if defined(_WIN32)
+    // rename() does not replace existing files on Windows.
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        Log::Warning(Event::Glyph, "Unable to write glyph store file " + filename);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Serializes updates of the index files.
+std::mutex indexMutex;
+
+} // namespace
+
+GlyphStore::GlyphStore(std::string directory_, uint64_t maximumSize_)
+    : directory(std::move(directory_)),
+      maximumSize(maximumSize_) {}
+
+std::string GlyphStore::name(const std::string& key, const GlyphRange& range) const {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(key) << "-" << std::dec << range.first
+         << ".glyphs";
+    return name.str();
+}
+
+std::optional<std::vector<Glyph>> GlyphStore::load(const std::string& url,
+                                                   const FontStack& fontStack,
+                                                   const GlyphRange& range) const {
+    const std::string key = storeKey(url, fontStack);
+    const util::MappedFile file(directory + "/" + name(key, range));
+    if (!file.data()) {
+        return std::nullopt;
+    }
+
+    const uint8_t* cursor = file.data();
+    const uint8_t* const end = file.data() + file.size();
+    const auto read = [&](void* destination, size_t length) {
+        if (static_cast<size_t>(end - cursor) < length) {
+            return false;
+        }
+        std::memcpy(destination, cursor, length);
+        cursor += length;
+        return true;
+    };
+
+    FileHeader header;
+    if (!read(&header, sizeof(header)) || std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.version != formatVersion || header.first != range.first || header.last != range.second ||
+        header.keyLength != key.size() || static_cast<size_t>(end - cursor) < key.size() ||
+        std::memcmp(cursor, key.data(), key.size()) != 0) {
+        // Either stale, corrupt, or a different key that hashed to the same name.
+        return std::nullopt;
+    }
+    cursor += key.size();
+
+    std::vector<GlyphRecord> records(header.glyphCount);
+    if (!read(records.data(), records.size() * sizeof(GlyphRecord))) {
+        return std::nullopt;
+    }
+
+    std::vector<Glyph> glyphs;
+    glyphs.reserve(records.size());
+    for (const auto& record : records) {
+        const size_t bytes = static_cast<size_t>(record.bitmapWidth) * record.bitmapHeight;
+        if (record.id < range.first || record.id > range.second || static_cast<size_t>(end - cursor) < bytes) {
+            return std::nullopt;
+        }
+
+        Glyph glyph;
+        glyph.id = record.id;
+        glyph.metrics.width = record.width;
+        glyph.metrics.height = record.height;
+        glyph.metrics.left = record.left;
+        glyph.metrics.top = record.top;
+        glyph.metrics.advance = record.advance;
+        if (bytes) {
+            glyph.bitmap = AlphaImage(Size(record.bitmapWidth, record.bitmapHeight), cursor, bytes);
+        }
+        cursor += bytes;
+        glyphs.push_back(std::move(glyph));
+    }
+
+    return glyphs;
+}
+
+bool GlyphStore::save(const std::string& url,
+                      const FontStack& fontStack,
+                      const GlyphRange& range,
+                      const std::vector<Immutable<Glyph>>& glyphs) const {
+    const std::string key = storeKey(url, fontStack);
+
+    FileHeader header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.first = range.first;
+    header.last = range.second;
+    header.keyLength = static_cast<uint32_t>(key.size());
+    header.glyphCount = static_cast<uint32_t>(glyphs.size());
+
+    std::string data;
+    data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(key);
+    for (const auto& glyph : glyphs) {
+        GlyphRecord record{};
+        record.id = glyph->id;
+        if (glyph->bitmap.valid()) {
+            record.bitmapWidth = glyph->bitmap.size.width;
+            record.bitmapHeight = glyph->bitmap.size.height;
+        }
+        record.width = glyph->metrics.width;
+        record.height = glyph->metrics.height;
+        record.left = glyph->metrics.left;
+        record.top = glyph->metrics.top;
+        record.advance = glyph->metrics.advance;
+        data.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    for (const auto& glyph : glyphs) {
+        if (glyph->bitmap.valid()) {
+            data.append(reinterpret_cast<const char*>(glyph->bitmap.data.get()), glyph->bitmap.bytes());
+        }
+    }
+
+    const std::string filename = name(key, range);
+    if (!writeFile(directory + "/" + filename, data)) {
+        return false;
+    }
+    addToIndex(filename, data.size());
+    return true;
+}
+
+void GlyphStore::addToIndex(const std::string& filename, uint64_t size) const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    const std::string indexPath = directory + "/index";
+
+    // One "<file name> <size>" line per range, oldest first.
+    std::vector<std::pair<std::string, uint64_t>> entries;
+    uint64_t total = 0;
+    if (auto index = util::readFile(indexPath)) {
+        std::istringstream lines(*index);
+        std::string entryName;
+        uint64_t entrySize;
+        while (lines >> entryName >> entrySize) {
+            if (entryName != filename) {
+                entries.emplace_back(entryName, entrySize);
+                total += entrySize;
+            }
+        }
+    }
+    entries.emplace_back(filename, size);
+    total += size;
+
+    auto kept = entries.begin();
+    while (total > maximumSize && kept != entries.end()) {
+        std::remove((directory + "/" + kept->first).c_str());
+        total -= kept->second;
+        ++kept;
+    }
+
+    std::string index;
+    for (auto it = kept; it != entries.end(); ++it) {
+        index += it->first + " " + std::to_string(it->second) + "\n";
+    }
+    writeFile(indexPath, index);
+}
+
+} // namespace mbgl
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mbgl/text/glyph.hpp>
+#include <mbgl/text/glyph_range.hpp>
+#include <mbgl/util/constants.hpp>
+#include <mbgl/util/font_stack.hpp>
+#include <mbgl/util/immutable.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace mbgl {
+
+/*
+    Keeps decoded glyph ranges on disk, one file per glyph URL, font stack and
+    range, in a directory that is separate from the resource cache. Stored
+    ranges are therefore never evicted in favor of tiles, and survive
+    clearing the ambient cache. Files hold the metrics and SDF bitmaps in the
+    layout they have in memory, so loading a range maps the file and copies
+    the bitmaps out without decoding a PBF.
+
+    An index file in the directory lists the stored ranges in the order they
+    were saved, with their sizes. Once the ranges take more than the maximum
+    size, the ones saved longest ago are deleted.
+
+    Saves update the index under a process-wide lock, so a GlyphStore may be
+    used from any thread. Processes sharing a directory may exceed the limit.
+*/
+class GlyphStore {
+public:
+    // `directory` must exist and be writable.
+    explicit GlyphStore(std::string directory, uint64_t maximumSize = util::DEFAULT_MAX_CACHE_SIZE);
+
+    // Returns the glyphs of a previously saved range, or nothing if the range
+    // has not been saved or the file is unreadable.
+    std::optional<std::vector<Glyph>> load(const std::string& url,
+                                           const FontStack&,
+                                           const GlyphRange&) const;
+
+    // Writes a range, replacing any previous version. Returns false if the
+    // file could not be written.
+    bool save(const std::string& url,
+              const FontStack&,
+              const GlyphRange&,
+              const std::vector<Immutable<Glyph>>&) const;
+
+private:
+    std::string name(const std::string& key, const GlyphRange&) const;
+    void addToIndex(const std::string& name, uint64_t size) const;
+
+    const std::string directory;
+    const uint64_t maximumSize;
+};
+
+} // namespace mbgl
@@ -27,7 +27,8 @@ namespace mbgl {
     It is left to platform-specific implementation to decide how best to
     map a FontStack to a particular rasterization.
 
-    The default implementation simply refuses to rasterize any glyphs.
+    The default implementation draws glyphs with FreeType when it is built
+    with MBGL_USE_FREETYPE, and otherwise refuses to rasterize any glyphs.
 */
 
 class LocalGlyphRasterizer {
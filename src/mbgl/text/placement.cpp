@@ -1,4 +1,7 @@
+#include <atomic>
+#include <future>
 #include <list>
+#include <mbgl/actor/scheduler.hpp>
 #include <mbgl/layout/symbol_layout.hpp>
 #include <mbgl/renderer/bucket.hpp>
 #include <mbgl/renderer/buckets/symbol_bucket.hpp>
@@ -8,10 +11,21 @@
 #include <mbgl/text/placement.hpp>
 #include <mbgl/tile/geometry_tile.hpp>
 #include <mbgl/util/math.hpp>
+#include <mbgl/util/parallel.hpp>
+#include <unordered_set>
 #include <utility>
 
 namespace mbgl {
 
+namespace {
+
+uint64_t nextPlacementRevision() {
+    static std::atomic<uint64_t> lastRevision{0};
+    return ++lastRevision;
+}
+
+} // namespace
+
 OpacityState::OpacityState(bool placed_, bool skipFade)
     : opacity((skipFade && placed_) ? 1.0f : 0.0f),
       placed(placed_) {}
@@ -65,32 +79,34 @@ using namespace style;
 // PlacementContext implemenation
 class PlacementContext {
     std::reference_wrapper<const SymbolBucket> bucket;
-    std::reference_wrapper<const RenderTile> renderTile;
+    std::reference_wrapper<const PlacementTile> tile;
     std::reference_wrapper<const TransformState> state;
 
 public:
     PlacementContext(const SymbolBucket& bucket_,
-                     const RenderTile& renderTile_,
+                     const PlacementTile& tile_,
                      const TransformState& state_,
                      float placementZoom,
                      CollisionGroups::CollisionGroup collisionGroup_,
+                     bool justReloaded_,
                      std::optional<CollisionBoundaries> avoidEdges_ = std::nullopt)
         : bucket(bucket_),
-          renderTile(renderTile_),
+          tile(tile_),
           state(state_),
-          pixelsToTileUnits(renderTile_.id.pixelsToTileUnits(1, placementZoom)),
+          pixelsToTileUnits(tile_.id.pixelsToTileUnits(1, placementZoom)),
           scale(static_cast<float>(std::pow(2, placementZoom - getOverscaledID().overscaledZ))),
           pixelRatio(static_cast<float>(util::tileSize_D * getOverscaledID().overscaleFactor() / util::EXTENT)),
           collisionGroup(std::move(collisionGroup_)),
+          justReloaded(justReloaded_),
           partiallyEvaluatedTextSize(bucket_.textSizeBinder->evaluateForZoom(placementZoom)),
           partiallyEvaluatedIconSize(bucket_.iconSizeBinder->evaluateForZoom(placementZoom)),
           avoidEdges(std::move(avoidEdges_)) {}
 
     const SymbolBucket& getBucket() const { return bucket.get(); }
     const style::SymbolLayoutProperties::PossiblyEvaluated& getLayout() const { return *getBucket().layout; }
-    const RenderTile& getRenderTile() const { return renderTile.get(); }
+    const PlacementTile& getTile() const { return tile.get(); }
 
-    const OverscaledTileID& getOverscaledID() const { return renderTile.get().getOverscaledTileID(); }
+    const OverscaledTileID& getOverscaledID() const { return tile.get().getOverscaledTileID(); }
 
     const TransformState& getTransformState() const { return state; }
 
@@ -109,14 +125,17 @@ public:
     SymbolPlacementType placementType = getLayout().get<SymbolPlacement>();
 
     mat4 textLabelPlaneMatrix = getLabelPlaneMatrix(
-        renderTile.get().matrix, pitchTextWithMap, rotateTextWithMap, state, pixelsToTileUnits);
+        tile.get().matrix, pitchTextWithMap, rotateTextWithMap, state, pixelsToTileUnits);
     mat4 iconLabelPlaneMatrix =
         (rotateTextWithMap == rotateIconWithMap && pitchTextWithMap == pitchIconWithMap)
             ? textLabelPlaneMatrix
             : getLabelPlaneMatrix(
-                  renderTile.get().matrix, pitchIconWithMap, rotateIconWithMap, state, pixelsToTileUnits);
+                  tile.get().matrix, pitchIconWithMap, rotateIconWithMap, state, pixelsToTileUnits);
 
     CollisionGroups::CollisionGroup collisionGroup;
+    // Taken from the placement data rather than the bucket, whose flags are
+    // written on the render thread while a background placement runs.
+    bool justReloaded;
     ZoomEvaluatedSize partiallyEvaluatedTextSize;
     ZoomEvaluatedSize partiallyEvaluatedIconSize;
 
@@ -150,14 +169,91 @@ public:
 
 // PlacementController implemenation
 
-PlacementController::PlacementController()
-    : placement(makeMutable<Placement>()) {}
+class PlacementController::PendingPlacement {
+public:
+    PendingPlacement(Mutable<Placement> placement_, PlacementSnapshot snapshot_, TimePoint startTime_)
+        : placement(std::move(placement_)),
+          snapshot(std::move(snapshot_)),
+          startTime(startTime_) {}
+
+    // The placement and the snapshot are owned here, so that they are released
+    // on the render thread; the background task only refers to them.
+    Mutable<Placement> placement;
+    const PlacementSnapshot snapshot;
+    const TimePoint startTime;
+    // Set for a background placement only.
+    std::optional<std::future<void>> result;
+    std::size_t frameCount = 0;
+};
+
+PlacementController::PlacementController(std::shared_ptr<Scheduler> scheduler_)
+    : placement(makeMutable<Placement>()),
+      scheduler(std::move(scheduler_)) {}
+
+PlacementController::~PlacementController() {
+    if (pending && pending->result) pending->result->wait();
+}
 
 void PlacementController::setPlacement(Immutable<Placement> placement_) {
     placement = std::move(placement_);
+    lastPlacementFrameCount = 1;
     stale = false;
 }
 
+void PlacementController::setBackgroundPlacement(bool enable, Duration maxStaleness_) {
+    backgroundPlacement = enable;
+    maxStaleness = maxStaleness_;
+}
+
+void PlacementController::startDeferredPlacement(Mutable<Placement> placement_,
+                                                 const RenderLayerReferences& layers,
+                                                 TimePoint now) {
+    assert(!pending);
+    assert(deferredPlacementEnabled());
+    PlacementSnapshot snapshot;
+    snapshot.reserve(layers.size());
+    for (auto it = layers.crbegin(); it != layers.crend(); ++it) {
+        snapshot.push_back(it->get().getPlacementData());
+    }
+    pending = std::make_unique<PendingPlacement>(std::move(placement_), std::move(snapshot), now);
+    if (!backgroundPlacement) return;
+
+    auto task = std::make_shared<std::packaged_task<void()>>(
+        [placement_ = pending->placement.get(), &snapshot_ = pending->snapshot] {
+            placement_->placeSnapshot(snapshot_);
+        });
+    pending->result = task->get_future();
+    if (!scheduler) scheduler = Scheduler::GetBackground();
+    scheduler->schedule([task] { (*task)(); });
+}
+
+bool PlacementController::commitPendingPlacement(TimePoint now) {
+    if (!pending) return false;
+    ++pending->frameCount;
+
+    if (pending->result) {
+        auto& result = *pending->result;
+        const bool complete = result.wait_for(std::chrono::seconds::zero()) == std::future_status::ready;
+        if (!complete && backgroundPlacement && now - pending->startTime < maxStaleness) {
+            return false;
+        }
+        // Rethrows the exception, if any, thrown by the placement.
+        result.get();
+    } else {
+        // Finish at once if incremental placement got disabled meanwhile.
+        const TimePoint deadline = timeBudget ? Clock::now() + *timeBudget : TimePoint::max();
+        if (!pending->placement->placeSnapshot(pending->snapshot, deadline)) {
+            return false;
+        }
+    }
+
+    pending->placement->finishSnapshotPlacement(pending->snapshot);
+    setPlacement(std::move(pending->placement));
+    lastPlacementFrameCount = pending->frameCount;
+    pending.reset();
+    return true;
+}
+
 bool PlacementController::placementIsRecent(TimePoint now,
                                             const float zoom,
                                             std::optional<Duration> periodOverride) const {
@@ -169,6 +265,9 @@ bool PlacementController::placementIsRecent(TimePoint now,
 }
 
 bool PlacementController::hasTransitions(TimePoint now) const {
+    // Keep frames coming, so that the pending placement gets committed.
+    if (pending) return true;
+
     if (!placement->transitionsEnabled()) return false;
 
     if (stale) return true;
@@ -187,7 +286,8 @@ Placement::Placement(std::shared_ptr<const UpdateParameters> updateParameters_,
       placementZoom(static_cast<float>(updateParameters->transformState.getZoom())),
       collisionGroups(updateParameters->crossSourceCollisions),
       prevPlacement(std::move(prevPlacement_)),
-      showCollisionBoxes(updateParameters->debugOptions & MapDebugOptions::Collision) {
+      showCollisionBoxes(updateParameters->debugOptions & MapDebugOptions::Collision),
+      revision(nextPlacementRevision()) {
     if (prevPlacement) {
         prevPlacement->get()->prevPlacement = std::nullopt; // Only hold on to one placement back
     }
@@ -195,22 +295,55 @@ Placement::Placement(std::shared_ptr<const UpdateParameters> updateParameters_,
 
 Placement::Placement()
     : collisionIndex({}, MapMode::Static),
-      collisionGroups(true) {}
+      collisionGroups(true),
+      revision(nextPlacementRevision()) {}
 
 Placement::~Placement() = default;
 
 void Placement::placeLayers(const RenderLayerReferences& layers) {
     for (auto it = layers.crbegin(); it != layers.crend(); ++it) {
         std::set<uint32_t> seenCrossTileIDs;
-        placeLayer(*it, seenCrossTileIDs);
+        placeLayer(it->get().getPlacementData(), seenCrossTileIDs);
     }
     commit();
 }
 
-void Placement::placeLayer(const RenderLayer& layer, std::set<uint32_t>& seenCrossTileIDs) {
-    for (const BucketPlacementData& data : layer.getPlacementData()) {
-        Bucket& bucket = data.bucket;
-        bucket.place(*this, data, seenCrossTileIDs);
+bool Placement::placeSnapshot(const PlacementSnapshot& snapshot, TimePoint deadline) {
+    placingSnapshot = true;
+    for (; snapshotLayerIndex < snapshot.size(); ++snapshotLayerIndex) {
+        const LayerPlacementData& layerData = snapshot[snapshotLayerIndex];
+        auto it = std::next(layerData.begin(), snapshotBucketIndex);
+        while (it != layerData.end()) {
+            it->bucket->place(*this, *it, snapshotSeenCrossTileIDs);
+            ++it;
+            ++snapshotBucketIndex;
+            if (it != layerData.end() && Clock::now() >= deadline) return false;
+        }
+        snapshotBucketIndex = 0;
+        snapshotSeenCrossTileIDs.clear();
+        if (snapshotLayerIndex + 1 < snapshot.size() && Clock::now() >= deadline) {
+            ++snapshotLayerIndex;
+            return false;
+        }
+    }
+    commit();
+    placingSnapshot = false;
+    return true;
+}
+
+void Placement::finishSnapshotPlacement(const PlacementSnapshot& snapshot) const {
+    for (const LayerPlacementData& layerData : snapshot) {
+        for (const BucketPlacementData& data : layerData) {
+            if (data.justReloaded) {
+                static_cast<const SymbolBucket&>(*data.bucket).justReloaded = false;
+            }
+        }
+    }
+}
+
+void Placement::placeLayer(const LayerPlacementData& layerData, std::set<uint32_t>& seenCrossTileIDs) {
+    for (const BucketPlacementData& data : layerData) {
+        data.bucket->place(*this, data, seenCrossTileIDs);
     }
 }
 
@@ -237,26 +370,29 @@ Point<float> calculateVariableLayoutOffset(style::SymbolAnchorType anchor,
 
 void Placement::placeSymbolBucket(const BucketPlacementData& params, std::set<uint32_t>& seenCrossTileIDs) {
     assert(updateParameters);
-    const auto& symbolBucket = static_cast<const SymbolBucket&>(params.bucket.get());
-    const RenderTile& renderTile = params.tile;
+    const auto& symbolBucket = static_cast<const SymbolBucket&>(*params.bucket);
+    const PlacementTile& tile = params.tile;
     PlacementContext ctx{symbolBucket,
                          params.tile,
                          collisionIndex.getTransformState(),
                          placementZoom,
                          collisionGroups.get(params.sourceId),
-                         getAvoidEdges(symbolBucket, renderTile.matrix)};
+                         params.justReloaded,
+                         getAvoidEdges(symbolBucket, tile.matrix)};
     for (const SymbolInstance& symbol : getSortedSymbols(params, ctx.pixelRatio)) {
         if (seenCrossTileIDs.count(symbol.crossTileID) != 0u) continue;
         placeSymbol(symbol, ctx);
 
         // Prevent a flickering issue while zooming out.
-        if (symbol.crossTileID != SymbolInstance::invalidCrossTileID() && !ctx.getRenderTile().holdForFade()) {
+        if (symbol.crossTileID != SymbolInstance::invalidCrossTileID() && !ctx.getTile().holdForFade()) {
             seenCrossTileIDs.insert(symbol.crossTileID);
         }
     }
 
     // Prevent a flickering issue when a symbol is moved.
-    symbolBucket.justReloaded = false;
+    // Buckets are rendered concurrently with a snapshot placement, so in that case the
+    // flag is reset by `finishSnapshotPlacement()` instead.
+    if (!placingSnapshot) symbolBucket.justReloaded = false;
 
     // As long as this placement lives, we have to hold onto this bucket's
     // matching FeatureIndex/data for querying purposes
@@ -270,14 +406,14 @@ JointPlacement Placement::placeSymbol(const SymbolInstance& symbolInstance, cons
     static const JointPlacement kUnplaced(false, false, false);
     if (symbolInstance.crossTileID == SymbolInstance::invalidCrossTileID()) return kUnplaced;
 
-    if (ctx.getRenderTile().holdForFade()) {
+    if (ctx.getTile().holdForFade()) {
         // Mark all symbols from this tile as "not placed", but don't add to
         // seenCrossTileIDs, because we don't know yet if we have a duplicate in
         // a parent tile that _should_ be placed.
         return kUnplaced;
     }
     const SymbolBucket& bucket = ctx.getBucket();
-    const mat4& posMatrix = ctx.getRenderTile().matrix;
+    const mat4& posMatrix = ctx.getTile().matrix;
     const auto& collisionGroup = ctx.collisionGroup;
     auto variableTextAnchors = ctx.getVariableTextAnchors();
     textBoxes.clear();
@@ -622,7 +758,7 @@ JointPlacement Placement::placeSymbol(const SymbolInstance& symbolInstance, cons
     }
 
     JointPlacement result(
-        placeText || ctx.alwaysShowText, placeIcon || ctx.alwaysShowIcon, offscreen || bucket.justReloaded);
+        placeText || ctx.alwaysShowText, placeIcon || ctx.alwaysShowIcon, offscreen || ctx.justReloaded);
     placements.emplace(symbolInstance.crossTileID, result);
     newSymbolPlaced(symbolInstance, ctx, result, ctx.placementType, textBoxes, iconBoxes);
     return result;
@@ -645,7 +781,7 @@ SymbolInstanceReferences getBucketSymbols(const SymbolBucket& bucket,
 } // namespace
 
 SymbolInstanceReferences Placement::getSortedSymbols(const BucketPlacementData& params, float) {
-    const auto& bucket = static_cast<const SymbolBucket&>(params.bucket.get());
+    const auto& bucket = static_cast<const SymbolBucket&>(*params.bucket);
     SymbolInstanceReferences sortedSymbols = getBucketSymbols(
         bucket, params.sortKeyRange, collisionIndex.getTransformState().getBearing());
     auto* previousPlacement = getPrevPlacement();
@@ -731,13 +867,29 @@ void Placement::commit() {
     fadeStartTime = placementChanged ? commitTime : getPrevPlacement()->fadeStartTime;
 }
 
-void Placement::updateLayerBuckets(const RenderLayer& layer, const TransformState& state, bool updateOpacities) const {
-    std::set<uint32_t> seenCrossTileIDs;
-    for (const auto& item : layer.getPlacementData()) {
-        if (!item.sortKeyRange || item.sortKeyRange->isFirstRange()) {
-            item.bucket.get().updateVertices(*this, updateOpacities, state, item.tile, seenCrossTileIDs);
+void Placement::updateLayerBuckets(const RenderLayerReferences& layers,
+                                   const TransformState& state,
+                                   bool updateOpacities,
+                                   Scheduler& helpers) const {
+    std::vector<std::pair<Bucket*, const PlacementTile*>> outdated;
+    std::unordered_set<const Bucket*> seenBuckets;
+    for (auto it = layers.rbegin(); it != layers.rend(); ++it) {
+        std::set<uint32_t> seenCrossTileIDs;
+        for (const auto& item : it->get().getPlacementData()) {
+            if (!item.sortKeyRange || item.sortKeyRange->isFirstRange()) {
+                Bucket& bucket = *item.bucket;
+                // Buckets can be shared by layers, but are reprojected only once.
+                if (bucket.updateVertices(*this, updateOpacities, state, item.tile, seenCrossTileIDs) &&
+                    seenBuckets.insert(&bucket).second) {
+                    outdated.emplace_back(&bucket, &item.tile);
+                }
+            }
         }
     }
+
+    util::runInParallel(helpers, util::renderHelperThreads, outdated.size(), [&](std::size_t i) {
+        outdated[i].first->updateDynamicVertices(*this, state, *outdated[i].second);
+    });
 }
 
 namespace {
@@ -758,7 +910,7 @@ Point<float> calculateVariableRenderShift(style::SymbolAnchorType anchor,
 
 bool Placement::updateBucketDynamicVertices(SymbolBucket& bucket,
                                             const TransformState& state,
-                                            const RenderTile& tile) const {
+                                            const PlacementTile& tile) const {
     using namespace style;
     const auto& layout = *bucket.layout;
     const bool alongLine = layout.get<SymbolPlacement>() != SymbolPlacementType::Point;
@@ -1377,7 +1529,7 @@ void TilePlacement::placeLayers(const RenderLayerReferences& layers) {
     // Populale intersections.
     populateIntersections = true;
     for (auto it = layers.crbegin(); it != layers.crend(); ++it) {
-        placeLayer(*it, seenCrossTileIDs);
+        placeLayer(it->get().getPlacementData(), seenCrossTileIDs);
     }
 
     std::sort(intersections.begin(), intersections.end(), [](const Intersection& a, const Intersection& b) {
@@ -1414,7 +1566,7 @@ void TilePlacement::placeLayers(const RenderLayerReferences& layers) {
     // Place the rest labels.
     populateIntersections = false;
     for (auto it = layers.crbegin(); it != layers.crend(); ++it) {
-        placeLayer(*it, seenCrossTileIDs);
+        placeLayer(it->get().getPlacementData(), seenCrossTileIDs);
     }
     commit();
 }
@@ -1431,7 +1583,7 @@ std::optional<CollisionBoundaries> TilePlacement::getAvoidEdges(const SymbolBuck
 
 void TilePlacement::placeSymbolBucket(const BucketPlacementData& params, std::set<uint32_t>& seen) {
     assert(updateParameters);
-    const auto& bucket = static_cast<const SymbolBucket&>(params.bucket.get());
+    const auto& bucket = static_cast<const SymbolBucket&>(*params.bucket);
     const auto& layout = *bucket.layout;
     if (!populateIntersections) {
         Placement::placeSymbolBucket(params, seen);
@@ -1441,13 +1593,14 @@ void TilePlacement::placeSymbolBucket(const BucketPlacementData& params, std::se
         // Collect intersection only for point placement.
         return;
     }
-    const RenderTile& renderTile = params.tile;
+    const PlacementTile& tile = params.tile;
     PlacementContext ctx{bucket,
                          params.tile,
                          collisionIndex.getTransformState(),
                          placementZoom,
                          collisionGroups.get(params.sourceId),
-                         getAvoidEdges(bucket, renderTile.matrix)};
+                         params.justReloaded,
+                         getAvoidEdges(bucket, tile.matrix)};
 
     const auto& variableTextAnchors = ctx.getVariableTextAnchors();
     // In this case we first try to place symbols, which intersects the tile
@@ -1475,9 +1628,9 @@ void TilePlacement::placeSymbolBucket(const BucketPlacementData& params, std::se
         CollisionBoundaries borders;
     };
 
-    uint8_t z = renderTile.id.canonical.z;
-    uint32_t x = renderTile.id.canonical.x;
-    uint32_t y = renderTile.id.canonical.y;
+    uint8_t z = tile.id.canonical.z;
+    uint32_t x = tile.id.canonical.x;
+    uint32_t y = tile.id.canonical.y;
     const std::array<NeighborTileData, 4> neighbours{{
         {collisionIndex, UnwrappedTileID(z, x, y - 1), {0.0f, util::EXTENT}},  // top
         {collisionIndex, UnwrappedTileID(z, x, y + 1), {0.0f, -util::EXTENT}}, // bottom
@@ -1488,7 +1641,7 @@ void TilePlacement::placeSymbolBucket(const BucketPlacementData& params, std::se
     auto collisionBoxIntersectsTileEdges = [&](const CollisionBox& collisionBox,
                                                Point<float> shift) noexcept -> IntersectStatus {
         IntersectStatus intersects = collisionIndex.intersectsTileEdges(
-            collisionBox, shift, renderTile.matrix, ctx.pixelRatio, *tileBorders);
+            collisionBox, shift, tile.matrix, ctx.pixelRatio, *tileBorders);
         // Check if this symbol intersects the neighbor tile borders. If so, it
         // also shall be placed with priority.
         for (const auto& neighbor : neighbours) {
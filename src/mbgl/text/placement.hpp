@@ -1,6 +1,7 @@
 #pragma once
 
 #include <mbgl/layout/symbol_projection.hpp>
+#include <mbgl/renderer/render_layer.hpp>
 #include <mbgl/renderer/renderer.hpp>
 #include <mbgl/style/transition_options.hpp>
 #include <mbgl/text/collision_index.hpp>
@@ -11,6 +12,7 @@
 
 namespace mbgl {
 
+class Scheduler;
 class SymbolBucket;
 class SymbolInstance;
 using SymbolInstanceReferences = std::vector<std::reference_wrapper<const SymbolInstance>>;
@@ -92,19 +94,55 @@ private:
     bool crossSourceCollisions;
 };
 
+// Copies of the placement data of the layers to be placed, in placement order.
+// The copies keep their buckets alive, so a snapshot can be placed after the
+// frame it was taken in.
+using PlacementSnapshot = std::vector<LayerPlacementData>;
+
 class Placement;
 class PlacementContext;
 class PlacementController {
 public:
-    PlacementController();
+    // Background placements run on `scheduler`, by default the shared
+    // background scheduler.
+    explicit PlacementController(std::shared_ptr<Scheduler> scheduler = nullptr);
+    ~PlacementController();
     void setPlacement(Immutable<Placement>);
     const Immutable<Placement>& getPlacement() const { return placement; }
     void setPlacementStale() { stale = true; }
     bool placementIsRecent(TimePoint now, float zoom, std::optional<Duration> periodOverride = std::nullopt) const;
     bool hasTransitions(TimePoint now) const;
 
+    // Background placement: a new placement is computed on a background thread
+    // while the current one stays in use. `maxStaleness` bounds how long the
+    // render thread keeps going without the new placement before it waits for it.
+    void setBackgroundPlacement(bool enable, Duration maxStaleness);
+    // Incremental placement: a new placement is computed on the render thread in
+    // slices of at most `budget` per frame, while the current one stays in use.
+    void setPlacementTimeBudget(std::optional<Duration> budget) { timeBudget = budget; }
+    // Returns true if new placements are not computed within a single frame.
+    bool deferredPlacementEnabled() const { return backgroundPlacement || timeBudget; }
+    // Starts placing the given layers into `placement`, either on a background
+    // thread or incrementally, depending on the configuration.
+    void startDeferredPlacement(Mutable<Placement> placement, const RenderLayerReferences&, TimePoint now);
+    bool hasPendingPlacement() const { return bool(pending); }
+    // Advances the pending placement and commits it once it is complete. A
+    // background placement older than the maximum staleness is waited for.
+    // Returns true if a placement got committed.
+    bool commitPendingPlacement(TimePoint now);
+    // Returns the number of frames the last committed placement took.
+    std::size_t getLastPlacementFrameCount() const { return lastPlacementFrameCount; }
+
 private:
+    class PendingPlacement;
+
     Immutable<Placement> placement;
+    std::unique_ptr<PendingPlacement> pending;
+    std::shared_ptr<Scheduler> scheduler;
+    Duration maxStaleness = Duration::zero();
+    std::optional<Duration> timeBudget;
+    std::size_t lastPlacementFrameCount = 0;
+    bool backgroundPlacement = false;
     bool stale = false;
 };
 
@@ -122,7 +160,20 @@ public:
 
     virtual ~Placement();
     virtual void placeLayers(const RenderLayerReferences&);
-    void updateLayerBuckets(const RenderLayer&, const TransformState&, bool updateOpacities) const;
+    // Places the given snapshot. Unlike `placeLayers()`, it does not modify the
+    // buckets, so it can run concurrently with the rendering of the buckets;
+    // `finishSnapshotPlacement()` must be called on the render thread afterwards.
+    // Stops after the first bucket placed past `deadline`, and continues from
+    // there when called again. Returns true once the placement is complete.
+    bool placeSnapshot(const PlacementSnapshot&, TimePoint deadline = TimePoint::max());
+    void finishSnapshotPlacement(const PlacementSnapshot&) const;
+    // Updates the opacities and dynamic vertices of the buckets of the given layers.
+    // Buckets whose dynamic vertices are outdated are reprojected in parallel, on
+    // the calling thread and on `helpers`.
+    void updateLayerBuckets(const RenderLayerReferences&,
+                            const TransformState&,
+                            bool updateOpacities,
+                            Scheduler& helpers) const;
     virtual float symbolFadeChange(TimePoint now) const;
     virtual bool hasTransitions(TimePoint now) const;
     virtual bool transitionsEnabled() const;
@@ -131,6 +182,8 @@ public:
 
     const CollisionIndex& getCollisionIndex() const;
     TimePoint getCommitTime() const { return commitTime; }
+    // Unique for every placement created in this process.
+    uint64_t getRevision() const { return revision; }
     Duration getUpdatePeriod(float zoom) const;
 
     float zoomAdjustment(float zoom) const;
@@ -146,7 +199,7 @@ protected:
     friend SymbolBucket;
     virtual void placeSymbolBucket(const BucketPlacementData&, std::set<uint32_t>& seenCrossTileIDs);
     JointPlacement placeSymbol(const SymbolInstance& symbolInstance, const PlacementContext&);
-    void placeLayer(const RenderLayer&, std::set<uint32_t>&);
+    void placeLayer(const LayerPlacementData&, std::set<uint32_t>&);
     virtual void commit();
     virtual void newSymbolPlaced(const SymbolInstance&,
                                  const PlacementContext&,
@@ -171,7 +224,7 @@ protected:
     }
 
     // Returns `true` if bucket vertices were updated; returns `false` otherwise.
-    bool updateBucketDynamicVertices(SymbolBucket&, const TransformState&, const RenderTile& tile) const;
+    bool updateBucketDynamicVertices(SymbolBucket&, const TransformState&, const PlacementTile& tile) const;
     void updateBucketOpacities(SymbolBucket&, const TransformState&, std::set<uint32_t>&) const;
     void markUsedJustification(SymbolBucket&,
                                style::TextVariableAnchorType,
@@ -200,6 +253,13 @@ protected:
     CollisionGroups collisionGroups;
     mutable std::optional<Immutable<Placement>> prevPlacement;
     bool showCollisionBoxes = false;
+    bool placingSnapshot = false;
+    const uint64_t revision;
+
+    // Position of an incremental snapshot placement.
+    std::size_t snapshotLayerIndex = 0;
+    std::size_t snapshotBucketIndex = 0;
+    std::set<uint32_t> snapshotSeenCrossTileIDs;
 
     // Cache being used by placeSymbol()
     std::vector<ProjectedCollisionBox> textBoxes;
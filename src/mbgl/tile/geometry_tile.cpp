@@ -260,7 +260,7 @@ void GeometryTile::onGlyphsAvailable(GlyphMap glyphs) {
 
 void GeometryTile::getGlyphs(GlyphDependencies glyphDependencies) {
     if (fileSource) {
-        glyphManager.getGlyphs(*this, std::move(glyphDependencies), *fileSource);
+        glyphManager.getGlyphs(*this, std::move(glyphDependencies), fileSource);
     }
 }
 
@@ -47,10 +47,10 @@ void RasterDEMTile::setMetadata(std::optional<Timestamp> modified_, std::optiona
     expires = std::move(expires_);
 }
 
-void RasterDEMTile::setData(const std::shared_ptr<const std::string>& data) {
+void RasterDEMTile::setData(const std::shared_ptr<const std::string>& data, bool compressed) {
     pending = true;
     ++correlationID;
-    worker.self().invoke(&RasterDEMTileWorker::parse, data, correlationID, encoding);
+    worker.self().invoke(&RasterDEMTileWorker::parse, data, compressed, correlationID, encoding);
 }
 
 void RasterDEMTile::onParsed(std::unique_ptr<HillshadeBucket> result, const uint64_t resultCorrelationID) {
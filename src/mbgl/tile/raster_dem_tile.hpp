@@ -70,7 +70,7 @@ public:
 
     void setError(std::exception_ptr);
     void setMetadata(std::optional<Timestamp> modified, std::optional<Timestamp> expires);
-    void setData(const std::shared_ptr<const std::string>& data);
+    void setData(const std::shared_ptr<const std::string>& data, bool compressed = false);
 
     bool layerPropertiesUpdated(const Immutable<style::LayerProperties>& layerProperties) override;
 
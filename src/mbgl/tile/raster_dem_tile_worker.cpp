@@ -2,6 +2,7 @@
 #include <mbgl/tile/raster_dem_tile.hpp>
 #include <mbgl/renderer/buckets/hillshade_bucket.hpp>
 #include <mbgl/actor/actor.hpp>
+#include <mbgl/util/compression.hpp>
 #include <mbgl/util/premultiply.hpp>
 
 namespace mbgl {
@@ -10,6 +11,7 @@ RasterDEMTileWorker::RasterDEMTileWorker(const ActorRef<RasterDEMTileWorker>&, A
     : parent(std::move(parent_)) {}
 
 void RasterDEMTileWorker::parse(const std::shared_ptr<const std::string>& data,
+                                bool compressed,
                                 uint64_t correlationID,
                                 Tileset::DEMEncoding encoding) {
     if (!data) {
@@ -19,7 +21,8 @@ void RasterDEMTileWorker::parse(const std::shared_ptr<const std::string>& data,
     }
 
     try {
-        auto bucket = std::make_unique<HillshadeBucket>(decodeImage(*data), encoding);
+        auto bucket = std::make_unique<HillshadeBucket>(decodeImage(compressed ? util::decompress(*data) : *data),
+                                                        encoding);
         parent.invoke(&RasterDEMTile::onParsed, std::move(bucket), correlationID);
     } catch (...) {
         parent.invoke(&RasterDEMTile::onError, std::current_exception(), correlationID);
@@ -14,7 +14,10 @@ class RasterDEMTileWorker {
 public:
     RasterDEMTileWorker(const ActorRef<RasterDEMTileWorker>&, ActorRef<RasterDEMTile>);
 
-    void parse(const std::shared_ptr<const std::string>& data, uint64_t correlationID, Tileset::DEMEncoding encoding);
+    void parse(const std::shared_ptr<const std::string>& data,
+               bool compressed,
+               uint64_t correlationID,
+               Tileset::DEMEncoding encoding);
 
 private:
     ActorRef<RasterDEMTile> parent;
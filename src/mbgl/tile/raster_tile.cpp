@@ -36,10 +36,10 @@ void RasterTile::setMetadata(std::optional<Timestamp> modified_, std::optional<T
     expires = std::move(expires_);
 }
 
-void RasterTile::setData(const std::shared_ptr<const std::string>& data) {
+void RasterTile::setData(const std::shared_ptr<const std::string>& data, bool compressed) {
     pending = true;
     ++correlationID;
-    worker.self().invoke(&RasterTileWorker::parse, data, correlationID);
+    worker.self().invoke(&RasterTileWorker::parse, data, compressed, correlationID);
 }
 
 void RasterTile::onParsed(std::unique_ptr<RasterBucket> result, const uint64_t resultCorrelationID) {
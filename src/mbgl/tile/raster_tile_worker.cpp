@@ -2,6 +2,7 @@
 #include <mbgl/tile/raster_tile.hpp>
 #include <mbgl/renderer/buckets/raster_bucket.hpp>
 #include <mbgl/actor/actor.hpp>
+#include <mbgl/util/compression.hpp>
 #include <mbgl/util/premultiply.hpp>
 
 namespace mbgl {
@@ -9,7 +10,7 @@ namespace mbgl {
 RasterTileWorker::RasterTileWorker(const ActorRef<RasterTileWorker>&, ActorRef<RasterTile> parent_)
     : parent(std::move(parent_)) {}
 
-void RasterTileWorker::parse(const std::shared_ptr<const std::string>& data, uint64_t correlationID) {
+void RasterTileWorker::parse(const std::shared_ptr<const std::string>& data, bool compressed, uint64_t correlationID) {
     if (!data) {
         parent.invoke(&RasterTile::onParsed, nullptr,
                       correlationID); // No data; empty tile.
@@ -17,7 +18,7 @@ void RasterTileWorker::parse(const std::shared_ptr<const std::string>& data, uin
     }
 
     try {
-        auto bucket = std::make_unique<RasterBucket>(decodeImage(*data));
+        auto bucket = std::make_unique<RasterBucket>(decodeImage(compressed ? util::decompress(*data) : *data));
         parent.invoke(&RasterTile::onParsed, std::move(bucket), correlationID);
     } catch (...) {
         parent.invoke(&RasterTile::onError, std::current_exception(), correlationID);
@@ -13,7 +13,7 @@ class RasterTileWorker {
 public:
     RasterTileWorker(const ActorRef<RasterTileWorker>&, ActorRef<RasterTile>);
 
-    void parse(const std::shared_ptr<const std::string>& data, uint64_t correlationID);
+    void parse(const std::shared_ptr<const std::string>& data, bool compressed, uint64_t correlationID);
 
 private:
     ActorRef<RasterTile> parent;
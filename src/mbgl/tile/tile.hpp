@@ -37,10 +37,13 @@ class UploadPass;
 struct TileUpdateParameters {
     Duration minimumUpdateInterval;
     bool isVolatile;
+    Resource::Priority priority = Resource::Priority::Regular;
+    uint32_t priorityOrder = 0;
 };
 
 inline bool operator==(const TileUpdateParameters& a, const TileUpdateParameters& b) {
-    return a.minimumUpdateInterval == b.minimumUpdateInterval && a.isVolatile == b.isVolatile;
+    return a.minimumUpdateInterval == b.minimumUpdateInterval && a.isVolatile == b.isVolatile &&
+           a.priority == b.priority && a.priorityOrder == b.priorityOrder;
 }
 
 inline bool operator!=(const TileUpdateParameters& a, const TileUpdateParameters& b) {
@@ -30,6 +30,8 @@ TileLoader<T>::TileLoader(T& tile_,
                               Resource::LoadingMethod::CacheOnly)),
       fileSource(parameters.fileSource) {
     assert(!request);
+    // Tiles decompress their data on the worker that parses it.
+    resource.acceptsCompressedData = true;
     if (!fileSource) {
         tile.setError(getCantLoadTileError());
         return;
@@ -72,11 +74,20 @@ void TileLoader<T>::setNecessity(TileNecessity newNecessity) {
 template <typename T>
 void TileLoader<T>::setUpdateParameters(const TileUpdateParameters& params) {
     if (updateParameters != params) {
+        const bool priorityChangedOnly = params.minimumUpdateInterval == updateParameters.minimumUpdateInterval &&
+                                         params.isVolatile == updateParameters.isVolatile;
         updateParameters = params;
         if (hasPendingNetworkRequest()) {
-            // Update the pending request.
-            request.reset();
-            loadFromNetwork();
+            if (priorityChangedOnly) {
+                // Move the pending request in the queue without restarting it.
+                resource.priority = updateParameters.priority;
+                resource.priorityOrder = updateParameters.priorityOrder;
+                fileSource->updatePriority(*request, resource);
+            } else {
+                // Update the pending request.
+                request.reset();
+                loadFromNetwork();
+            }
         }
     }
 }
@@ -106,6 +117,7 @@ void TileLoader<T>::loadFromCache() {
             resource.priorExpires = res.expires;
             resource.priorEtag = res.etag;
             resource.priorData = res.data;
+            resource.priorDataCompressed = res.compressed;
         } else {
             loadedData(res);
         }
@@ -146,7 +158,7 @@ void TileLoader<T>::loadedData(const Response& res) {
         resource.priorExpires = res.expires;
         resource.priorEtag = res.etag;
         tile.setMetadata(res.modified, res.expires);
-        tile.setData(res.noContent ? nullptr : res.data);
+        tile.setData(res.noContent ? nullptr : res.data, res.compressed);
     }
 }
 
@@ -164,6 +176,8 @@ void TileLoader<T>::loadFromNetwork() {
     resource.minimumUpdateInterval = updateParameters.minimumUpdateInterval;
     resource.storagePolicy = updateParameters.isVolatile ? Resource::StoragePolicy::Volatile
                                                          : Resource::StoragePolicy::Permanent;
+    resource.priority = updateParameters.priority;
+    resource.priorityOrder = updateParameters.priorityOrder;
     request = fileSource->request(resource, [this](const Response& res) { loadedData(res); });
 }
 
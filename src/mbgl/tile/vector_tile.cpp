@@ -26,8 +26,8 @@ void VectorTile::setMetadata(std::optional<Timestamp> modified_, std::optional<T
     expires = std::move(expires_);
 }
 
-void VectorTile::setData(const std::shared_ptr<const std::string>& data_) {
-    GeometryTile::setData(data_ ? std::make_unique<VectorTileData>(data_) : nullptr);
+void VectorTile::setData(const std::shared_ptr<const std::string>& data_, bool compressed) {
+    GeometryTile::setData(data_ ? std::make_unique<VectorTileData>(data_, compressed) : nullptr);
 }
 
 } // namespace mbgl
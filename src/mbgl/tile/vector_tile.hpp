@@ -15,7 +15,7 @@ public:
     void setNecessity(TileNecessity) final;
     void setUpdateParameters(const TileUpdateParameters&) final;
     void setMetadata(std::optional<Timestamp> modified, std::optional<Timestamp> expires);
-    void setData(const std::shared_ptr<const std::string>& data);
+    void setData(const std::shared_ptr<const std::string>& data, bool compressed = false);
 
 private:
     TileLoader<VectorTile> loader;
@@ -1,4 +1,5 @@
 #include <mbgl/tile/vector_tile_data.hpp>
+#include <mbgl/util/compression.hpp>
 #include <mbgl/util/constants.hpp>
 #include <mbgl/util/logging.hpp>
 
@@ -70,11 +71,20 @@ std::string VectorTileLayer::getName() const {
     return layer.getName();
 }
 
-VectorTileData::VectorTileData(std::shared_ptr<const std::string> data_)
-    : data(std::move(data_)) {}
+VectorTileData::VectorTileData(std::shared_ptr<const std::string> data_, bool compressed_)
+    : data(std::move(data_)),
+      compressed(compressed_) {}
 
 std::unique_ptr<GeometryTileData> VectorTileData::clone() const {
-    return std::make_unique<VectorTileData>(data);
+    return std::make_unique<VectorTileData>(data, compressed);
+}
+
+const std::shared_ptr<const std::string>& VectorTileData::getData() const {
+    if (compressed) {
+        data = std::make_shared<const std::string>(util::decompress(*data));
+        compressed = false;
+    }
+    return data;
 }
 
 std::unique_ptr<GeometryTileLayer> VectorTileData::getLayer(const std::string& name) const {
@@ -82,7 +92,7 @@ std::unique_ptr<GeometryTileLayer> VectorTileData::getLayer(const std::string& n
         // We're parsing this lazily so that we can construct VectorTileData
         // objects on the main thread without incurring the overhead of parsing
         // immediately.
-        layers = mapbox::vector_tile::buffer(*data).getLayers();
+        layers = mapbox::vector_tile::buffer(*getData()).getLayers();
         parsed = true;
     }
 
@@ -94,7 +104,7 @@ std::unique_ptr<GeometryTileLayer> VectorTileData::getLayer(const std::string& n
 }
 
 std::vector<std::string> VectorTileData::layerNames() const {
-    return mapbox::vector_tile::buffer(*data).layerNames();
+    return mapbox::vector_tile::buffer(*getData()).layerNames();
 }
 
 } // namespace mbgl
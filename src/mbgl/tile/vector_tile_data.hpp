@@ -51,7 +51,8 @@ private:
 
 class VectorTileData : public GeometryTileData {
 public:
-    VectorTileData(std::shared_ptr<const std::string> data);
+    // `compressed` data is decompressed when the tile is first parsed.
+    VectorTileData(std::shared_ptr<const std::string> data, bool compressed = false);
 
     std::unique_ptr<GeometryTileData> clone() const override;
     std::unique_ptr<GeometryTileLayer> getLayer(const std::string& name) const override;
@@ -59,7 +60,10 @@ public:
     std::vector<std::string> layerNames() const;
 
 private:
-    std::shared_ptr<const std::string> data;
+    const std::shared_ptr<const std::string>& getData() const;
+
+    mutable std::shared_ptr<const std::string> data;
+    mutable bool compressed;
     mutable bool parsed = false;
     mutable std::map<std::string, const protozero::data_view> layers;
 };
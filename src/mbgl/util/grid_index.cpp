@@ -2,7 +2,7 @@
 #include <mbgl/geometry/feature_index.hpp>
 #include <mbgl/math/minmax.hpp>
 
-#include <unordered_set>
+#include <cassert>
 #include <cmath>
 
 namespace mbgl {
@@ -17,52 +17,84 @@ GridIndex<T>::GridIndex(const float width_, const float height_, const uint32_t
       yScale(yCellCount / height) {
     assert(width > 0.0f);
     assert(height > 0.0f);
-    boxCells.resize(xCellCount * yCellCount);
-    circleCells.resize(xCellCount * yCellCount);
+    boxCells.head.resize(xCellCount * yCellCount, npos);
+    boxCells.tail.resize(xCellCount * yCellCount, npos);
+    circleCells.head.resize(xCellCount * yCellCount, npos);
+    circleCells.tail.resize(xCellCount * yCellCount, npos);
+}
+
+template <class T>
+void GridIndex<T>::CellChains::append(const std::size_t cellIndex, const uint32_t uid) {
+    const auto entry = static_cast<uint32_t>(element.size());
+    element.push_back(uid);
+    next.push_back(npos);
+    // Append at the tail so that every cell keeps insertion order.
+    if (tail[cellIndex] == npos) {
+        head[cellIndex] = entry;
+    } else {
+        next[tail[cellIndex]] = entry;
+    }
+    tail[cellIndex] = entry;
 }
 
 template <class T>
 void GridIndex<T>::insert(T&& t, const BBox& bbox) {
-    size_t uid = boxElements.size();
+    const auto uid = static_cast<uint32_t>(boxes.size());
 
     auto cx1 = convertToXCellCoord(bbox.min.x);
     auto cy1 = convertToYCellCoord(bbox.min.y);
     auto cx2 = convertToXCellCoord(bbox.max.x);
     auto cy2 = convertToYCellCoord(bbox.max.y);
 
-    std::size_t x;
-    std::size_t y;
-    std::size_t cellIndex;
-    for (x = cx1; x <= cx2; ++x) {
-        for (y = cy1; y <= cy2; ++y) {
-            cellIndex = xCellCount * y + x;
-            boxCells[cellIndex].push_back(uid);
+    for (std::size_t x = cx1; x <= cx2; ++x) {
+        for (std::size_t y = cy1; y <= cy2; ++y) {
+            boxCells.append(xCellCount * y + x, uid);
         }
     }
 
-    boxElements.emplace_back(t, bbox);
+    boxKeys.push_back(static_cast<uint32_t>(keys.size()));
+    boxes.push_back(bbox);
+    keys.emplace_back(std::move(t));
 }
 
 template <class T>
-void GridIndex<T>::insert(T&& t, const BCircle& bcircle) {
-    size_t uid = circleElements.size();
+void GridIndex<T>::insertCircle(const uint32_t key, const BCircle& bcircle) {
+    const auto uid = static_cast<uint32_t>(circles.size());
 
     auto cx1 = convertToXCellCoord(bcircle.center.x - bcircle.radius);
     auto cy1 = convertToYCellCoord(bcircle.center.y - bcircle.radius);
     auto cx2 = convertToXCellCoord(bcircle.center.x + bcircle.radius);
     auto cy2 = convertToYCellCoord(bcircle.center.y + bcircle.radius);
 
-    std::size_t x;
-    std::size_t y;
-    std::size_t cellIndex;
-    for (x = cx1; x <= cx2; ++x) {
-        for (y = cy1; y <= cy2; ++y) {
-            cellIndex = xCellCount * y + x;
-            circleCells[cellIndex].push_back(uid);
+    for (std::size_t x = cx1; x <= cx2; ++x) {
+        for (std::size_t y = cy1; y <= cy2; ++y) {
+            circleCells.append(xCellCount * y + x, uid);
         }
     }
 
-    circleElements.emplace_back(t, bcircle);
+    circleKeys.push_back(key);
+    circles.push_back(bcircle);
+}
+
+template <class T>
+void GridIndex<T>::insert(T&& t, const BCircle& bcircle) {
+    insertCircle(static_cast<uint32_t>(keys.size()), bcircle);
+    keys.emplace_back(std::move(t));
+}
+
+template <class T>
+void GridIndex<T>::insert(T&& t, const std::vector<BCircle>& bcircles) {
+    if (bcircles.empty()) {
+        return;
+    }
+
+    const auto key = static_cast<uint32_t>(keys.size());
+    circleKeys.reserve(circleKeys.size() + bcircles.size());
+    circles.reserve(circles.size() + bcircles.size());
+    for (const auto& bcircle : bcircles) {
+        insertCircle(key, bcircle);
+    }
+    keys.emplace_back(std::move(t));
 }
 
 template <class T>
@@ -86,31 +118,13 @@ std::vector<std::pair<T, typename GridIndex<T>::BBox>> GridIndex<T>::queryWithBo
 }
 
 template <class T>
-bool GridIndex<T>::hitTest(const BBox& queryBBox, std::optional<std::function<bool(const T&)>> predicate) const {
-    bool hit = false;
-    query(queryBBox, [&](const T& t, const BBox&) -> bool {
-        if (!predicate || (*predicate)(t)) {
-            hit = true;
-            return true;
-        } else {
-            return false;
-        }
-    });
-    return hit;
+bool GridIndex<T>::hitTest(const BBox& queryBBox) const {
+    return hitTest(queryBBox, [](const T&) { return true; });
 }
 
 template <class T>
-bool GridIndex<T>::hitTest(const BCircle& queryBCircle, std::optional<std::function<bool(const T&)>> predicate) const {
-    bool hit = false;
-    query(queryBCircle, [&](const T& t, const BBox&) -> bool {
-        if (!predicate || (*predicate)(t)) {
-            hit = true;
-            return true;
-        } else {
-            return false;
-        }
-    });
-    return hit;
+bool GridIndex<T>::hitTest(const BCircle& queryBCircle) const {
+    return hitTest(queryBCircle, [](const T&) { return true; });
 }
 
 template <class T>
@@ -124,141 +138,11 @@ bool GridIndex<T>::completeIntersection(const BBox& queryBBox) const {
 }
 
 template <class T>
-typename GridIndex<T>::BBox GridIndex<T>::convertToBox(const BCircle& circle) const {
+typename GridIndex<T>::BBox GridIndex<T>::convertToBox(const BCircle& circle) {
     return BBox{{circle.center.x - circle.radius, circle.center.y - circle.radius},
                 {circle.center.x + circle.radius, circle.center.y + circle.radius}};
 }
 
-template <class T>
-void GridIndex<T>::query(const BBox& queryBBox, std::function<bool(const T&, const BBox&)> resultFn) const {
-    std::unordered_set<size_t> seenBoxes;
-    std::unordered_set<size_t> seenCircles;
-
-    if (noIntersection(queryBBox)) {
-        return;
-    } else if (completeIntersection(queryBBox)) {
-        for (auto& element : boxElements) {
-            if (resultFn(element.first, element.second)) {
-                return;
-            }
-        }
-        for (auto& element : circleElements) {
-            if (resultFn(element.first, convertToBox(element.second))) {
-                return;
-            }
-        }
-        return;
-    }
-
-    auto cx1 = convertToXCellCoord(queryBBox.min.x);
-    auto cy1 = convertToYCellCoord(queryBBox.min.y);
-    auto cx2 = convertToXCellCoord(queryBBox.max.x);
-    auto cy2 = convertToYCellCoord(queryBBox.max.y);
-
-    std::size_t x;
-    std::size_t y;
-    std::size_t cellIndex;
-    for (x = cx1; x <= cx2; ++x) {
-        for (y = cy1; y <= cy2; ++y) {
-            cellIndex = xCellCount * y + x;
-            // Look up other boxes
-            for (auto uid : boxCells[cellIndex]) {
-                if (seenBoxes.count(uid) == 0) {
-                    seenBoxes.insert(uid);
-
-                    auto& pair = boxElements.at(uid);
-                    auto& bbox = pair.second;
-                    if (boxesCollide(queryBBox, bbox)) {
-                        if (resultFn(pair.first, bbox)) {
-                            return;
-                        }
-                    }
-                }
-            }
-
-            // Look up circles
-            for (auto uid : circleCells[cellIndex]) {
-                if (seenCircles.count(uid) == 0) {
-                    seenCircles.insert(uid);
-
-                    auto& pair = circleElements.at(uid);
-                    auto& bcircle = pair.second;
-                    if (circleAndBoxCollide(bcircle, queryBBox)) {
-                        if (resultFn(pair.first, convertToBox(bcircle))) {
-                            return;
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
-template <class T>
-void GridIndex<T>::query(const BCircle& queryBCircle, std::function<bool(const T&, const BBox&)> resultFn) const {
-    std::unordered_set<size_t> seenBoxes;
-    std::unordered_set<size_t> seenCircles;
-
-    BBox queryBBox = convertToBox(queryBCircle);
-    if (noIntersection(queryBBox)) {
-        return;
-    } else if (completeIntersection(queryBBox)) {
-        for (auto& element : boxElements) {
-            if (resultFn(element.first, element.second)) {
-                return;
-            }
-        }
-        for (auto& element : circleElements) {
-            if (resultFn(element.first, convertToBox(element.second))) {
-                return;
-            }
-        }
-    }
-
-    auto cx1 = convertToXCellCoord(queryBCircle.center.x - queryBCircle.radius);
-    auto cy1 = convertToYCellCoord(queryBCircle.center.y - queryBCircle.radius);
-    auto cx2 = convertToXCellCoord(queryBCircle.center.x + queryBCircle.radius);
-    auto cy2 = convertToYCellCoord(queryBCircle.center.y + queryBCircle.radius);
-
-    std::size_t x;
-    std::size_t y;
-    std::size_t cellIndex;
-    for (x = cx1; x <= cx2; ++x) {
-        for (y = cy1; y <= cy2; ++y) {
-            cellIndex = xCellCount * y + x;
-            // Look up boxes
-            for (auto uid : boxCells[cellIndex]) {
-                if (seenBoxes.count(uid) == 0) {
-                    seenBoxes.insert(uid);
-
-                    auto& pair = boxElements.at(uid);
-                    auto& bbox = pair.second;
-                    if (circleAndBoxCollide(queryBCircle, bbox)) {
-                        if (resultFn(pair.first, bbox)) {
-                            return;
-                        }
-                    }
-                }
-            }
-
-            // Look up other circles
-            for (auto uid : circleCells[cellIndex]) {
-                if (seenCircles.count(uid) == 0) {
-                    seenCircles.insert(uid);
-
-                    auto& pair = circleElements.at(uid);
-                    auto& bcircle = pair.second;
-                    if (circlesCollide(queryBCircle, bcircle)) {
-                        if (resultFn(pair.first, convertToBox(bcircle))) {
-                            return;
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
 template <class T>
 std::size_t GridIndex<T>::convertToXCellCoord(const float x) const {
     return static_cast<size_t>(util::max(0.0, util::min(xCellCount - 1.0, std::floor(x * xScale))));
@@ -270,13 +154,13 @@ std::size_t GridIndex<T>::convertToYCellCoord(const float y) const {
 }
 
 template <class T>
-bool GridIndex<T>::boxesCollide(const BBox& first, const BBox& second) const {
+bool GridIndex<T>::boxesCollide(const BBox& first, const BBox& second) {
     return first.min.x <= second.max.x && first.min.y <= second.max.y && first.max.x >= second.min.x &&
            first.max.y >= second.min.y;
 }
 
 template <class T>
-bool GridIndex<T>::circlesCollide(const BCircle& first, const BCircle& second) const {
+bool GridIndex<T>::circlesCollide(const BCircle& first, const BCircle& second) {
     auto dx = second.center.x - first.center.x;
     auto dy = second.center.y - first.center.y;
     auto bothRadii = first.radius + second.radius;
@@ -284,7 +168,7 @@ bool GridIndex<T>::circlesCollide(const BCircle& first, const BCircle& second) c
 }
 
 template <class T>
-bool GridIndex<T>::circleAndBoxCollide(const BCircle& circle, const BBox& box) const {
+bool GridIndex<T>::circleAndBoxCollide(const BCircle& circle, const BBox& box) {
     auto halfRectWidth = (box.max.x - box.min.x) / 2;
     auto distX = std::abs(circle.center.x - (box.min.x + halfRectWidth));
     if (distX > (halfRectWidth + circle.radius)) {
@@ -308,7 +192,7 @@ bool GridIndex<T>::circleAndBoxCollide(const BCircle& circle, const BBox& box) c
 
 template <class T>
 bool GridIndex<T>::empty() const {
-    return boxElements.empty() && circleElements.empty();
+    return keys.empty();
 }
 
 template class GridIndex<IndexedSubfeature>;
@@ -6,8 +6,8 @@
 #include <cstdint>
 #include <cstddef>
 #include <vector>
-#include <functional>
-#include <optional>
+#include <algorithm>
+#include <limits>
 
 namespace mbgl {
 
@@ -47,6 +47,13 @@ constexpr bool operator!=(circle<T> const& lhs, circle<T> const& rhs) {
  at least one cell. As long as the geometries are relatively
  uniformly distributed across the plane, this greatly reduces
  the number of comparisons necessary.
+
+ Storage is flat: keys, boxes and circles live in contiguous arrays,
+ and every cell is a chain of entries threaded through a single
+ shared entry array, so inserting never allocates per cell and
+ querying never allocates at all. A geometry spanning several cells
+ is reported once, from the first cell of the query range it touches,
+ which removes the need for a "seen" set.
 */
 
 template <class T>
@@ -59,29 +66,59 @@ public:
 
     void insert(T&& t, const BBox&);
     void insert(T&& t, const BCircle&);
+    // Inserts several circles sharing the same key; the key is stored once.
+    void insert(T&& t, const std::vector<BCircle>&);
 
     std::vector<T> query(const BBox&) const;
     std::vector<std::pair<T, BBox>> queryWithBoxes(const BBox&) const;
 
-    bool hitTest(const BBox&, std::optional<std::function<bool(const T&)>> predicate = std::nullopt) const;
-    bool hitTest(const BCircle&, std::optional<std::function<bool(const T&)>> predicate = std::nullopt) const;
+    // Invokes `fn(const T&, const BBox&)` for every geometry intersecting
+    // the query; the query stops as soon as `fn` returns true.
+    template <class Fn>
+    void query(const BBox&, Fn&& fn) const;
+    template <class Fn>
+    void query(const BCircle&, Fn&& fn) const;
+
+    bool hitTest(const BBox&) const;
+    bool hitTest(const BCircle&) const;
+
+    // Like hitTest above, but only geometries whose key satisfies
+    // `pred(const T&)` count as hits.
+    template <class Pred>
+    bool hitTest(const BBox&, Pred&& pred) const;
+    template <class Pred>
+    bool hitTest(const BCircle&, Pred&& pred) const;
 
     bool empty() const;
 
 private:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    // A cell is the head of a chain of entries; each entry names one
+    // geometry and links to the next entry of the same cell.
+    struct CellChains {
+        std::vector<uint32_t> head;
+        std::vector<uint32_t> tail;
+        std::vector<uint32_t> next;
+        std::vector<uint32_t> element;
+
+        void append(std::size_t cellIndex, uint32_t uid);
+    };
+
     bool noIntersection(const BBox& queryBBox) const;
     bool completeIntersection(const BBox& queryBBox) const;
-    BBox convertToBox(const BCircle& circle) const;
+    static BBox convertToBox(const BCircle& circle);
 
-    void query(const BBox&, std::function<bool(const T&, const BBox&)>) const;
-    void query(const BCircle&, std::function<bool(const T&, const BBox&)>) const;
+    template <class Fn>
+    bool queryAll(Fn& fn) const;
+    void insertCircle(uint32_t key, const BCircle&);
 
     std::size_t convertToXCellCoord(float x) const;
     std::size_t convertToYCellCoord(float y) const;
 
-    bool boxesCollide(const BBox&, const BBox&) const;
-    bool circlesCollide(const BCircle&, const BCircle&) const;
-    bool circleAndBoxCollide(const BCircle&, const BBox&) const;
+    static bool boxesCollide(const BBox&, const BBox&);
+    static bool circlesCollide(const BCircle&, const BCircle&);
+    static bool circleAndBoxCollide(const BCircle&, const BBox&);
 
     const float width;
     const float height;
@@ -91,11 +128,143 @@ private:
     const double xScale;
     const double yScale;
 
-    std::vector<std::pair<T, BBox>> boxElements;
-    std::vector<std::pair<T, BCircle>> circleElements;
+    std::vector<T> keys;
+
+    std::vector<BBox> boxes;
+    std::vector<uint32_t> boxKeys;
+    std::vector<BCircle> circles;
+    std::vector<uint32_t> circleKeys;
 
-    std::vector<std::vector<size_t>> boxCells;
-    std::vector<std::vector<size_t>> circleCells;
+    CellChains boxCells;
+    CellChains circleCells;
 };
 
+template <class T>
+template <class Fn>
+bool GridIndex<T>::queryAll(Fn& fn) const {
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+        if (fn(keys[boxKeys[i]], boxes[i])) {
+            return true;
+        }
+    }
+    for (std::size_t i = 0; i < circles.size(); ++i) {
+        if (fn(keys[circleKeys[i]], convertToBox(circles[i]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class T>
+template <class Fn>
+void GridIndex<T>::query(const BBox& queryBBox, Fn&& fn) const {
+    if (noIntersection(queryBBox)) {
+        return;
+    } else if (completeIntersection(queryBBox)) {
+        queryAll(fn);
+        return;
+    }
+
+    const auto cx1 = convertToXCellCoord(queryBBox.min.x);
+    const auto cy1 = convertToYCellCoord(queryBBox.min.y);
+    const auto cx2 = convertToXCellCoord(queryBBox.max.x);
+    const auto cy2 = convertToYCellCoord(queryBBox.max.y);
+
+    for (std::size_t x = cx1; x <= cx2; ++x) {
+        for (std::size_t y = cy1; y <= cy2; ++y) {
+            const std::size_t cellIndex = xCellCount * y + x;
+            // Look up other boxes
+            for (uint32_t entry = boxCells.head[cellIndex]; entry != npos; entry = boxCells.next[entry]) {
+                const uint32_t uid = boxCells.element[entry];
+                const BBox& bbox = boxes[uid];
+                // Only report the box from the first cell it shares with the query.
+                if (x != std::max(cx1, convertToXCellCoord(bbox.min.x)) ||
+                    y != std::max(cy1, convertToYCellCoord(bbox.min.y))) {
+                    continue;
+                }
+                if (boxesCollide(queryBBox, bbox) && fn(keys[boxKeys[uid]], bbox)) {
+                    return;
+                }
+            }
+
+            // Look up circles
+            for (uint32_t entry = circleCells.head[cellIndex]; entry != npos; entry = circleCells.next[entry]) {
+                const uint32_t uid = circleCells.element[entry];
+                const BCircle& bcircle = circles[uid];
+                if (x != std::max(cx1, convertToXCellCoord(bcircle.center.x - bcircle.radius)) ||
+                    y != std::max(cy1, convertToYCellCoord(bcircle.center.y - bcircle.radius))) {
+                    continue;
+                }
+                if (circleAndBoxCollide(bcircle, queryBBox) && fn(keys[circleKeys[uid]], convertToBox(bcircle))) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+template <class T>
+template <class Fn>
+void GridIndex<T>::query(const BCircle& queryBCircle, Fn&& fn) const {
+    const BBox queryBBox = convertToBox(queryBCircle);
+    if (noIntersection(queryBBox)) {
+        return;
+    } else if (completeIntersection(queryBBox)) {
+        queryAll(fn);
+        return;
+    }
+
+    const auto cx1 = convertToXCellCoord(queryBBox.min.x);
+    const auto cy1 = convertToYCellCoord(queryBBox.min.y);
+    const auto cx2 = convertToXCellCoord(queryBBox.max.x);
+    const auto cy2 = convertToYCellCoord(queryBBox.max.y);
+
+    for (std::size_t x = cx1; x <= cx2; ++x) {
+        for (std::size_t y = cy1; y <= cy2; ++y) {
+            const std::size_t cellIndex = xCellCount * y + x;
+            // Look up boxes
+            for (uint32_t entry = boxCells.head[cellIndex]; entry != npos; entry = boxCells.next[entry]) {
+                const uint32_t uid = boxCells.element[entry];
+                const BBox& bbox = boxes[uid];
+                if (x != std::max(cx1, convertToXCellCoord(bbox.min.x)) ||
+                    y != std::max(cy1, convertToYCellCoord(bbox.min.y))) {
+                    continue;
+                }
+                if (circleAndBoxCollide(queryBCircle, bbox) && fn(keys[boxKeys[uid]], bbox)) {
+                    return;
+                }
+            }
+
+            // Look up other circles
+            for (uint32_t entry = circleCells.head[cellIndex]; entry != npos; entry = circleCells.next[entry]) {
+                const uint32_t uid = circleCells.element[entry];
+                const BCircle& bcircle = circles[uid];
+                if (x != std::max(cx1, convertToXCellCoord(bcircle.center.x - bcircle.radius)) ||
+                    y != std::max(cy1, convertToYCellCoord(bcircle.center.y - bcircle.radius))) {
+                    continue;
+                }
+                if (circlesCollide(queryBCircle, bcircle) && fn(keys[circleKeys[uid]], convertToBox(bcircle))) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+template <class T>
+template <class Pred>
+bool GridIndex<T>::hitTest(const BBox& queryBBox, Pred&& pred) const {
+    bool hit = false;
+    query(queryBBox, [&](const T& t, const BBox&) -> bool { return hit = pred(t); });
+    return hit;
+}
+
+template <class T>
+template <class Pred>
+bool GridIndex<T>::hitTest(const BCircle& queryBCircle, Pred&& pred) const {
+    bool hit = false;
+    query(queryBCircle, [&](const T& t, const BBox&) -> bool { return hit = pred(t); });
+    return hit;
+}
+
 } // namespace mbgl
@@ -0,0 +1,48 @@
+#include <mbgl/util/mapped_file.hpp>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <mbgl/util/io.hpp>
+#endif
+
+namespace mbgl {
+namespace util {
+
+MappedFile::MappedFile(const std::string& filename) {
+#if !defined(_WIN32)
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data_ = static_cast<const uint8_t*>(mapped);
+            size_ = static_cast<size_t>(info.st_size);
+        }
+    }
+    ::close(fd);
+#else
+    contents = readFile(filename);
+    if (contents && !contents->empty()) {
+        data_ = reinterpret_cast<const uint8_t*>(contents->data());
+        size_ = contents->size();
+    }
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (data_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+}
+
+} // namespace util
+} // namespace mbgl
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace mbgl {
+namespace util {
+
+// Read-only view of a whole file, mapped into memory where the platform
+// supports it, and read into a buffer elsewhere. data() is null if the file
+// does not exist, is empty or could not be mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    std::optional<std::string> contents;
+#endif
+};
+
+} // namespace util
+} // namespace mbgl
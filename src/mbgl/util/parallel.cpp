@@ -0,0 +1,67 @@
+#include <mbgl/util/parallel.hpp>
+#include <mbgl/util/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace mbgl {
+namespace util {
+
+std::shared_ptr<Scheduler> getRenderHelperScheduler() {
+    static std::weak_ptr<Scheduler> weak;
+    static std::mutex mtx;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    std::shared_ptr<Scheduler> scheduler = weak.lock();
+
+    if (!scheduler) {
+        weak = scheduler = std::make_shared<ParallelScheduler<renderHelperThreads - 1>>();
+    }
+
+    return scheduler;
+}
+
+void runInParallel(Scheduler& scheduler,
+                   std::size_t helpers,
+                   std::size_t count,
+                   const std::function<void(std::size_t)>& fn) {
+    if (count < 2 || helpers == 0) {
+        for (std::size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    // Helper tasks may start after this function has returned, so everything
+    // they touch lives in shared state.
+    struct State {
+        std::atomic<std::size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::size_t done = 0;
+        std::size_t count = 0;
+        std::function<void(std::size_t)> fn;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->fn = fn;
+
+    const auto work = [state] {
+        for (std::size_t i = state->next++; i < state->count; i = state->next++) {
+            state->fn(i);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->done == state->count) state->finished.notify_all();
+        }
+    };
+
+    for (std::size_t i = 0; i < std::min(helpers, count - 1); ++i) {
+        scheduler.schedule(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == state->count; });
+}
+
+} // namespace util
+} // namespace mbgl
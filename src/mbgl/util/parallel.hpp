@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace mbgl {
+
+class Scheduler;
+
+namespace util {
+
+// Number of threads in the scheduler returned by getRenderHelperScheduler().
+constexpr std::size_t renderHelperThreads = 2;
+
+// Returns a scheduler reserved for work the render thread waits for, so that
+// this work never queues up behind tile parsing on the background scheduler.
+std::shared_ptr<Scheduler> getRenderHelperScheduler();
+
+// Runs `fn(i)` for every `i` in [0, count) and returns once every call has
+// finished. The calling thread claims indices itself, and up to `helpers`
+// tasks scheduled on `scheduler` claim indices alongside it. A helper task
+// that starts after every index has been claimed does nothing, so the caller
+// only ever waits for calls that are already running.
+void runInParallel(Scheduler& scheduler,
+                   std::size_t helpers,
+                   std::size_t count,
+                   const std::function<void(std::size_t)>& fn);
+
+} // namespace util
+} // namespace mbgl
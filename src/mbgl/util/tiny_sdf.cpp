@@ -3,23 +3,37 @@
 #include <mbgl/util/math.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace mbgl {
 namespace util {
 
 namespace tinysdf {
 
-static const double INF = 1e20;
+static const float INF = 1e20f;
+
+// Number of columns edtColumns processes together. Grid rows are padded to a
+// multiple of this so that no column needs a scalar remainder loop.
+static const uint32_t columnBlock = 8;
+
+// Beyond this search window, evaluating every parabola in edtColumns does more
+// work than the lower envelope algorithm in edt1d.
+static const uint32_t maxWindow = 16;
 
 // 1D squared distance transform
-void edt1d(
-    std::vector<double>& f, std::vector<double>& d, std::vector<int16_t>& v, std::vector<double>& z, uint32_t n) {
+void edt1d(std::vector<float>& f, std::vector<float>& d, std::vector<int16_t>& v, std::vector<float>& z, uint32_t n) {
     v[0] = 0;
     z[0] = -INF;
     z[1] = +INF;
 
     for (uint32_t q = 1, k = 0; q < n; q++) {
-        double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
         while (s <= z[k]) {
             k--;
             s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
@@ -32,34 +46,103 @@ void edt1d(
 
     for (uint32_t q = 0, k = 0; q < n; q++) {
         while (z[k + 1] < q) k++;
-        d[q] = (static_cast<double>(q) - v[k]) * (static_cast<double>(q) - v[k]) + f[v[k]];
+        const auto dq = static_cast<float>(static_cast<int32_t>(q) - v[k]);
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+// Squared distance transform of every column of a grid with `stride` floats
+// per row, limited to distances of at most `window` rows:
+//
+//   out(x, q) = min over |q - p| <= window of in(x, p) + (q - p)^2
+//
+// Unlike edt1d, this has no data dependent branches, so a block of adjacent
+// columns is processed with one instruction per step.
+void edtColumns(const float* in, float* out, uint32_t stride, uint32_t height, uint32_t window) {
+    for (uint32_t q = 0; q < height; q++) {
+        const uint32_t begin = q > window ? q - window : 0;
+        const uint32_t end = std::min(height, q + window + 1);
+        float* row = out + static_cast<std::size_t>(q) * stride;
+        for (uint32_t x = 0; x < stride; x += columnBlock) {
+#if defined(__SSE2__)
+            // Two independent accumulators hide the latency of the min chain.
+            __m128 a = _mm_set1_ps(INF);
+            __m128 b = _mm_set1_ps(INF);
+            for (uint32_t p = begin; p < end; p++) {
+                const float* source = in + static_cast<std::size_t>(p) * stride + x;
+                const auto offset = static_cast<float>(static_cast<int32_t>(q) - static_cast<int32_t>(p));
+                const __m128 offsetSquared = _mm_set1_ps(offset * offset);
+                a = _mm_min_ps(a, _mm_add_ps(_mm_loadu_ps(source), offsetSquared));
+                b = _mm_min_ps(b, _mm_add_ps(_mm_loadu_ps(source + 4), offsetSquared));
+            }
+            _mm_storeu_ps(row + x, a);
+            _mm_storeu_ps(row + x + 4, b);
+#else
+            std::array<float, columnBlock> block;
+            block.fill(INF);
+            for (uint32_t p = begin; p < end; p++) {
+                const float* source = in + static_cast<std::size_t>(p) * stride + x;
+                const auto offset = static_cast<float>(static_cast<int32_t>(q) - static_cast<int32_t>(p));
+                for (uint32_t i = 0; i < columnBlock; i++) {
+                    block[i] = std::min(block[i], source[i] + offset * offset);
+                }
+            }
+            std::copy(block.begin(), block.end(), row + x);
+#endif
+        }
     }
 }
 
-// 2D Euclidean distance transform by Felzenszwalb & Huttenlocher https://cs.brown.edu/~pff/dt/
-void edt(std::vector<double>& data,
-         uint32_t width,
-         uint32_t height,
-         std::vector<double>& f,
-         std::vector<double>& d,
-         std::vector<int16_t>& v,
-         std::vector<double>& z) {
+// 2D Euclidean distance transform of a grid with `stride` floats per row.
+// Replaces the squared distances in `data` with distances; distances larger
+// than `window` may come out larger than they are. Large windows use the
+// algorithm by Felzenszwalb & Huttenlocher https://cs.brown.edu/~pff/dt/
+void edt(std::vector<float>& data, uint32_t width, uint32_t height, uint32_t stride, uint32_t window) {
+    if (window <= maxWindow) {
+        // Run the column pass a second time on the transposed grid, so that
+        // both passes read adjacent columns from contiguous memory.
+        const uint32_t transposedStride = (height + columnBlock - 1) / columnBlock * columnBlock;
+        std::vector<float> scratch(std::max(static_cast<std::size_t>(height) * stride,
+                                            static_cast<std::size_t>(width) * transposedStride));
+        std::vector<float> transposed(static_cast<std::size_t>(width) * transposedStride, INF);
+
+        edtColumns(data.data(), scratch.data(), stride, height, window);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                transposed[x * transposedStride + y] = scratch[y * stride + x];
+            }
+        }
+        edtColumns(transposed.data(), scratch.data(), transposedStride, width, window);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                data[y * stride + x] = std::sqrt(scratch[x * transposedStride + y]);
+            }
+        }
+        return;
+    }
+
+    const uint32_t maxDimension = std::max(width, height);
+    std::vector<float> f(maxDimension);
+    std::vector<float> d(maxDimension);
+    std::vector<float> z(maxDimension + 1);
+    std::vector<int16_t> v(maxDimension);
+
     for (uint32_t x = 0; x < width; x++) {
         for (uint32_t y = 0; y < height; y++) {
-            f[y] = data[y * width + x];
+            f[y] = data[y * stride + x];
         }
         edt1d(f, d, v, z, height);
         for (uint32_t y = 0; y < height; y++) {
-            data[y * width + x] = d[y];
+            data[y * stride + x] = d[y];
         }
     }
     for (uint32_t y = 0; y < height; y++) {
         for (uint32_t x = 0; x < width; x++) {
-            f[x] = data[y * width + x];
+            f[x] = data[y * stride + x];
         }
         edt1d(f, d, v, z, width);
         for (uint32_t x = 0; x < width; x++) {
-            data[y * width + x] = std::sqrt(d[x]);
+            data[y * stride + x] = std::sqrt(d[x]);
         }
     }
 }
@@ -67,32 +150,58 @@ void edt(std::vector<double>& data,
 } // namespace tinysdf
 
 AlphaImage transformRasterToSDF(const AlphaImage& rasterInput, double radius, double cutoff) {
-    uint32_t size = rasterInput.size.width * rasterInput.size.height;
-    uint32_t maxDimension = std::max(rasterInput.size.width, rasterInput.size.height);
+    const uint32_t width = rasterInput.size.width;
+    const uint32_t height = rasterInput.size.height;
+    const uint32_t stride = (width + tinysdf::columnBlock - 1) / tinysdf::columnBlock * tinysdf::columnBlock;
 
     AlphaImage sdf(rasterInput.size);
 
-    // temporary arrays for the distance transform
-    std::vector<double> gridOuter(size);
-    std::vector<double> gridInner(size);
-    std::vector<double> f(maxDimension);
-    std::vector<double> d(maxDimension);
-    std::vector<double> z(maxDimension + 1);
-    std::vector<int16_t> v(maxDimension);
+    // Squared distances to the glyph edge for each alpha value, outside and
+    // inside the glyph respectively.
+    static const auto squaredDistances = [] {
+        std::array<std::array<float, 2>, 256> result{};
+        for (uint32_t i = 0; i < 256; i++) {
+            double a = static_cast<double>(i) / 255; // alpha value
+            result[i][0] = i == 255 ? 0.0f
+                           : i == 0 ? tinysdf::INF
+                                    : static_cast<float>(std::pow(std::max(0.0, 0.5 - a), 2.0));
+            result[i][1] = i == 255 ? tinysdf::INF
+                           : i == 0 ? 0.0f
+                                    : static_cast<float>(std::pow(std::max(0.0, a - 0.5), 2.0));
+        }
+        return result;
+    }();
+
+    // temporary arrays for the distance transform, with rows padded to stride
+    std::vector<float> gridOuter(static_cast<std::size_t>(height) * stride, tinysdf::INF);
+    std::vector<float> gridInner(static_cast<std::size_t>(height) * stride, tinysdf::INF);
 
-    for (uint32_t i = 0; i < size; i++) {
-        double a = static_cast<double>(rasterInput.data[i]) / 255; // alpha value
-        gridOuter[i] = a == 1.0 ? 0.0 : a == 0.0 ? tinysdf::INF : std::pow(std::max(0.0, 0.5 - a), 2.0);
-        gridInner[i] = a == 1.0 ? tinysdf::INF : a == 0.0 ? 0.0 : std::pow(std::max(0.0, a - 0.5), 2.0);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t alpha = rasterInput.data[y * width + x];
+            gridOuter[y * stride + x] = squaredDistances[alpha][0];
+            gridInner[y * stride + x] = squaredDistances[alpha][1];
+        }
     }
 
-    tinysdf::edt(gridOuter, rasterInput.size.width, rasterInput.size.height, f, d, v, z);
-    tinysdf::edt(gridInner, rasterInput.size.width, rasterInput.size.height, f, d, v, z);
+    // Outside the glyph, the output is 0 once the distance reaches
+    // radius * (1 - cutoff); inside, it is 255 once the distance reaches
+    // radius * cutoff. Larger distances need not be exact.
+    const double saturation = std::max(cutoff, 1.0 - cutoff) * radius;
+    const auto window = static_cast<uint32_t>(
+        std::min<double>(std::ceil(std::max(0.0, saturation)) + 1, std::max(width, height)));
+
+    tinysdf::edt(gridOuter, width, height, stride, window);
+    tinysdf::edt(gridInner, width, height, stride, window);
 
-    for (uint32_t i = 0; i < size; i++) {
-        double distance = gridOuter[i] - gridInner[i];
-        sdf.data[i] = static_cast<uint8_t>(
-            std::max(0l, std::min(255l, ::lround(255.0 - 255.0 * (distance / radius + cutoff)))));
+    const auto scale = static_cast<float>(255.0 / radius);
+    const auto offset = static_cast<float>(255.0 - 255.0 * cutoff);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const float distance = gridOuter[y * stride + x] - gridInner[y * stride + x];
+            const float value = std::clamp(offset - scale * distance, 0.0f, 255.0f);
+            sdf.data[y * width + x] = static_cast<uint8_t>(value + 0.5f);
+        }
     }
 
     return sdf;
@@ -8,9 +8,14 @@
 #include <mbgl/renderer/buckets/raster_bucket.hpp>
 #include <mbgl/renderer/buckets/symbol_bucket.hpp>
 #include <mbgl/renderer/bucket_parameters.hpp>
+#include <mbgl/renderer/render_tile.hpp>
 #include <mbgl/style/layers/symbol_layer_properties.hpp>
 #include <mbgl/gl/context.hpp>
 #include <mbgl/gl/headless_backend.hpp>
+#include <mbgl/map/transform_state.hpp>
+#include <mbgl/text/placement.hpp>
+#include <mbgl/tile/tile.hpp>
+#include <mbgl/util/mat4.hpp>
 
 #include <mbgl/map/mode.hpp>
 
@@ -193,6 +198,77 @@ TEST(Buckets, SymbolBucket) {
     ASSERT_FALSE(bucket.needsUpload());
 }
 
+namespace {
+
+class StubTile : public Tile {
+public:
+    explicit StubTile(const OverscaledTileID& id_)
+        : Tile(Kind::Geometry, id_) {}
+    std::unique_ptr<TileRenderData> createRenderData() override { return nullptr; }
+    bool layerPropertiesUpdated(const Immutable<style::LayerProperties>&) override { return true; }
+};
+
+} // namespace
+
+TEST(Buckets, SymbolBucketDynamicVerticesKey) {
+    using Key = SymbolBucket::DynamicVerticesKey;
+    mat4 matrix;
+    matrix::identity(matrix);
+    const Key key{matrix, 2.0, {512, 512}, 1};
+    EXPECT_TRUE(key == (Key{matrix, 2.0, {512, 512}, 1}));
+    EXPECT_FALSE(key == (Key{matrix, 2.5, {512, 512}, 1}));
+    EXPECT_FALSE(key == (Key{matrix, 2.0, {256, 512}, 1}));
+    EXPECT_FALSE(key == (Key{matrix, 2.0, {512, 512}, 2}));
+    mat4 translated = matrix;
+    translated[12] = 1.0;
+    EXPECT_FALSE(key == (Key{translated, 2.0, {512, 512}, 1}));
+
+    SymbolBucket bucket{makeMutable<style::SymbolLayoutProperties::PossiblyEvaluated>(),
+                        {},
+                        16.0f,
+                        1.0f,
+                        0,
+                        false /*iconsNeedLinear*/,
+                        false /*sortFeaturesByY*/,
+                        "test",
+                        {},
+                        {},
+                        1.0f,
+                        false,
+                        {},
+                        false /*iconsInText*/};
+
+    StubTile tile{OverscaledTileID(0, 0, 0)};
+    RenderTile renderTile{UnwrappedTileID(0, 0, 0), tile};
+    matrix::identity(renderTile.matrix);
+    const PlacementTile placementTile{renderTile};
+
+    TransformState state;
+    state.setSize({512, 512});
+    auto placement = makeMutable<Placement>();
+    std::set<uint32_t> seenIds;
+
+    // Nothing has been projected yet.
+    EXPECT_TRUE(bucket.updateVertices(*placement, false, state, placementTile, seenIds));
+    bucket.updateDynamicVertices(*placement, state, placementTile);
+    EXPECT_FALSE(bucket.updateVertices(*placement, false, state, placementTile, seenIds));
+
+    // Updating the opacities invalidates the projection.
+    EXPECT_TRUE(bucket.updateVertices(*placement, true, state, placementTile, seenIds));
+    bucket.updateDynamicVertices(*placement, state, placementTile);
+    EXPECT_FALSE(bucket.updateVertices(*placement, false, state, placementTile, seenIds));
+
+    // So do a new view and a new placement.
+    state.setSize({256, 256});
+    EXPECT_TRUE(bucket.updateVertices(*placement, false, state, placementTile, seenIds));
+    bucket.updateDynamicVertices(*placement, state, placementTile);
+    EXPECT_FALSE(bucket.updateVertices(*placement, false, state, placementTile, seenIds));
+
+    auto nextPlacement = makeMutable<Placement>();
+    EXPECT_NE(placement->getRevision(), nextPlacement->getRevision());
+    EXPECT_TRUE(bucket.updateVertices(*nextPlacement, false, state, placementTile, seenIds));
+}
+
 TEST(Buckets, RasterBucket) {
     gl::HeadlessBackend backend({512, 256});
     gfx::BackendScope scope{backend};
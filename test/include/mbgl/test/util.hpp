@@ -18,6 +18,16 @@
 #define TEST_IS_SIMULATOR 0
 #endif
 
+// HTTP/2 tests need an h2 server with a trusted certificate that serves the
+// test server's endpoints; see test/CMakeLists.txt.
+#ifndef TEST_HAS_H2_SERVER
+#define TEST_HAS_H2_SERVER 0
+#endif
+
+#ifndef TEST_H2_SERVER
+#define TEST_H2_SERVER "https://localhost:3443"
+#endif
+
 #if !TEST_IS_SIMULATOR && !CI_BUILD
 #define TEST_REQUIRES_ACCURATE_TIMING(name) name
 #else
@@ -36,6 +46,12 @@
 #define TEST_REQUIRES_SERVER(name) DISABLED_##name
 #endif
 
+#if TEST_HAS_H2_SERVER
+#define TEST_REQUIRES_H2_SERVER(name) name
+#else
+#define TEST_REQUIRES_H2_SERVER(name) DISABLED_##name
+#endif
+
 #if !CI_BUILD
 #define TEST_DISABLED_ON_CI(name) name
 #else
@@ -1600,3 +1600,50 @@ TEST(Map, ObserveShaderRegistration) {
     test.frontend.render(test.map);
     EXPECT_EQ(observedRegistry, false);
 }
+
+TEST(Map, BackgroundPlacement) {
+    MapTest<> test{1, MapMode::Continuous};
+    test.frontend.getRenderer()->setBackgroundPlacement(true);
+
+    test.map.getStyle().loadJSON(util::read_file("test/fixtures/api/query_style.json"));
+    test.map.getStyle().addImage(std::make_unique<style::Image>(
+        "test-icon", decodeImage(util::read_file("test/fixtures/sprites/default_marker.png")), 1.0f));
+
+    bool placementChanged = false;
+    test.observer.didFinishRenderingFrameCallback = [&](MapObserver::RenderFrameStatus status) {
+        placementChanged |= status.placementChanged;
+        if (placementChanged && status.mode == MapObserver::RenderMode::Full && !status.needsRepaint) {
+            test.runLoop.stop();
+        }
+    };
+    test.runLoop.run();
+
+    EXPECT_TRUE(placementChanged);
+    auto features = test.frontend.getRenderer()->queryRenderedFeatures(test.map.pixelForLatLng({0, 0}));
+    EXPECT_EQ(4u, features.size());
+}
+
+TEST(Map, IncrementalPlacement) {
+    MapTest<> test{1, MapMode::Continuous};
+    // A zero budget places a single bucket per frame.
+    test.frontend.getRenderer()->setPlacementTimeBudget(Duration::zero());
+
+    test.map.getStyle().loadJSON(util::read_file("test/fixtures/api/query_style.json"));
+    test.map.getStyle().addImage(std::make_unique<style::Image>(
+        "test-icon", decodeImage(util::read_file("test/fixtures/sprites/default_marker.png")), 1.0f));
+
+    bool placementChanged = false;
+    test.observer.didFinishRenderingFrameCallback = [&](MapObserver::RenderFrameStatus status) {
+        placementChanged |= status.placementChanged;
+        if (placementChanged && status.mode == MapObserver::RenderMode::Full && !status.needsRepaint) {
+            test.runLoop.stop();
+        }
+    };
+    test.runLoop.run();
+
+    EXPECT_TRUE(placementChanged);
+    // The style has four symbol layers, each placing at least one bucket.
+    EXPECT_LE(4u, test.frontend.getRenderer()->getLastPlacementFrameCount());
+    auto features = test.frontend.getRenderer()->queryRenderedFeatures(test.map.pixelForLatLng({0, 0}));
+    EXPECT_EQ(4u, features.size());
+}
@@ -537,6 +537,46 @@ TEST(Transform, IsPanning) {
     transform.updateTransitions(transform.getTransitionStart() + transform.getTransitionDuration());
 }
 
+TEST(Transform, TransitionTrajectory) {
+    Transform transform;
+    transform.resize({1000, 1000});
+    transform.jumpTo(CameraOptions().withCenter(LatLng{45, 135}).withZoom(10.0));
+    EXPECT_TRUE(transform.getTransitionTrajectory().empty());
+
+    const LatLng destination{-45, -135};
+    transform.flyTo(CameraOptions().withCenter(destination).withZoom(12.0), AnimationOptions(Seconds(1)));
+
+    // The whole path is known before the camera starts moving.
+    const size_t samples = transform.getTransitionTrajectory().size();
+    ASSERT_GT(samples, 1u);
+    EXPECT_DOUBLE_EQ(10.0, transform.getZoom());
+    const TransformState& last = transform.getTransitionTrajectory().back();
+    EXPECT_NEAR(destination.latitude(), last.getLatLng(LatLng::Wrapped).latitude(), 1e-6);
+    EXPECT_NEAR(destination.longitude(), last.getLatLng(LatLng::Wrapped).longitude(), 1e-6);
+    EXPECT_NEAR(12.0, last.getZoom(), 1e-5);
+    // Flying across the globe zooms out on the way.
+    EXPECT_LT(transform.getTransitionTrajectory()[samples / 2].getZoom(), 10.0);
+
+    // Samples the camera has passed are dropped.
+    transform.updateTransitions(transform.getTransitionStart() + Milliseconds(500));
+    EXPECT_LT(transform.getTransitionTrajectory().size(), samples);
+    EXPECT_FALSE(transform.getTransitionTrajectory().empty());
+
+    transform.updateTransitions(transform.getTransitionStart() + transform.getTransitionDuration());
+    EXPECT_FALSE(transform.inTransition());
+    EXPECT_TRUE(transform.getTransitionTrajectory().empty());
+
+    transform.easeTo(CameraOptions().withZoom(14.0), AnimationOptions(Seconds(1)));
+    EXPECT_EQ(samples, transform.getTransitionTrajectory().size());
+    EXPECT_NEAR(14.0, transform.getTransitionTrajectory().back().getZoom(), 1e-5);
+    transform.cancelTransitions();
+    EXPECT_TRUE(transform.getTransitionTrajectory().empty());
+
+    // Immediate transitions have no trajectory.
+    transform.easeTo(CameraOptions().withZoom(16.0));
+    EXPECT_TRUE(transform.getTransitionTrajectory().empty());
+}
+
 TEST(Transform, DefaultTransform) {
     struct TransformObserver : public mbgl::MapObserver {
         void onCameraWillChange(MapObserver::CameraChangeMode) final { cameraWillChangeCallback(); };
@@ -186,6 +186,24 @@ void runServer(std::unique_ptr<httplib::Server>& server) {
         res.set_content("Request " + std::string(numbers), "text/plain");
     });
 
+    // Over HTTP/1.1, each request in progress has a connection of its own, so
+    // the peak number of concurrent requests is that of open connections.
+    std::atomic_int concurrentRequests(0);
+    std::atomic_int peakConcurrentRequests(0);
+    server->Get(R"(/concurrent/(\d+))", [&](const Request& req, Response& res) {
+        const int current = ++concurrentRequests;
+        int peak = peakConcurrentRequests;
+        while (current > peak && !peakConcurrentRequests.compare_exchange_weak(peak, current)) {
+        }
+        usleep(20000);
+        --concurrentRequests;
+        res.set_content("Request " + std::string(req.matches[1]), "text/plain");
+    });
+
+    server->Get("/concurrent-peak", [&](const Request&, Response& res) {
+        res.set_content(std::to_string(peakConcurrentRequests.exchange(0)), "text/plain");
+    });
+
     server->Get(R"(/online/(.*))", [](const Request req, Response& res) {
         res.status = 200;
         auto file = "test/fixtures/map/online/"s + std::string(req.matches[1]);
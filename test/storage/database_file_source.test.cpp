@@ -1,12 +1,18 @@
+#include <mbgl/storage/database_file_source.hpp>
 #include <mbgl/storage/file_source_manager.hpp>
 #include <mbgl/storage/resource.hpp>
 #include <mbgl/storage/resource_options.hpp>
 #include <mbgl/test/util.hpp>
+#include <mbgl/util/client_options.hpp>
+#include <mbgl/util/io.hpp>
 #include <mbgl/util/run_loop.hpp>
 #include <mbgl/util/timer.hpp>
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <vector>
+
 using namespace mbgl;
 
 TEST(DatabaseFileSource, PauseResume) {
@@ -54,4 +60,119 @@ TEST(DatabaseFileSource, VolatileResource) {
         });
     });
     loop.run();
-}
\ No newline at end of file
+}
+
+TEST(DatabaseFileSource, TEST_REQUIRES_WRITE(ReadConnections)) {
+    util::RunLoop loop;
+
+    const std::string path = "test/fixtures/database_file_source/read_connections.db";
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::remove((path + suffix).c_str());
+    }
+    DatabaseFileSource dbfs(ResourceOptions().withCachePath(path).withCacheReadConnections(2), ClientOptions());
+
+    Resource resource{Resource::Unknown, "http://127.0.0.1:3000/test", {}, Resource::LoadingMethod::CacheOnly};
+    Response response{};
+    response.data = std::make_shared<std::string>("Cached value");
+    std::unique_ptr<mbgl::AsyncRequest> req;
+
+    // Once the writer stored the resource, both read connections find it.
+    dbfs.forward(resource, response, [&] {
+        req = dbfs.request(resource, [&](Response res1) {
+            EXPECT_EQ(nullptr, res1.error);
+            ASSERT_TRUE(res1.data.get());
+            EXPECT_EQ("Cached value", *res1.data);
+            req = dbfs.request(resource, [&](Response res2) {
+                req.reset();
+                EXPECT_EQ(nullptr, res2.error);
+                ASSERT_TRUE(res2.data.get());
+                EXPECT_EQ("Cached value", *res2.data);
+                loop.stop();
+            });
+        });
+    });
+    loop.run();
+}
+
+TEST(DatabaseFileSource, TEST_REQUIRES_WRITE(ReadConnectionsAfterPackAndClear)) {
+    util::RunLoop loop;
+
+    const std::string path = "test/fixtures/database_file_source/read_connections_pack.db";
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::remove((path + suffix).c_str());
+    }
+    DatabaseFileSource dbfs(ResourceOptions().withCachePath(path).withCacheReadConnections(2), ClientOptions());
+
+    Resource resource{Resource::Unknown, "http://127.0.0.1:3000/test", {}, Resource::LoadingMethod::CacheOnly};
+    Response response{};
+    response.data = std::make_shared<std::string>("Cached value");
+    std::unique_ptr<mbgl::AsyncRequest> req;
+
+    // The read connections are reopened after the database was packed, and
+    // no longer see the resource once the ambient cache has been cleared.
+    // Pack and clear call back on the database thread.
+    const auto checkCleared = [&] {
+        req = dbfs.request(resource, [&](Response res) {
+            req.reset();
+            ASSERT_TRUE(res.error.get());
+            EXPECT_EQ(Response::Error::Reason::NotFound, res.error->reason);
+            loop.stop();
+        });
+    };
+    const auto checkPacked = [&] {
+        req = dbfs.request(resource, [&](Response res) {
+            EXPECT_EQ(nullptr, res.error);
+            ASSERT_TRUE(res.data.get());
+            EXPECT_EQ("Cached value", *res.data);
+            dbfs.clearAmbientCache([&](std::exception_ptr error) {
+                EXPECT_EQ(nullptr, error);
+                loop.invoke(checkCleared);
+            });
+        });
+    };
+    dbfs.forward(resource, response, [&] {
+        dbfs.packDatabase([&](std::exception_ptr error) {
+            EXPECT_EQ(nullptr, error);
+            loop.invoke(checkPacked);
+        });
+    });
+    loop.run();
+}
+
+TEST(DatabaseFileSource, TEST_REQUIRES_WRITE(MergeOfflineRegionsProgress)) {
+    util::RunLoop loop;
+
+    const std::string sidePath = "test/fixtures/database_file_source/merge_sideload.db";
+    util::deleteFile(sidePath);
+    util::copyFile(sidePath, "test/fixtures/offline_database/sideload_sat_multiple.db");
+
+    class Observer : public OfflineMergeObserver {
+    public:
+        explicit Observer(std::vector<OfflineMergeProgress>& progress_)
+            : progress(progress_) {}
+        void progressChanged(OfflineMergeProgress status) override { progress.push_back(status); }
+
+        std::vector<OfflineMergeProgress>& progress;
+    };
+
+    // Only touched on the database thread.
+    std::vector<OfflineMergeProgress> progress;
+    DatabaseFileSource dbfs(ResourceOptions().withCachePath(":memory:"), ClientOptions());
+
+    dbfs.mergeOfflineRegions(
+        sidePath, std::make_unique<Observer>(progress), [&](expected<OfflineRegions, std::exception_ptr> result) {
+            loop.stop();
+            ASSERT_TRUE(result);
+            EXPECT_EQ(2u, result->size());
+
+            ASSERT_LT(2u, progress.size());
+            EXPECT_EQ(0u, progress.front().completedTileCount);
+            EXPECT_EQ(0u, progress.front().completedResourceCount);
+            EXPECT_TRUE(progress.back().complete());
+            for (size_t i = 1; i < progress.size(); i++) {
+                EXPECT_LE(progress[i - 1].completedTileCount, progress[i].completedTileCount);
+                EXPECT_LE(progress[i - 1].completedResourceCount, progress[i].completedResourceCount);
+            }
+        });
+    loop.run();
+}
@@ -207,3 +207,72 @@ TEST(HTTPFileSource, TEST_REQUIRES_SERVER(Load)) {
 
     loop.run();
 }
+
+TEST(HTTPFileSource, TEST_REQUIRES_SERVER(MaximumConnectionsPerHost)) {
+    util::RunLoop loop;
+    HTTPFileSource fs(ResourceOptions::Default().withMaximumConnectionsPerHost(2), ClientOptions());
+
+    // Requests beyond the limit wait for a connection, and all complete.
+    const int count = 20;
+    int completed = 0;
+    std::unique_ptr<AsyncRequest> reqs[count];
+
+    for (int i = 0; i < count; i++) {
+        const auto number = util::toString(i + 1);
+        reqs[i] = fs.request({Resource::Unknown, "http://127.0.0.1:3000/concurrent/" + number},
+                             [&, i, number](Response res) {
+                                 reqs[i].reset();
+                                 if (++completed == count) {
+                                     loop.stop();
+                                 }
+                                 EXPECT_EQ(nullptr, res.error);
+                                 ASSERT_TRUE(res.data.get());
+                                 EXPECT_EQ("Request " + number, *res.data);
+                             });
+    }
+
+    loop.run();
+
+    // The server never had more than two requests, i.e. connections, at once.
+    std::unique_ptr<AsyncRequest> peakReq;
+    peakReq = fs.request({Resource::Unknown, "http://127.0.0.1:3000/concurrent-peak"}, [&](Response res) {
+        peakReq.reset();
+        loop.stop();
+        EXPECT_EQ(nullptr, res.error);
+        ASSERT_TRUE(res.data.get());
+        const int peak = std::stoi(*res.data);
+        EXPECT_LE(1, peak);
+        EXPECT_GE(2, peak);
+    });
+
+    loop.run();
+}
+
+TEST(HTTPFileSource, TEST_REQUIRES_H2_SERVER(MultiplexesHTTP2Requests)) {
+    util::RunLoop loop;
+    HTTPFileSource fs(ResourceOptions::Default().withMaximumConnectionsPerHost(1), ClientOptions());
+
+    // Each response takes 200 ms. With a single connection, they only arrive
+    // together if the requests are streams of that connection.
+    const int count = 10;
+    int completed = 0;
+    std::unique_ptr<AsyncRequest> reqs[count];
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; i++) {
+        reqs[i] = fs.request({Resource::Unknown, TEST_H2_SERVER "/delayed?" + util::toString(i)},
+                             [&, i](Response res) {
+                                 reqs[i].reset();
+                                 if (++completed == count) {
+                                     loop.stop();
+                                 }
+                                 EXPECT_EQ(nullptr, res.error);
+                                 ASSERT_TRUE(res.data.get());
+                                 EXPECT_EQ("Response", *res.data);
+                             });
+    }
+
+    loop.run();
+
+    EXPECT_GT(std::chrono::milliseconds(1000), std::chrono::steady_clock::now() - start);
+}
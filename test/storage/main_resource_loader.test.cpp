@@ -6,14 +6,130 @@
 #include <mbgl/storage/online_file_source.hpp>
 #include <mbgl/storage/resource_options.hpp>
 #include <mbgl/storage/resource_transform.hpp>
+#include <mbgl/util/chrono.hpp>
 #include <mbgl/util/client_options.hpp>
 #include <mbgl/test/util.hpp>
 #include <mbgl/util/run_loop.hpp>
 #include <mbgl/util/timer.hpp>
 #include <mbgl/util/tile_server_options.hpp>
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
 using namespace mbgl;
 
+namespace {
+
+// Stands in for the network and counts the requests that reach it. Responses
+// contain the requested URL and expire in an hour. Like OnlineFileSource,
+// requests to refresh a resource that hasn't expired yet wait, here forever.
+class CountingFileSource : public FileSource {
+public:
+    CountingFileSource(std::shared_ptr<std::atomic<unsigned>> count_,
+                       const ResourceOptions& resourceOptions_,
+                       const ClientOptions& clientOptions_)
+        : count(std::move(count_)),
+          resourceOptions(resourceOptions_.clone()),
+          clientOptions(clientOptions_.clone()) {}
+
+    std::unique_ptr<AsyncRequest> request(const Resource& resource, Callback callback) override {
+        auto req = std::make_unique<TimerRequest>();
+        if (resource.priorExpires && *resource.priorExpires > util::now()) {
+            return req;
+        }
+        ++*count;
+        req->timer.start(Milliseconds(10), Duration::zero(), [callback, url = resource.url] {
+            Response response;
+            response.data = std::make_shared<std::string>(url);
+            response.expires = util::now() + Seconds(3600);
+            callback(response);
+        });
+        return req;
+    }
+
+    bool canRequest(const Resource& resource) const override {
+        return resource.hasLoadingMethod(Resource::LoadingMethod::Network);
+    }
+
+    void setResourceOptions(ResourceOptions options) override { resourceOptions = options.clone(); }
+    ResourceOptions getResourceOptions() override { return resourceOptions.clone(); }
+
+    void setClientOptions(ClientOptions options) override { clientOptions = options.clone(); }
+    ClientOptions getClientOptions() override { return clientOptions.clone(); }
+
+private:
+    struct TimerRequest : AsyncRequest {
+        util::Timer timer;
+    };
+
+    const std::shared_ptr<std::atomic<unsigned>> count;
+    ResourceOptions resourceOptions;
+    ClientOptions clientOptions;
+};
+
+// Stands in for the network and records the priority of each request made to
+// it, and of each update to one. Requests are never answered.
+class PriorityRecordingFileSource : public FileSource {
+public:
+    using Event = std::tuple<std::string, Resource::Priority, uint32_t>;
+
+    struct Recorder {
+        std::mutex mutex;
+        std::vector<Event> events;
+        // Called once the number of events reaches `awaited`.
+        std::size_t awaited = 0;
+        std::function<void()> onAwaited;
+
+        void record(std::string what, const Resource& resource) {
+            bool reached;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                events.emplace_back(std::move(what), resource.priority, resource.priorityOrder);
+                reached = events.size() == awaited;
+            }
+            if (reached && onAwaited) {
+                onAwaited();
+            }
+        }
+    };
+
+    PriorityRecordingFileSource(std::shared_ptr<Recorder> recorder_,
+                                const ResourceOptions& resourceOptions_,
+                                const ClientOptions& clientOptions_)
+        : recorder(std::move(recorder_)),
+          resourceOptions(resourceOptions_.clone()),
+          clientOptions(clientOptions_.clone()) {}
+
+    std::unique_ptr<AsyncRequest> request(const Resource& resource, Callback) override {
+        recorder->record("request " + resource.url, resource);
+        return std::make_unique<AsyncRequest>();
+    }
+
+    void updatePriority(AsyncRequest&, const Resource& resource) override {
+        recorder->record("update " + resource.url, resource);
+    }
+
+    bool canRequest(const Resource& resource) const override {
+        return resource.hasLoadingMethod(Resource::LoadingMethod::Network);
+    }
+
+    void setResourceOptions(ResourceOptions options) override { resourceOptions = options.clone(); }
+    ResourceOptions getResourceOptions() override { return resourceOptions.clone(); }
+
+    void setClientOptions(ClientOptions options) override { clientOptions = options.clone(); }
+    ClientOptions getClientOptions() override { return clientOptions.clone(); }
+
+private:
+    const std::shared_ptr<Recorder> recorder;
+    ResourceOptions resourceOptions;
+    ClientOptions clientOptions;
+};
+
+} // namespace
+
 TEST(MainResourceLoader, TEST_REQUIRES_SERVER(CacheResponse)) {
     util::RunLoop loop;
     MainResourceLoader fs(ResourceOptions{}, ClientOptions{});
@@ -856,3 +972,301 @@ TEST(MainResourceLoader, ResourceOptions) {
     EXPECT_EQ(updatedOptions.baseURL(), "updatedBaseURL");
     EXPECT_EQ(updatedOptions.uriSchemeAlias(), "updatedAlias");
 }
+
+TEST(MainResourceLoader, CoalesceRequests) {
+    util::RunLoop loop;
+
+    auto count = std::make_shared<std::atomic<unsigned>>(0);
+    auto* manager = FileSourceManager::get();
+    auto networkFactory = manager->unRegisterFileSourceFactory(FileSourceType::Network);
+    manager->registerFileSourceFactory(
+        FileSourceType::Network, [count](const ResourceOptions& resourceOptions, const ClientOptions& clientOptions) {
+            return std::make_unique<CountingFileSource>(count, resourceOptions, clientOptions);
+        });
+
+    {
+        MainResourceLoader fs(ResourceOptions().withApiKey("coalesce"), ClientOptions());
+
+        const std::string urlTemplate = "http://127.0.0.1:3000/{z}-{x}-{y}.vector.pbf";
+        const Resource tile = Resource::tile(
+            urlTemplate, 1.0, 0, 0, 0, Tileset::Scheme::XYZ, Resource::LoadingMethod::NetworkOnly);
+        const Resource otherTile = Resource::tile(
+            urlTemplate, 1.0, 1, 0, 1, Tileset::Scheme::XYZ, Resource::LoadingMethod::NetworkOnly);
+
+        std::vector<std::unique_ptr<AsyncRequest>> requests;
+        unsigned responses = 0;
+        const auto expect = [&](const Resource& resource, unsigned total) {
+            return [&, url = resource.url, total](Response res) {
+                ASSERT_TRUE(res.data.get());
+                EXPECT_EQ(url, *res.data);
+                if (++responses == total) {
+                    loop.stop();
+                }
+            };
+        };
+
+        // Queue the requests, e.g. from several maps, before the loader
+        // handles the first one. Identical ones share a source request.
+        fs.pause();
+        for (int i = 0; i < 3; ++i) {
+            requests.push_back(fs.request(tile, expect(tile, 4)));
+        }
+        requests.push_back(fs.request(otherTile, expect(otherTile, 4)));
+        fs.resume();
+        loop.run();
+
+        EXPECT_EQ(4u, responses);
+        EXPECT_EQ(2u, count->load());
+
+        // Once answered, a request for the same resource reaches the source
+        // again. Cancelling one of the requests sharing a source request
+        // doesn't cancel it for the others.
+        requests.clear();
+        responses = 0;
+        fs.pause();
+        requests.push_back(fs.request(tile, expect(tile, 2)));
+        requests.push_back(fs.request(tile, expect(tile, 2)));
+        requests.push_back(fs.request(tile, expect(tile, 2)));
+        requests.front().reset();
+        fs.resume();
+        loop.run();
+
+        EXPECT_EQ(2u, responses);
+        EXPECT_EQ(3u, count->load());
+    }
+
+    manager->registerFileSourceFactory(FileSourceType::Network, std::move(networkFactory));
+}
+
+TEST(MainResourceLoader, MemoryCache) {
+    util::RunLoop loop;
+
+    auto count = std::make_shared<std::atomic<unsigned>>(0);
+    auto* manager = FileSourceManager::get();
+    auto networkFactory = manager->unRegisterFileSourceFactory(FileSourceType::Network);
+    manager->registerFileSourceFactory(
+        FileSourceType::Network, [count](const ResourceOptions& resourceOptions, const ClientOptions& clientOptions) {
+            return std::make_unique<CountingFileSource>(count, resourceOptions, clientOptions);
+        });
+
+    {
+        MainResourceLoader fs(ResourceOptions().withApiKey("memory-cache").withMemoryCacheSize(1024 * 1024),
+                              ClientOptions());
+        const auto hits = [&] { return *fs.getProperty(MEMORY_CACHE_HITS_KEY).getUint(); };
+        const auto misses = [&] { return *fs.getProperty(MEMORY_CACHE_MISSES_KEY).getUint(); };
+
+        const auto requestOnce = [&](const Resource& resource) {
+            std::unique_ptr<AsyncRequest> req = fs.request(resource, [&, url = resource.url](Response res) {
+                ASSERT_TRUE(res.data.get());
+                EXPECT_EQ(url, *res.data);
+                loop.stop();
+            });
+            loop.run();
+        };
+
+        Resource resource{Resource::Unknown, "http://127.0.0.1:3000/memory"};
+        requestOnce(resource);
+        EXPECT_EQ(1u, count->load());
+        EXPECT_EQ(0u, hits());
+        EXPECT_EQ(1u, misses());
+
+        // The fresh response in memory is used without asking the database,
+        // and the network request waits for it to expire.
+        requestOnce(resource);
+        EXPECT_EQ(1u, count->load());
+        EXPECT_EQ(1u, hits());
+        EXPECT_EQ(1u, misses());
+
+        // Volatile resources are not kept.
+        Resource volatileResource{Resource::Unknown, "http://127.0.0.1:3000/volatile"};
+        volatileResource.storagePolicy = Resource::StoragePolicy::Volatile;
+        requestOnce(volatileResource);
+        requestOnce(volatileResource);
+        EXPECT_EQ(3u, count->load());
+        EXPECT_EQ(1u, hits());
+        EXPECT_EQ(1u, misses());
+
+        // Invalidating the ambient cache drops the responses in memory too.
+        auto dbfs = std::static_pointer_cast<DatabaseFileSource>(FileSourceManager::get()->getFileSource(
+            FileSourceType::Database, ResourceOptions().withApiKey("memory-cache"), ClientOptions()));
+        dbfs->invalidateAmbientCache([&](std::exception_ptr) { loop.stop(); });
+        loop.run();
+        requestOnce(resource);
+        EXPECT_EQ(4u, count->load());
+        EXPECT_EQ(1u, hits());
+        EXPECT_EQ(2u, misses());
+    }
+
+    manager->registerFileSourceFactory(FileSourceType::Network, std::move(networkFactory));
+}
+
+TEST(MainResourceLoader, UpdatePriorityAfterCacheLookup) {
+    util::RunLoop loop;
+
+    using Event = PriorityRecordingFileSource::Event;
+    auto recorder = std::make_shared<PriorityRecordingFileSource::Recorder>();
+    recorder->onAwaited = [&] { loop.stop(); };
+    const auto waitForEvents = [&](std::size_t count) {
+        {
+            std::lock_guard<std::mutex> lock(recorder->mutex);
+            if (recorder->events.size() >= count) {
+                return;
+            }
+            recorder->awaited = count;
+        }
+        loop.run();
+    };
+    const auto events = [&] {
+        std::lock_guard<std::mutex> lock(recorder->mutex);
+        return recorder->events;
+    };
+
+    auto* manager = FileSourceManager::get();
+    auto networkFactory = manager->unRegisterFileSourceFactory(FileSourceType::Network);
+    manager->registerFileSourceFactory(
+        FileSourceType::Network,
+        [recorder](const ResourceOptions& resourceOptions, const ClientOptions& clientOptions) {
+            return std::make_unique<PriorityRecordingFileSource>(recorder, resourceOptions, clientOptions);
+        });
+
+    {
+        const auto resourceOptions = ResourceOptions().withApiKey("update-priority");
+        MainResourceLoader fs(resourceOptions, ClientOptions());
+
+        const std::string urlTemplate = "http://127.0.0.1:3000/{z}-{x}-{y}.vector.pbf";
+        const auto tile = [&](int32_t x, Resource::Priority priority, uint32_t order) {
+            Resource resource = Resource::tile(urlTemplate, 1.0, x, 0, 1, Tileset::Scheme::XYZ);
+            resource.setPriority(priority);
+            resource.priorityOrder = order;
+            return resource;
+        };
+
+        // A priority update that arrives while the cache is being read
+        // applies to the network request made after the cache miss.
+        fs.pause();
+        const Resource missing = tile(0, Resource::Priority::Regular, 1);
+        std::unique_ptr<AsyncRequest> missingReq = fs.request(missing, [](Response) { ADD_FAILURE(); });
+        fs.updatePriority(*missingReq, tile(0, Resource::Priority::Prefetch, 2));
+        fs.resume();
+        waitForEvents(1);
+        EXPECT_EQ(Event("request " + missing.url, Resource::Priority::Prefetch, 2u), events().back());
+
+        // Later updates move the network request.
+        fs.updatePriority(*missingReq, tile(0, Resource::Priority::Regular, 3));
+        waitForEvents(2);
+        EXPECT_EQ(Event("update " + missing.url, Resource::Priority::Regular, 3u), events().back());
+
+        // Revalidating an expired but usable resource stays at low priority.
+        const Resource stale = tile(1, Resource::Priority::Regular, 0);
+        Response response;
+        response.data = std::make_shared<std::string>("stale");
+        response.expires = util::now() - Seconds(60);
+        std::shared_ptr<FileSource> dbfs = manager->getFileSource(
+            FileSourceType::Database, resourceOptions, ClientOptions());
+        dbfs->forward(stale, response, [&] { loop.stop(); });
+        loop.run();
+
+        unsigned staleResponses = 0;
+        std::unique_ptr<AsyncRequest> staleReq = fs.request(stale, [&](Response res) {
+            ASSERT_TRUE(res.data.get());
+            EXPECT_EQ("stale", *res.data);
+            ++staleResponses;
+        });
+        waitForEvents(3);
+        EXPECT_EQ(Event("request " + stale.url, Resource::Priority::Low, 0u), events().back());
+
+        // The update is handled before the following request reaches the network.
+        fs.updatePriority(*staleReq, tile(1, Resource::Priority::Regular, 4));
+        const Resource other = tile(2, Resource::Priority::Regular, 5);
+        std::unique_ptr<AsyncRequest> otherReq = fs.request(other, [](Response) { ADD_FAILURE(); });
+        waitForEvents(4);
+        EXPECT_EQ(Event("request " + other.url, Resource::Priority::Regular, 5u), events().back());
+        EXPECT_EQ(1u, staleResponses);
+    }
+
+    manager->registerFileSourceFactory(FileSourceType::Network, std::move(networkFactory));
+}
+
+TEST(MainResourceLoader, CoalescedRequestsUseMostUrgentPriority) {
+    util::RunLoop loop;
+
+    using Event = PriorityRecordingFileSource::Event;
+    auto recorder = std::make_shared<PriorityRecordingFileSource::Recorder>();
+    recorder->onAwaited = [&] { loop.stop(); };
+    const auto waitForEvents = [&](std::size_t count) {
+        {
+            std::lock_guard<std::mutex> lock(recorder->mutex);
+            if (recorder->events.size() >= count) {
+                return;
+            }
+            recorder->awaited = count;
+        }
+        loop.run();
+    };
+    const auto events = [&] {
+        std::lock_guard<std::mutex> lock(recorder->mutex);
+        return recorder->events;
+    };
+
+    auto* manager = FileSourceManager::get();
+    auto networkFactory = manager->unRegisterFileSourceFactory(FileSourceType::Network);
+    manager->registerFileSourceFactory(
+        FileSourceType::Network,
+        [recorder](const ResourceOptions& resourceOptions, const ClientOptions& clientOptions) {
+            return std::make_unique<PriorityRecordingFileSource>(recorder, resourceOptions, clientOptions);
+        });
+
+    {
+        MainResourceLoader fs(ResourceOptions().withApiKey("coalesced-priority"), ClientOptions());
+
+        const std::string urlTemplate = "http://127.0.0.1:3000/coalesced/{z}-{x}-{y}.vector.pbf";
+        const auto tile = [&](int32_t x, Resource::Priority priority, uint32_t order) {
+            Resource resource = Resource::tile(urlTemplate, 1.0, x, 0, 1, Tileset::Scheme::XYZ);
+            resource.setPriority(priority);
+            resource.priorityOrder = order;
+            return resource;
+        };
+        const auto unanswered = [](Response) {
+            ADD_FAILURE();
+        };
+
+        // Map A shows the tile on screen.
+        const std::string url = tile(0, Resource::Priority::Regular, 0).url;
+        std::unique_ptr<AsyncRequest> reqA = fs.request(tile(0, Resource::Priority::Regular, 5), unanswered);
+        waitForEvents(1);
+        EXPECT_EQ(Event("request " + url, Resource::Priority::Regular, 5u), events().back());
+
+        // Map B prefetches the same tile, which shares the request of map A
+        // without demoting it. The request for another tile reaches the
+        // network next.
+        std::unique_ptr<AsyncRequest> reqB = fs.request(tile(0, Resource::Priority::Prefetch, 1), unanswered);
+        const Resource first = tile(1, Resource::Priority::Regular, 0);
+        std::unique_ptr<AsyncRequest> firstReq = fs.request(first, unanswered);
+        waitForEvents(2);
+        EXPECT_EQ(Event("request " + first.url, Resource::Priority::Regular, 0u), events().back());
+
+        // Map B moves closer to the tile.
+        fs.updatePriority(*reqB, tile(0, Resource::Priority::Regular, 2));
+        waitForEvents(3);
+        EXPECT_EQ(Event("update " + url, Resource::Priority::Regular, 2u), events().back());
+
+        // Map A panning away doesn't demote the tile that map B shows.
+        fs.updatePriority(*reqA, tile(0, Resource::Priority::Prefetch, 9));
+        const Resource second = tile(2, Resource::Priority::Regular, 0);
+        std::unique_ptr<AsyncRequest> secondReq = fs.request(second, unanswered);
+        waitForEvents(4);
+        EXPECT_EQ(Event("request " + second.url, Resource::Priority::Regular, 0u), events().back());
+
+        // Once map B no longer needs it, map A's priority applies.
+        reqB.reset();
+        waitForEvents(5);
+        EXPECT_EQ(Event("update " + url, Resource::Priority::Prefetch, 9u), events().back());
+
+        // A request at another priority still joins the group.
+        std::unique_ptr<AsyncRequest> reqC = fs.request(tile(0, Resource::Priority::High, 0), unanswered);
+        waitForEvents(6);
+        EXPECT_EQ(Event("update " + url, Resource::Priority::High, 0u), events().back());
+    }
+
+    manager->registerFileSourceFactory(FileSourceType::Network, std::move(networkFactory));
+}
@@ -5,6 +5,8 @@
 #include <mbgl/util/run_loop.hpp>
 
 #include <climits>
+#include <tuple>
+#include <vector>
 #include <gtest/gtest.h>
 
 #if defined(WIN32)
@@ -138,3 +140,30 @@ TEST(MBTilesFileSource, NonExistentTile) {
 
     loop.run();
 }
+
+// Tiles read ahead along with their siblings return the same data as tiles
+// looked up on their own
+TEST(MBTilesFileSource, TileBlock) {
+    util::RunLoop loop;
+
+    MBTilesFileSource mbtiles(ResourceOptions::Default(), ClientOptions());
+
+    // Sizes of the zoom level 1 tiles in the fixture, by XYZ column and row.
+    const std::vector<std::tuple<uint32_t, uint32_t, size_t>> tiles = {
+        {0, 0, 21130}, {1, 0, 20156}, {0, 1, 13843}, {1, 1, 12097}, {0, 0, 21130}};
+
+    for (const auto &[x, y, size] : tiles) {
+        std::unique_ptr<AsyncRequest> req = mbtiles.request(
+            Resource::tile(
+                toAbsoluteURL("geography-class-png.mbtiles?file={z}/{x}/{y}.png"), 1.0, x, y, 1, Tileset::Scheme::XYZ),
+            [&, expected = size](Response res) {
+                req.reset();
+                EXPECT_EQ(nullptr, res.error);
+                ASSERT_TRUE(res.data.get());
+                EXPECT_EQ(expected, res.data->size());
+                loop.stop();
+            });
+
+        loop.run();
+    }
+}
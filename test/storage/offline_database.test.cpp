@@ -3,8 +3,10 @@
 #include <mbgl/test/sqlite3_test_fs.hpp>
 
 #include <mbgl/storage/offline_database.hpp>
+#include <mbgl/storage/pmtiles_archive.hpp>
 #include <mbgl/storage/resource.hpp>
 #include <mbgl/storage/response.hpp>
+#include <mbgl/util/compression.hpp>
 #include <mbgl/util/io.hpp>
 #include <mbgl/util/string.hpp>
 
@@ -98,6 +100,25 @@ static std::vector<std::string> databaseTableColumns(const std::string& path, co
     return columns;
 }
 
+static std::vector<int64_t> databaseTileAmbientFlags(const std::string& path) {
+    mapbox::sqlite::Database db = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly);
+    mapbox::sqlite::Statement stmt{db, "SELECT ambient FROM tiles ORDER BY id"};
+    mapbox::sqlite::Query query{stmt};
+    std::vector<int64_t> flags;
+    while (query.run()) {
+        flags.push_back(query.get<int64_t>(0));
+    }
+    return flags;
+}
+
+static int64_t databaseTileDataCount(const std::string& path) {
+    mapbox::sqlite::Database db = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly);
+    mapbox::sqlite::Statement stmt{db, "SELECT COUNT(*) FROM tile_data"};
+    mapbox::sqlite::Query query{stmt};
+    query.run();
+    return query.get<int64_t>(0);
+}
+
 static int databaseAutoVacuum(const std::string& path) {
     mapbox::sqlite::Database db = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly);
     mapbox::sqlite::Statement stmt{db, "pragma auto_vacuum"};
@@ -157,7 +178,6 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(CreateFail)) {
     // will always get an empty result.
     for (const auto& res : {fixture::resource, fixture::tile}) {
         EXPECT_FALSE(bool(db.get(res)));
-        EXPECT_EQ(1u, log.count(warning(ResultCode::CantOpen, "Can't update timestamp: unable to open database file")));
         EXPECT_EQ(1u, log.count(warning(ResultCode::CantOpen, "Can't read resource: unable to open database file")));
         EXPECT_EQ(0u, log.uncheckedCount());
     }
@@ -175,14 +195,12 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(CreateFail)) {
     }
 
     // Next, set the file system to read only mode and try to read the data
-    // again. While we can't write anymore, we should still be able to read, and
-    // the query that tries to update the last accessed timestamp may fail
-    // without crashing.
+    // again. While we can't write anymore, we should still be able to read,
+    // since reads only buffer the last accessed timestamp.
     fs.allowFileCreate(false);
     fs.setWriteLimit(0);
     for (const auto& res : {fixture::resource, fixture::tile}) {
         auto result = db.get(res);
-        EXPECT_EQ(1u, log.count(warning(ResultCode::CantOpen, "Can't update timestamp: unable to open database file")));
         EXPECT_EQ(0u, log.uncheckedCount());
 
         ASSERT_TRUE(result && result->data);
@@ -191,13 +209,11 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(CreateFail)) {
     fs.setDebug(false);
 
     // We're allowing SQLite to create a journal file, but restrict the number
-    // of bytes it can write so that it can start writing the journal file, but
-    // eventually fails during the timestamp update.
+    // of bytes it can write. Reads still succeed without writing anything.
     fs.allowFileCreate(true);
     fs.setWriteLimit(8192);
     for (const auto& res : {fixture::resource, fixture::tile}) {
         auto result = db.get(res);
-        EXPECT_EQ(1u, log.count(warning(ResultCode::Full, "Can't update timestamp: database or disk is full")));
         EXPECT_EQ(0u, log.uncheckedCount());
         ASSERT_TRUE(result && result->data);
         EXPECT_EQ("first", *result->data);
@@ -210,7 +226,6 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(CreateFail)) {
     for (const auto& res : {fixture::resource, fixture::tile}) {
         // First, try reading.
         auto result = db.get(res);
-        EXPECT_EQ(1u, log.count(warning(ResultCode::Auth, "Can't update timestamp: authorization denied")));
         EXPECT_EQ(1u, log.count(warning(ResultCode::Auth, "Can't read resource: authorization denied")));
         EXPECT_EQ(0u, log.uncheckedCount());
         EXPECT_FALSE(result);
@@ -238,7 +253,7 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(SchemaVersion)) {
 
     { OfflineDatabase db(filename, fixture::tileServerOptions); }
 
-    EXPECT_EQ(6, databaseUserVersion(filename));
+    EXPECT_EQ(10, databaseUserVersion(filename));
 
     OfflineDatabase db(filename, fixture::tileServerOptions);
     // Now try inserting and reading back to make sure we have a valid database.
@@ -397,6 +412,118 @@ TEST(OfflineDatabase, PutTile) {
     EXPECT_EQ(0u, log.uncheckedCount());
 }
 
+TEST(OfflineDatabase, PutTileCompressed) {
+    FixtureLog log;
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+
+    Resource resource{Resource::Tile, "http://example.com/"};
+    resource.tileData = Resource::TileData{"http://example.com/", 1, 0, 0, 0};
+    const std::string data(1024, 'a');
+    const std::string compressedData = util::compress(data);
+
+    Response response;
+    response.data = std::make_shared<std::string>(compressedData);
+    response.compressed = true;
+    auto putResult = db.put(resource, response);
+    EXPECT_TRUE(putResult.first);
+    EXPECT_EQ(compressedData.size(), putResult.second);
+
+    // The stored bytes are handed out as they are to callers that accept them...
+    resource.acceptsCompressedData = true;
+    auto compressedResult = db.get(resource);
+    EXPECT_TRUE(compressedResult->compressed);
+    EXPECT_EQ(compressedData, *compressedResult->data);
+
+    // ...and decompressed for everyone else.
+    resource.acceptsCompressedData = false;
+    auto result = db.get(resource);
+    EXPECT_FALSE(result->compressed);
+    EXPECT_EQ(data, *result->data);
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
+static int64_t databaseTileEncoding(const std::string& path, int32_t x) {
+    mapbox::sqlite::Database db = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly);
+    mapbox::sqlite::Statement stmt{db, "SELECT compressed FROM tiles WHERE x = ?1"};
+    mapbox::sqlite::Query query{stmt};
+    query.bind(1, x);
+    query.run();
+    return query.get<int64_t>(0);
+}
+
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(TrainTileDictionary)) {
+    FixtureLog log;
+    deleteDatabaseFiles();
+    OfflineDatabase db(filename, fixture::tileServerOptions);
+
+    const std::string urlTemplate = "http://example.com/{z}/{x}/{y}.pbf";
+    const auto tileData = [](int32_t x) {
+        std::string data;
+        for (int32_t i = 0; i < 50; i++) {
+            data += "water\tclass=river\tname=" + util::toString(x * 50 + i) + "\troad\tclass=primary\n";
+        }
+        return data;
+    };
+    const auto tile = [&](int32_t x) {
+        return Resource::tile(urlTemplate, 1, x, 0, 10, Tileset::Scheme::XYZ);
+    };
+    const auto put = [&](int32_t x) {
+        Response response;
+        response.data = std::make_shared<std::string>(tileData(x));
+        db.put(tile(x), response);
+    };
+
+    for (int32_t x = 0; x < 100; x++) {
+        put(x);
+    }
+
+    if (!util::zstd::supported()) {
+        EXPECT_FALSE(db.trainTileDictionary(urlTemplate));
+        return;
+    }
+
+    EXPECT_TRUE(db.trainTileDictionary(urlTemplate));
+    EXPECT_FALSE(db.trainTileDictionary(urlTemplate));
+
+    // Tiles stored before training keep their compression.
+    put(100);
+    EXPECT_EQ(1, databaseTileEncoding(filename, 0));
+    EXPECT_EQ(2, databaseTileEncoding(filename, 100));
+
+    for (int32_t x : {0, 100}) {
+        auto response = db.get(tile(x));
+        ASSERT_TRUE(response && response->data);
+        EXPECT_FALSE(response->compressed);
+        EXPECT_EQ(tileData(x), *response->data);
+    }
+
+    // Tiles compressed with the dictionary are passed on as they are, too,
+    // and util::decompress() finds the dictionary.
+    Resource compressedTile = tile(100);
+    compressedTile.acceptsCompressedData = true;
+    auto compressed = db.get(compressedTile);
+    ASSERT_TRUE(compressed && compressed->data);
+    EXPECT_TRUE(compressed->compressed);
+    EXPECT_EQ(tileData(100), util::decompress(*compressed->data));
+
+    // Data that arrives compressed isn't recompressed with the dictionary.
+    Response gzipped;
+    gzipped.data = std::make_shared<std::string>(util::compress(tileData(101), util::GZIP));
+    gzipped.compressed = true;
+    db.put(tile(101), gzipped);
+    EXPECT_EQ(1, databaseTileEncoding(filename, 101));
+
+    // Other tilesets don't use the dictionary.
+    Resource otherTile = Resource::tile("http://example.com/other/{z}/{x}/{y}.pbf", 1, 200, 0, 10, Tileset::Scheme::XYZ);
+    Response response;
+    response.data = std::make_shared<std::string>(tileData(200));
+    db.put(otherTile, response);
+    EXPECT_EQ(1, databaseTileEncoding(filename, 200));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
 TEST(OfflineDatabase, PutResourceNoContent) {
     FixtureLog log;
     OfflineDatabase db(":memory:", fixture::tileServerOptions);
@@ -1082,6 +1209,53 @@ TEST(OfflineDatabase, PutReturnsSize) {
     EXPECT_EQ(0u, log.uncheckedCount());
 }
 
+static int64_t databaseAccessedTimestamp(const std::string& path, const char* table) {
+    mapbox::sqlite::Database db = mapbox::sqlite::Database::open(path, mapbox::sqlite::ReadOnly);
+    const std::string sql = "SELECT accessed FROM "s + table;
+    mapbox::sqlite::Statement stmt{db, sql.c_str()};
+    mapbox::sqlite::Query query{stmt};
+    query.run();
+    return query.get<int64_t>(0);
+}
+
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(GetDefersAccessedTimestamps)) {
+    FixtureLog log;
+    deleteDatabaseFiles();
+    OfflineDatabase db(filename, fixture::tileServerOptions);
+
+    for (const auto& res : {fixture::resource, fixture::tile}) {
+        db.put(res, fixture::response);
+    }
+
+    // Reading an entry that was just written doesn't refresh its timestamp.
+    for (const auto& res : {fixture::resource, fixture::tile}) {
+        EXPECT_TRUE(bool(db.get(res)));
+    }
+    EXPECT_FALSE(db.hasPendingAccessedTimestamps());
+
+    {
+        mapbox::sqlite::Database raw = mapbox::sqlite::Database::open(filename, mapbox::sqlite::ReadWriteCreate);
+        raw.exec("UPDATE resources SET accessed = 0");
+        raw.exec("UPDATE tiles SET accessed = 0");
+    }
+
+    // Reading older entries only buffers the new timestamps...
+    for (const auto& res : {fixture::resource, fixture::tile}) {
+        EXPECT_TRUE(bool(db.get(res)));
+    }
+    EXPECT_TRUE(db.hasPendingAccessedTimestamps());
+    EXPECT_EQ(0, databaseAccessedTimestamp(filename, "resources"));
+    EXPECT_EQ(0, databaseAccessedTimestamp(filename, "tiles"));
+
+    // ...until they are flushed.
+    db.flushAccessedTimestamps();
+    EXPECT_FALSE(db.hasPendingAccessedTimestamps());
+    EXPECT_LT(0, databaseAccessedTimestamp(filename, "resources"));
+    EXPECT_LT(0, databaseAccessedTimestamp(filename, "tiles"));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
 TEST(OfflineDatabase, PutEvictsLeastRecentlyUsedResources) {
     FixtureLog log;
     OfflineDatabase db(":memory:", fixture::tileServerOptions);
@@ -1183,6 +1357,150 @@ TEST(OfflineDatabase, PutFailsWhenEvictionInsuffices) {
     EXPECT_EQ(0u, log.uncheckedCount());
 }
 
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(AmbientFlagFollowsRegions)) {
+    FixtureLog log;
+    deleteDatabaseFiles();
+    OfflineDatabase db(filename, fixture::tileServerOptions);
+
+    OfflineTilePyramidRegionDefinition definition{"", LatLngBounds::world(), 0, INFINITY, 1.0, true};
+    auto region1 = db.createRegion(definition, OfflineRegionMetadata());
+    auto region2 = db.createRegion(definition, OfflineRegionMetadata());
+    ASSERT_TRUE(region1);
+    ASSERT_TRUE(region2);
+
+    const auto tile = [](int32_t x) {
+        return Resource::tile("http://example.com/{z}-{x}-{y}", 1, x, 0, 1, Tileset::Scheme::XYZ);
+    };
+
+    db.put(tile(0), fixture::response);
+    db.putRegionResource(region1->getID(), tile(1), fixture::response);
+    db.putRegionResource(region2->getID(), tile(1), fixture::response);
+    db.putRegionResource(region2->getID(), tile(2), fixture::response);
+    // An ambient tile becomes part of a region when it is downloaded again.
+    db.put(tile(3), fixture::response);
+    db.putRegionResource(region1->getID(), tile(3), fixture::response);
+    EXPECT_EQ((std::vector<int64_t>{1, 0, 0, 0}), databaseTileAmbientFlags(filename));
+
+    // Tiles become ambient once no region uses them anymore.
+    db.deleteRegion(std::move(*region2));
+    EXPECT_EQ((std::vector<int64_t>{1, 0, 1, 0}), databaseTileAmbientFlags(filename));
+    db.deleteRegion(std::move(*region1));
+    EXPECT_EQ((std::vector<int64_t>{1, 1, 1, 1}), databaseTileAmbientFlags(filename));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(DeduplicateTileData)) {
+    FixtureLog log;
+    deleteDatabaseFiles();
+    OfflineDatabase db(filename, fixture::tileServerOptions);
+
+    OfflineTilePyramidRegionDefinition definition{"", LatLngBounds::world(), 0, INFINITY, 1.0, true};
+    auto region = db.createRegion(definition, OfflineRegionMetadata());
+    ASSERT_TRUE(region);
+
+    const auto tile = [](int32_t x) {
+        return Resource::tile("http://example.com/{z}-{x}-{y}", 1, x, 0, 4, Tileset::Scheme::XYZ);
+    };
+
+    Response water;
+    water.data = randomString(1024);
+    Response land;
+    land.data = randomString(2048);
+
+    for (int32_t x = 0; x < 8; ++x) {
+        db.putRegionResource(region->getID(), tile(x), water);
+    }
+    db.putRegionResource(region->getID(), tile(8), land);
+    db.put(tile(9), water);
+    EXPECT_EQ(2, databaseTileDataCount(filename));
+
+    for (int32_t x : {0, 7, 9}) {
+        auto result = db.get(tile(x));
+        ASSERT_TRUE(result && result->data);
+        EXPECT_EQ(*water.data, *result->data);
+    }
+
+    // Shared contents count once towards the size of the region.
+    auto status = db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_EQ(9u, status->completedTileCount);
+    EXPECT_EQ(1024u + 2048u, status->completedTileSize);
+
+    // A download adds the same size as the region gains.
+    Response rock;
+    rock.data = randomString(512);
+    OfflineRegionStatus downloadStatus;
+    EXPECT_EQ(std::vector<uint64_t>({0u, 512u, 0u}),
+              db.putRegionResources(region->getID(), {{tile(10), water}, {tile(11), rock}, {tile(12), rock}},
+                                    downloadStatus));
+    EXPECT_EQ(3u, downloadStatus.completedTileCount);
+    EXPECT_EQ(512u, downloadStatus.completedTileSize);
+    status = db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_EQ(12u, status->completedTileCount);
+    EXPECT_EQ(1024u + 2048u + 512u, status->completedTileSize);
+
+    // Contents are deleted along with the last tile using them.
+    db.put(tile(8), water);
+    EXPECT_EQ(2, databaseTileDataCount(filename));
+    db.deleteRegion(std::move(*region));
+    db.clearAmbientCache();
+    EXPECT_EQ(0, databaseTileDataCount(filename));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
+TEST(OfflineDatabase, EvictAmbientCacheBatch) {
+    FixtureLog log;
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    db.setMaximumAmbientCacheSize(1024 * 200);
+
+    Response response;
+    response.data = randomString(1024);
+
+    const auto resource = [](uint32_t i) {
+        return Resource::style("http://example.com/"s + util::toString(i));
+    };
+    const auto retained = [&] {
+        std::vector<uint32_t> result;
+        for (uint32_t i = 1; i <= 300; ++i) {
+            if (db.get(resource(i))) {
+                result.push_back(i);
+            }
+        }
+        return result;
+    };
+
+    // Nothing is evicted below the high watermark.
+    db.put(resource(1), response);
+    EXPECT_FALSE(db.evictAmbientCacheBatch());
+    EXPECT_EQ((std::vector<uint32_t>{1}), retained());
+
+    // put() only evicts what it needs to stay below the maximum size.
+    for (uint32_t i = 2; i <= 300; ++i) {
+        db.put(resource(i), response);
+    }
+    const auto before = retained();
+    ASSERT_FALSE(before.empty());
+
+    while (db.evictAmbientCacheBatch()) {
+    }
+    const auto after = retained();
+
+    // Batches evict the least recently used resources down to the low watermark.
+    ASSERT_FALSE(after.empty());
+    EXPECT_LT(after.size(), before.size());
+    EXPECT_EQ(300u, after.back());
+    EXPECT_EQ(after.size(), after.back() - after.front() + 1);
+
+    // Once below the low watermark, eviction waits for the high watermark again.
+    EXPECT_FALSE(db.evictAmbientCacheBatch());
+    EXPECT_EQ(after, retained());
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
 TEST(OfflineDatabase, GetRegionCompletedStatus) {
     FixtureLog log;
     OfflineDatabase db(":memory:", fixture::tileServerOptions);
@@ -1224,6 +1542,165 @@ TEST(OfflineDatabase, GetRegionCompletedStatus) {
     EXPECT_EQ(0u, log.uncheckedCount());
 }
 
+TEST(OfflineDatabase, RegionTileCursor) {
+    FixtureLog log;
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    OfflineTilePyramidRegionDefinition definition{
+        "http://example.com/style", LatLngBounds::hull({1, 2}, {3, 4}), 5, 6, 2.0, false};
+    auto region = db.createRegion(definition, OfflineRegionMetadata());
+    ASSERT_TRUE(region);
+
+    const std::string urlTemplate = "http://example.com/{z}-{x}-{y}";
+    EXPECT_FALSE(db.getRegionTileCursor(region->getID(), urlTemplate, {5, 6}));
+
+    OfflineDatabase::RegionTileCursor cursor;
+    cursor.position = 10;
+    cursor.completedCount = 8;
+    cursor.completedSize = 1024;
+    db.putRegionTileCursor(region->getID(), urlTemplate, {5, 6}, cursor);
+    cursor.position = 12;
+    cursor.completedCount = 9;
+    cursor.completedSize = 2048;
+    db.putRegionTileCursor(region->getID(), urlTemplate, {5, 6}, cursor);
+
+    auto stored = db.getRegionTileCursor(region->getID(), urlTemplate, {5, 6});
+    ASSERT_TRUE(stored);
+    EXPECT_EQ(12u, stored->position);
+    EXPECT_EQ(9u, stored->completedCount);
+    EXPECT_EQ(2048u, stored->completedSize);
+
+    // Cursors are kept per tileset and zoom range.
+    EXPECT_FALSE(db.getRegionTileCursor(region->getID(), urlTemplate, {5, 7}));
+    EXPECT_FALSE(db.getRegionTileCursor(region->getID(), "http://example.com/other/{z}-{x}-{y}", {5, 6}));
+
+    db.deleteRegionTileCursors(region->getID());
+    EXPECT_FALSE(db.getRegionTileCursor(region->getID(), urlTemplate, {5, 6}));
+
+    // Deleting the region deletes its cursors.
+    db.putRegionTileCursor(region->getID(), urlTemplate, {5, 6}, cursor);
+    const int64_t regionID = region->getID();
+    db.deleteRegion(std::move(*region));
+    EXPECT_FALSE(db.getRegionTileCursor(regionID, urlTemplate, {5, 6}));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
+TEST(OfflineDatabase, ImportRegionTilesMBTiles) {
+    FixtureLog log;
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    OfflineTilePyramidRegionDefinition definition{
+        "http://example.com/style", LatLngBounds::world(), 0, 1, 1.0, false};
+    auto region = db.createRegion(definition, OfflineRegionMetadata());
+    ASSERT_TRUE(region);
+
+    const std::string archivePath = "test/fixtures/storage/mbtiles/geography-class-png.mbtiles";
+    const std::string urlTemplate = "http://example.com/{z}/{x}/{y}.png";
+    auto imported = db.importRegionTiles(region->getID(), archivePath, urlTemplate);
+    ASSERT_TRUE(imported);
+    EXPECT_EQ(5u, *imported);
+
+    auto status = db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_EQ(5u, status->completedTileCount);
+
+    // MBTiles rows are in the TMS scheme; tiles are stored for XYZ tilesets.
+    auto archive = mapbox::sqlite::Database::open(archivePath, mapbox::sqlite::ReadOnly);
+    mapbox::sqlite::Statement statement(
+        archive, "SELECT tile_data FROM tiles WHERE zoom_level = 1 AND tile_column = 1 AND tile_row = 1");
+    mapbox::sqlite::Query query{statement};
+    ASSERT_TRUE(query.run());
+    auto response = db.get(Resource::tile(urlTemplate, 1.0, 1, 0, 1, Tileset::Scheme::XYZ));
+    ASSERT_TRUE(response && response->data);
+    EXPECT_EQ(query.get<std::string>(0), *response->data);
+
+    // Importing again stores nothing new.
+    imported = db.importRegionTiles(region->getID(), archivePath, urlTemplate);
+    ASSERT_TRUE(imported);
+    EXPECT_EQ(5u, *imported);
+    status = db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_EQ(5u, status->completedTileCount);
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
+TEST(OfflineDatabase, ImportRegionTilesPMTiles) {
+    FixtureLog log;
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    OfflineTilePyramidRegionDefinition definition{
+        "http://example.com/style", LatLngBounds::world(), 0, 3, 2.0, false};
+    auto region = db.createRegion(definition, OfflineRegionMetadata());
+    ASSERT_TRUE(region);
+
+    // Uncompressed raster tiles, stored in runs.
+    const std::string rasterTemplate = "http://example.com/{z}/{x}/{y}{ratio}.png";
+    auto imported =
+        db.importRegionTiles(region->getID(), "test/fixtures/storage/pmtiles/raster.pmtiles", rasterTemplate);
+    ASSERT_TRUE(imported);
+    EXPECT_EQ(21u, *imported);
+
+    // Gzipped vector tiles in leaf directories stay compressed.
+    const std::string vectorTemplate = "http://example.com/{z}/{x}/{y}.pbf";
+    imported =
+        db.importRegionTiles(region->getID(), "test/fixtures/storage/pmtiles/vector-leaves.pmtiles", vectorTemplate);
+    ASSERT_TRUE(imported);
+    EXPECT_EQ(85u, *imported);
+
+    auto status = db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_EQ(106u, status->completedTileCount);
+
+    pmtiles::Archive archive("test/fixtures/storage/pmtiles/vector-leaves.pmtiles");
+    auto stored = archive.tile(3, 5, 2);
+    ASSERT_TRUE(stored);
+    Resource resource = Resource::tile(vectorTemplate, 2.0, 5, 2, 3, Tileset::Scheme::XYZ);
+    resource.acceptsCompressedData = true;
+    auto response = db.get(resource);
+    ASSERT_TRUE(response && response->data);
+    EXPECT_TRUE(response->compressed);
+    EXPECT_EQ(std::string(stored->first, stored->second), *response->data);
+
+    // The raster template has a {ratio} token, so its tiles are stored at pixel ratio 2.
+    response = db.get(Resource::tile(rasterTemplate, 2.0, 0, 0, 0, Tileset::Scheme::XYZ));
+    ASSERT_TRUE(response && response->data);
+    EXPECT_FALSE(db.get(Resource::tile(rasterTemplate, 1.0, 0, 0, 0, Tileset::Scheme::XYZ)));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
+TEST(OfflineDatabase, ImportRegionTilesErrors) {
+    FixtureLog log;
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    OfflineTilePyramidRegionDefinition definition{
+        "http://example.com/style", LatLngBounds::world(), 0, 1, 1.0, false};
+    auto region = db.createRegion(definition, OfflineRegionMetadata());
+    ASSERT_TRUE(region);
+
+    auto imported = db.importRegionTiles(
+        region->getID(), "test/fixtures/storage/assets/nonempty", "http://example.com/{z}/{x}/{y}.png");
+    EXPECT_FALSE(imported);
+    EXPECT_EQ(1u,
+              log.count({EventSeverity::Error,
+                         Event::Database,
+                         -1,
+                         "Can't import region tiles: not an MBTiles or PMTiles archive: "
+                         "test/fixtures/storage/assets/nonempty"}));
+
+    // Tiles of canonical tilesets count towards the offline tile limit. The
+    // tile that exceeds it is kept, as when downloading.
+    db.setOfflineMapboxTileCountLimit(3);
+    imported = db.importRegionTiles(region->getID(),
+                                    "test/fixtures/storage/mbtiles/geography-class-png.mbtiles",
+                                    "maptiler://tiles/{z}/{x}/{y}.png");
+    ASSERT_FALSE(imported);
+    EXPECT_THROW(std::rethrow_exception(imported.error()), MapboxTileLimitExceededException);
+    auto status = db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_EQ(4u, status->completedTileCount);
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
 TEST(OfflineDatabase, HasRegionResource) {
     FixtureLog log;
     OfflineDatabase db(":memory:", fixture::tileServerOptions);
@@ -1419,7 +1896,7 @@ TEST(OfflineDatabase, MigrateFromV2Schema) {
         }
     }
 
-    EXPECT_EQ(6, databaseUserVersion(filename));
+    EXPECT_EQ(10, databaseUserVersion(filename));
     EXPECT_LT(databasePageCount(filename), databasePageCount("test/fixtures/offline_database/v2.db"));
 
     EXPECT_EQ(0u, log.uncheckedCount());
@@ -1441,7 +1918,7 @@ TEST(OfflineDatabase, MigrateFromV3Schema) {
         }
     }
 
-    EXPECT_EQ(6, databaseUserVersion(filename));
+    EXPECT_EQ(10, databaseUserVersion(filename));
 
     EXPECT_EQ(0u, log.uncheckedCount());
 }
@@ -1463,7 +1940,7 @@ TEST(OfflineDatabase, MigrateFromV4Schema) {
         }
     }
 
-    EXPECT_EQ(6, databaseUserVersion(filename));
+    EXPECT_EQ(10, databaseUserVersion(filename));
 
     // Journal mode should be DELETE after migration to v5.
     EXPECT_EQ("delete", databaseJournalMode(filename));
@@ -1490,7 +1967,7 @@ TEST(OfflineDatabase, MigrateFromV5Schema) {
         }
     }
 
-    EXPECT_EQ(6, databaseUserVersion(filename));
+    EXPECT_EQ(10, databaseUserVersion(filename));
 
     EXPECT_EQ((std::vector<std::string>{"id",
                                         "url_template",
@@ -1504,12 +1981,22 @@ TEST(OfflineDatabase, MigrateFromV5Schema) {
                                         "data",
                                         "compressed",
                                         "accessed",
-                                        "must_revalidate"}),
+                                        "must_revalidate",
+                                        "ambient",
+                                        "data_id"}),
               databaseTableColumns(filename, "tiles"));
-    EXPECT_EQ(
-        (std::vector<std::string>{
-            "id", "url", "kind", "expires", "modified", "etag", "data", "compressed", "accessed", "must_revalidate"}),
-        databaseTableColumns(filename, "resources"));
+    EXPECT_EQ((std::vector<std::string>{"id",
+                                        "url",
+                                        "kind",
+                                        "expires",
+                                        "modified",
+                                        "etag",
+                                        "data",
+                                        "compressed",
+                                        "accessed",
+                                        "must_revalidate",
+                                        "ambient"}),
+              databaseTableColumns(filename, "resources"));
 
     EXPECT_EQ(0u, log.uncheckedCount());
 }
@@ -1535,6 +2022,35 @@ TEST(OfflineDatabase, IncrementalVacuum) {
     EXPECT_EQ(0u, log.uncheckedCount());
 }
 
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(MigrateFromV6Schema)) {
+    FixtureLog log;
+    deleteDatabaseFiles();
+
+    util::copyFile(filename, "test/fixtures/offline_database/v5.db");
+
+    {
+        // Turn the v5 database into a v6 one, with a region tile and an ambient tile.
+        mapbox::sqlite::Database db = mapbox::sqlite::Database::open(filename, mapbox::sqlite::ReadWriteCreate);
+        db.exec("ALTER TABLE resources ADD COLUMN must_revalidate INTEGER NOT NULL DEFAULT 0");
+        db.exec("ALTER TABLE tiles ADD COLUMN must_revalidate INTEGER NOT NULL DEFAULT 0");
+        db.exec(
+            "INSERT INTO tiles (id, url_template, pixel_ratio, z, x, y, accessed) "
+            "VALUES (1, 'http://example.com/{z}-{x}-{y}', 1, 0, 0, 0, 0), "
+            "       (2, 'http://example.com/{z}-{x}-{y}', 1, 1, 0, 0, 0)");
+        db.exec("INSERT INTO regions (id, definition) VALUES (1, '{}')");
+        db.exec("INSERT INTO region_tiles (region_id, tile_id) VALUES (1, 1)");
+        db.exec("PRAGMA user_version = 6");
+    }
+
+    { OfflineDatabase db(filename, fixture::tileServerOptions); }
+
+    EXPECT_EQ(10, databaseUserVersion(filename));
+    EXPECT_EQ((std::vector<std::string>{"id", "url_template", "data"}), databaseTableColumns(filename, "dictionaries"));
+    EXPECT_EQ((std::vector<int64_t>{0, 1}), databaseTileAmbientFlags(filename));
+
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
 TEST(OfflineDatabase, DowngradeSchema) {
     // v999.db is a v999 database, it should be deleted
     // and recreated with the current schema.
@@ -1547,7 +2063,7 @@ TEST(OfflineDatabase, DowngradeSchema) {
         db.setMaximumAmbientCacheSize(0);
     }
 
-    EXPECT_EQ(6, databaseUserVersion(filename));
+    EXPECT_EQ(10, databaseUserVersion(filename));
 
     EXPECT_EQ((std::vector<std::string>{"id",
                                         "url_template",
@@ -1561,12 +2077,22 @@ TEST(OfflineDatabase, DowngradeSchema) {
                                         "data",
                                         "compressed",
                                         "accessed",
-                                        "must_revalidate"}),
+                                        "must_revalidate",
+                                        "ambient",
+                                        "data_id"}),
               databaseTableColumns(filename, "tiles"));
-    EXPECT_EQ(
-        (std::vector<std::string>{
-            "id", "url", "kind", "expires", "modified", "etag", "data", "compressed", "accessed", "must_revalidate"}),
-        databaseTableColumns(filename, "resources"));
+    EXPECT_EQ((std::vector<std::string>{"id",
+                                        "url",
+                                        "kind",
+                                        "expires",
+                                        "modified",
+                                        "etag",
+                                        "data",
+                                        "compressed",
+                                        "accessed",
+                                        "must_revalidate",
+                                        "ambient"}),
+              databaseTableColumns(filename, "resources"));
 
     EXPECT_EQ(
         1u,
@@ -1630,6 +2156,47 @@ TEST(OfflineDatabase, CorruptDatabaseOnQuery) {
     }
 }
 
+TEST(OfflineDatabase, CorruptDatabaseOnReadOnlyQuery) {
+    FixtureLog log;
+    util::deleteFile(filename);
+    util::copyFile(filename, "test/fixtures/offline_database/corrupt-delayed.db");
+    const std::string corrupt = util::read_file(filename);
+
+    // A read connection that finds the database corrupt, or moved away by a
+    // reset, leaves the file to the writer.
+    OfflineDatabase reader(filename, fixture::tileServerOptions, true);
+    EXPECT_EQ(std::nullopt, reader.get(fixture::tile));
+    EXPECT_EQ(1u, log.count(error(ResultCode::Corrupt, "Can't read resource: database disk image is malformed"), true));
+    EXPECT_EQ(0u, log.uncheckedCount());
+    EXPECT_EQ(corrupt, util::read_file(filename));
+
+    // The writer replaces the file, and the read connection opens the new one.
+    OfflineDatabase writer(filename, fixture::tileServerOptions);
+    EXPECT_EQ(std::nullopt, writer.get(fixture::tile));
+    EXPECT_EQ(1u, log.count(error(ResultCode::Corrupt, "Can't read resource: database disk image is malformed"), true));
+    EXPECT_EQ(
+        1u,
+        log.count({EventSeverity::Warning, Event::Database, -1, "Removing existing incompatible offline database"}));
+    EXPECT_EQ(std::make_pair(true, uint64_t(5)), writer.put(fixture::tile, fixture::response));
+
+    auto result = reader.get(fixture::tile);
+    ASSERT_TRUE(result && result->data);
+    EXPECT_EQ("first", *result->data);
+    EXPECT_EQ(0u, log.uncheckedCount());
+
+    // Nor does a read connection reset the database.
+    EXPECT_TRUE(reader.resetDatabase());
+    EXPECT_EQ(1u,
+              log.count({EventSeverity::Error,
+                         Event::Database,
+                         -1,
+                         "Can't reset database: Cannot modify database in read-only mode"}));
+    result = writer.get(fixture::tile);
+    ASSERT_TRUE(result && result->data);
+    EXPECT_EQ("first", *result->data);
+    EXPECT_EQ(0u, log.uncheckedCount());
+}
+
 #ifndef __QT__ // Qt doesn't expose the ability to register virtual file system handlers.
 TEST(OfflineDatabase, TEST_REQUIRES_WRITE(DisallowedIO)) {
     FixtureLog log;
@@ -1649,7 +2216,6 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(DisallowedIO)) {
     fs.allowIO(false);
 
     EXPECT_EQ(std::nullopt, db.get(fixture::resource));
-    EXPECT_EQ(1u, log.count(warning(ResultCode::Auth, "Can't update timestamp: authorization denied")));
     EXPECT_EQ(1u, log.count(warning(ResultCode::Auth, "Can't read resource: authorization denied")));
     EXPECT_EQ(0u, log.uncheckedCount());
 
@@ -1670,7 +2236,6 @@ TEST(OfflineDatabase, TEST_REQUIRES_WRITE(DisallowedIO)) {
     EXPECT_EQ(0u, log.uncheckedCount());
 
     EXPECT_EQ(std::nullopt, db.getRegionResource(fixture::resource));
-    EXPECT_EQ(1u, log.count(warning(ResultCode::Auth, "Can't update timestamp: authorization denied")));
     EXPECT_EQ(1u, log.count(warning(ResultCode::Auth, "Can't read region resource: authorization denied")));
     EXPECT_EQ(0u, log.uncheckedCount());
 
@@ -1823,6 +2388,27 @@ TEST(OfflineDatabase, MergeDatabaseWithMultipleRegions_New) {
     EXPECT_EQ(200u, status->completedResourceCount);
 }
 
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(MergeDatabaseWithZstdTiles)) {
+    util::deleteFile(filename_sideload);
+    util::copyFile(filename_sideload, "test/fixtures/offline_database/sideload_sat.db");
+    {
+        mapbox::sqlite::Database side =
+            mapbox::sqlite::Database::open(filename_sideload, mapbox::sqlite::ReadWriteCreate);
+        side.exec("UPDATE tiles SET compressed = 2");
+    }
+
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    auto result = db.mergeDatabase(filename_sideload);
+    if (util::zstd::supported()) {
+        EXPECT_TRUE(result);
+        return;
+    }
+
+    // Builds without zstd refuse the merge instead of copying tiles they can't read.
+    ASSERT_FALSE(result);
+    EXPECT_EQ(0u, db.listRegions()->size());
+}
+
 TEST(OfflineDatabase, MergeDatabaseWithMultipleRegionsWithOverlap) {
     deleteDatabaseFiles();
     util::deleteFile(filename_sideload);
@@ -1865,6 +2451,101 @@ TEST(OfflineDatabase, MergeDatabaseWithMultipleRegionsWithOverlap) {
     }
 }
 
+TEST(OfflineDatabase, MergeDatabaseInChunks) {
+    util::deleteFile(filename_sideload);
+    util::copyFile(filename_sideload, "test/fixtures/offline_database/sideload_sat_multiple.db");
+
+    OfflineDatabase db(":memory:", fixture::tileServerOptions);
+    EXPECT_FALSE(db.mergeChunk());
+    EXPECT_FALSE(db.finishMerge());
+
+    auto progress = db.beginMerge(filename_sideload);
+    ASSERT_TRUE(progress);
+    EXPECT_TRUE(db.isMerging());
+    EXPECT_EQ(5u, progress->tileCount);
+    EXPECT_LT(0u, progress->resourceCount);
+    EXPECT_EQ(0u, progress->completedTileCount);
+    EXPECT_EQ(0u, progress->completedResourceCount);
+
+    // Only one merge can be in progress.
+    EXPECT_FALSE(db.beginMerge(filename_sideload));
+
+    // The regions exist, and get their tiles and resources chunk by chunk.
+    EXPECT_EQ(2u, db.listRegions()->size());
+
+    size_t chunks = 0;
+    while (!progress->complete()) {
+        auto next = db.mergeChunk();
+        ASSERT_TRUE(next);
+        EXPECT_LE(progress->completedTileCount, next->completedTileCount);
+        EXPECT_LE(progress->completedResourceCount, next->completedResourceCount);
+        EXPECT_LE(next->completedTileCount, next->tileCount);
+        EXPECT_LE(next->completedResourceCount, next->resourceCount);
+        progress = next;
+        ASSERT_GT(100u, ++chunks);
+    }
+    EXPECT_LT(1u, chunks);
+
+    auto result = db.finishMerge();
+    ASSERT_TRUE(result);
+    EXPECT_FALSE(db.isMerging());
+    EXPECT_EQ(2u, result->size());
+
+    auto status = db.getRegionCompletedStatus(result->front().getID());
+    EXPECT_EQ(398u, status->completedResourceCount);
+    EXPECT_EQ(5u, status->completedTileCount);
+    status = db.getRegionCompletedStatus(result->back().getID());
+    EXPECT_EQ(0u, status->completedTileCount);
+    EXPECT_EQ(200u, status->completedResourceCount);
+
+    // Merging again adds no regions and no duplicate contents.
+    result = db.mergeDatabase(filename_sideload);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(2u, db.listRegions()->size());
+    status = db.getRegionCompletedStatus(result->front().getID());
+    EXPECT_EQ(398u, status->completedResourceCount);
+    EXPECT_EQ(5u, status->completedTileCount);
+}
+
+TEST(OfflineDatabase, TEST_REQUIRES_WRITE(InterruptedMergeLeavesNoTileData)) {
+    deleteDatabaseFiles();
+    util::deleteFile(filename_sideload);
+
+    const Resource tile = Resource::tile("http://example.com/{z}-{x}-{y}", 1, 0, 0, 0, Tileset::Scheme::XYZ);
+    {
+        OfflineDatabase side(filename_sideload, fixture::tileServerOptions);
+        OfflineTilePyramidRegionDefinition definition{"", LatLngBounds::world(), 0, INFINITY, 1.0, true};
+        auto region = side.createRegion(definition, OfflineRegionMetadata());
+        ASSERT_TRUE(region);
+        Response response;
+        response.data = randomString(1024);
+        response.modified = Timestamp(Seconds(2));
+        side.putRegionResource(region->getID(), tile, response);
+    }
+
+    {
+        OfflineDatabase db(filename, fixture::tileServerOptions);
+        Response response;
+        response.data = randomString(1024);
+        response.modified = Timestamp(Seconds(1));
+        db.put(tile, response);
+        EXPECT_EQ(1, databaseTileDataCount(filename));
+
+        // The merged tile replaces the older one, whose contents are only
+        // deleted once the merge ends. This one is interrupted.
+        ASSERT_TRUE(db.beginMerge(filename_sideload));
+        ASSERT_TRUE(db.mergeChunk());
+        EXPECT_EQ(1, databaseTileDataCount(filename));
+    }
+
+    OfflineDatabase db(filename, fixture::tileServerOptions);
+    EXPECT_FALSE(db.pack());
+    EXPECT_EQ(0, databaseTileDataCount(filename));
+    auto result = db.get(tile);
+    ASSERT_TRUE(result && result->data);
+    EXPECT_EQ(1024u, result->data->size());
+}
+
 TEST(OfflineDatabase, MergeDatabaseWithSingleRegionTooManyNewTiles) {
     FixtureLog log;
     util::deleteFile(filename_sideload);
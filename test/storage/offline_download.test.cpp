@@ -673,6 +673,113 @@ TEST(OfflineDownload, WithPreviouslyExistingTile) {
     test.loop.run();
 }
 
+TEST(OfflineDownload, ResumeFromTileCursor) {
+    OfflineTest test;
+    auto region = test.createRegion();
+    ASSERT_TRUE(region);
+    OfflineDownload download(region->getID(),
+                             OfflineTilePyramidRegionDefinition(
+                                 "http://127.0.0.1:3000/style.json", LatLngBounds::world(), 0.0, 1.0, 1.0, false),
+                             test.db,
+                             test.fileSource);
+
+    // An earlier download got through three of the five tiles: two of them
+    // were stored, 100 bytes in total, and one was not found.
+    const std::string urlTemplate = "http://127.0.0.1:3000/{z}-{x}-{y}.vector.pbf";
+    OfflineDatabase::RegionTileCursor cursor;
+    cursor.position = 3;
+    cursor.completedCount = 2;
+    cursor.completedSize = 100;
+    test.db.putRegionTileCursor(region->getID(), urlTemplate, {0, 1}, cursor);
+
+    test.fileSource.styleResponse = [&](const Resource& resource) {
+        EXPECT_EQ("http://127.0.0.1:3000/style.json", resource.url);
+        return test.response("inline_source.style.json");
+    };
+
+    // Both remaining tiles have the same contents, which count once.
+    unsigned tileRequests = 0;
+    std::optional<Response> tile;
+    test.fileSource.tileResponse = [&](const Resource& resource) {
+        EXPECT_EQ(urlTemplate, resource.tileData->urlTemplate);
+        EXPECT_EQ(1, resource.tileData->z);
+        tileRequests++;
+        if (!tile) {
+            tile = test.response("0-0-0.vector.pbf");
+        }
+        return *tile;
+    };
+
+    auto observer = std::make_unique<MockObserver>();
+
+    observer->statusChangedFn = [&](OfflineRegionStatus status) {
+        if (status.complete()) {
+            EXPECT_EQ(2u, tileRequests);
+            EXPECT_EQ(4u, status.completedTileCount);
+            EXPECT_EQ(5u, status.completedResourceCount);
+            EXPECT_EQ(test.size + 100, status.completedResourceSize);
+            test.loop.stop();
+        }
+    };
+
+    download.setObserver(std::move(observer));
+    download.setState(OfflineRegionDownloadState::Active);
+
+    test.loop.run();
+
+    // Once complete, activating the download again checks all tiles.
+    EXPECT_FALSE(test.db.getRegionTileCursor(region->getID(), urlTemplate, {0, 1}));
+}
+
+TEST(OfflineDownload, DeactivateBeforeFoundTilesAreMarked) {
+    OfflineTest test;
+    auto region = test.createRegion();
+    ASSERT_TRUE(region);
+    OfflineDownload download(region->getID(),
+                             OfflineTilePyramidRegionDefinition(
+                                 "http://127.0.0.1:3000/style.json", LatLngBounds::world(), 0.0, 1.0, 1.0, false),
+                             test.db,
+                             test.fileSource);
+
+    test.fileSource.styleResponse = [&](const Resource& resource) {
+        EXPECT_EQ("http://127.0.0.1:3000/style.json", resource.url);
+        return test.response("inline_source.style.json");
+    };
+
+    // All tiles are in the database already, so they are only marked as used
+    // by the region, in batches.
+    const std::string urlTemplate = "http://127.0.0.1:3000/{z}-{x}-{y}.vector.pbf";
+    test.db.put(Resource::tile(urlTemplate, 1, 0, 0, 0, Tileset::Scheme::XYZ), test.response("0-0-0.vector.pbf"));
+    for (int32_t x = 0; x < 2; x++) {
+        for (int32_t y = 0; y < 2; y++) {
+            test.db.put(Resource::tile(urlTemplate, 1, x, y, 1, Tileset::Scheme::XYZ),
+                        test.response("0-0-0.vector.pbf"));
+        }
+    }
+
+    auto observer = std::make_unique<MockObserver>();
+    observer->statusChangedFn = [&](OfflineRegionStatus status) {
+        // Deactivate once the first tile is done, long before a batch is full.
+        if (status.downloadState == OfflineRegionDownloadState::Active && status.completedTileCount > 0) {
+            download.setState(OfflineRegionDownloadState::Inactive);
+            test.loop.stop();
+        }
+    };
+
+    download.setObserver(std::move(observer));
+    download.setState(OfflineRegionDownloadState::Active);
+
+    test.loop.run();
+
+    // The tiles the saved cursor passed belong to the region.
+    auto cursor = test.db.getRegionTileCursor(region->getID(), urlTemplate, {0, 1});
+    ASSERT_TRUE(cursor);
+    EXPECT_LT(0u, cursor->completedCount);
+    auto status = test.db.getRegionCompletedStatus(region->getID());
+    ASSERT_TRUE(status);
+    EXPECT_LE(cursor->completedCount, status->completedTileCount);
+}
+
 TEST(OfflineDownload, ReactivatePreviouslyCompletedDownload) {
     OfflineTest test;
     auto region = test.createRegion();
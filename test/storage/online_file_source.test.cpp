@@ -589,6 +589,77 @@ TEST(OnlineFileSource, TEST_REQUIRES_SERVER(LowHighPriorityRequestsMany)) {
     loop.run();
 }
 
+TEST(OnlineFileSource, TEST_REQUIRES_SERVER(PriorityOrder)) {
+    util::RunLoop loop;
+    std::unique_ptr<FileSource> fs = std::make_unique<OnlineFileSource>(ResourceOptions::Default(), ClientOptions());
+
+    NetworkStatus::Set(NetworkStatus::Status::Offline);
+    fs->setProperty(MAX_CONCURRENT_REQUESTS_KEY, 1u);
+    fs->pause();
+
+    // Queued from least to most urgent.
+    const std::vector<std::pair<Resource::Priority, uint32_t>> priorities = {{Resource::Priority::Low, 0},
+                                                                             {Resource::Priority::Prefetch, 0},
+                                                                             {Resource::Priority::Regular, 5},
+                                                                             {Resource::Priority::Regular, 1},
+                                                                             {Resource::Priority::High, 0}};
+    std::vector<size_t> order;
+    std::vector<std::unique_ptr<AsyncRequest>> requests;
+    for (size_t i = 0; i < priorities.size(); i++) {
+        Resource resource{Resource::Unknown, "http://127.0.0.1:3000/load/" + std::to_string(i)};
+        resource.setPriority(priorities[i].first);
+        resource.priorityOrder = priorities[i].second;
+        requests.push_back(fs->request(resource, [&, i](Response) {
+            order.push_back(i);
+            if (order.size() == priorities.size()) {
+                loop.stop();
+            }
+        }));
+    }
+
+    fs->resume();
+    NetworkStatus::Set(NetworkStatus::Status::Online);
+    loop.run();
+
+    EXPECT_EQ((std::vector<size_t>{4, 3, 2, 1, 0}), order);
+}
+
+TEST(OnlineFileSource, TEST_REQUIRES_SERVER(UpdatePriority)) {
+    util::RunLoop loop;
+    std::unique_ptr<FileSource> fs = std::make_unique<OnlineFileSource>(ResourceOptions::Default(), ClientOptions());
+
+    NetworkStatus::Set(NetworkStatus::Status::Offline);
+    fs->setProperty(MAX_CONCURRENT_REQUESTS_KEY, 1u);
+    fs->pause();
+
+    std::vector<size_t> order;
+    std::vector<std::unique_ptr<AsyncRequest>> requests;
+    std::vector<Resource> resources;
+    for (size_t i = 0; i < 4; i++) {
+        resources.emplace_back(Resource::Unknown, "http://127.0.0.1:3000/load/" + std::to_string(i));
+        requests.push_back(fs->request(resources.back(), [&, i](Response) {
+            order.push_back(i);
+            if (order.size() == 4) {
+                loop.stop();
+            }
+        }));
+    }
+
+    // The last request is moved ahead of the others, the first one behind them.
+    resources[3].setPriority(Resource::Priority::High);
+    fs->updatePriority(*requests[3], resources[3]);
+    resources[0].setPriority(Resource::Priority::Low);
+    fs->updatePriority(*requests[0], resources[0]);
+
+    fs->resume();
+    NetworkStatus::Set(NetworkStatus::Status::Online);
+    loop.run();
+
+    ASSERT_EQ(4u, order.size());
+    EXPECT_EQ(3u, order.front());
+    EXPECT_EQ(0u, order.back());
+}
+
 TEST(OnlineFileSource, TEST_REQUIRES_SERVER(MaximumConcurrentRequests)) {
     util::RunLoop loop;
     std::unique_ptr<FileSource> fs = std::make_unique<OnlineFileSource>(ResourceOptions::Default(), ClientOptions());
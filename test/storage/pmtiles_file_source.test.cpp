@@ -0,0 +1,205 @@
+#include <mbgl/storage/pmtiles_file_source.hpp>
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/storage/resource_options.hpp>
+#include <mbgl/util/compression.hpp>
+#include <mbgl/util/platform.hpp>
+#include <mbgl/util/run_loop.hpp>
+
+#include <cassert>
+#include <climits>
+#include <tuple>
+#include <gtest/gtest.h>
+
+#if defined(WIN32)
+#include <Windows.h>
+#ifndef PATH_MAX
+#define PATH_MAX MAX_PATH
+#endif /* PATH_MAX */
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string toAbsoluteURL(const std::string &fileName) {
+    char buff[PATH_MAX + 1];
+#ifdef _MSC_VER
+    char *cwd = _getcwd(buff, PATH_MAX + 1);
+#else
+    char *cwd = getcwd(buff, PATH_MAX + 1);
+#endif
+    std::string url = {"pmtiles://" + std::string(cwd) + "/test/fixtures/storage/pmtiles/" + fileName};
+    assert(url.size() <= PATH_MAX);
+    return url;
+}
+
+// Requests a tile and returns the response. Tiles in the fixtures contain
+// their own "z/x/y" coordinates as text.
+mbgl::Response requestTile(
+    const std::string &fileName, uint8_t z, uint32_t x, uint32_t y, bool acceptsCompressedData = false) {
+    using namespace mbgl;
+    util::RunLoop loop;
+    PMTilesFileSource pmtiles(ResourceOptions::Default(), ClientOptions());
+
+    Resource resource = Resource::tile(
+        toAbsoluteURL(fileName + "?file={z}/{x}/{y}"), 1.0, x, y, z, Tileset::Scheme::XYZ);
+    resource.acceptsCompressedData = acceptsCompressedData;
+
+    Response response;
+    std::unique_ptr<AsyncRequest> req = pmtiles.request(resource, [&](Response res) {
+        req.reset();
+        response = res;
+        loop.stop();
+    });
+
+    loop.run();
+    return response;
+}
+
+} // namespace
+
+using namespace mbgl;
+
+TEST(PMTilesFileSource, AcceptsURL) {
+    PMTilesFileSource pmtiles(ResourceOptions::Default(), ClientOptions());
+    EXPECT_TRUE(pmtiles.canRequest(Resource::style("pmtiles:///test")));
+    EXPECT_FALSE(pmtiles.canRequest(Resource::style("pmtile://test")));
+    EXPECT_FALSE(pmtiles.canRequest(Resource::style("mbtiles:///test")));
+    EXPECT_FALSE(pmtiles.canRequest(Resource::style("pmtiles:")));
+    EXPECT_FALSE(pmtiles.canRequest(Resource::style("")));
+}
+
+// pmtiles paths must be absolute
+TEST(PMTilesFileSource, AbsolutePath) {
+    util::RunLoop loop;
+
+    PMTilesFileSource pmtiles(ResourceOptions::Default(), ClientOptions());
+
+    std::unique_ptr<AsyncRequest> req = pmtiles.request(
+        {Resource::Unknown, "pmtiles://not_absolute"}, [&](Response res) {
+            req.reset();
+            ASSERT_NE(nullptr, res.error);
+            EXPECT_EQ(Response::Error::Reason::Other, res.error->reason);
+            EXPECT_NE((res.error->message).find("absolute"), std::string::npos);
+            ASSERT_FALSE(res.data.get());
+            loop.stop();
+        });
+
+    loop.run();
+}
+
+// Nonexistent pmtiles file raises error
+TEST(PMTilesFileSource, NonExistentFile) {
+    util::RunLoop loop;
+
+    PMTilesFileSource pmtiles(ResourceOptions::Default(), ClientOptions());
+
+    std::unique_ptr<AsyncRequest> req = pmtiles.request(
+        {Resource::Unknown, toAbsoluteURL("does_not_exist")}, [&](Response res) {
+            req.reset();
+            ASSERT_NE(nullptr, res.error);
+            EXPECT_EQ(Response::Error::Reason::NotFound, res.error->reason);
+            EXPECT_NE((res.error->message).find("path not found"), std::string::npos);
+            ASSERT_FALSE(res.data.get());
+            loop.stop();
+        });
+
+    loop.run();
+}
+
+// Files that aren't PMTiles archives raise errors instead of crashing
+TEST(PMTilesFileSource, NotAnArchive) {
+    util::RunLoop loop;
+
+    PMTilesFileSource pmtiles(ResourceOptions::Default(), ClientOptions());
+
+    std::string url = toAbsoluteURL("../mbtiles/geography-class-png.mbtiles");
+    std::unique_ptr<AsyncRequest> req = pmtiles.request({Resource::Unknown, url}, [&](Response res) {
+        req.reset();
+        ASSERT_NE(nullptr, res.error);
+        EXPECT_NE((res.error->message).find("not a PMTiles archive"), std::string::npos);
+        ASSERT_FALSE(res.data.get());
+        loop.stop();
+    });
+
+    loop.run();
+}
+
+// Existing pmtiles file default request returns TileJSON built from the
+// header and the archive metadata
+TEST(PMTilesFileSource, TileJSON) {
+    util::RunLoop loop;
+
+    PMTilesFileSource pmtiles(ResourceOptions::Default(), ClientOptions());
+
+    std::unique_ptr<AsyncRequest> req = pmtiles.request(
+        {Resource::Unknown, toAbsoluteURL("vector-leaves.pmtiles")}, [&](Response res) {
+            req.reset();
+            EXPECT_EQ(nullptr, res.error);
+            ASSERT_TRUE(res.data.get());
+            EXPECT_NE((*res.data).find("vector-leaves.pmtiles?file={z}/{x}/{y}.pbf"), std::string::npos);
+            EXPECT_NE((*res.data).find("\"minzoom\":0"), std::string::npos);
+            EXPECT_NE((*res.data).find("\"maxzoom\":3"), std::string::npos);
+            EXPECT_NE((*res.data).find("\"vector_layers\":[{"), std::string::npos);
+            loop.stop();
+        });
+
+    loop.run();
+}
+
+// Existing tiles return tile data
+TEST(PMTilesFileSource, Tile) {
+    for (const auto &tile : {std::make_tuple(0, 0, 0), std::make_tuple(1, 1, 0), std::make_tuple(2, 3, 1)}) {
+        const auto [z, x, y] = tile;
+        Response res = requestTile("raster.pmtiles", z, x, y);
+        EXPECT_EQ(nullptr, res.error);
+        ASSERT_TRUE(res.data.get());
+        EXPECT_FALSE(res.noContent);
+        EXPECT_EQ(std::to_string(z) + "/" + std::to_string(x) + "/" + std::to_string(y), *res.data);
+    }
+}
+
+// Consecutive tiles with the same contents are stored once, as a run
+TEST(PMTilesFileSource, TileRun) {
+    for (uint32_t x = 0; x < 4; x++) {
+        Response res = requestTile("raster.pmtiles", 2, x, 3);
+        EXPECT_EQ(nullptr, res.error);
+        ASSERT_TRUE(res.data.get());
+        EXPECT_EQ("ocean", *res.data);
+    }
+}
+
+// Tiles are found through leaf directories
+TEST(PMTilesFileSource, LeafDirectory) {
+    for (uint32_t x = 0; x < 8; x++) {
+        for (uint32_t y = 0; y < 8; y++) {
+            Response res = requestTile("vector-leaves.pmtiles", 3, x, y);
+            EXPECT_EQ(nullptr, res.error);
+            ASSERT_TRUE(res.data.get());
+            EXPECT_EQ("3/" + std::to_string(x) + "/" + std::to_string(y), *res.data);
+        }
+    }
+}
+
+// Compressed tiles are passed through when the requester can decompress them
+TEST(PMTilesFileSource, CompressedTile) {
+    Response res = requestTile("vector-leaves.pmtiles", 2, 1, 3, true);
+    EXPECT_EQ(nullptr, res.error);
+    ASSERT_TRUE(res.data.get());
+    EXPECT_TRUE(res.compressed);
+    EXPECT_EQ("2/1/3", util::decompress(*res.data));
+
+    res = requestTile("vector-leaves.pmtiles", 2, 1, 3, false);
+    EXPECT_EQ(nullptr, res.error);
+    ASSERT_TRUE(res.data.get());
+    EXPECT_FALSE(res.compressed);
+    EXPECT_EQ("2/1/3", *res.data);
+}
+
+// Nonexistent tiles do not raise errors, they simply return no content
+TEST(PMTilesFileSource, NonExistentTile) {
+    Response res = requestTile("raster.pmtiles", 4, 0, 0);
+    EXPECT_EQ(nullptr, res.error);
+    ASSERT_FALSE(res.data.get());
+    ASSERT_EQ(res.noContent, true);
+}
@@ -35,6 +35,7 @@
 
 #include <mbgl/util/logging.hpp>
 #include <mbgl/util/range.hpp>
+#include <mbgl/util/tile_cover.hpp>
 #include <mbgl/util/tileset.hpp>
 #include <mbgl/util/timer.hpp>
 
@@ -777,6 +778,7 @@ class FakeTileSource : public RenderTileSetSource {
 public:
     MOCK_METHOD1(tileSetNecessity, void(TileNecessity));
     MOCK_METHOD1(tileSetMinimumUpdateInterval, void(Duration));
+    MOCK_METHOD1(tileSetPriority, void(Resource::Priority));
 
     explicit FakeTileSource(Immutable<style::Source::Impl> impl_)
         : RenderTileSetSource(std::move(impl_)) {}
@@ -807,6 +809,7 @@ void FakeTile::setNecessity(TileNecessity necessity) {
 
 void FakeTile::setUpdateParameters(const TileUpdateParameters& params) {
     source.tileSetMinimumUpdateInterval(params.minimumUpdateInterval);
+    source.tileSetPriority(params.priority);
 }
 
 } // namespace
@@ -877,6 +880,49 @@ TEST(Source, SourceMinimumUpdateInterval) {
     renderSource->update(initialized.baseImpl, layers, true, false, test.tileParameters());
 }
 
+TEST(Source, TransitionTrajectoryTiles) {
+    SourceTest test;
+    VectorSource initialized("source", Tileset{{"tiles"}});
+    initialized.loadDescription(*test.fileSource);
+
+    FakeTileSource renderTilesetSource{initialized.baseImpl};
+    RenderSource* renderSource = &renderTilesetSource;
+    LineLayer layer("id", "source");
+    Immutable<LayerProperties> layerProperties = makeMutable<LineLayerProperties>(
+        staticImmutableCast<LineLayer::Impl>(layer.baseImpl));
+    std::vector<Immutable<LayerProperties>> layers{layerProperties};
+
+    // The camera is about to zoom in from z0 to z2.
+    TransformState destination = test.transformState;
+    destination.setLatLngZoom(LatLng(), 2.0);
+    const std::vector<TransformState> trajectory{destination};
+    const auto trajectoryTileCount = static_cast<int>(util::tileCover(destination, 2).size());
+    ASSERT_GT(trajectoryTileCount, 1);
+
+    TileParameters parameters{1.0,
+                              MapDebugOptions(),
+                              test.transformState,
+                              test.fileSource,
+                              MapMode::Continuous,
+                              test.annotationManager.makeWeakPtr(),
+                              test.imageManager,
+                              test.glyphManager,
+                              0,
+                              &trajectory};
+
+    // Tiles along the trajectory are prefetched.
+    EXPECT_CALL(renderTilesetSource, tileSetNecessity(TileNecessity::Required)).Times(1 + trajectoryTileCount);
+    EXPECT_CALL(renderTilesetSource, tileSetPriority(Resource::Priority::Regular)).Times(1);
+    EXPECT_CALL(renderTilesetSource, tileSetPriority(Resource::Priority::Prefetch)).Times(trajectoryTileCount);
+    renderSource->update(initialized.baseImpl, layers, true, false, parameters);
+
+    // Once the transition is over, their pending requests are cancelled.
+    EXPECT_CALL(renderTilesetSource, tileSetNecessity(TileNecessity::Required)).Times(1);
+    EXPECT_CALL(renderTilesetSource, tileSetNecessity(TileNecessity::Optional)).Times(trajectoryTileCount);
+    EXPECT_CALL(renderTilesetSource, tileSetPriority(Resource::Priority::Regular)).Times(1);
+    renderSource->update(initialized.baseImpl, layers, true, false, test.tileParameters());
+}
+
 TEST(Source, RenderTileSetSourceUpdate) {
     SourceTest test;
 
@@ -0,0 +1,87 @@
+#include <mbgl/test/util.hpp>
+
+#include <mbgl/text/collision_feature.hpp>
+#include <mbgl/text/collision_projection.hpp>
+#include <mbgl/util/constants.hpp>
+
+#include <cstring>
+#include <random>
+
+using namespace mbgl;
+using namespace mbgl::collision;
+
+namespace {
+
+std::vector<CollisionBox> makeBoxes(std::size_t count) {
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> position(-util::EXTENT, 2.0f * util::EXTENT);
+    std::vector<CollisionBox> boxes;
+    for (std::size_t i = 0; i < count; ++i) {
+        boxes.emplace_back(Point<float>{position(generator), position(generator)}, -4.0f, -4.0f, 4.0f, 4.0f);
+    }
+    return boxes;
+}
+
+mat4 makeMatrix(bool pitched) {
+    mat4 matrix;
+    matrix::perspective(matrix, 0.6435, 1.5, 1, 10000);
+    matrix::translate(matrix, matrix, 0, 0, -1000);
+    if (pitched) {
+        matrix::rotate_x(matrix, matrix, 0.9);
+    }
+    matrix::rotate_z(matrix, matrix, 0.3);
+    matrix::scale(matrix, matrix, 0.0625, -0.0625, 1);
+    return matrix;
+}
+
+} // namespace
+
+TEST(CollisionProjection, PathsAreBitIdentical) {
+    // 19 boxes leave a remainder for both the 2- and 4-lane paths.
+    const auto boxes = makeBoxes(19);
+    const Size size{1024, 768};
+    const float padding = 100.0f;
+
+    for (const bool pitched : {false, true}) {
+        const mat4 matrix = makeMatrix(pitched);
+
+        std::vector<float> expectedX(boxes.size());
+        std::vector<float> expectedY(boxes.size());
+        projectAnchors(matrix,
+                       size,
+                       padding,
+                       boxes.data(),
+                       boxes.size(),
+                       expectedX.data(),
+                       expectedY.data(),
+                       ProjectionPath::Scalar);
+
+        for (const auto path : {ProjectionPath::SSE2, ProjectionPath::AVX2}) {
+            if (!supportsProjectionPath(path)) {
+                continue;
+            }
+            std::vector<float> x(boxes.size());
+            std::vector<float> y(boxes.size());
+            projectAnchors(matrix, size, padding, boxes.data(), boxes.size(), x.data(), y.data(), path);
+            EXPECT_EQ(0, std::memcmp(expectedX.data(), x.data(), x.size() * sizeof(float)));
+            EXPECT_EQ(0, std::memcmp(expectedY.data(), y.data(), y.size() * sizeof(float)));
+        }
+    }
+}
+
+TEST(CollisionProjection, MatchesTransform) {
+    const std::vector<CollisionBox> boxes{{{0, 0}, 0, 0, 0, 0}, {{util::EXTENT, util::EXTENT}, 0, 0, 0, 0}};
+    mat4 matrix;
+    matrix::identity(matrix);
+    // Maps tile units to clip space [-1, 1].
+    matrix::translate(matrix, matrix, -1, 1, 0);
+    matrix::scale(matrix, matrix, 2.0 / util::EXTENT, -2.0 / util::EXTENT, 1);
+
+    float x[2];
+    float y[2];
+    projectAnchors(matrix, {512, 256}, 10.0f, boxes.data(), boxes.size(), x, y);
+    EXPECT_FLOAT_EQ(10.0f, x[0]);
+    EXPECT_FLOAT_EQ(10.0f, y[0]);
+    EXPECT_FLOAT_EQ(522.0f, x[1]);
+    EXPECT_FLOAT_EQ(266.0f, y[1]);
+}
@@ -384,6 +384,70 @@ TEST(CrossTileSymbolLayerIndex, bucketReplacement) {
               3u); // C' gets new ID
 }
 
+TEST(CrossTileSymbolLayerIndex, firstMatchInBucketOrder) {
+    uint32_t maxCrossTileID = 0;
+    uint32_t maxBucketInstanceId = 0;
+    CrossTileSymbolLayerIndex index(maxCrossTileID);
+
+    Immutable<style::SymbolLayoutProperties::PossiblyEvaluated> layout =
+        makeMutable<style::SymbolLayoutProperties::PossiblyEvaluated>();
+    bool iconsNeedLinear = false;
+    bool sortFeaturesByY = false;
+    std::string bucketLeaderID = "test";
+
+    OverscaledTileID mainID(6, 0, 6, 8, 8);
+    std::vector<SymbolInstance> mainInstances;
+    std::vector<SortKeyRange> mainRanges;
+    // Both are within tolerance of the child symbol below, but A comes first
+    // in the bucket even though it has the larger x coordinate.
+    mainInstances.push_back(makeSymbolInstance(1064, 1000, u"Detroit")); // A
+    mainInstances.push_back(makeSymbolInstance(1032, 1000, u"Detroit")); // B
+    SymbolBucket mainBucket{layout,
+                            {},
+                            16.0f,
+                            1.0f,
+                            0,
+                            iconsNeedLinear,
+                            sortFeaturesByY,
+                            bucketLeaderID,
+                            std::move(mainInstances),
+                            std::move(mainRanges),
+                            1.0f,
+                            false,
+                            {},
+                            false /*iconsInText*/};
+    mainBucket.bucketInstanceId = ++maxBucketInstanceId;
+    index.addBucket(mainID, mat4{}, mainBucket);
+    ASSERT_EQ(mainBucket.symbolInstances.at(0).crossTileID, 1u);
+    ASSERT_EQ(mainBucket.symbolInstances.at(1).crossTileID, 2u);
+
+    OverscaledTileID childID(7, 0, 7, 16, 16);
+    std::vector<SymbolInstance> childInstances;
+    std::vector<SortKeyRange> childRanges;
+    childInstances.push_back(makeSymbolInstance(2048, 2000, u"Detroit")); // A'
+    childInstances.push_back(makeSymbolInstance(2048, 2000, u"Detroit")); // B'
+    childInstances.push_back(makeSymbolInstance(2048, 2000, u"Detroit")); // C'
+    SymbolBucket childBucket{layout,
+                             {},
+                             16.0f,
+                             1.0f,
+                             0,
+                             iconsNeedLinear,
+                             sortFeaturesByY,
+                             bucketLeaderID,
+                             std::move(childInstances),
+                             std::move(childRanges),
+                             1.0f,
+                             false,
+                             {},
+                             false /*iconsInText*/};
+    childBucket.bucketInstanceId = ++maxBucketInstanceId;
+    index.addBucket(childID, mat4{}, childBucket);
+    ASSERT_EQ(childBucket.symbolInstances.at(0).crossTileID, 1u); // A' copies from A
+    ASSERT_EQ(childBucket.symbolInstances.at(1).crossTileID, 2u); // B' copies from B
+    ASSERT_EQ(childBucket.symbolInstances.at(2).crossTileID, 3u); // C' gets new ID
+}
+
 namespace {
 
 void populatePosMatrix(mat4& posMatrix, const OverscaledTileID& tileId, double lat, double lon, double zoom) {
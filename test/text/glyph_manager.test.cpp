@@ -1,7 +1,10 @@
 #include <mbgl/test/util.hpp>
 #include <mbgl/test/stub_file_source.hpp>
 
+#include <mbgl/storage/resource_options.hpp>
 #include <mbgl/text/glyph_manager.hpp>
+#include <mbgl/text/glyph_store.hpp>
+#include <mbgl/util/chrono.hpp>
 #include <mbgl/util/run_loop.hpp>
 #include <mbgl/util/string.hpp>
 #include <mbgl/util/i18n.hpp>
@@ -145,7 +148,7 @@ public:
 class GlyphManagerTest {
 public:
     util::RunLoop loop;
-    StubFileSource fileSource;
+    std::shared_ptr<StubFileSource> fileSource = std::make_shared<StubFileSource>();
     StubGlyphManagerObserver observer;
     StubGlyphRequestor requestor;
     GlyphManager glyphManager{std::make_unique<StubLocalGlyphRasterizer>()};
@@ -167,7 +170,7 @@ public:
 TEST(GlyphManager, LoadingSuccess) {
     GlyphManagerTest test;
 
-    test.fileSource.glyphsResponse = [&](const Resource& resource) {
+    test.fileSource->glyphsResponse = [&](const Resource& resource) {
         EXPECT_EQ(Resource::Kind::Glyphs, resource.kind);
         Response response;
         response.data = std::make_shared<std::string>(util::read_file("test/fixtures/resources/glyphs.pbf"));
@@ -202,7 +205,7 @@ TEST(GlyphManager, LoadingSuccess) {
 TEST(GlyphManager, LoadingFail) {
     GlyphManagerTest test;
 
-    test.fileSource.glyphsResponse = [&](const Resource&) {
+    test.fileSource->glyphsResponse = [&](const Resource&) {
         Response response;
         response.error = std::make_unique<Response::Error>(Response::Error::Reason::Other, "Failed by the test case");
         return response;
@@ -230,7 +233,7 @@ TEST(GlyphManager, LoadingFail) {
 TEST(GlyphManager, LoadingCorrupted) {
     GlyphManagerTest test;
 
-    test.fileSource.glyphsResponse = [&](const Resource&) {
+    test.fileSource->glyphsResponse = [&](const Resource&) {
         Response response;
         response.data = std::make_unique<std::string>("CORRUPTED");
         return response;
@@ -258,7 +261,7 @@ TEST(GlyphManager, LoadingCorrupted) {
 TEST(GlyphManager, LoadingCancel) {
     GlyphManagerTest test;
 
-    test.fileSource.glyphsResponse = [&](const Resource&) {
+    test.fileSource->glyphsResponse = [&](const Resource&) {
         test.end();
         return std::optional<Response>();
     };
@@ -270,11 +273,64 @@ TEST(GlyphManager, LoadingCancel) {
     test.run("test/fixtures/resources/glyphs.pbf", GlyphDependencies{{{{"Test Stack"}}, {u'a', u'å'}}});
 }
 
+TEST(GlyphManager, LoadingFromGlyphStore) {
+    GlyphManagerTest test;
+    const std::string url = "test/fixtures/resources/glyphs.pbf";
+
+    auto stored = makeMutable<Glyph>();
+    stored->id = u'a';
+    stored->metrics.advance = 42;
+    GlyphStore("test/fixtures/glyph_store").save(url, {"Stored Stack"}, {0, 255}, {std::move(stored)});
+    test.fileSource->setResourceOptions(ResourceOptions().withGlyphCachePath("test/fixtures/glyph_store"));
+
+    test.fileSource->glyphsResponse = [&](const Resource&) {
+        ADD_FAILURE() << "Stored range should not be requested";
+        return Response();
+    };
+
+    test.requestor.glyphsAvailable = [&](GlyphMap glyphs) {
+        const auto& testPositions = glyphs.at(FontStackHasher()({{"Stored Stack"}}));
+        ASSERT_EQ(1u, testPositions.size());
+        ASSERT_TRUE(bool(testPositions.at(u'a')));
+        EXPECT_EQ(42u, (*testPositions.at(u'a'))->metrics.advance);
+        test.end();
+    };
+
+    test.run(url, GlyphDependencies{{{{"Stored Stack"}}, {u'a'}}});
+}
+
+TEST(GlyphManager, GlyphStoreMiss) {
+    GlyphManagerTest test;
+    // A URL of its own, so that no earlier run has stored the range.
+    const std::string url = "test/fixtures/resources/glyphs.pbf?" +
+                            util::toString(static_cast<int64_t>(util::now().time_since_epoch().count()));
+    test.fileSource->setResourceOptions(ResourceOptions().withGlyphCachePath("test/fixtures/glyph_store"));
+
+    int requests = 0;
+    test.fileSource->glyphsResponse = [&](const Resource& resource) {
+        ++requests;
+        EXPECT_EQ(url, resource.url);
+        Response response;
+        response.data = std::make_shared<std::string>(util::read_file("test/fixtures/resources/glyphs.pbf"));
+        return response;
+    };
+
+    test.requestor.glyphsAvailable = [&](GlyphMap glyphs) {
+        EXPECT_EQ(1, requests);
+        const auto& testPositions = glyphs.at(FontStackHasher()({{"Test Stack"}}));
+        ASSERT_EQ(1u, testPositions.size());
+        EXPECT_TRUE(bool(testPositions.at(u'a')));
+        test.end();
+    };
+
+    test.run(url, GlyphDependencies{{{{"Test Stack"}}, {u'a'}}});
+}
+
 TEST(GlyphManager, LoadLocalCJKGlyph) {
     GlyphManagerTest test;
     int glyphResponses = 0;
 
-    test.fileSource.glyphsResponse = [&](const Resource&) {
+    test.fileSource->glyphsResponse = [&](const Resource&) {
         glyphResponses++;
         return std::optional<Response>();
     };
@@ -316,7 +372,7 @@ TEST(GlyphManager, LoadLocalCJKGlyphAfterLoadingRangeFromURL) {
     GlyphManagerTest test;
     bool firstGlyphResponse = false;
 
-    test.fileSource.glyphsResponse = [&](const Resource&) {
+    test.fileSource->glyphsResponse = [&](const Resource&) {
         firstGlyphResponse = true;
         Response response;
         response.data = std::make_shared<std::string>(
@@ -366,7 +422,7 @@ TEST(GlyphManager, LoadLocalCJKGlyphAfterLoadingRangeFromURL) {
 TEST(GlyphManager, LoadingInvalid) {
     GlyphManagerTest test;
 
-    test.fileSource.glyphsResponse = [&](const Resource& resource) {
+    test.fileSource->glyphsResponse = [&](const Resource& resource) {
         EXPECT_EQ(Resource::Kind::Glyphs, resource.kind);
         Response response;
         response.data = std::make_shared<std::string>(util::read_file("test/fixtures/resources/fake_glyphs-0-255.pbf"));
@@ -400,7 +456,8 @@ TEST(GlyphManager, ImmediateFileSource) {
     class GlyphManagerTestSynchronous {
     public:
         util::RunLoop loop;
-        StubFileSource fileSource = {StubFileSource::ResponseType::Synchronous};
+        std::shared_ptr<StubFileSource> fileSource = std::make_shared<StubFileSource>(
+            StubFileSource::ResponseType::Synchronous);
         StubGlyphManagerObserver observer;
         StubGlyphRequestor requestor;
         GlyphManager glyphManager;
@@ -421,7 +478,7 @@ TEST(GlyphManager, ImmediateFileSource) {
 
     GlyphManagerTestSynchronous test;
 
-    test.fileSource.glyphsResponse = [&](const Resource&) {
+    test.fileSource->glyphsResponse = [&](const Resource&) {
         Response response;
         response.data = std::make_shared<std::string>(util::read_file("test/fixtures/resources/glyphs.pbf"));
         return response;
@@ -0,0 +1,118 @@
+#include <mbgl/test/util.hpp>
+
+#include <mbgl/text/glyph_store.hpp>
+#include <mbgl/util/io.hpp>
+#include <mbgl/util/logging.hpp>
+
+#include <sstream>
+
+using namespace mbgl;
+
+namespace {
+
+const std::string directory = "test/fixtures/glyph_store";
+const std::string url = "mapbox://fonts/{fontstack}/{range}.pbf";
+
+Immutable<Glyph> makeGlyph(GlyphID id, uint32_t size) {
+    auto glyph = makeMutable<Glyph>();
+    glyph->id = id;
+    glyph->metrics.width = size;
+    glyph->metrics.height = size;
+    glyph->metrics.left = 1;
+    glyph->metrics.top = -7;
+    glyph->metrics.advance = size + 2;
+    glyph->bitmap = AlphaImage({size + 2 * Glyph::borderSize, size + 2 * Glyph::borderSize});
+    for (size_t i = 0; i < glyph->bitmap.bytes(); i++) {
+        glyph->bitmap.data[i] = static_cast<uint8_t>(i * id);
+    }
+    return glyph;
+}
+
+} // namespace
+
+TEST(GlyphStore, RoundTrip) {
+    GlyphStore store(directory);
+    const FontStack fontStack{"Test Stack", "Fallback"};
+    const GlyphRange range{0, 255};
+
+    // Space has no bitmap.
+    auto space = makeMutable<Glyph>();
+    space->id = u' ';
+    space->metrics.advance = 6;
+    const std::vector<Immutable<Glyph>> glyphs{makeGlyph(u'a', 12), makeGlyph(u'b', 14), std::move(space)};
+    ASSERT_TRUE(store.save(url, fontStack, range, glyphs));
+
+    auto loaded = store.load(url, fontStack, range);
+    ASSERT_TRUE(loaded);
+    ASSERT_EQ(3u, loaded->size());
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        EXPECT_EQ(glyphs[i]->id, (*loaded)[i].id);
+        EXPECT_EQ(glyphs[i]->metrics, (*loaded)[i].metrics);
+        EXPECT_EQ(glyphs[i]->bitmap, (*loaded)[i].bitmap);
+    }
+    EXPECT_FALSE((*loaded)[2].bitmap.valid());
+}
+
+TEST(GlyphStore, Miss) {
+    GlyphStore store(directory);
+    const FontStack fontStack{"Test Stack"};
+    ASSERT_TRUE(store.save(url, fontStack, {256, 511}, {makeGlyph(300, 10)}));
+
+    EXPECT_TRUE(store.load(url, fontStack, {256, 511}));
+    EXPECT_FALSE(store.load(url, fontStack, {512, 767}));
+    EXPECT_FALSE(store.load(url, FontStack{"Other Stack"}, {256, 511}));
+    EXPECT_FALSE(store.load("https://example.com/{fontstack}/{range}.pbf", fontStack, {256, 511}));
+}
+
+TEST(GlyphStore, Replace) {
+    GlyphStore store(directory);
+    const FontStack fontStack{"Replaced Stack"};
+    const GlyphRange range{0, 255};
+    ASSERT_TRUE(store.save(url, fontStack, range, {makeGlyph(u'a', 12), makeGlyph(u'b', 12)}));
+    ASSERT_TRUE(store.save(url, fontStack, range, {makeGlyph(u'c', 16)}));
+
+    auto loaded = GlyphStore(directory).load(url, fontStack, range);
+    ASSERT_TRUE(loaded);
+    ASSERT_EQ(1u, loaded->size());
+    EXPECT_EQ(u'c', loaded->front().id);
+    EXPECT_EQ(16u, loaded->front().metrics.width);
+}
+
+TEST(GlyphStore, UnwritableDirectory) {
+    Log::setObserver(std::make_unique<Log::NullObserver>());
+    GlyphStore store("test/fixtures/glyph_store/does_not_exist");
+    EXPECT_FALSE(store.save(url, {"Test Stack"}, {0, 255}, {makeGlyph(u'a', 12)}));
+    EXPECT_FALSE(store.load(url, {"Test Stack"}, {0, 255}));
+}
+
+TEST(GlyphStore, MaximumSize) {
+    const FontStack fontStack{"Trimmed Stack"};
+    const auto glyphs = [](GlyphID first) {
+        return std::vector<Immutable<Glyph>>{makeGlyph(first + 1, 10)};
+    };
+
+    // All ranges below have the same size; the last line of the index has it.
+    ASSERT_TRUE(GlyphStore(directory).save(url, fontStack, {0, 255}, glyphs(0)));
+    std::istringstream index(util::read_file(directory + "/index"));
+    std::string name;
+    uint64_t size = 0;
+    while (index >> name >> size) {
+    }
+    ASSERT_LT(0u, size);
+
+    // Room for two and a half ranges: the range saved first is deleted.
+    GlyphStore store(directory, size * 5 / 2);
+    ASSERT_TRUE(store.save(url, fontStack, {0, 255}, glyphs(0)));
+    ASSERT_TRUE(store.save(url, fontStack, {256, 511}, glyphs(256)));
+    ASSERT_TRUE(store.save(url, fontStack, {512, 767}, glyphs(512)));
+    EXPECT_FALSE(store.load(url, fontStack, {0, 255}));
+    EXPECT_TRUE(store.load(url, fontStack, {256, 511}));
+    EXPECT_TRUE(store.load(url, fontStack, {512, 767}));
+
+    // Saving a range again makes it the newest.
+    ASSERT_TRUE(store.save(url, fontStack, {256, 511}, glyphs(256)));
+    ASSERT_TRUE(store.save(url, fontStack, {0, 255}, glyphs(0)));
+    EXPECT_TRUE(store.load(url, fontStack, {0, 255}));
+    EXPECT_TRUE(store.load(url, fontStack, {256, 511}));
+    EXPECT_FALSE(store.load(url, fontStack, {512, 767}));
+}
@@ -9,6 +9,10 @@
 #include <mbgl/renderer/renderer.hpp>
 #include <mbgl/gfx/headless_frontend.hpp>
 #include <mbgl/style/style.hpp>
+#include <mbgl/text/local_glyph_rasterizer.hpp>
+
+#include <cstring>
+#include <filesystem>
 
 /*
     LoadLocalCJKGlyph in glyph_manager.test.cpp exercises the
@@ -165,3 +169,66 @@ TEST(LocalGlyphRasterizer, NoLocalWithContentInsetsAndPitch) {
     test.map.jumpTo(CameraOptions().withPitch(45).withPadding(EdgeInsets{0, viewSize.width * 0.4, 0, 0}));
     test.checkRendering("no_local_with_content_insets_and_pitch", 0.001, 0.1);
 }
+
+#if defined(MBGL_USE_FREETYPE)
+
+namespace {
+
+// The FreeType rasterizer tests need a CJK font, which is not part of the
+// fixtures because of its size. They pass trivially where none is installed.
+std::optional<std::string> installedCJKFont() {
+    for (const char* path : {"/usr/share/fonts/opentype/noto/NotoSansCJK-Regular.ttc",
+                             "/usr/share/fonts/noto-cjk/NotoSansCJK-Regular.ttc",
+                             "/usr/share/fonts/google-noto-cjk/NotoSansCJK-Regular.ttc",
+                             "/usr/share/fonts/truetype/wqy/wqy-microhei.ttc",
+                             "/usr/share/fonts/wenquanyi/wqy-microhei/wqy-microhei.ttc"}) {
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(path, ec)) {
+            return std::string(path);
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+TEST(LocalGlyphRasterizer, FreeTypeDisabled) {
+    LocalGlyphRasterizer rasterizer;
+    EXPECT_FALSE(rasterizer.canRasterizeGlyph({"Open Sans Regular"}, u'中'));
+}
+
+TEST(LocalGlyphRasterizer, FreeTypeUnknownFont) {
+    LocalGlyphRasterizer rasterizer(std::string("No Such Font Family"));
+    EXPECT_FALSE(rasterizer.canRasterizeGlyph({"No Such Font Regular"}, u'中'));
+}
+
+TEST(LocalGlyphRasterizer, FreeTypeFontFile) {
+    const auto font = installedCJKFont();
+    if (!font) return;
+
+    LocalGlyphRasterizer rasterizer(*font);
+    const FontStack fontStack{"Open Sans Regular"};
+
+    // Only ideographs and Hangul are drawn locally.
+    EXPECT_FALSE(rasterizer.canRasterizeGlyph(fontStack, u'A'));
+    ASSERT_TRUE(rasterizer.canRasterizeGlyph(fontStack, u'中'));
+
+    const Glyph glyph = rasterizer.rasterizeGlyph(fontStack, u'中');
+    EXPECT_EQ(u'中', glyph.id);
+    ASSERT_TRUE(glyph.bitmap.valid());
+    EXPECT_GT(glyph.metrics.width, 0u);
+    EXPECT_GT(glyph.metrics.height, 0u);
+    EXPECT_GT(glyph.metrics.advance, 0u);
+    EXPECT_EQ(glyph.metrics.width + 2 * Glyph::borderSize, glyph.bitmap.size.width);
+    EXPECT_EQ(glyph.metrics.height + 2 * Glyph::borderSize, glyph.bitmap.size.height);
+
+    // A second rasterizer is served from the shared cache and gets its own
+    // copy of the same bitmap.
+    LocalGlyphRasterizer other(*font);
+    const Glyph cached = other.rasterizeGlyph(fontStack, u'中');
+    ASSERT_EQ(glyph.bitmap.bytes(), cached.bitmap.bytes());
+    EXPECT_NE(glyph.bitmap.data.get(), cached.bitmap.data.get());
+    EXPECT_EQ(0, std::memcmp(glyph.bitmap.data.get(), cached.bitmap.data.get(), glyph.bitmap.bytes()));
+}
+
+#endif // defined(MBGL_USE_FREETYPE)
@@ -0,0 +1,122 @@
+#include <mbgl/actor/scheduler.hpp>
+#include <mbgl/renderer/update_parameters.hpp>
+#include <mbgl/style/light.hpp>
+#include <mbgl/style/light_impl.hpp>
+#include <mbgl/test/util.hpp>
+#include <mbgl/text/placement.hpp>
+
+#include <mutex>
+#include <thread>
+
+using namespace mbgl;
+
+namespace {
+
+// Keeps scheduled tasks until the test runs them, possibly from another thread.
+class ManualScheduler : public Scheduler {
+public:
+    void schedule(std::function<void()> fn) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(fn));
+    }
+    mapbox::base::WeakPtr<Scheduler> makeWeakPtr() override { return weakFactory.makeWeakPtr(); }
+
+    void runAll() {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(tasks);
+        }
+        for (auto& task : ready) task();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::function<void()>> tasks;
+    mapbox::base::WeakPtrFactory<Scheduler> weakFactory{this};
+};
+
+std::shared_ptr<const UpdateParameters> makeUpdateParameters(TimePoint timePoint) {
+    return std::make_shared<UpdateParameters>(
+        UpdateParameters{true,
+                         MapMode::Continuous,
+                         1.0f,
+                         MapDebugOptions::NoDebug,
+                         timePoint,
+                         TransformState{},
+                         {},
+                         true,
+                         style::TransitionOptions{},
+                         style::Light().impl,
+                         makeMutable<std::vector<Immutable<style::Image::Impl>>>(),
+                         makeMutable<std::vector<Immutable<style::Source::Impl>>>(),
+                         makeMutable<std::vector<Immutable<style::Layer::Impl>>>(),
+                         {},
+                         nullptr,
+                         0,
+                         false,
+                         false,
+                         {}});
+}
+
+} // namespace
+
+TEST(PlacementController, PendingBackgroundPlacement) {
+    auto scheduler = std::make_shared<ManualScheduler>();
+    PlacementController controller(scheduler);
+    controller.setBackgroundPlacement(true, Seconds(1));
+
+    const TimePoint start = Clock::now();
+    const Placement* previous = controller.getPlacement().get();
+    Mutable<Placement> placement = Placement::create(makeUpdateParameters(start), controller.getPlacement());
+    const Placement* started = placement.get();
+    controller.startDeferredPlacement(std::move(placement), {}, start);
+
+    // The placement hasn't run yet when the next frame arrives, which keeps
+    // using the previous placement.
+    EXPECT_FALSE(controller.commitPendingPlacement(start + Milliseconds(16)));
+    EXPECT_TRUE(controller.hasPendingPlacement());
+    EXPECT_EQ(previous, controller.getPlacement().get());
+
+    // The frame after it completed commits it.
+    scheduler->runAll();
+    EXPECT_TRUE(controller.commitPendingPlacement(start + Milliseconds(32)));
+    EXPECT_FALSE(controller.hasPendingPlacement());
+    EXPECT_EQ(started, controller.getPlacement().get());
+    EXPECT_EQ(2u, controller.getLastPlacementFrameCount());
+}
+
+TEST(PlacementController, StaleBackgroundPlacementIsWaitedFor) {
+    auto scheduler = std::make_shared<ManualScheduler>();
+    PlacementController controller(scheduler);
+    controller.setBackgroundPlacement(true, Milliseconds(100));
+
+    const TimePoint start = Clock::now();
+    Mutable<Placement> placement = Placement::create(makeUpdateParameters(start), controller.getPlacement());
+    const Placement* started = placement.get();
+    controller.startDeferredPlacement(std::move(placement), {}, start);
+    EXPECT_FALSE(controller.commitPendingPlacement(start + Milliseconds(16)));
+
+    // Past the maximum staleness, the frame waits for the placement, which
+    // only runs once the frame has started waiting.
+    std::thread worker([&] {
+        std::this_thread::sleep_for(Milliseconds(20));
+        scheduler->runAll();
+    });
+    EXPECT_TRUE(controller.commitPendingPlacement(start + Milliseconds(200)));
+    worker.join();
+
+    EXPECT_FALSE(controller.hasPendingPlacement());
+    EXPECT_EQ(started, controller.getPlacement().get());
+
+    // The next placement starts from the committed one.
+    Mutable<Placement> next = Placement::create(makeUpdateParameters(start + Milliseconds(300)),
+                                                controller.getPlacement());
+    const Placement* nextStarted = next.get();
+    controller.startDeferredPlacement(std::move(next), {}, start + Milliseconds(300));
+    EXPECT_FALSE(controller.commitPendingPlacement(start + Milliseconds(316)));
+    EXPECT_EQ(started, controller.getPlacement().get());
+    scheduler->runAll();
+    EXPECT_TRUE(controller.commitPendingPlacement(start + Milliseconds(332)));
+    EXPECT_EQ(nextStarted, controller.getPlacement().get());
+}
@@ -51,8 +51,67 @@ TEST(GridIndex, CircleBox) {
     EXPECT_EQ(grid.query({{0, 80}, {20, 100}}), (std::vector<int16_t>{2}));
 }
 
+TEST(GridIndex, HitTestPredicate) {
+    GridIndex<int16_t> grid(100, 100, 10);
+    grid.insert(0, {{10, 10}, {20, 20}});
+    grid.insert(1, {{15, 15}, {25, 25}});
+    grid.insert(2, {{50, 50}, 10});
+
+    const auto isOdd = [](const int16_t key) { return key % 2 == 1; };
+    EXPECT_TRUE(grid.hitTest({{12, 12}, {18, 18}}, isOdd));
+    EXPECT_FALSE(grid.hitTest({{10, 10}, {12, 12}}, isOdd));
+    EXPECT_FALSE(grid.hitTest({{50, 50}, 5}, isOdd));
+    EXPECT_TRUE(grid.hitTest({{50, 50}, 5}, [](const int16_t key) { return key == 2; }));
+    EXPECT_TRUE(grid.hitTest({{50, 50}, 5}));
+}
+
 TEST(GridIndex, IndexesFeaturesOverflow) {
     GridIndex<int16_t> grid(5000, 5000, 25);
     grid.insert(0, {{4500, 4500}, {4900, 4900}});
     EXPECT_EQ(grid.query({{4000, 4000}, {5000, 5000}}), (std::vector<int16_t>{0}));
 }
+
+TEST(GridIndex, BatchInsertCircles) {
+    using BCircle = GridIndex<int16_t>::BCircle;
+    GridIndex<int16_t> grid(100, 100, 10);
+    grid.insert(0, std::vector<BCircle>{{{10, 10}, 5}, {{30, 10}, 5}, {{50, 10}, 5}});
+    grid.insert(1, std::vector<BCircle>{});
+    grid.insert(2, {{50, 50}, 5});
+
+    EXPECT_EQ(grid.query({{0, 0}, {100, 20}}), (std::vector<int16_t>{0, 0, 0}));
+    EXPECT_EQ(grid.query({{25, 5}, {35, 15}}), (std::vector<int16_t>{0}));
+    EXPECT_EQ(grid.query({{45, 45}, {55, 55}}), (std::vector<int16_t>{2}));
+    EXPECT_TRUE(grid.hitTest({{30, 20}, 6}));
+    EXPECT_FALSE(grid.hitTest({{30, 30}, 6}));
+}
+
+TEST(GridIndex, QueryCallback) {
+    using BBox = GridIndex<int16_t>::BBox;
+    using BCircle = GridIndex<int16_t>::BCircle;
+    GridIndex<int16_t> grid(100, 100, 10);
+    // Spans many cells, but must only be reported once per query.
+    grid.insert(0, {{5, 5}, {95, 95}});
+    grid.insert(1, {{40, 40}, {45, 45}});
+    grid.insert(2, {{50, 50}, 5});
+
+    std::vector<int16_t> seen;
+    grid.query(BBox{{30, 30}, {60, 60}}, [&](const int16_t& key, const BBox&) {
+        seen.push_back(key);
+        return false;
+    });
+    EXPECT_EQ(seen, (std::vector<int16_t>{0, 1, 2}));
+
+    seen.clear();
+    grid.query(BBox{{30, 30}, {60, 60}}, [&](const int16_t& key, const BBox&) {
+        seen.push_back(key);
+        return key == 1;
+    });
+    EXPECT_EQ(seen, (std::vector<int16_t>{0, 1}));
+
+    seen.clear();
+    grid.query(BCircle{{50, 50}, 1}, [&](const int16_t& key, const BBox&) {
+        seen.push_back(key);
+        return false;
+    });
+    EXPECT_EQ(seen, (std::vector<int16_t>{0, 2}));
+}
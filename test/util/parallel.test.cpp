@@ -0,0 +1,85 @@
+#include <mbgl/util/parallel.hpp>
+
+#include <mbgl/actor/scheduler.hpp>
+#include <mbgl/test/util.hpp>
+
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+using namespace mbgl;
+using namespace mbgl::util;
+
+namespace {
+
+// Keeps scheduled tasks until `runAll()` is called.
+class DeferredScheduler : public Scheduler {
+public:
+    void schedule(std::function<void()> fn) override { tasks.push_back(std::move(fn)); }
+    mapbox::base::WeakPtr<Scheduler> makeWeakPtr() override { return weakFactory.makeWeakPtr(); }
+
+    void runAll() {
+        for (auto& task : tasks) task();
+        tasks.clear();
+    }
+
+    std::vector<std::function<void()>> tasks;
+
+private:
+    mapbox::base::WeakPtrFactory<Scheduler> weakFactory{this};
+};
+
+} // namespace
+
+TEST(Parallel, MatchesSerialResult) {
+    const std::size_t count = 1000;
+    std::vector<uint64_t> serial(count);
+    for (std::size_t i = 0; i < count; ++i) serial[i] = i * i;
+
+    std::vector<uint64_t> parallel(count);
+    std::vector<std::atomic<int>> calls(count);
+    auto scheduler = getRenderHelperScheduler();
+    runInParallel(*scheduler, renderHelperThreads, count, [&](std::size_t i) {
+        parallel[i] = i * i;
+        ++calls[i];
+    });
+
+    EXPECT_EQ(serial, parallel);
+    for (const auto& n : calls) EXPECT_EQ(1, n.load());
+}
+
+TEST(Parallel, CallerTakesWorkItself) {
+    // The helper tasks only run after runInParallel() has returned, so the
+    // calling thread must have done all of the work.
+    DeferredScheduler scheduler;
+    std::vector<std::size_t> done;
+    runInParallel(scheduler, 3, 10, [&](std::size_t i) { done.push_back(i); });
+
+    std::vector<std::size_t> expected(10);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, done);
+    EXPECT_EQ(3u, scheduler.tasks.size());
+
+    // Late helpers find nothing left to do.
+    scheduler.runAll();
+    EXPECT_EQ(expected, done);
+}
+
+TEST(Parallel, SmallCountsRunInline) {
+    DeferredScheduler scheduler;
+    std::size_t calls = 0;
+    runInParallel(scheduler, 3, 0, [&](std::size_t) { ++calls; });
+    EXPECT_EQ(0u, calls);
+    runInParallel(scheduler, 3, 1, [&](std::size_t) { ++calls; });
+    EXPECT_EQ(1u, calls);
+    runInParallel(scheduler, 0, 5, [&](std::size_t) { ++calls; });
+    EXPECT_EQ(6u, calls);
+    EXPECT_TRUE(scheduler.tasks.empty());
+}
+
+TEST(Parallel, RenderHelperSchedulerIsShared) {
+    auto first = getRenderHelperScheduler();
+    auto second = getRenderHelperScheduler();
+    EXPECT_EQ(first, second);
+    EXPECT_NE(Scheduler::GetBackground(), first);
+}
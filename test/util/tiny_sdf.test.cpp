@@ -0,0 +1,152 @@
+#include <mbgl/test/util.hpp>
+
+#include <mbgl/util/tiny_sdf.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace mbgl;
+
+namespace {
+
+// The double precision Felzenszwalb & Huttenlocher transform that
+// transformRasterToSDF used before it switched to float, kept as a reference.
+const double INF = 1e20;
+
+void edt1d(std::vector<double>& f, std::vector<double>& d, std::vector<int16_t>& v, std::vector<double>& z, uint32_t n) {
+    v[0] = 0;
+    z[0] = -INF;
+    z[1] = +INF;
+
+    for (uint32_t q = 1, k = 0; q < n; q++) {
+        double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = +INF;
+    }
+
+    for (uint32_t q = 0, k = 0; q < n; q++) {
+        while (z[k + 1] < q) k++;
+        d[q] = (static_cast<double>(q) - v[k]) * (static_cast<double>(q) - v[k]) + f[v[k]];
+    }
+}
+
+void edt(std::vector<double>& data, uint32_t width, uint32_t height) {
+    const uint32_t maxDimension = std::max(width, height);
+    std::vector<double> f(maxDimension);
+    std::vector<double> d(maxDimension);
+    std::vector<double> z(maxDimension + 1);
+    std::vector<int16_t> v(maxDimension);
+
+    for (uint32_t x = 0; x < width; x++) {
+        for (uint32_t y = 0; y < height; y++) {
+            f[y] = data[y * width + x];
+        }
+        edt1d(f, d, v, z, height);
+        for (uint32_t y = 0; y < height; y++) {
+            data[y * width + x] = d[y];
+        }
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            f[x] = data[y * width + x];
+        }
+        edt1d(f, d, v, z, width);
+        for (uint32_t x = 0; x < width; x++) {
+            data[y * width + x] = std::sqrt(d[x]);
+        }
+    }
+}
+
+AlphaImage referenceSDF(const AlphaImage& rasterInput, double radius, double cutoff) {
+    const uint32_t size = rasterInput.size.width * rasterInput.size.height;
+    AlphaImage sdf(rasterInput.size);
+
+    std::vector<double> gridOuter(size);
+    std::vector<double> gridInner(size);
+    for (uint32_t i = 0; i < size; i++) {
+        double a = static_cast<double>(rasterInput.data[i]) / 255;
+        gridOuter[i] = a == 1.0 ? 0.0 : a == 0.0 ? INF : std::pow(std::max(0.0, 0.5 - a), 2.0);
+        gridInner[i] = a == 1.0 ? INF : a == 0.0 ? 0.0 : std::pow(std::max(0.0, a - 0.5), 2.0);
+    }
+
+    edt(gridOuter, rasterInput.size.width, rasterInput.size.height);
+    edt(gridInner, rasterInput.size.width, rasterInput.size.height);
+
+    for (uint32_t i = 0; i < size; i++) {
+        double distance = gridOuter[i] - gridInner[i];
+        sdf.data[i] = static_cast<uint8_t>(
+            std::max(0l, std::min(255l, ::lround(255.0 - 255.0 * (distance / radius + cutoff)))));
+    }
+    return sdf;
+}
+
+// An antialiased ring, roughly the shape and size of a rasterized glyph.
+AlphaImage ring(Size size) {
+    AlphaImage image(size);
+    const double cx = size.width / 2.0;
+    const double cy = size.height / 2.0;
+    const double outer = std::min(cx, cy) - 4;
+    for (uint32_t y = 0; y < size.height; y++) {
+        for (uint32_t x = 0; x < size.width; x++) {
+            const double r = std::hypot(x + 0.5 - cx, y + 0.5 - cy);
+            const double coverage = std::min(std::clamp(outer - r + 0.5, 0.0, 1.0),
+                                             std::clamp(r - outer / 2 + 0.5, 0.0, 1.0));
+            image.data[y * size.width + x] = static_cast<uint8_t>(std::lround(coverage * 255));
+        }
+    }
+    return image;
+}
+
+void expectMatchesReference(const AlphaImage& raster, double radius = 8, double cutoff = .25) {
+    const AlphaImage expected = referenceSDF(raster, radius, cutoff);
+    const AlphaImage actual = util::transformRasterToSDF(raster, radius, cutoff);
+    ASSERT_EQ(expected.size, actual.size);
+
+    // Single precision may round a few values the other way.
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < expected.bytes(); i++) {
+        EXPECT_LE(std::abs(int(expected.data[i]) - int(actual.data[i])), 1) << "at " << i;
+        mismatches += expected.data[i] != actual.data[i];
+    }
+    EXPECT_LE(mismatches, expected.bytes() / 100);
+}
+
+} // namespace
+
+TEST(TinySDF, MatchesReferenceGlyph) {
+    expectMatchesReference(ring({30, 30}));
+    expectMatchesReference(ring({23, 37}));
+}
+
+TEST(TinySDF, MatchesReferenceLarge) {
+    expectMatchesReference(ring({100, 80}));
+    // A radius this large falls back to the lower envelope algorithm.
+    expectMatchesReference(ring({100, 80}), 40, .5);
+}
+
+TEST(TinySDF, MatchesReferenceNoise) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> value(0, 3);
+    AlphaImage raster({31, 29});
+    for (std::size_t i = 0; i < raster.bytes(); i++) {
+        // Mostly fully transparent or opaque pixels, with some partial coverage.
+        const int v = value(generator);
+        raster.data[i] = v == 0 ? 0 : v == 1 ? 255 : static_cast<uint8_t>(generator() % 256);
+    }
+    expectMatchesReference(raster);
+}
+
+TEST(TinySDF, Empty) {
+    AlphaImage raster({24, 24});
+    std::fill(raster.data.get(), raster.data.get() + raster.bytes(), 0);
+    expectMatchesReference(raster);
+    EXPECT_EQ(0u, util::transformRasterToSDF(AlphaImage({0, 0}), 8, .25).bytes());
+}